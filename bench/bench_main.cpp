@@ -0,0 +1,384 @@
+// Microbenchmarks for the core paths; results are written as JSON.
+#include "program_gen.h"
+#include "kernels.h"
+#include "../include/parser.h"
+#include "../include/executor.h"
+#include "../include/decode_batch.h"
+#include "../include/lockstep_engine.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    std::string unit;       // what one "op" is
+    uint64_t iterations;
+    uint64_t ops;
+    double seconds;
+};
+
+// Discards everything written to it (used to silence syscall output)
+struct NullBuffer : std::streambuf {
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+volatile uint64_t g_sink = 0;
+
+class BenchRunner {
+public:
+    BenchRunner(double min_time, std::string filter) : min_time(min_time), filter(std::move(filter)) {}
+
+    // Run `body` (which performs `ops_per_iter` ops) until min_time has elapsed
+    template <typename F>
+    void run(const std::string& name, const std::string& unit, uint64_t ops_per_iter, F&& body) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+
+        body(); // warm-up
+        uint64_t iterations = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        do {
+            body();
+            ++iterations;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < min_time);
+
+        results.push_back({name, unit, iterations, iterations * ops_per_iter, elapsed});
+        std::cerr << std::left << std::setw(28) << name << std::right << std::setw(16) << std::fixed
+                  << std::setprecision(0) << (results.back().ops / elapsed) << " " << unit << "/s\n";
+    }
+
+    void write_json(std::ostream& out) const {
+        out << "{\n  \"suite\": \"mips_bench\",\n  \"min_time\": " << min_time << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            double rate = r.seconds > 0 ? r.ops / r.seconds : 0.0;
+            double ns = r.ops > 0 ? r.seconds * 1e9 / r.ops : 0.0;
+            out << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit
+                << "\", \"iterations\": " << r.iterations << ", \"ops\": " << r.ops
+                << std::setprecision(6) << std::fixed
+                << ", \"seconds\": " << r.seconds << ", \"ops_per_sec\": " << rate
+                << ", \"ns_per_op\": " << ns << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    double min_time;
+    std::string filter;
+    std::vector<BenchResult> results;
+};
+
+void bench_codec(BenchRunner& runner) {
+    ProgramGenerator gen(42);
+    GeneratedProgram prog = gen.generate(4096);
+    std::vector<uint32_t> words;
+    for (const Instruction& instr : prog.instructions) {
+        words.push_back(InstructionUtils::encode(instr));
+    }
+
+    runner.run("decode", "instr", words.size(), [&] {
+        uint64_t acc = 0;
+        for (uint32_t w : words) acc += InstructionUtils::decode(w).index();
+        g_sink += acc;
+    });
+    runner.run("predecode", "instr", words.size(), [&] {
+        uint64_t acc = 0;
+        for (uint32_t w : words) acc += InstructionUtils::predecode(w).imm;
+        g_sink += acc;
+    });
+
+    // 4 MiB text segment, decoded whole on every backend
+    std::vector<uint32_t> image;
+    while (image.size() < (1u << 20)) image.insert(image.end(), words.begin(), words.end());
+    DecodedFields fields;
+    for (DecodeBackend backend : {DecodeBackend::SCALAR, DecodeBackend::SSE2, DecodeBackend::AVX2}) {
+        if (!BatchDecoder::backend_available(backend)) continue;
+        runner.run(std::string("decode_batch/") + BatchDecoder::backend_name(backend), "instr", image.size(), [&] {
+            BatchDecoder::decode(image.data(), image.size(), fields, backend);
+            g_sink += fields.op[fields.size() / 2];
+        });
+    }
+    runner.run("encode", "instr", prog.instructions.size(), [&] {
+        uint64_t acc = 0;
+        for (const Instruction& instr : prog.instructions) acc += InstructionUtils::encode(instr);
+        g_sink += acc;
+    });
+}
+
+void bench_memory(BenchRunner& runner) {
+    constexpr uint32_t kAccesses = 65536;
+    machine_state state;
+
+    runner.run("memory/read32", "access", kAccesses, [&] {
+        uint64_t acc = 0;
+        for (uint32_t i = 0; i < kAccesses; ++i) acc += state.read_memory32((i * 4) & 0x3FFFC);
+        g_sink += acc;
+    });
+    runner.run("memory/write32", "access", kAccesses, [&] {
+        for (uint32_t i = 0; i < kAccesses; ++i) state.write_memory32((i * 4) & 0x3FFFC, i);
+    });
+
+    if (!GuestMemory::backend_available(MemoryBackend::GUARDED)) return;
+    machine_state guarded(1024 * 1024, MemoryBackend::GUARDED);
+    runner.run("memory/read32/guarded", "access", kAccesses, [&] {
+        uint64_t acc = 0;
+        for (uint32_t i = 0; i < kAccesses; ++i) acc += guarded.load32((i * 4) & 0x3FFFC);
+        g_sink += acc;
+    });
+    runner.run("memory/write32/guarded", "access", kAccesses, [&] {
+        for (uint32_t i = 0; i < kAccesses; ++i) guarded.store32((i * 4) & 0x3FFFC, i);
+    });
+}
+
+void bench_execute(BenchRunner& runner) {
+    auto t = [](Register r) { return static_cast<uint8_t>(r); };
+    const uint8_t t0 = t(Register::T0), t1 = t(Register::T1), t2 = t(Register::T2);
+
+    struct OpClass {
+        std::string name;
+        std::vector<Instruction> instrs;
+    };
+    std::vector<OpClass> classes = {
+        {"alu_r", {RInstruction(t0, t1, t2, 0, FunctionCode::ADDU), RInstruction(t0, t1, t2, 0, FunctionCode::XOR),
+                   RInstruction(t0, t1, t2, 0, FunctionCode::SLT), RInstruction(0, t1, t2, 3, FunctionCode::SLL)}},
+        {"alu_i", {IInstruction(Opcode::ADDI, t0, t2, 7), IInstruction(Opcode::ORI, t0, t2, 0xFF),
+                   IInstruction(Opcode::SLTI, t0, t2, 100), IInstruction(Opcode::LHI, 0, t2, 0x1234)}},
+        {"load",  {IInstruction(Opcode::LW, 0, t2, 0x100), IInstruction(Opcode::LB, 0, t2, 0x104),
+                   IInstruction(Opcode::LHU, 0, t2, 0x108), IInstruction(Opcode::LBU, 0, t2, 0x10C)}},
+        {"store", {IInstruction(Opcode::SW, 0, t0, 0x100), IInstruction(Opcode::SB, 0, t0, 0x104),
+                   IInstruction(Opcode::SH, 0, t0, 0x108), IInstruction(Opcode::SW, 0, t1, 0x10C)}},
+        {"branch", {IInstruction(Opcode::BEQ, t0, t1, 1), IInstruction(Opcode::BNE, t0, t1, 1),
+                    IInstruction(Opcode::BLEZ, t0, 0, 1), IInstruction(Opcode::BGTZ, t0, 0, 1)}},
+        {"jump",  {JInstruction(Opcode::J, 0x40), JInstruction(Opcode::JAL, 0x80),
+                   RInstruction(t(Register::RA), 0, 0, 0, FunctionCode::JR), JInstruction(Opcode::J, 0x10)}},
+        {"hilo",  {RInstruction(t0, t1, 0, 0, FunctionCode::MULT), RInstruction(0, 0, t2, 0, FunctionCode::MFLO),
+                   RInstruction(t0, t1, 0, 0, FunctionCode::DIVU), RInstruction(0, 0, t2, 0, FunctionCode::MFHI)}},
+    };
+
+    constexpr int kRepeat = 1024;
+    for (const OpClass& cls : classes) {
+        machine_state state;
+        InstructionExecutor executor;
+        state.set_register(Register::T0, 12345);
+        state.set_register(Register::T1, 678);
+        runner.run("execute/" + cls.name, "instr", kRepeat * cls.instrs.size(), [&] {
+            for (int r = 0; r < kRepeat; ++r) {
+                state.set_pc(0x200);
+                for (const Instruction& instr : cls.instrs) executor.execute(state, instr);
+            }
+        });
+    }
+}
+
+void bench_parser(BenchRunner& runner) {
+    ProgramGenerator gen(7);
+    GeneratedProgram prog = gen.generate(2000);
+    uint64_t lines = 0;
+    for (char c : prog.assembly) lines += (c == '\n');
+
+    runner.run("parse_assembly", "line", lines, [&] {
+        Parser parser;
+        ParseResult res = parser.parse_assembly(prog.assembly);
+        g_sink += res.lines.size();
+    });
+
+    // Encoding the image into a vector (then loading it) vs. into guest memory
+    Parser parser;
+    ParseResult parsed = parser.parse_assembly(prog.assembly);
+    runner.run("generate_binary/vector", "line", lines, [&] {
+        machine_state state(1024 * 1024);
+        state.load_memory(0, parser.generate_binary(parsed));
+        g_sink += state.read_memory8(0);
+    });
+    runner.run("generate_binary/memory", "line", lines, [&] {
+        machine_state state(1024 * 1024);
+        MemoryEmitter emitter(state);
+        parser.generate_binary(parsed, emitter);
+        g_sink += state.read_memory8(0);
+    });
+}
+
+// Executor configurations compared on every kernel
+struct RunVariant {
+    const char* suffix;
+    MemoryBackend memory;
+    ExecutionMode mode;
+};
+
+const RunVariant kRunVariants[] = {
+    {"", MemoryBackend::CHECKED, ExecutionMode::STEP},
+    {"/guarded", MemoryBackend::GUARDED, ExecutionMode::STEP},
+    {"/blocks", MemoryBackend::CHECKED, ExecutionMode::BLOCK},
+};
+
+void bench_kernels(BenchRunner& runner) {
+    NullBuffer null_buffer;
+    for (const Kernel& k : benchmark_kernels()) {
+        Parser parser;
+        std::vector<uint8_t> bin = parser.generate_binary(parser.parse_assembly(k.assembly));
+        std::string image(bin.begin(), bin.end());
+
+        std::streambuf* saved = std::cout.rdbuf(&null_buffer);
+        for (const RunVariant& v : kRunVariants) {
+            if (!GuestMemory::backend_available(v.memory)) continue;
+
+            ExecutorOptions options;
+            options.max_steps = k.max_steps;
+            options.memory = v.memory;
+            options.mode = v.mode;
+            runner.run("run/" + k.name + v.suffix, "run", 1, [&] {
+                Executor exe;
+                std::istringstream in(image);
+                machine_state final_state = exe.run_stream(in, options);
+                g_sink += final_state.get_pc();
+            });
+        }
+        std::cout.rdbuf(saved);
+    }
+}
+
+// One image over many inputs: separate Executor runs against lockstep lanes
+void bench_lockstep(BenchRunner& runner) {
+    struct LaneKernel {
+        const char* name;
+        const char* assembly;
+    };
+    const LaneKernel kernels[] = {
+        // Same trip count on every lane, different data
+        {"hash", R"(
+            .text
+            main:
+                trap 3
+                add  $t0, $v0, $zero
+                addi $t1, $zero, 2000
+            loop:
+                sll  $t2, $t0, 13
+                xor  $t0, $t0, $t2
+                srl  $t2, $t0, 17
+                xor  $t0, $t0, $t2
+                sll  $t2, $t0, 5
+                xor  $t0, $t0, $t2
+                addi $t1, $t1, -1
+                bne  $t1, $zero, loop
+                add  $a0, $t0, $zero
+                trap 0
+                trap 5
+        )"},
+        // Collatz: lanes diverge on every step
+        {"collatz", R"(
+            .text
+            main:
+                trap 3
+                add  $s0, $v0, $zero
+                addi $t9, $zero, 1
+            loop:
+                beq  $s0, $t9, done
+                andi $t0, $s0, 1
+                beq  $t0, $zero, even
+                sll  $t1, $s0, 1
+                add  $s0, $s0, $t1
+                addi $s0, $s0, 1
+                j    loop
+            even:
+                sra  $s0, $s0, 1
+                j    loop
+            done:
+                trap 5
+        )"},
+    };
+
+    std::vector<std::string> inputs;
+    for (int i = 0; i < 64; ++i) inputs.push_back(std::to_string(i * 7919 + 27) + "\n");
+
+    NullBuffer null_buffer;
+    for (const LaneKernel& k : kernels) {
+        Parser parser;
+        std::vector<uint8_t> bin = parser.generate_binary(parser.parse_assembly(k.assembly));
+        std::string image(bin.begin(), bin.end());
+
+        std::streambuf* saved_out = std::cout.rdbuf(&null_buffer);
+        runner.run(std::string("lockstep/") + k.name + "/executor", "run", inputs.size(), [&] {
+            for (const std::string& input : inputs) {
+                std::istringstream in(input);
+                std::streambuf* saved_in = std::cin.rdbuf(in.rdbuf());
+                Executor exe;
+                std::istringstream bin_in(image);
+                g_sink += exe.run_stream(bin_in, 1000000ULL).get_pc();
+                std::cin.rdbuf(saved_in);
+            }
+        });
+        std::cout.rdbuf(saved_out);
+
+        LockstepEngine engine(bin, 0);
+        for (DecodeBackend backend : {DecodeBackend::SCALAR, DecodeBackend::SSE2, DecodeBackend::AVX2}) {
+            if (!BatchDecoder::backend_available(backend)) continue;
+            engine.set_backend(backend);
+            runner.run(std::string("lockstep/") + k.name + "/" + BatchDecoder::backend_name(backend), "run",
+                       inputs.size(), [&] {
+                std::vector<LaneResult> results = engine.run(inputs, 1000000ULL, 16);
+                g_sink += results.back().pc;
+            });
+        }
+    }
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage:\n";
+    std::cerr << "  " << prog << " [-t <seconds>] [-f <filter>] [-o <out.json>]\n";
+    std::cerr << "    -t  minimum time per benchmark (default 0.2)\n";
+    std::cerr << "    -f  only run benchmarks whose name contains <filter>\n";
+    std::cerr << "    -o  write JSON results to a file instead of stdout\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double min_time = 0.2;
+    std::string filter;
+    std::string out_file;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            min_time = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_file = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        BenchRunner runner(min_time, filter);
+        bench_codec(runner);
+        bench_memory(runner);
+        bench_execute(runner);
+        bench_parser(runner);
+        bench_kernels(runner);
+        bench_lockstep(runner);
+
+        if (out_file.empty()) {
+            runner.write_json(std::cout);
+        } else {
+            std::ofstream ofs(out_file);
+            if (!ofs) {
+                std::cerr << "Cannot open output file: " << out_file << std::endl;
+                return 2;
+            }
+            runner.write_json(ofs);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark error: " << e.what() << std::endl;
+        return 2;
+    }
+}
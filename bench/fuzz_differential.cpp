@@ -0,0 +1,278 @@
+// Differential fuzzer: runs random programs through every engine and compares final states.
+#include "program_gen.h"
+#include "../include/interpreter.h"
+#include "../include/executor.h"
+#include "../include/lockstep_engine.h"
+#include "../include/vm.h"
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// Every engine runs a program to at most this many instructions
+constexpr uint64_t kMaxSteps = 100000;
+
+// Outcome of running one program on one engine
+struct EngineRun {
+    bool faulted = false;
+    std::string error;
+    GuestFault fault;               // the guest fault behind `error`; cause NONE for limits
+    uint64_t steps = 0;             // instructions executed, as the engine counts them
+    machine_state state{0};
+    bool has_memory = true;         // false: `state` holds only registers, hi, lo and pc
+};
+
+// A program loaded by Engine::load. Only `run` is timed; `collect`, if
+// set, then copies out what the comparison needs.
+struct LoadedRun {
+    std::function<void(EngineRun&)> run;
+    std::function<void(EngineRun&)> collect;
+};
+
+struct Engine {
+    std::string name;
+    std::function<LoadedRun(const GeneratedProgram&)> load;
+    double seconds = 0.0;
+    uint64_t instructions = 0;
+};
+
+// Executor in `mode` over `memory`, the program parsed up front
+Engine executor_engine(const std::string& name, ExecutionMode mode, MemoryBackend memory) {
+    return {name, [mode, memory](const GeneratedProgram& p) -> LoadedRun {
+        std::istringstream in(std::string(p.binary.begin(), p.binary.end()));
+        std::shared_ptr<const Program> program = Program::load(in);
+        return {[program, mode, memory](EngineRun& run) {
+            ResourceUsage usage;
+            ExecutorOptions options;
+            options.max_steps = kMaxSteps;
+            options.mode = mode;
+            options.memory = memory;
+            options.usage = &usage;
+            try {
+                run.state = Executor().run(*program, options);
+            } catch (const std::exception& ex) {
+                run.faulted = true;
+                run.error = ex.what();
+            }
+            run.steps = usage.instructions;
+            run.fault = usage.fault;
+        }};
+    }};
+}
+
+std::vector<Engine> make_engines() {
+    std::vector<Engine> engines;
+    engines.push_back({"interpreter", [](const GeneratedProgram& p) -> LoadedRun {
+        Parser parser;
+        ParseResult parsed = parser.parse_assembly(p.assembly);
+        auto source = std::make_shared<AssembledSource>();
+        source->main_address = parsed.main_address;
+        source->has_main = parsed.has_main;
+        source->image = std::make_shared<const SharedImage>(parser.generate_binary(parsed));
+        auto interp = std::make_shared<Interpreter>();
+        return {[source, interp](EngineRun& run) {
+            ResourceUsage usage;
+            interp->set_usage(&usage);
+            try {
+                run.state = interp->run(*source, kMaxSteps);
+            } catch (const std::exception& ex) {
+                run.faulted = true;
+                run.error = ex.what();
+            }
+            run.steps = usage.instructions;
+            run.fault = usage.fault;
+        }};
+    }});
+    engines.push_back(executor_engine("executor", ExecutionMode::STEP, MemoryBackend::CHECKED));
+    engines.push_back(executor_engine("executor/blocks", ExecutionMode::BLOCK, MemoryBackend::CHECKED));
+    if (GuestMemory::backend_available(MemoryBackend::GUARDED)) {
+        engines.push_back(executor_engine("executor/guarded", ExecutionMode::STEP, MemoryBackend::GUARDED));
+    }
+    // One lane: the vector ALU path with a group that never diverges
+    engines.push_back({"lockstep", [](const GeneratedProgram& p) -> LoadedRun {
+        auto engine = std::make_shared<LockstepEngine>(p.binary, 0);
+        return {[engine](EngineRun& run) {
+            LaneResult lane = std::move(engine->run({""}, kMaxSteps, 1).front());
+            run.faulted = !lane.error.empty();
+            run.error = lane.error;
+            run.fault = lane.fault;
+            run.steps = lane.steps;
+            for (uint8_t r = 0; r < 32; ++r) run.state.set_register(static_cast<Register>(r), lane.registers[r]);
+            run.state.set_pc(lane.pc);
+            run.state.set_hi(lane.hi);
+            run.state.set_lo(lane.lo);
+            run.has_memory = false;
+        }};
+    }});
+    engines.push_back({"vm", [](const GeneratedProgram& p) -> LoadedRun {
+        std::istringstream in(std::string(p.binary.begin(), p.binary.end()));
+        auto vm = std::make_shared<Vm>();
+        vm->load(in);
+        return {[vm](EngineRun& run) {
+            RunStop stop = vm->step(kMaxSteps);
+            if (stop == RunStop::FAULTED) {
+                run.faulted = true;
+                run.error = vm->fault_message();
+                run.fault = vm->state().fault();
+            } else if (stop != RunStop::EXITED) {
+                run.faulted = true;
+                run.error = "Executor error: reached maximum instruction count limit.";
+            }
+            run.steps = vm->steps();
+        }, [vm](EngineRun& run) { run.state = vm->state(); }};
+    }});
+    return engines;
+}
+
+// FNV-1a over the whole guest memory
+uint64_t memory_hash(const machine_state& state) {
+    uint64_t h = 1469598103934665603ULL;
+    size_t size = state.get_memory_size() & ~size_t{3};
+    for (size_t addr = 0; addr < size; addr += 4) {
+        h ^= state.read_memory32(static_cast<uint32_t>(addr));
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string hex(uint32_t v) {
+    std::ostringstream os;
+    os << "0x" << std::hex << std::setw(8) << std::setfill('0') << v;
+    return os.str();
+}
+
+// The message as Executor words it; Interpreter has its own for fetch
+// faults and the step limit
+std::string executor_wording(const std::string& error) {
+    static const std::string kFetch = "Interpreter error: PC points outside valid memory at address ";
+    if (error.compare(0, kFetch.size(), kFetch) == 0) {
+        return "Executor error: PC out of bounds at " + error.substr(kFetch.size());
+    }
+    if (error == "Interpreter error: reached maximum instruction count limit.") {
+        return "Executor error: reached maximum instruction count limit.";
+    }
+    return error;
+}
+
+// Describe the first difference between two runs, or return "" if they agree.
+std::string compare_runs(const EngineRun& a, const EngineRun& b) {
+    if (a.faulted || b.faulted) {
+        if (a.faulted != b.faulted) {
+            return "fault mismatch: " + (a.faulted ? a.error : std::string("ok")) +
+                   " vs " + (b.faulted ? b.error : std::string("ok"));
+        }
+        if (executor_wording(a.error) != executor_wording(b.error)) {
+            return "error: " + a.error + " vs " + b.error;
+        }
+        if (a.fault.cause != b.fault.cause) {
+            return "fault cause: " + std::to_string(static_cast<int>(a.fault.cause)) + " vs " +
+                   std::to_string(static_cast<int>(b.fault.cause));
+        }
+        if (a.fault.epc != b.fault.epc) {
+            return "fault EPC: " + hex(a.fault.epc) + " vs " + hex(b.fault.epc);
+        }
+        if (a.fault.bad_address != b.fault.bad_address) {
+            return "fault BadVAddr: " + hex(a.fault.bad_address) + " vs " + hex(b.fault.bad_address);
+        }
+        return "";
+    }
+    for (uint8_t r = 0; r < 32; ++r) {
+        uint32_t va = a.state.get_register(static_cast<Register>(r));
+        uint32_t vb = b.state.get_register(static_cast<Register>(r));
+        if (va != vb) {
+            return "register $" + std::to_string(r) + ": " + hex(va) + " vs " + hex(vb);
+        }
+    }
+    if (a.state.get_hi() != b.state.get_hi()) {
+        return "hi: " + hex(a.state.get_hi()) + " vs " + hex(b.state.get_hi());
+    }
+    if (a.state.get_lo() != b.state.get_lo()) {
+        return "lo: " + hex(a.state.get_lo()) + " vs " + hex(b.state.get_lo());
+    }
+    if (a.state.get_pc() != b.state.get_pc()) {
+        return "pc: " + hex(a.state.get_pc()) + " vs " + hex(b.state.get_pc());
+    }
+    if (a.has_memory && b.has_memory && memory_hash(a.state) != memory_hash(b.state)) {
+        return "memory hash differs";
+    }
+    return "";
+}
+
+void usage(const char* prog) {
+    std::cerr << "Usage:\n";
+    std::cerr << "  " << prog << " [-n <iterations>] [-s <seed>] [-l <length>] [-v]\n";
+    std::cerr << "    -n  number of random programs (default 1000)\n";
+    std::cerr << "    -s  RNG seed (default 1)\n";
+    std::cerr << "    -l  instructions per program (default 200)\n";
+    std::cerr << "    -v  print every program\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t iterations = 1000;
+    uint64_t seed = 1;
+    size_t length = 200;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if ((std::strcmp(argv[i], "-n") == 0 || std::strcmp(argv[i], "-s") == 0 ||
+                    std::strcmp(argv[i], "-l") == 0) && i + 1 < argc) {
+            uint64_t value = std::stoull(argv[i + 1]);
+            if (argv[i][1] == 'n') iterations = value;
+            else if (argv[i][1] == 's') seed = value;
+            else length = static_cast<size_t>(value);
+            ++i;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ProgramGenerator gen(seed);
+    std::vector<Engine> engines = make_engines();
+
+    for (uint64_t iter = 0; iter < iterations; ++iter) {
+        GeneratedProgram prog = gen.generate(length);
+        if (verbose) {
+            std::cout << "# program " << iter << "\n" << prog.assembly;
+        }
+
+        std::vector<EngineRun> runs(engines.size());
+        for (size_t e = 0; e < engines.size(); ++e) {
+            LoadedRun run = engines[e].load(prog);
+            auto start = std::chrono::steady_clock::now();
+            run.run(runs[e]);
+            engines[e].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            engines[e].instructions += runs[e].steps;
+            if (run.collect) run.collect(runs[e]);
+        }
+
+        for (size_t e = 1; e < engines.size(); ++e) {
+            std::string diff = compare_runs(runs[0], runs[e]);
+            if (!diff.empty()) {
+                std::cout << "DIVERGENCE in program " << iter << " (seed " << seed << ", length " << length << ")\n";
+                std::cout << "  " << engines[0].name << " vs " << engines[e].name << ": " << diff << "\n";
+                std::cout << prog.assembly;
+                return 1;
+            }
+        }
+    }
+
+    std::cout << "No divergence in " << iterations << " programs (seed " << seed << ")\n";
+    std::cout << "Throughput (instructions executed, run time only):\n";
+    for (const Engine& e : engines) {
+        double rate = e.seconds > 0 ? static_cast<double>(e.instructions) / e.seconds : 0.0;
+        std::cout << "  " << std::left << std::setw(18) << e.name
+                  << std::right << std::setw(12) << std::fixed << std::setprecision(0) << rate << " instr/s"
+                  << std::setw(10) << std::setprecision(3) << e.seconds << " s\n";
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "kernels.h"
+
+std::vector<Kernel> benchmark_kernels() {
+    std::vector<Kernel> kernels;
+
+    // Tight ALU loop, 100000 iterations
+    kernels.push_back({"loop", R"(
+        .text
+        main:
+            addi $t0, $zero, 0
+            llo  $t1, $zero, 0x86A0
+            lhi  $t1, $zero, 1
+        loop:
+            addi $t0, $t0, 1
+            addu $t2, $t2, $t0
+            xor  $t3, $t3, $t2
+            bne  $t0, $t1, loop
+            trap 5
+    )", 1000000ULL});
+
+    // Word copy of a 4 KiB buffer, 50 times
+    kernels.push_back({"memcpy", R"(
+        .data
+        src: .space 4096
+        dst: .space 4096
+        .text
+        main:
+            addi $s0, $zero, 50
+        outer:
+            addi $a0, $zero, src
+            addi $a1, $zero, dst
+            addi $a2, $zero, 1024
+        copy:
+            lw   $t0, 0($a0)
+            sw   $t0, 0($a1)
+            addi $a0, $a0, 4
+            addi $a1, $a1, 4
+            addi $a2, $a2, -1
+            bne  $a2, $zero, copy
+            addi $s0, $s0, -1
+            bne  $s0, $zero, outer
+            trap 5
+    )", 1000000ULL});
+
+    // Naive recursive fib(18): call-heavy with stack traffic
+    kernels.push_back({"recursion", R"(
+        .text
+        main:
+            addi $sp, $zero, 30000
+            addi $a0, $zero, 18
+            jal  fib
+            trap 5
+        fib:
+            slti $t0, $a0, 2
+            beq  $t0, $zero, rec
+            add  $v0, $a0, $zero
+            jr   $ra
+        rec:
+            addi $sp, $sp, -12
+            sw   $ra, 0($sp)
+            sw   $a0, 4($sp)
+            addi $a0, $a0, -1
+            jal  fib
+            sw   $v0, 8($sp)
+            lw   $a0, 4($sp)
+            addi $a0, $a0, -2
+            jal  fib
+            lw   $t1, 8($sp)
+            add  $v0, $v0, $t1
+            lw   $ra, 0($sp)
+            addi $sp, $sp, 12
+            jr   $ra
+    )", 1000000ULL});
+
+    // Byte-wise clear, copy and strlen of a 4 KiB buffer, 20 times
+    kernels.push_back({"bytes", R"(
+        .data
+        src: .space 4096
+        dst: .space 4096
+        .text
+        main:
+            addi $s0, $zero, 20
+        outer:
+            addi $a0, $zero, src
+            addi $a2, $zero, 4095
+            addi $t1, $zero, 0x61
+        fill:
+            sb   $t1, 0($a0)
+            addi $a0, $a0, 1
+            addi $a2, $a2, -1
+            bne  $a2, $zero, fill
+            addi $a0, $zero, src
+            addi $a1, $zero, dst
+            addi $a2, $zero, 4096
+        copy:
+            lbu  $t0, 0($a0)
+            sb   $t0, 0($a1)
+            addi $a0, $a0, 1
+            addi $a1, $a1, 1
+            addi $a2, $a2, -1
+            bne  $a2, $zero, copy
+            addi $a0, $zero, dst
+        walk:
+            lbu  $t0, 0($a0)
+            addi $a0, $a0, 1
+            bne  $t0, $zero, walk
+            addi $s0, $s0, -1
+            bne  $s0, $zero, outer
+            trap 5
+    )", 2000000ULL});
+
+    // print_int / print_character in a loop
+    kernels.push_back({"syscall", R"(
+        .text
+        main:
+            addi $t0, $zero, 2000
+        loop:
+            add  $a0, $t0, $zero
+            trap 0
+            addi $a0, $zero, 10
+            trap 1
+            addi $t0, $t0, -1
+            bne  $t0, $zero, loop
+            trap 5
+    )", 1000000ULL});
+
+    return kernels;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Small guest programs used for end-to-end benchmarks.
+struct Kernel {
+    std::string name;
+    std::string assembly;
+    uint64_t max_steps;     // enough to run to completion
+};
+
+// loops, memcpy, recursion and syscall-heavy kernels
+std::vector<Kernel> benchmark_kernels();
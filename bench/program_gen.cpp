@@ -0,0 +1,203 @@
+#include "program_gen.h"
+#include <sstream>
+#include <iterator>
+
+namespace {
+
+// R-type functions that never transfer control (jr/jalr need computed targets)
+const FunctionCode kRFunctions[] = {
+    FunctionCode::SLL, FunctionCode::SRL, FunctionCode::SRA,
+    FunctionCode::SLLV, FunctionCode::SRLV, FunctionCode::SRAV,
+    FunctionCode::MFHI, FunctionCode::MTHI, FunctionCode::MFLO, FunctionCode::MTLO,
+    FunctionCode::MULT, FunctionCode::MULTU, FunctionCode::DIV, FunctionCode::DIVU,
+    FunctionCode::ADD, FunctionCode::ADDU, FunctionCode::SUB, FunctionCode::SUBU,
+    FunctionCode::AND, FunctionCode::OR, FunctionCode::XOR, FunctionCode::NOR,
+    FunctionCode::SLT, FunctionCode::SLTU
+};
+
+const Opcode kImmediateOps[] = {
+    Opcode::ADDI, Opcode::ADDIU, Opcode::SLTI, Opcode::SLTIU,
+    Opcode::ANDI, Opcode::ORI, Opcode::XORI, Opcode::LLO, Opcode::LHI
+};
+
+const Opcode kMemoryOps[] = {
+    Opcode::LB, Opcode::LH, Opcode::LW, Opcode::LBU, Opcode::LHU,
+    Opcode::SB, Opcode::SH, Opcode::SW
+};
+
+const Opcode kBranchOps[] = {
+    Opcode::BEQ, Opcode::BNE, Opcode::BLEZ, Opcode::BGTZ
+};
+
+std::string reg(uint8_t r) {
+    return "$" + std::to_string(r);
+}
+
+bool is_memory_op(Opcode op) {
+    for (Opcode m : kMemoryOps) {
+        if (m == op) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+ProgramGenerator::ProgramGenerator(uint64_t seed) : rng(seed) {}
+
+uint32_t ProgramGenerator::next(uint32_t bound) {
+    return static_cast<uint32_t>(rng() % bound);
+}
+
+uint8_t ProgramGenerator::random_register() {
+    return static_cast<uint8_t>(next(32));
+}
+
+Instruction ProgramGenerator::random_instruction(size_t index, size_t length) {
+    // Branch/jump targets are instruction slots after this one; `length` is the final trap.
+    auto forward_target = [&]() -> uint32_t {
+        return static_cast<uint32_t>(index + 1 + next(static_cast<uint32_t>(length - index)));
+    };
+
+    uint32_t kind = next(100);
+    if (kind < 45) {
+        FunctionCode funct = kRFunctions[next(std::size(kRFunctions))];
+        uint8_t rs = random_register(), rt = random_register(), rd = random_register();
+        switch (funct) {
+            case FunctionCode::SLL:
+            case FunctionCode::SRL:
+            case FunctionCode::SRA:
+                return RInstruction(0, rt, rd, static_cast<uint8_t>(next(32)), funct);
+            case FunctionCode::MFHI:
+            case FunctionCode::MFLO:
+                return RInstruction(0, 0, rd, 0, funct);
+            case FunctionCode::MTHI:
+            case FunctionCode::MTLO:
+                return RInstruction(rs, 0, 0, 0, funct);
+            case FunctionCode::MULT:
+            case FunctionCode::MULTU:
+            case FunctionCode::DIV:
+            case FunctionCode::DIVU:
+                return RInstruction(rs, rt, 0, 0, funct);
+            default:
+                return RInstruction(rs, rt, rd, 0, funct);
+        }
+    } else if (kind < 75) {
+        Opcode op = kImmediateOps[next(std::size(kImmediateOps))];
+        return IInstruction(op, random_register(), random_register(), static_cast<uint16_t>(next(0x10000)));
+    } else if (kind < 90) {
+        Opcode op = kMemoryOps[next(std::size(kMemoryOps))];
+        uint16_t offset = static_cast<uint16_t>(GEN_DATA_BASE + next(GEN_DATA_SIZE - 3));
+        return IInstruction(op, 0, random_register(), offset);
+    } else if (kind < 97) {
+        Opcode op = kBranchOps[next(std::size(kBranchOps))];
+        uint8_t rt = (op == Opcode::BEQ || op == Opcode::BNE) ? random_register() : 0;
+        int32_t offset = static_cast<int32_t>(forward_target()) - static_cast<int32_t>(index);
+        return IInstruction(op, random_register(), rt, static_cast<uint16_t>(offset & 0xFFFF));
+    } else {
+        Opcode op = next(2) ? Opcode::J : Opcode::JAL;
+        return JInstruction(op, forward_target());
+    }
+}
+
+GeneratedProgram ProgramGenerator::generate(size_t length) {
+    GeneratedProgram prog;
+
+    // Prologue: give a handful of registers non-trivial values
+    for (int i = 0; i < 8; ++i) {
+        uint8_t r = static_cast<uint8_t>(1 + next(31));
+        prog.instructions.push_back(IInstruction(Opcode::LLO, 0, r, static_cast<uint16_t>(next(0x10000))));
+        prog.instructions.push_back(IInstruction(Opcode::LHI, 0, r, static_cast<uint16_t>(next(0x10000))));
+    }
+
+    size_t total = prog.instructions.size() + length;
+    while (prog.instructions.size() < total) {
+        prog.instructions.push_back(random_instruction(prog.instructions.size(), total));
+    }
+    // One program in two also accesses memory through a random register,
+    // which usually faults, so the engines' faults get compared too
+    if (length > 0 && next(2) == 0) {
+        Opcode op = kMemoryOps[next(std::size(kMemoryOps))];
+        prog.instructions[total - length + next(static_cast<uint32_t>(length))] =
+            IInstruction(op, random_register(), random_register(), static_cast<uint16_t>(next(0x10000)));
+    }
+    prog.instructions.push_back(IInstruction(Opcode::TRAP, 0, 0, static_cast<uint16_t>(Syscall::EXIT)));
+
+    std::ostringstream os;
+    os << ".text\n";
+    for (size_t i = 0; i < prog.instructions.size(); ++i) {
+        if (i == 0) os << "main:\n";
+        os << "L" << i << ": " << disassemble(prog.instructions[i], i) << "\n";
+
+        uint32_t word = InstructionUtils::encode(prog.instructions[i]);
+        prog.binary.push_back(word & 0xFF);
+        prog.binary.push_back((word >> 8) & 0xFF);
+        prog.binary.push_back((word >> 16) & 0xFF);
+        prog.binary.push_back((word >> 24) & 0xFF);
+    }
+    prog.assembly = os.str();
+    return prog;
+}
+
+std::string ProgramGenerator::disassemble(const Instruction& instr, size_t index) {
+    std::string name = InstructionUtils::get_name(instr);
+    std::ostringstream os;
+    os << name;
+
+    if (std::holds_alternative<RInstruction>(instr)) {
+        const RInstruction& r = std::get<RInstruction>(instr);
+        switch (r.funct) {
+            case FunctionCode::SLL:
+            case FunctionCode::SRL:
+            case FunctionCode::SRA:
+                os << " " << reg(r.rd) << ", " << reg(r.rt) << ", " << static_cast<int>(r.shamt);
+                break;
+            case FunctionCode::SLLV:
+            case FunctionCode::SRLV:
+            case FunctionCode::SRAV:
+                os << " " << reg(r.rd) << ", " << reg(r.rt) << ", " << reg(r.rs);
+                break;
+            case FunctionCode::JR:
+            case FunctionCode::MTHI:
+            case FunctionCode::MTLO:
+                os << " " << reg(r.rs);
+                break;
+            case FunctionCode::JALR:
+                os << " " << reg(r.rd) << ", " << reg(r.rs);
+                break;
+            case FunctionCode::MFHI:
+            case FunctionCode::MFLO:
+                os << " " << reg(r.rd);
+                break;
+            case FunctionCode::MULT:
+            case FunctionCode::MULTU:
+            case FunctionCode::DIV:
+            case FunctionCode::DIVU:
+                os << " " << reg(r.rs) << ", " << reg(r.rt);
+                break;
+            default:
+                os << " " << reg(r.rd) << ", " << reg(r.rs) << ", " << reg(r.rt);
+                break;
+        }
+    } else if (std::holds_alternative<IInstruction>(instr)) {
+        const IInstruction& i = std::get<IInstruction>(instr);
+        int32_t simm = static_cast<int16_t>(i.immediate);
+        if (i.opcode == Opcode::TRAP) {
+            os << " " << i.immediate;
+        } else if (is_memory_op(i.opcode)) {
+            os << " " << reg(i.rt) << ", " << simm << "(" << reg(i.rs) << ")";
+        } else if (i.opcode == Opcode::BEQ || i.opcode == Opcode::BNE) {
+            os << " " << reg(i.rs) << ", " << reg(i.rt) << ", L" << (static_cast<int64_t>(index) + simm);
+        } else if (i.opcode == Opcode::BLEZ || i.opcode == Opcode::BGTZ) {
+            os << " " << reg(i.rs) << ", L" << (static_cast<int64_t>(index) + simm);
+        } else if (i.opcode == Opcode::ANDI || i.opcode == Opcode::ORI || i.opcode == Opcode::XORI) {
+            os << " " << reg(i.rt) << ", " << reg(i.rs) << ", " << i.immediate;
+        } else {
+            os << " " << reg(i.rt) << ", " << reg(i.rs) << ", " << simm;
+        }
+    } else {
+        const JInstruction& j = std::get<JInstruction>(instr);
+        // text starts at 0, so the word address is also the slot index
+        os << " L" << j.address;
+    }
+    return os.str();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../include/instruction.h"
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+// Scratch area used by generated loads/stores. Programs address it through
+// $zero-based offsets so every access stays inside the default 1 MiB memory.
+constexpr uint32_t GEN_DATA_BASE = 0x4000;
+constexpr uint32_t GEN_DATA_SIZE = 0x1000;
+
+// A randomly generated guest program in every form our engines accept.
+struct GeneratedProgram {
+    std::vector<Instruction> instructions; // text segment, main at address 0
+    std::string assembly;                  // same program as parser input
+    std::vector<uint8_t> binary;           // little-endian image for Executor
+};
+
+class ProgramGenerator {
+public:
+    explicit ProgramGenerator(uint64_t seed);
+
+    // Generate `length` random instructions followed by `trap 5`.
+    // Only forward branches and jumps are emitted, so every program terminates.
+    // Loads and stores stay in the scratch area, except one access through
+    // a random register in one program out of two.
+    GeneratedProgram generate(size_t length);
+
+    // Render a single instruction in the syntax accepted by Parser.
+    // `index` is the instruction slot; branch/jump targets are printed as L<n> labels.
+    static std::string disassemble(const Instruction& instr, size_t index);
+
+private:
+    std::mt19937_64 rng;
+
+    uint32_t next(uint32_t bound);
+    uint8_t random_register();
+    Instruction random_instruction(size_t index, size_t length);
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "machine_state.h"
+#include "instruction.h"
+#include "run_budget.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// What mips_aot compiles into a translated program besides its blocks
+struct AotImage {
+    const uint8_t* bytes;
+    size_t size;
+    uint32_t entry;
+    uint32_t code_lo;       // span of translated instructions
+    uint32_t code_hi;
+};
+
+// The guest of a program translated by mips_aot (see AotTranslator), linked
+// from libmips. Translated blocks run every instruction through
+// InstructionExecutor's handlers, as mips_executor does, and keep only the
+// control flow; interpret() runs whatever they do not cover.
+//
+// Blocks only run while no exception vector is installed, so a fault in
+// one ends the run and the PC is only set where an instruction needs it.
+class AotMachine {
+public:
+    AotMachine(const AotImage& image, uint64_t max_steps, uint32_t memory_pages,
+               std::chrono::milliseconds time_limit);
+
+    AotMachine(const AotMachine&) = delete;
+    AotMachine& operator=(const AotMachine&) = delete;
+
+    uint32_t pc() const { return state.get_pc(); }
+    void set_pc(uint32_t pc) { state.set_pc(pc); }
+
+    // Translated code is valid until a store hits it or a vector is installed
+    bool translatable() const { return !code_dirty && !state.has_exception_vector(); }
+
+    // The instruction at `pc`; throws the executor's error if it faulted
+    void step(uint32_t pc, const DecodedInstruction& instr) {
+        state.set_pc(pc);
+        executor.execute<true>(state, instr);
+        if (state.faulted()) fail();
+    }
+    // A conditional branch at `pc`: true if taken somewhere else
+    bool branch(uint32_t pc, const DecodedInstruction& instr) {
+        step(pc, instr);
+        return state.get_pc() != pc;
+    }
+    // jr/jalr at `pc`, leaving the PC at the target (a jump to itself falls through)
+    void jump(uint32_t pc, const DecodedInstruction& instr) {
+        step(pc, instr);
+        if (state.get_pc() == pc) state.increment_pc();
+    }
+    // A store at `pc`: true when it wrote into translated code
+    bool store(uint32_t pc, const DecodedInstruction& instr) {
+        bool hit = hits_code(instr);
+        step(pc, instr);
+        code_dirty |= hit;
+        return hit;
+    }
+
+    // mips_executor's step loop from the PC. True at the exit trap; unless
+    // `to_exit`, false after the next jump or branch so the caller can go
+    // back to translated code.
+    bool interpret(bool to_exit);
+
+    // Instructions counted so far; blocks add theirs up front and stay
+    // within slice_end, where interpret() looks at the limits
+    uint64_t steps = 0;
+    uint64_t slice_end = 0;
+
+private:
+    [[noreturn]] void fail() const;
+    void next_slice();
+    bool hits_code(const DecodedInstruction& instr) const;
+
+    machine_state state;
+    InstructionExecutor executor;
+    uint64_t max_steps;
+    Watchdog watchdog;
+    uint32_t code_lo;
+    uint32_t code_hi;
+    bool code_dirty = false;
+};
+
+// main() of a translated program: takes mips_executor's -m, -T and -M, runs
+// `run` and reports errors the way mips_executor does
+int aot_main(int argc, char** argv, const AotImage& image, void (*run)(AotMachine&));
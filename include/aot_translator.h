@@ -0,0 +1,51 @@
+#pragma once
+
+#include "instruction.h"
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A basic block recovered from the image
+struct AotBlock {
+    uint32_t start;
+    std::vector<DecodedInstruction> code;   // code[i] sits at start + 4 * i
+};
+
+// Ahead-of-time translator: turns an assembled image into a C++ translation
+// unit that, linked against libmips, behaves like mips_executor on the same
+// image.
+//
+// Blocks are found by following fallthrough, branch and j/jal targets from
+// the entry point. Each block becomes a labelled region of one function that
+// hands its instructions, decoded at translation time, to AotMachine and so
+// to InstructionExecutor; jr/jalr go through a switch over known block
+// addresses. Anything the translation cannot see ahead of time (targets
+// outside the recovered code, a block the remaining step budget cannot
+// cover) runs in AotMachine::interpret() until the next jump or branch.
+// After a store into translated code the interpreter runs the rest of the
+// program.
+class AotTranslator {
+public:
+    AotTranslator(std::vector<uint8_t> image, uint32_t entry);
+
+    const std::map<uint32_t, AotBlock>& blocks() const { return cfg; }
+
+    // Writes the complete program (image, translated blocks and main)
+    void emit(std::ostream& out) const;
+
+private:
+    void discover();
+    uint32_t word_at(uint32_t addr) const;
+    bool in_image(uint32_t addr) const;
+
+    void emit_block(std::ostream& out, const AotBlock& block) const;
+    void emit_goto(std::ostream& out, uint32_t target) const;
+
+    std::vector<uint8_t> bytes;
+    uint32_t entry;
+    std::map<uint32_t, AotBlock> cfg;
+    uint32_t code_lo = UINT32_MAX;      // span of translated instructions
+    uint32_t code_hi = 0;
+};
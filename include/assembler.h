@@ -14,4 +14,12 @@ public:
     std::vector<uint8_t> assemble_stream(std::istream& input);
     std::vector<uint8_t> assemble_file(const std::string& filename);
     void write_binary_to_stream(const std::vector<uint8_t>& bytes, std::ostream& out);
+    // Appends the labels and line table of the last source assembled (see
+    // DebugInfo) to a binary of which `offset` bytes are in `out`
+    void write_debug_section(std::ostream& out, uint64_t offset) const;
+
+private:
+    std::unordered_map<std::string, uint32_t> labels;
+    std::vector<SourceLine> lines;
+    std::string source;     // file name; empty for streams
 };
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "parser.h"
+#include "guest_memory.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// An assembled source, as the interpreter runs it
+struct AssembledSource {
+    std::shared_ptr<const SharedImage> image;       // loaded at address 0
+    uint32_t main_address = 0;
+    bool has_main = false;
+    std::unordered_map<std::string, uint32_t> labels;
+};
+
+// Assembled images kept on disk, keyed by XXH64 of the source text and
+// kToolVersion, so an unchanged source is not parsed again. An entry is the
+// binary padded to whole pages, then the main address and label table; a
+// hit maps the binary straight from the entry (copy-on-write into GUARDED
+// memory). A second digest stored in the entry catches name collisions, and
+// entries written with another page size are rebuilt. Writes go through a
+// temporary file and a rename.
+class AssemblyCache {
+public:
+    // Part of every key: bump whenever the parser's output for a source changes
+    static constexpr const char* kToolVersion = "mips-asm 1";
+
+    explicit AssemblyCache(std::string directory);
+
+    bool lookup(const std::string& source, AssembledSource& assembled) const;
+    // False if the entry could not be written
+    bool store(const std::string& source, const ParseResult& parsed, const std::vector<uint8_t>& binary) const;
+
+    // The cached assembly of `source`, or `parser`'s, which is then cached;
+    // `hit` reports which. Parse errors propagate and cache nothing.
+    AssembledSource assemble(Parser& parser, const std::string& source, bool* hit = nullptr) const;
+
+    std::string path(const std::string& source) const;
+
+private:
+    std::string directory;
+};
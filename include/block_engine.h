@@ -0,0 +1,119 @@
+#pragma once
+
+#include "machine_state.h"
+#include "instruction.h"
+#include "run_budget.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class Program;
+
+// One dispatch unit of a compiled block: a single instruction or a fused pair
+struct BlockSlot {
+    DecodedInstruction first;
+    DecodedInstruction second;  // only meaningful when fused
+    uint32_t pc;                // address of `first`
+    uint32_t aux;               // pattern-specific value computed at compile time
+    int16_t pattern;            // index into BlockEngine::patterns(), -1 = single instruction
+    uint8_t length;             // guest instructions covered (1 or 2)
+    bool store;                 // single store: may write into compiled code
+    bool faults;                // may raise a guest exception (memory, trap, invalid word)
+};
+
+// Superinstruction: two adjacent instructions executed by one handler.
+// Add a row to the table in block_engine.cpp to fuse a new pair.
+struct FusionPattern {
+    const char* name;
+    Operation first;
+    Operation second;
+    // Operand constraint on top of the opcodes (null = any operands)
+    bool (*matches)(const DecodedInstruction& first, const DecodedInstruction& second);
+    // Computes BlockSlot::aux (null = unused)
+    uint32_t (*prepare)(const DecodedInstruction& first, const DecodedInstruction& second);
+    // Runs both instructions. Handlers ending in a branch set the PC as the
+    // branch would, relative to the second instruction; others leave it alone.
+    void (*execute)(machine_state& state, const BlockSlot& slot);
+};
+
+// Canonical single-block loops replaced by host memory routines
+enum class LoopIdiom : uint8_t {
+    NONE,
+    BYTE_COPY,  // lb/lbu + sb + three addi + bne on a down-counter  -> memmove
+    BYTE_FILL,  // sb + two addi + bne on a down-counter             -> memset
+    STRLEN      // lb/lbu + addi (+ addi length) + bne on the byte   -> memchr
+};
+
+struct BlockStats {
+    uint64_t blocks_compiled = 0;
+    uint64_t blocks_executed = 0;
+    uint64_t invalidations = 0;
+    uint64_t idiom_loops = 0;               // whole loops run by a host routine
+    uint64_t idiom_bytes = 0;
+    std::vector<uint64_t> pattern_hits;     // per pattern, fused pairs executed
+};
+
+// Adjacent unfused operations and how often they ran (fusion candidates)
+struct PairCount {
+    Operation first;
+    Operation second;
+    uint64_t count;
+};
+
+// Executes guest code a basic block at a time. Blocks are decoded once,
+// keyed by entry PC, and end at the first control transfer or trap, so a
+// branch into the middle of a fused pair simply starts a new block there.
+// Stores that hit compiled code flush the cache. Self-looping blocks that
+// match a LoopIdiom run as one host call when the whole loop provably fits
+// in memory and in the step budget; otherwise they iterate normally.
+class BlockEngine {
+public:
+    // Blocks take their instructions from `program`'s decoded words when given
+    explicit BlockEngine(InstructionExecutor& executor, const Program* program = nullptr);
+    ~BlockEngine();
+
+    // Run from state.get_pc() until trap 5, an unhandled fault
+    // (state.faulted()) or the budget runs out, with the same step
+    // accounting as Executor's instruction-at-a-time loop. `steps` counts on
+    // from its value; `expired` (Watchdog::flag()) is polled between blocks.
+    // Once the guest installs an exception vector the rest of the run steps.
+    RunStop run(machine_state& state, uint64_t& steps, uint64_t max_steps,
+                const std::atomic<bool>* expired = nullptr);
+    RunStop run(machine_state& state, uint64_t max_steps) {
+        uint64_t steps = 0;
+        return run(state, steps, max_steps);
+    }
+    // After GuestMemory::run_trapped caught a fault inside run(), before the
+    // fault is raised: counts only the interrupted block's instructions up
+    // to the faulting one in `steps`
+    void trapped(const machine_state& state, uint64_t& steps);
+
+    void invalidate();
+    const BlockStats& stats() const { return counters; }
+
+    // Most frequent adjacent pairs executed without fusion, highest first
+    std::vector<PairCount> unfused_pairs(size_t limit) const;
+
+    static const std::vector<FusionPattern>& patterns();
+
+private:
+    struct Block;
+
+    Block* lookup(machine_state& state, uint32_t pc);
+    Block* compile(machine_state& state, uint32_t pc);
+    bool run_idiom(machine_state& state, const Block& block, uint64_t& steps, uint64_t max_steps);
+    RunStop stop_at_fault(const machine_state& state, uint64_t& steps);
+    RunStop step_until_exit(machine_state& state, uint64_t& steps, uint64_t max_steps,
+                            const std::atomic<bool>* expired);
+    void add_pair_counts(const Block& block, std::vector<uint64_t>& counts) const;
+
+    InstructionExecutor& executor;
+    const Program* program;
+    std::unordered_map<uint32_t, std::unique_ptr<Block>> blocks;
+    std::vector<uint64_t> flushed_pairs;            // pair counts of invalidated blocks
+    uint32_t code_lo = UINT32_MAX;                  // span of compiled code
+    uint32_t code_hi = 0;
+    const Block* running = nullptr;                 // block charged to `steps` while it runs
+    BlockStats counters;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+// Which way of a full set a miss evicts
+enum class ReplacementPolicy {
+    LRU,
+    FIFO,
+    RANDOM
+};
+
+// Geometry of one cache; sizes in bytes, all powers of two
+struct CacheConfig {
+    uint32_t size = 32 * 1024;
+    uint32_t ways = 8;
+    uint32_t line = 64;
+    ReplacementPolicy policy = ReplacementPolicy::LRU;
+};
+
+struct CacheHierarchyConfig {
+    CacheConfig l1i;
+    CacheConfig l1d;
+    CacheConfig l2{1024 * 1024, 16, 64, ReplacementPolicy::LRU};
+    uint32_t region = 4096;     // granularity of the per-region data report
+
+    // Defaults overridden by "level=size:ways:line[:policy]" and
+    // "region=size" items, comma separated: "l1d=16K:4:32:fifo,l2=256K:8:64".
+    // Levels are l1i, l1d and l2; sizes take K and M suffixes; policies are
+    // lru, fifo and random. "default" keeps everything. Throws
+    // std::runtime_error on a malformed spec.
+    static CacheHierarchyConfig parse(const std::string& spec);
+};
+
+// Misses are counted at the first level a request reaches, so l2_misses of
+// an access are also among its l1_misses
+struct CacheCounts {
+    uint64_t accesses = 0;
+    uint64_t l1_misses = 0;
+    uint64_t l2_misses = 0;
+
+    void add(int level_missed) {
+        ++accesses;
+        l1_misses += level_missed >= 1;
+        l2_misses += level_missed >= 2;
+    }
+};
+
+// One set-associative cache: tags and replacement stamps in flat arrays
+// indexed by set * ways + way, so an access never allocates.
+class CacheLevel {
+public:
+    explicit CacheLevel(const CacheConfig& config);
+
+    // True on a hit; a miss fills the line (write-allocate for stores too)
+    bool access(uint32_t addr) {
+        uint32_t block = addr >> line_shift;
+        uint32_t set = block & set_mask;
+        uint32_t* tag = &tags[static_cast<size_t>(set) * ways];
+        uint64_t* stamp = &stamps[static_cast<size_t>(set) * ways];
+        ++clock;
+        for (uint32_t w = 0; w < ways; ++w) {
+            if (tag[w] == block) {
+                if (policy == ReplacementPolicy::LRU) stamp[w] = clock;
+                ++hits;
+                return true;
+            }
+        }
+        uint32_t victim = choose_victim(stamp);
+        tag[victim] = block;
+        stamp[victim] = clock;
+        ++misses;
+        return false;
+    }
+
+    uint32_t line_size() const { return 1u << line_shift; }
+    const CacheConfig& config() const { return geometry; }
+    uint64_t hit_count() const { return hits; }
+    uint64_t miss_count() const { return misses; }
+
+private:
+    uint32_t choose_victim(const uint64_t* stamp);
+
+    // Tag of an empty way; no block number reaches it, lines being at least 2 bytes
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    CacheConfig geometry;
+    ReplacementPolicy policy;
+    uint32_t ways;
+    uint32_t line_shift;
+    uint32_t set_mask;
+    std::vector<uint32_t> tags;     // block number (address >> line_shift), or kEmpty
+    std::vector<uint64_t> stamps;   // last use (LRU) or fill (FIFO) time
+    uint64_t clock = 0;
+    uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// Split L1 over a unified L2, fed instruction fetches and data accesses by a
+// machine_state it is attached to (machine_state::attach_caches). Counts are
+// kept per PC that ran, and per data region in an array sized up front for
+// `memory_size`.
+class CacheHierarchy {
+public:
+    CacheHierarchy(const CacheHierarchyConfig& config, size_t memory_size);
+
+    void fetch(uint32_t pc) {
+        per_pc[pc].fetch.add(reach(l1i, pc, 4));
+    }
+    // Load or store of `size` bytes at `addr` by the instruction at `pc`
+    void data(uint32_t pc, uint32_t addr, uint32_t size) {
+        int missed = reach(l1d, addr, size);
+        per_pc[pc].data.add(missed);
+        size_t region = addr >> region_shift;
+        if (region < per_region.size()) per_region[region].add(missed);
+    }
+
+    struct PcCounts {
+        CacheCounts fetch;
+        CacheCounts data;
+    };
+
+    const CacheLevel& l1i_cache() const { return l1i; }
+    const CacheLevel& l1d_cache() const { return l1d; }
+    const CacheLevel& l2_cache() const { return l2; }
+    // Keyed by PC; only PCs that fetched or accessed data have an entry
+    const std::unordered_map<uint32_t, PcCounts>& pc_counts() const { return per_pc; }
+    // Indexed by address / config().region
+    const std::vector<CacheCounts>& region_counts() const { return per_region; }
+    const CacheHierarchyConfig& config() const { return settings; }
+
+    // Level summaries, the `top` PCs with the most L1 misses (fetch and
+    // data), and every data region that was touched
+    void report(std::ostream& out, size_t top = 10) const;
+
+private:
+    // Deepest level missed (0 = L1 hit); accesses crossing a line touch both lines
+    int reach(CacheLevel& l1, uint32_t addr, uint32_t size) {
+        int missed = reach_line(l1, addr);
+        if ((addr & (l1.line_size() - 1)) + size > l1.line_size()) {
+            int second = reach_line(l1, addr + size - 1);
+            if (second > missed) missed = second;
+        }
+        return missed;
+    }
+    int reach_line(CacheLevel& l1, uint32_t addr) {
+        if (l1.access(addr)) return 0;
+        return l2.access(addr) ? 1 : 2;
+    }
+
+    CacheHierarchyConfig settings;
+    CacheLevel l1i;
+    CacheLevel l1d;
+    CacheLevel l2;
+    uint32_t region_shift;
+    std::unordered_map<uint32_t, PcCounts> per_pc;
+    std::vector<CacheCounts> per_region;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Entry encoding shared by the on-disk caches (ResultCache, AssemblyCache):
+// little-endian fields appended to a string, read back by RecordReader
+
+void put32(std::string& out, uint32_t v);
+void put64(std::string& out, uint64_t v);
+
+// Reads little-endian fields of an entry; any overrun marks it bad and
+// every later read returns nothing
+struct RecordReader {
+    const std::string& bytes;
+    size_t at = 0;
+    bool ok = true;
+
+    uint64_t get(int size);
+    std::string text(uint64_t size);
+};
+
+// Writes `bytes` to `path` through a temporary file and a rename, creating
+// its directory first, so processes sharing the directory never see half an
+// entry. Returns false, leaving nothing behind, when any step fails.
+bool write_entry(const std::string& path, const std::string& bytes);
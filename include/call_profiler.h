@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+// Per-function instruction counts from a shadow call stack. The
+// InstructionExecutor it is set on reports jal/jalr as calls and jr $ra as
+// returns. Between two such events every instruction belongs to the frame
+// on top, so the profiler only works when a call or return happens and
+// reads the run loop's instruction counter then.
+//
+// Counts are kept per call path, so they also make a flame graph
+// (write_collapsed). A jr $ra that matches no return address on the stack
+// is taken for a plain jump; one matching a deeper frame unwinds to it.
+class CallProfiler {
+public:
+    // `labels` name functions (ParseResult::labels); other entry points
+    // print as hex addresses
+    explicit CallProfiler(const std::unordered_map<std::string, uint32_t>& labels = {});
+    void set_symbols(const std::unordered_map<std::string, uint32_t>& labels);
+
+    // Run loop side: profile from `entry`, reading `*clock` (instructions
+    // retired so far) at every event until finish(). Several runs add up.
+    void start(uint32_t entry, const uint64_t* clock);
+    void finish();
+
+    // InstructionExecutor side
+    void call(uint32_t target, uint32_t return_address);
+    void ret(uint32_t target);
+
+    struct FunctionProfile {
+        std::string name;
+        uint32_t address = 0;
+        uint64_t calls = 0;
+        uint64_t inclusive = 0;     // recursive activations counted once
+        uint64_t exclusive = 0;
+    };
+    // By inclusive count, largest first
+    std::vector<FunctionProfile> functions() const;
+
+    // One "outer;inner;leaf count" line per call path with exclusive
+    // instructions, the input flamegraph.pl and similar tools take
+    void write_collapsed(std::ostream& out) const;
+    void report(std::ostream& out, size_t top = 20) const;
+
+    std::string name_of(uint32_t address) const;
+
+private:
+    struct Node {
+        uint32_t function;
+        uint32_t parent;        // kNoNode for a root
+        uint64_t calls = 0;
+        uint64_t self = 0;      // instructions retired with this path on top
+    };
+    struct Frame {
+        uint32_t node;
+        uint32_t return_address;
+    };
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+
+    uint32_t child(uint32_t parent, uint32_t function);
+    // Charges the instructions since the last event to the frame on top
+    void charge();
+    std::string path_of(uint32_t node) const;
+
+    std::unordered_map<uint32_t, std::string> names;
+    std::vector<Node> nodes;
+    std::unordered_map<uint64_t, uint32_t> children;    // parent << 32 | function -> node
+    std::vector<Frame> stack;
+    const uint64_t* clock = nullptr;
+    uint64_t last_event = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "instruction.h"
+#include "parser.h"
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+// Which instructions, and which directions of which branches, a guest ran.
+// Three flat bitmaps with one bit per word address (pc >> 2): executed,
+// branch taken and branch not taken. The run loop records every
+// instruction the main hart retires (ExecutorOptions::coverage); maps of
+// one memory size from separate runs merge with a bitwise OR, so parallel
+// runs each keep their own and are combined afterwards.
+class CoverageMap {
+public:
+    explicit CoverageMap(size_t memory_size);
+
+    // `taken` is the direction a conditional branch went, as the executor
+    // evaluated it (InstructionExecutor::last_branch_taken); other
+    // instructions ignore it
+    void record(uint32_t pc, const DecodedInstruction& instr, bool taken) {
+        size_t index = pc >> 2;
+        if (index >= slots) return;
+        uint64_t bit = uint64_t{1} << (index & 63);
+        size_t word = index >> 6;
+        bits[word] |= bit;
+        if (instr.op >= Operation::BEQ && instr.op <= Operation::BGTZ) {
+            bits[(taken ? words : 2 * words) + word] |= bit;
+        }
+    }
+
+    bool executed(uint32_t pc) const { return test(0, pc); }
+    bool taken(uint32_t pc) const { return test(words, pc); }
+    bool not_taken(uint32_t pc) const { return test(2 * words, pc); }
+    size_t memory_size() const { return slots * 4; }
+
+    // ORs `other` in (SSE2 where available). Throws std::runtime_error if
+    // the memory sizes differ.
+    void merge(const CoverageMap& other);
+
+    // Raw bitmaps behind a small header; load throws std::runtime_error on
+    // anything save did not write
+    void save(std::ostream& out) const;
+    static CoverageMap load(std::istream& in);
+
+    // `source` annotated line by line from `lines` (ParseResult::source_lines
+    // or DebugInfo::lines), each line marked
+    //   +  all its code ran          #  none of it ran
+    //   ~  a branch went one way only (the missing way is named)
+    //   -  no code
+    // after a summary of instructions and branch directions covered
+    void report(std::ostream& out, const std::vector<SourceLine>& lines, std::istream& source) const;
+
+private:
+    bool test(size_t base, uint32_t pc) const {
+        size_t index = pc >> 2;
+        return index < slots && (bits[base + (index >> 6)] >> (index & 63)) & 1;
+    }
+
+    size_t slots;                   // instruction addresses covered
+    size_t words;                   // 64-bit words per bitmap
+    std::vector<uint64_t> bits;     // executed, taken, not taken
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "parser.h"
+#include "guest_memory.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+// Symbols of an assembled binary, kept in a section after the image:
+//
+//   section   label count, line count, source name (string offset or
+//             UINT32_MAX), string table size; then {address, name offset}
+//             per label and {address, line} per instruction, both sorted by
+//             address; then the NUL-terminated strings
+//   trailer   section offset and size, then "MIPSDBG1" -- the last 16 bytes
+//
+// All words are little-endian. Loaders find the trailer at the end of the
+// file and stop reading where the section starts (see image_end), so a
+// binary runs the same with or without it. A DebugInfo reads only the
+// trailer when opened; the section is mapped on the first lookup. Lookups
+// on one instance are not thread-safe.
+class DebugInfo {
+public:
+    static constexpr size_t kTrailerSize = 16;
+
+    // Appends the section and trailer for a binary of which `offset` bytes
+    // have been written to `out` already
+    static void write(std::ostream& out, uint64_t offset, const std::unordered_map<std::string, uint32_t>& labels,
+                      const std::vector<SourceLine>& lines, const std::string& source = "");
+
+    // Where the section starts in a file of `file_size` bytes ending in
+    // `tail` (its last kTrailerSize bytes); `file_size` if there is none
+    static uint64_t image_end(const uint8_t* tail, uint64_t file_size);
+
+    // Throws std::runtime_error if `path` cannot be read
+    explicit DebugInfo(const std::string& path);
+    ~DebugInfo();
+
+    bool available() const { return section_size != 0; }
+
+    std::unordered_map<std::string, uint32_t> labels() const;
+    // The line table, in address order
+    std::vector<SourceLine> lines() const;
+    // Source file the lines refer to; empty if not recorded
+    std::string source() const;
+    // Line of the instruction at `address`; 0 if unknown
+    uint32_t line_of(uint32_t address) const;
+    // "label+0x8 (file.asm:12)" from the nearest label at or below `address`;
+    // empty without debug info
+    std::string symbolize(uint32_t address) const;
+
+private:
+    struct Section;
+
+    // Maps the section; null without one. Throws std::runtime_error on a
+    // malformed section.
+    const Section* section() const;
+
+    std::string path;
+    uint64_t section_offset = 0;
+    uint32_t section_size = 0;
+    mutable std::unique_ptr<SharedImage> mapping;
+    mutable std::unique_ptr<Section> parsed;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "instruction.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Structure-of-arrays view of a decoded text segment.
+// Every array has one entry per input word.
+struct DecodedFields {
+    std::vector<uint8_t> op;        // Operation id (table lookup on opcode/funct)
+    std::vector<uint8_t> opcode;    // bits 31..26
+    std::vector<uint8_t> rs;        // bits 25..21
+    std::vector<uint8_t> rt;        // bits 20..16
+    std::vector<uint8_t> rd;        // bits 15..11
+    std::vector<uint8_t> shamt;     // bits 10..6
+    std::vector<uint8_t> funct;     // bits 5..0
+    std::vector<uint32_t> imm;      // bits 15..0, sign-extended
+
+    void resize(size_t n);
+    size_t size() const { return op.size(); }
+};
+
+// Field extraction implementations, fastest first
+enum class DecodeBackend {
+    AVX2,
+    SSE2,
+    SCALAR
+};
+
+// Decodes whole runs of instruction words at once (e.g. a text segment
+// when loading an image or filling a decode cache).
+class BatchDecoder {
+public:
+    // Decode `count` host-order words into `out` (resized to `count`)
+    static void decode(const uint32_t* words, size_t count, DecodedFields& out);
+
+    // Same, forcing a backend; falls back to SCALAR if it is unavailable
+    static void decode(const uint32_t* words, size_t count, DecodedFields& out, DecodeBackend backend);
+
+    // Decode a little-endian byte image (trailing partial word ignored)
+    static void decode_image(const std::vector<uint8_t>& bytes, DecodedFields& out);
+
+    // Dense array of compact instructions, e.g. for a decode cache
+    static void predecode(const uint32_t* words, size_t count, DecodedInstruction* out);
+
+    // Backend picked by decode() on this machine
+    static DecodeBackend best_backend();
+    static bool backend_available(DecodeBackend backend);
+    static const char* backend_name(DecodeBackend backend);
+};
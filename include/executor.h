@@ -2,13 +2,94 @@
 
 #include "machine_state.h"
 #include "instruction.h"
+#include "pipeline_model.h"
+#include "call_profiler.h"
+#include "debug_info.h"
+#include "coverage.h"
+#include "run_budget.h"
 #include <string>
+#include <chrono>
 #include <cstdint>
 #include <istream>
+#include <ostream>
+#include <memory>
+#include <vector>
+
+// How Executor drives InstructionExecutor
+enum class ExecutionMode {
+    STEP,       // fetch and decode every instruction
+    BLOCK       // cached basic blocks with fused instruction pairs (BlockEngine)
+};
+
+// Run-time settings for Executor
+struct ExecutorOptions {
+    uint64_t max_steps = 100000ULL;
+    std::chrono::milliseconds time_limit{0};        // wall-clock limit (Watchdog); 0: none
+    uint32_t memory_pages = 256;                    // guest memory size in kGuestPageSize pages
+    ResourceUsage* usage = nullptr;                 // what the run used
+    bool verbose = false;
+    const DebugInfo* symbols = nullptr;             // names PCs in the verbose trace
+    uint32_t start_address = UINT32_MAX;            // UINT32_MAX: header main address, else 0
+    MemoryBackend memory = MemoryBackend::CHECKED;
+    ExecutionMode mode = ExecutionMode::STEP;       // verbose tracing always steps
+    size_t harts = 1;                               // harts sharing memory, main included (see HartGroup);
+                                                    // above 1 every hart steps and only hart 0 traces
+    std::istream* input = nullptr;                  // guest stdin; null: std::cin
+    std::ostream* output = nullptr;                 // guest stdout; null: std::cout (traces always go there)
+    CacheHierarchy* caches = nullptr;               // fed by the main hart's fetches and accesses; forces
+                                                    // stepping, as blocks fetch ahead of execution
+    PipelineModel* timing = nullptr;                // fed every instruction the main hart retires; forces stepping
+    CallProfiler* profiler = nullptr;               // follows the main hart's calls and returns; forces stepping,
+                                                    // as blocks count instructions a block at a time
+    CoverageMap* coverage = nullptr;                // marks what the main hart retires; forces stepping
+};
+
+// Assembled program as written by Assembler::write_binary_to_stream
+struct ExecutableImage {
+    std::vector<uint8_t> bytes;     // loaded at address 0
+    uint32_t entry = 0;             // main address from the header, else 0
+    bool has_header = false;        // began with "MIPS" + main address
+};
+
+// Reads a whole image, stripping the optional "MIPS" header and leaving out
+// a trailing debug section
+ExecutableImage read_executable_image(std::istream& in);
+
+// An image loaded once for any number of runs, on any threads at once. Runs
+// map its bytes copy-on-write (SharedImage) and take instructions from its
+// decoded words, so per run there is only the memory a guest dirties and
+// the registers. Immutable after construction.
+class Program {
+public:
+    explicit Program(ExecutableImage image);
+    static std::shared_ptr<const Program> load(std::istream& in);
+
+    const SharedImage& image() const { return bytes; }
+    uint32_t entry() const { return start; }
+    bool has_header() const { return header; }
+
+    // The instruction `word` fetched at `pc`; decoded once here unless the
+    // guest has overwritten it
+    DecodedInstruction decode(uint32_t pc, uint32_t word) const {
+        size_t index = pc >> 2;
+        if ((pc & 3) == 0 && index < words.size() && words[index] == word) return decoded[index];
+        return InstructionUtils::predecode(word);
+    }
+
+private:
+    SharedImage bytes;
+    uint32_t start;
+    bool header;
+    std::vector<uint32_t> words;
+    std::vector<DecodedInstruction> decoded;
+};
 
 class Executor {
 public:
     Executor();
+    machine_state run(const Program& program, const ExecutorOptions& options);
+    machine_state run_stream(std::istream& in, const ExecutorOptions& options);
+    machine_state run_file(const std::string& filename, const ExecutorOptions& options);
     machine_state run_stream(std::istream& in, uint64_t max_steps = 100000ULL, bool verbose = false, uint32_t start_address = UINT32_MAX);
     machine_state run_file(const std::string& filename, uint64_t max_steps = 100000ULL, bool verbose = false, uint32_t start_address = UINT32_MAX);
 };
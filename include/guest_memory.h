@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+// How guest memory is backed
+enum class MemoryBackend {
+    CHECKED,    // heap buffer; every access is bounds-checked in software
+    GUARDED     // 4 GiB PROT_NONE reservation; stray accesses fault in hardware
+};
+
+// Read-only program bytes that many GuestMemory instances map at address 0.
+// Where the host allows it the bytes live in a file (an anonymous one, or a
+// region of an existing file), so GUARDED memories map them copy-on-write
+// and only pages a guest stores to are copied; elsewhere map_image() falls
+// back to copying. Instances keep their mappings after the SharedImage is gone.
+class SharedImage {
+public:
+    explicit SharedImage(std::vector<uint8_t> bytes);
+    // `size` bytes of `path` at `offset`, mapped read-only rather than read
+    // where possible; `offset` must be a multiple of the page size for that.
+    // Throws std::runtime_error if the file cannot be read.
+    SharedImage(const std::string& path, size_t offset, size_t size);
+    ~SharedImage();
+    SharedImage(const SharedImage&) = delete;
+    SharedImage& operator=(const SharedImage&) = delete;
+
+    const uint8_t* data() const { return base; }
+    size_t size() const { return length; }
+    bool mappable() const { return fd >= 0; }
+
+    static size_t page_size();
+
+private:
+    friend class GuestMemory;
+
+    std::vector<uint8_t> bytes;     // storage unless the bytes are mapped
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    int fd = -1;
+    size_t offset = 0;              // of the bytes in `fd`
+    void* mapping = nullptr;
+};
+
+// Byte-addressable guest memory starting at guest address 0.
+//
+// The GUARDED backend reserves the whole 32-bit guest address space (plus a
+// guard page for accesses that straddle 4 GiB) and commits only the first
+// size() bytes, so host pointer arithmetic on any guest address is safe to
+// attempt: it either hits committed memory or faults inside the reservation.
+// Such faults are only recoverable inside run_trapped().
+class GuestMemory {
+public:
+    // GUARDED silently becomes CHECKED where backend_available() says no
+    explicit GuestMemory(size_t size = 0, MemoryBackend backend = MemoryBackend::CHECKED);
+    ~GuestMemory();
+
+    GuestMemory(const GuestMemory& other);
+    GuestMemory& operator=(const GuestMemory& other);
+    GuestMemory(GuestMemory&& other) noexcept;
+    GuestMemory& operator=(GuestMemory&& other) noexcept;
+
+    uint8_t* data() { return base; }
+    const uint8_t* data() const { return base; }
+    uint8_t& operator[](size_t addr) { return base[addr]; }
+    uint8_t operator[](size_t addr) const { return base[addr]; }
+    size_t size() const { return length; }
+    MemoryBackend backend() const { return kind; }
+
+    // Grow or shrink; new bytes read as zero. GUARDED sizes round up to whole pages.
+    // Views cannot be resized.
+    void resize(size_t new_size);
+
+    // Put `image` at address 0, copy-on-write when GUARDED and the image is
+    // mappable. Meant for fresh memory that already holds the image; the
+    // rest of a mapped last page reads as zero. Views cannot map.
+    void map_image(const SharedImage& image);
+
+    // Bytes of this memory the host has backed so far, in whole host pages:
+    // the pages a guest touched plus resident pages of a mapped image. All
+    // of size() where the host cannot tell.
+    size_t resident_bytes() const;
+
+    // Non-owning alias of the same bytes (for harts sharing one memory).
+    // This memory must outlive the view; copying a view copies the bytes.
+    GuestMemory view();
+    bool is_view() const { return !owner; }
+
+    // Run `body`; returns false if it was cut short by an access to the
+    // uncommitted part of this memory's reservation (the guest address is
+    // stored in `fault_address`). Frames unwound this way are not destroyed,
+    // so `body` must not own resources across guest memory accesses.
+    template <typename F>
+    bool run_trapped(F&& body, uint32_t& fault_address) const {
+        using Body = std::remove_reference_t<F>;
+        return run_trapped_impl([](void* ctx) { (*static_cast<Body*>(ctx))(); }, &body, fault_address);
+    }
+
+    static bool backend_available(MemoryBackend backend);
+    static const char* backend_name(MemoryBackend backend);
+
+private:
+    bool run_trapped_impl(void (*fn)(void*), void* ctx, uint32_t& fault_address) const;
+    void release();
+
+    MemoryBackend kind;
+    uint8_t* base = nullptr;
+    size_t length = 0;
+    struct Free {
+        void operator()(uint8_t* p) const;
+    };
+    // CHECKED storage, from calloc so large memories start as untouched zero pages
+    std::unique_ptr<uint8_t, Free> heap;
+    bool owner = true;          // false for view()s
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "machine_state.h"
+#include "instruction.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// Outcome of one guest run by GuestScheduler
+struct GuestResult {
+    std::string output;     // what the guest printed since the last take_output()
+    std::string error;      // error Executor would have thrown, empty after trap 5
+    uint64_t steps = 0;     // instructions executed
+};
+
+// Runs many guest programs on a few host threads.
+//
+// A guest whose read_int/read_character syscall has no input yet is
+// suspended with its PC on the trap instead of blocking a thread; feed()
+// makes it runnable again. Runnable guests take turns in slices of
+// `quantum` instructions, so compute-bound guests cannot starve the rest.
+// Each guest ends exactly as Executor::run_stream would with all of its
+// input on stdin (STEP mode, checked memory); a read at the end of the
+// input waits until close_input().
+class GuestScheduler {
+public:
+    explicit GuestScheduler(size_t threads = 2, uint64_t quantum = 10000);
+    ~GuestScheduler();
+
+    // Starts `image` (loaded at address 0, header stripped) at `entry`; returns its id
+    uint64_t submit(std::vector<uint8_t> image, uint32_t entry, uint64_t max_steps = 100000ULL,
+                    size_t memory_size = 1024 * 1024);
+
+    // Appends to the guest's stdin / marks its end
+    void feed(uint64_t id, const std::string& input);
+    void close_input(uint64_t id);
+
+    // Output printed so far and not yet taken
+    std::string take_output(uint64_t id);
+
+    // Blocks until the guest exits or fails; its id is released
+    GuestResult wait(uint64_t id);
+
+    // Guests currently suspended on input
+    size_t waiting_for_input() const;
+
+private:
+    class Task;
+
+    void worker();
+    void enqueue(const std::shared_ptr<Task>& task);   // with `lock` held
+    std::shared_ptr<Task> find(uint64_t id) const;
+
+    const uint64_t quantum;
+    mutable std::mutex lock;                // guards everything below and Task scheduling flags
+    std::condition_variable work;           // runnable tasks or shutdown
+    std::condition_variable done;           // a task finished
+    std::deque<std::shared_ptr<Task>> runnable;
+    std::unordered_map<uint64_t, std::shared_ptr<Task>> tasks;
+    uint64_t next_id = 1;
+    size_t parked = 0;
+    bool shutting_down = false;
+    std::vector<std::thread> threads;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "machine_state.h"
+#include "instruction.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// Guest harts sharing one memory, each running on its own host thread.
+//
+// Hart 0 is the state the program was loaded into. spawn (trap 6) starts
+// another hart at $a0 with $a1 in its $a0 and $a2 in its $sp and returns its
+// id, or -1 when all harts are in use; join (trap 7) waits for hart $a0 to
+// exit (trap 5) and returns its $v0, or -1 for an id that is not running or
+// already joined. A joined id can be spawned again. Every hart has its own
+// registers, hi/lo, ll/sc link and step budget. Ordinary loads and stores
+// are not atomic between harts; guests synchronize with ll/sc and sync.
+//
+// The first error in any hart stops all of them and is rethrown by run().
+// So is every running hart waiting in join, which would never end.
+class HartGroup : public HartHost {
+public:
+    // Runs one hart until it exits or `stop` becomes true; throws on errors
+    using RunHart = std::function<void(machine_state&, InstructionExecutor&, const std::atomic<bool>& stop)>;
+
+    HartGroup(size_t max_harts, RunHart run_hart, std::istream& input = std::cin,
+              std::ostream& output = std::cout);
+    ~HartGroup() override;
+
+    // Runs `main` as hart 0 on the calling thread, then waits for every
+    // other hart to exit
+    void run(machine_state& main);
+
+    uint32_t spawn(machine_state& parent, uint32_t entry, uint32_t arg, uint32_t stack) override;
+    uint32_t join(machine_state& caller, uint32_t hart) override;
+    std::mutex& io_mutex() override { return io; }
+
+private:
+    struct Hart;
+
+    void run_hart(Hart& hart);
+    void fail(const std::string& message);      // with `lock` held
+    bool deadlocked() const;                    // with `lock` held
+
+    size_t max_harts;
+    RunHart body;
+    std::istream& input;
+    std::ostream& output;
+    std::vector<std::shared_ptr<Hart>> harts;   // by id; slot 0 is the main hart
+
+    std::mutex lock;                // guards everything below and the Hart flags
+    std::condition_variable changed;
+    size_t running = 0;             // harts not yet exited
+    std::string error;
+    std::atomic<bool> stop{false};
+
+    std::mutex io;
+};
@@ -4,10 +4,10 @@
 #include <string>
 #include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <variant>
-#include <unordered_map>
-#include <functional>
+#include <type_traits>
 
 enum class InstructionFormat {
     R_TYPE,    // Register format
@@ -41,7 +41,9 @@ enum class Opcode : uint8_t {
     LHU = 0x25,      // Load halfword unsigned
     SB = 0x28,       // Store byte
     SH = 0x29,       // Store halfword
-    SW = 0x2B        // Store word
+    SW = 0x2B,       // Store word
+    LL = 0x30,       // Load linked word
+    SC = 0x38        // Store conditional word
 };
 
 // Function codes for R-type instructions
@@ -54,6 +56,7 @@ enum class FunctionCode : uint8_t {
     SRAV = 0x07,     // Shift right arithmetic variable
     JR = 0x08,       // Jump register
     JALR = 0x09,     // Jump and link register
+    SYNC = 0x0F,     // Memory barrier
     MFHI = 0x10,     // Move from HI
     MTHI = 0x11,     // Move to HI
     MFLO = 0x12,     // Move from LO
@@ -81,7 +84,14 @@ enum class Syscall : uint8_t {
     PRINT_STRING = 2,
     READ_INT = 3,
     READ_CHARACTER = 4,
-    EXIT = 5
+    EXIT = 5,
+    SPAWN = 6,       // start a hart at $a0 with $a1 in its $a0 and $a2 as its $sp; $v0 = id or -1
+    JOIN = 7,        // wait for hart $a0 to exit; $v0 = its $v0, or -1
+    // Guest exception handling (see machine_state::raise_exception); there
+    // is no mfc0/mtc0/eret, so coprocessor 0 is reached through traps
+    SET_EXCEPTION_VECTOR = 8,   // handler at $a0, -1 for none; $v0 = the previous one
+    EXCEPTION_RETURN = 9,       // eret: leave the handler, resuming at $k0
+    BAD_ADDRESS = 10            // $k1 = BadVAddr of the exception being handled
 };
 
 // R-type instruction format
@@ -122,6 +132,34 @@ struct JInstruction {
 // Variant to hold any instruction type
 using Instruction = std::variant<RInstruction, IInstruction, JInstruction>;
 
+// Dense operation ids for the decoded form (one per supported mnemonic)
+enum class Operation : uint8_t {
+    SLL, SRL, SRA, SLLV, SRLV, SRAV, JR, JALR,
+    MFHI, MTHI, MFLO, MTLO, MULT, MULTU, DIV, DIVU,
+    ADD, ADDU, SUB, SUBU, AND, OR, XOR, NOR, SLT, SLTU, SYNC,
+    BEQ, BNE, BLEZ, BGTZ, ADDI, ADDIU, SLTI, SLTIU,
+    ANDI, ORI, XORI, LLO, LHI, TRAP,
+    LB, LH, LW, LBU, LHU, SB, SH, SW, LL, SC,
+    J, JAL,
+    INVALID,     // unknown opcode/function; rd holds the InstructionFormat
+    COUNT
+};
+
+// Packed, trivially-copyable decoded instruction (8 bytes).
+// `imm` is ready to use: sign/zero-extended immediate, shift amount for
+// sll/srl/sra, pre-shifted upper half for lhi, byte offset for branches and
+// the pre-shifted 28-bit target for j/jal.
+struct DecodedInstruction {
+    Operation op;
+    uint8_t rs;
+    uint8_t rt;
+    uint8_t rd;
+    uint32_t imm;
+};
+
+static_assert(sizeof(DecodedInstruction) == 8, "DecodedInstruction must stay 8 bytes");
+static_assert(std::is_trivially_copyable<DecodedInstruction>::value, "DecodedInstruction must be trivially copyable");
+
 class InstructionUtils {
 public:
     // Encoding: Convert instruction to 32-bit binary
@@ -130,11 +168,17 @@ public:
     // Decoding: Convert 32-bit binary to instruction
     static Instruction decode(uint32_t binary);
     
+    // Table-driven decoding into the compact form used by the run loops
+    static DecodedInstruction predecode(uint32_t binary);
+    static DecodedInstruction predecode(const Instruction& instr);
+    
     // Get instruction format
     static InstructionFormat get_format(const Instruction& instr);
+    static InstructionFormat get_format(const DecodedInstruction& instr);
     
     // Get instruction name for debugging
     static std::string get_name(const Instruction& instr);
+    static std::string get_name(const DecodedInstruction& instr);
     
     // Helper functions for sign/zero extension
     static uint32_t sign_extend_16(uint16_t value);
@@ -153,11 +197,20 @@ private:
     static JInstruction decode_j_type(uint32_t binary);
 };
 
-// Forward declaration
+// Forward declarations
 class machine_state;
+class CallProfiler;
 
-// Instruction execution function type
-using InstructionHandler = std::function<void(machine_state&, const Instruction&)>;
+// Where the spawn and join syscalls go when several harts share one memory
+// (see HartGroup). Without one, spawn and join return -1.
+class HartHost {
+public:
+    virtual ~HartHost() = default;
+    virtual uint32_t spawn(machine_state& parent, uint32_t entry, uint32_t arg, uint32_t stack) = 0;
+    virtual uint32_t join(machine_state& caller, uint32_t hart) = 0;
+    // Held around every syscall that touches the shared streams
+    virtual std::mutex& io_mutex() = 0;
+};
 
 // Execution engine class
 class InstructionExecutor {
@@ -166,81 +219,105 @@ public:
     
     // Execute a single instruction
     void execute(machine_state& state, const Instruction& instr);
+    void execute(machine_state& state, const DecodedInstruction& instr);
+    // Same, for a loop that knows its memory backend at compile time
+    // (Checked: CHECKED memory) and whether anything observes it (Observed:
+    // accesses go to the attached cache model, calls to the profiler);
+    // instantiated for all four
+    template <bool Checked, bool Observed = false>
+    void execute(machine_state& state, const DecodedInstruction& instr);
     
     // Set custom I/O streams for testing
     void set_io_streams(std::istream& input, std::ostream& output);
+
+    // Route spawn/join to `host` and serialize stream syscalls with its lock
+    void set_hart_host(HartHost* host) { harts = host; }
+
+    // Report jal/jalr as calls and jr $ra as returns to `p` from observed
+    // execute(); null stops it
+    void set_profiler(CallProfiler* p) { profiler = p; }
+
+    // Direction of the last conditional branch observed execute() ran
+    bool last_branch_taken() const { return branch_taken; }
+
+    // Raises the address error for a guarded-memory fault at guest address
+    // `fault_address`, taken by the fetch or the instruction at the PC. A
+    // load or store reports its effective address as BadVAddr instead.
+    static void raise_trapped_fault(machine_state& state, uint32_t fault_address);
+
+    // Executor's error for the fault that halted `state`, worded from the
+    // instruction at its EPC
+    static std::string fault_message(const machine_state& state);
     
 private:
     // I/O stream references for syscalls
     std::istream& input_stream;
     std::ostream& output_stream;
-    
-    // Handler map for different instructions
-    std::unordered_map<std::string, InstructionHandler> handlers;
-    
-    // Initialize all instruction handlers
-    void init_handlers();
-    
-    // Helper function to get instruction key for handler lookup
-    std::string get_instruction_key(const Instruction& instr);
+    HartHost* harts = nullptr;
+    CallProfiler* profiler = nullptr;
+    bool branch_taken = false;
     
     // Individual instruction implementations
     // R-type instruction handlers
-    void execute_sll(machine_state& state, const RInstruction& instr);
-    void execute_srl(machine_state& state, const RInstruction& instr);
-    void execute_sra(machine_state& state, const RInstruction& instr);
-    void execute_sllv(machine_state& state, const RInstruction& instr);
-    void execute_srlv(machine_state& state, const RInstruction& instr);
-    void execute_srav(machine_state& state, const RInstruction& instr);
-    void execute_jr(machine_state& state, const RInstruction& instr);
-    void execute_jalr(machine_state& state, const RInstruction& instr);
-    void execute_mfhi(machine_state& state, const RInstruction& instr);
-    void execute_mthi(machine_state& state, const RInstruction& instr);
-    void execute_mflo(machine_state& state, const RInstruction& instr);
-    void execute_mtlo(machine_state& state, const RInstruction& instr);
-    void execute_mult(machine_state& state, const RInstruction& instr);
-    void execute_multu(machine_state& state, const RInstruction& instr);
-    void execute_div(machine_state& state, const RInstruction& instr);
-    void execute_divu(machine_state& state, const RInstruction& instr);
-    void execute_add(machine_state& state, const RInstruction& instr);
-    void execute_addu(machine_state& state, const RInstruction& instr);
-    void execute_sub(machine_state& state, const RInstruction& instr);
-    void execute_subu(machine_state& state, const RInstruction& instr);
-    void execute_and(machine_state& state, const RInstruction& instr);
-    void execute_or(machine_state& state, const RInstruction& instr);
-    void execute_xor(machine_state& state, const RInstruction& instr);
-    void execute_nor(machine_state& state, const RInstruction& instr);
-    void execute_slt(machine_state& state, const RInstruction& instr);
-    void execute_sltu(machine_state& state, const RInstruction& instr);
+    void execute_sll(machine_state& state, const DecodedInstruction& instr);
+    void execute_srl(machine_state& state, const DecodedInstruction& instr);
+    void execute_sra(machine_state& state, const DecodedInstruction& instr);
+    void execute_sllv(machine_state& state, const DecodedInstruction& instr);
+    void execute_srlv(machine_state& state, const DecodedInstruction& instr);
+    void execute_srav(machine_state& state, const DecodedInstruction& instr);
+    template <bool Observed> void execute_jr(machine_state& state, const DecodedInstruction& instr);
+    template <bool Observed> void execute_jalr(machine_state& state, const DecodedInstruction& instr);
+    void execute_mfhi(machine_state& state, const DecodedInstruction& instr);
+    void execute_mthi(machine_state& state, const DecodedInstruction& instr);
+    void execute_mflo(machine_state& state, const DecodedInstruction& instr);
+    void execute_mtlo(machine_state& state, const DecodedInstruction& instr);
+    void execute_mult(machine_state& state, const DecodedInstruction& instr);
+    void execute_multu(machine_state& state, const DecodedInstruction& instr);
+    void execute_div(machine_state& state, const DecodedInstruction& instr);
+    void execute_divu(machine_state& state, const DecodedInstruction& instr);
+    void execute_add(machine_state& state, const DecodedInstruction& instr);
+    void execute_addu(machine_state& state, const DecodedInstruction& instr);
+    void execute_sub(machine_state& state, const DecodedInstruction& instr);
+    void execute_subu(machine_state& state, const DecodedInstruction& instr);
+    void execute_and(machine_state& state, const DecodedInstruction& instr);
+    void execute_or(machine_state& state, const DecodedInstruction& instr);
+    void execute_xor(machine_state& state, const DecodedInstruction& instr);
+    void execute_nor(machine_state& state, const DecodedInstruction& instr);
+    void execute_slt(machine_state& state, const DecodedInstruction& instr);
+    void execute_sltu(machine_state& state, const DecodedInstruction& instr);
+    void execute_sync(machine_state& state, const DecodedInstruction& instr);
 
     // I-type instruction handlers
-    void execute_beq(machine_state& state, const IInstruction& instr);
-    void execute_bne(machine_state& state, const IInstruction& instr);
-    void execute_blez(machine_state& state, const IInstruction& instr);
-    void execute_bgtz(machine_state& state, const IInstruction& instr);
-    void execute_addi(machine_state& state, const IInstruction& instr);
-    void execute_addiu(machine_state& state, const IInstruction& instr);
-    void execute_slti(machine_state& state, const IInstruction& instr);
-    void execute_sltiu(machine_state& state, const IInstruction& instr);
-    void execute_andi(machine_state& state, const IInstruction& instr);
-    void execute_ori(machine_state& state, const IInstruction& instr);
-    void execute_xori(machine_state& state, const IInstruction& instr);
-    void execute_llo(machine_state& state, const IInstruction& instr);
-    void execute_lhi(machine_state& state, const IInstruction& instr);
-    void execute_lb(machine_state& state, const IInstruction& instr);
-    void execute_lh(machine_state& state, const IInstruction& instr);
-    void execute_lw(machine_state& state, const IInstruction& instr);
-    void execute_lbu(machine_state& state, const IInstruction& instr);
-    void execute_lhu(machine_state& state, const IInstruction& instr);
-    void execute_sb(machine_state& state, const IInstruction& instr);
-    void execute_sh(machine_state& state, const IInstruction& instr);
-    void execute_sw(machine_state& state, const IInstruction& instr);
+    template <bool Observed> void execute_beq(machine_state& state, const DecodedInstruction& instr);
+    template <bool Observed> void execute_bne(machine_state& state, const DecodedInstruction& instr);
+    template <bool Observed> void execute_blez(machine_state& state, const DecodedInstruction& instr);
+    template <bool Observed> void execute_bgtz(machine_state& state, const DecodedInstruction& instr);
+    void execute_addi(machine_state& state, const DecodedInstruction& instr);
+    void execute_addiu(machine_state& state, const DecodedInstruction& instr);
+    void execute_slti(machine_state& state, const DecodedInstruction& instr);
+    void execute_sltiu(machine_state& state, const DecodedInstruction& instr);
+    void execute_andi(machine_state& state, const DecodedInstruction& instr);
+    void execute_ori(machine_state& state, const DecodedInstruction& instr);
+    void execute_xori(machine_state& state, const DecodedInstruction& instr);
+    void execute_llo(machine_state& state, const DecodedInstruction& instr);
+    void execute_lhi(machine_state& state, const DecodedInstruction& instr);
+    // Checked=false is for GUARDED memory: raw accesses, faults trapped by the run loop
+    template <bool Checked, bool Observed> void execute_lb(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_lh(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_lw(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_lbu(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_lhu(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_sb(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_sh(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_sw(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_ll(machine_state& state, const DecodedInstruction& instr);
+    template <bool Checked, bool Observed> void execute_sc(machine_state& state, const DecodedInstruction& instr);
 
     // J-type instruction handlers
-    void execute_j(machine_state& state, const JInstruction& instr);
-    void execute_jal(machine_state& state, const JInstruction& instr);
+    void execute_j(machine_state& state, const DecodedInstruction& instr);
+    template <bool Observed> void execute_jal(machine_state& state, const DecodedInstruction& instr);
 
     // Syscall handling
-    void execute_trap(machine_state& state, const IInstruction& instr);
-    void handle_syscall(machine_state& state, Syscall syscall_num);
+    template <bool Observed> void execute_trap(machine_state& state, const DecodedInstruction& instr);
+    template <bool Observed> void handle_syscall(machine_state& state, Syscall syscall_num);
 };
\ No newline at end of file
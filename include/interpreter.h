@@ -1,8 +1,13 @@
 #pragma once
 
 #include "parser.h"
+#include "assembly_cache.h"
 #include "machine_state.h"
 #include "instruction.h"
+#include "call_profiler.h"
+#include "coverage.h"
+#include "run_budget.h"
+#include <memory>
 #include <string>
 #include <iostream>
 #include <cstdint>
@@ -10,9 +15,29 @@
 class Interpreter {
 public:
     Interpreter();
-    machine_state run_stream(std::istream& input, uint64_t max_steps = 10000000ULL);
-    machine_state run_file(const std::string& filename, uint64_t max_steps = 10000000ULL);
+    machine_state run_stream(std::istream& input, uint64_t max_steps = 10000000ULL,
+                             MemoryBackend memory = MemoryBackend::CHECKED);
+    machine_state run_file(const std::string& filename, uint64_t max_steps = 10000000ULL,
+                           MemoryBackend memory = MemoryBackend::CHECKED);
+    machine_state run(const AssembledSource& program, uint64_t max_steps = 10000000ULL,
+                      MemoryBackend memory = MemoryBackend::CHECKED);
+
+    // Reuse assembled sources kept in `directory` (see AssemblyCache); empty turns it off
+    void set_cache_directory(const std::string& directory);
+    // Feed fetches and data accesses of later runs to `model`; null stops it
+    void set_cache_model(CacheHierarchy* model);
+    // Profile calls of later runs into `p`, naming functions by the program's labels; null stops it
+    void set_profiler(CallProfiler* p);
+    // Mark the instructions later runs execute in `map`; null stops it
+    void set_coverage(CoverageMap* map);
+    // Report what each later run used into `u` (no time limit); null stops it
+    void set_usage(ResourceUsage* u);
 
 private:
     Parser parser;
+    std::unique_ptr<AssemblyCache> cache;
+    CacheHierarchy* caches = nullptr;
+    CallProfiler* profiler = nullptr;
+    CoverageMap* coverage = nullptr;
+    ResourceUsage* usage = nullptr;
 };
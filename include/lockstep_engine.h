@@ -0,0 +1,63 @@
+#pragma once
+
+#include "machine_state.h"
+#include "instruction.h"
+#include "decode_batch.h"
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Outcome of one instance run by LockstepEngine
+struct LaneResult {
+    std::string output;                     // everything the guest printed
+    std::string error;                      // error Executor would have thrown, empty after trap 5
+    GuestFault fault;                       // the fault behind `error`; cause NONE otherwise
+    uint64_t steps = 0;                     // instructions executed
+    std::array<uint32_t, 32> registers{};
+    uint32_t pc = 0;
+    uint32_t hi = 0;
+    uint32_t lo = 0;
+};
+
+// Runs one image over many stdin inputs, a group of lanes at a time.
+//
+// Lanes keep their registers as structure-of-arrays so that one decoded
+// instruction updates every lane with vector ALU ops (AVX2 when the CPU has
+// it, SSE2 otherwise). Each step runs the lanes at the lowest PC; lanes that
+// branched elsewhere wait, so divergent lanes run as separate groups and
+// merge again when their PCs meet. Memory is one machine_state per lane;
+// loads, stores and syscalls run lane by lane with InstructionExecutor's
+// semantics. Every lane ends exactly as Executor::run_stream would with the
+// same input (STEP mode, checked memory).
+class LockstepEngine {
+public:
+    static constexpr size_t kMaxLanes = 64;
+
+    // `image` as loaded at address 0 (header already stripped)
+    LockstepEngine(std::vector<uint8_t> image, uint32_t entry);
+    ~LockstepEngine();
+
+    // One result per input, in input order. `lanes` (rounded up to a
+    // multiple of 8, at most kMaxLanes) instances run side by side.
+    std::vector<LaneResult> run(const std::vector<std::string>& inputs, uint64_t max_steps = 100000ULL,
+                                size_t lanes = 16);
+
+    // Vector code used for ALU steps; unavailable backends fall back to SCALAR
+    void set_backend(DecodeBackend backend);
+    DecodeBackend backend() const { return vector_backend; }
+
+private:
+    struct Lane;
+    struct Group;
+
+    void run_group(Group& group, uint64_t max_steps);
+    void reset_lane(Lane& lane, const std::string& input);
+
+    std::vector<uint8_t> image;
+    uint32_t entry;
+    DecodeBackend vector_backend;
+    std::vector<std::unique_ptr<Lane>> lane_pool;
+    std::vector<uint64_t> dirty_lines;      // 64-byte lines stored to since the last reset
+};
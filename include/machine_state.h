@@ -1,5 +1,7 @@
 #pragma once
 
+#include "guest_memory.h"
+#include "cache_model.h"
 #include <array>
 #include <vector>
 #include <cstdint>
@@ -14,24 +16,74 @@ enum class Register : uint8_t {
     GP = 28, SP = 29, S8 = 30, RA = 31,
 };
 
+// Guest exception causes, numbered as the ExcCode field of the MIPS Cause register
+enum class ExceptionCause : uint8_t {
+    NONE = 0,
+    ADDRESS_LOAD = 4,           // load or fetch outside memory, unaligned ll
+    ADDRESS_STORE = 5,          // store outside memory, unaligned sc
+    SYSCALL = 8,                // trap with an unknown number
+    RESERVED_INSTRUCTION = 10,  // word that is no instruction
+    OVERFLOW = 12,              // add, addi or sub overflowed (only with a vector)
+};
+
+// The coprocessor 0 view of the last exception raised
+struct GuestFault {
+    ExceptionCause cause = ExceptionCause::NONE;
+    uint32_t epc = 0;           // the instruction that raised it
+    uint32_t bad_address = 0;   // BadVAddr of an address error
+
+    // A fetch from outside memory: no data access faults at its own valid PC
+    bool on_fetch() const { return cause == ExceptionCause::ADDRESS_LOAD && bad_address == epc; }
+};
+
 class machine_state {
 private:
 
     std::array<uint32_t, 32> registers{}; // 32 general registers
-    std::vector<uint8_t> memory; // Memory as a vector of bytes (dynamic size)
+    GuestMemory memory; // Guest memory (dynamic size)
     uint32_t pc; // Program counter
     uint32_t hi; // High word register
     uint32_t lo; // Low word register
 
+    // Link left by ll for the next sc: the word's address and the value read
+    bool linked = false;
+    uint32_t link_address = 0;
+    uint32_t link_value = 0;
+
+    CacheHierarchy* caches = nullptr;   // see attach_caches
+
+    // Guest exceptions (see raise_exception)
+    GuestFault last_fault;
+    uint32_t exception_vector = kNoVector;
+    bool in_handler = false;    // delivered and not yet returned from (EXL)
+    bool halted = false;        // raised with nobody to handle it
+
+    explicit machine_state(GuestMemory shared);
 
 public:
+    static constexpr uint32_t kNoVector = UINT32_MAX;
 
     // Initial size of memory
-    machine_state(size_t memory_size = 1024 * 1024);
+    machine_state(size_t memory_size = 1024 * 1024, MemoryBackend backend = MemoryBackend::CHECKED);
+
+    // Fresh registers over this state's memory, for another hart. This
+    // state must outlive the result and not resize its memory meanwhile.
+    machine_state share_memory();
 
     // Register access
-    uint32_t get_register(Register reg) const;
-    void set_register(Register reg, uint32_t value);
+    uint32_t get_register(Register reg) const { return registers[static_cast<uint8_t>(reg)]; }
+    void set_register(Register reg, uint32_t value) { set_reg(static_cast<uint8_t>(reg), value); }
+
+    // All 32, read-only: writes go through set_reg to keep $zero
+    const std::array<uint32_t, 32>& register_file() const { return registers; }
+
+    // Hot-path register access by raw 5-bit index (no enum conversion, no branch).
+    // $zero stays hardwired because every write resets slot 0 afterwards.
+    uint32_t reg(unsigned index) const { return registers[index]; }
+    void set_reg(unsigned index, uint32_t value) {
+        registers[index] = value;
+        registers[0] = 0;
+    }
 
     // Special registers access
     uint32_t get_pc() const { return pc; }
@@ -51,8 +103,152 @@ public:
     void write_memory16(uint32_t addr, uint16_t value);
     void write_memory32(uint32_t addr, uint32_t value);
 
+    // Unchecked access for the GUARDED backend: an out-of-range address
+    // faults in the reservation (see GuestMemory::run_trapped) instead of
+    // being tested here. On a CHECKED state, only for validated addresses.
+    // Modelled accesses are reported to the attached cache model; a run
+    // loop asks for them only when something observes it.
+    template <bool Modelled = false> uint8_t load8(uint32_t addr) const {
+        model<Modelled>(addr, 1);
+        return memory[addr];
+    }
+    template <bool Modelled = false> uint16_t load16(uint32_t addr) const {
+        model<Modelled>(addr, 2);
+        const uint8_t* p = memory.data() + addr;
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+    template <bool Modelled = false> uint32_t load32(uint32_t addr) const {
+        model<Modelled>(addr, 4);
+        return word_at(addr);
+    }
+    template <bool Modelled = false> void store8(uint32_t addr, uint8_t value) {
+        model<Modelled>(addr, 1);
+        memory[addr] = value;
+    }
+    template <bool Modelled = false> void store16(uint32_t addr, uint16_t value) {
+        model<Modelled>(addr, 2);
+        uint8_t* p = memory.data() + addr;
+        p[0] = value & 0xFF;
+        p[1] = (value >> 8) & 0xFF;
+    }
+    template <bool Modelled = false> void store32(uint32_t addr, uint32_t value) {
+        model<Modelled>(addr, 4);
+        uint8_t* p = memory.data() + addr;
+        p[0] = value & 0xFF;
+        p[1] = (value >> 8) & 0xFF;
+        p[2] = (value >> 16) & 0xFF;
+        p[3] = (value >> 24) & 0xFF;
+    }
+
+    // Word atomics for ll/sc. `addr` must be 4-byte aligned and, on a
+    // CHECKED state, already validated.
+    template <bool Modelled = false> uint32_t atomic_load32(uint32_t addr) const {
+        model<Modelled>(addr, 4);
+        return guest_word(__atomic_load_n(reinterpret_cast<const uint32_t*>(memory.data() + addr), __ATOMIC_SEQ_CST));
+    }
+    template <bool Modelled = false> bool atomic_cas32(uint32_t addr, uint32_t expected, uint32_t value) {
+        model<Modelled>(addr, 4);
+        uint32_t want = guest_word(expected);
+        return __atomic_compare_exchange_n(reinterpret_cast<uint32_t*>(memory.data() + addr), &want,
+                                           guest_word(value), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    // Instruction fetch by a run loop, at a PC already bounds-checked (or
+    // GUARDED); an attached cache model counts it as a fetch, not a load
+    template <bool Modelled = false> uint32_t fetch32(uint32_t addr) const {
+        if constexpr (Modelled) {
+            if (caches) caches->fetch(addr);
+        }
+        return word_at(addr);
+    }
+
+    // Report modelled fetches and data accesses to `model` (null detaches).
+    // The accesses are attributed to the current PC. read_memory*() and
+    // write_memory*(), and bulk host_range() copies made by syscalls and
+    // fused block operations, are not seen.
+    void attach_caches(CacheHierarchy* model) { caches = model; }
+    CacheHierarchy* attached_caches() const { return caches; }
+
+    // ll/sc link
+    void set_link(uint32_t addr, uint32_t value) {
+        linked = true;
+        link_address = addr;
+        link_value = value;
+    }
+    // True if linked to `addr` (its value goes to `value`); clears the link
+    bool take_link(uint32_t addr, uint32_t& value) {
+        bool hit = linked && link_address == addr;
+        value = link_value;
+        linked = false;
+        return hit;
+    }
+    void clear_link() { linked = false; }
+
+    // Faults are a status, not a C++ exception. With a vector installed and
+    // no handler running, the guest handles the exception: the fault is
+    // recorded, $k0 = EPC, $k1 = cause code, and the PC moves to the vector.
+    // Otherwise the state halts at the faulting instruction (faulted()) and
+    // the run loop stops for its caller to report fault().
+    void raise_exception(ExceptionCause cause, uint32_t bad_address = 0);
+    bool faulted() const { return halted; }
+    const GuestFault& fault() const { return last_fault; }
+    // Lets a halted state run again, from its PC
+    void clear_fault() { halted = false; }
+    // No vector, no handler running, no fault: as constructed
+    void reset_exceptions() {
+        last_fault = GuestFault();
+        exception_vector = kNoVector;
+        in_handler = false;
+        halted = false;
+    }
+
+    // kNoVector removes the handler. Overflow only raises with one installed;
+    // without, add/addi/sub wrap like their unsigned forms.
+    void set_exception_vector(uint32_t address) { exception_vector = address; }
+    uint32_t get_exception_vector() const { return exception_vector; }
+    bool has_exception_vector() const { return exception_vector != kNoVector; }
+    // eret: leave the handler and resume at $k0
+    void return_from_exception() {
+        in_handler = false;
+        pc = get_register(Register::K0);
+    }
+
     // Memory management
     size_t get_memory_size() const { return memory.size(); }
     void resize_memory(size_t new_size);
     void load_memory(uint32_t addr, const std::vector<uint8_t>& data);
+    // Image at address 0, shared copy-on-write where possible (GuestMemory::map_image)
+    void map_image(const SharedImage& image) { memory.map_image(image); }
+
+    // Host view of guest bytes [addr, addr + size) for bulk operations
+    uint8_t* host_range(uint32_t addr, size_t size) {
+        if (!is_valid_address(addr, size)) {
+            throw std::out_of_range("Memory range out of bounds");
+        }
+        return memory.data() + addr;
+    }
+    MemoryBackend memory_backend() const { return memory.backend(); }
+    bool bounds_checked() const { return memory.backend() == MemoryBackend::CHECKED; }
+    const GuestMemory& guest_memory() const { return memory; }
+
+private:
+    template <bool Modelled> void model(uint32_t addr, unsigned size) const {
+        if constexpr (Modelled) {
+            if (caches) caches->data(pc, addr, size);
+        }
+    }
+
+    uint32_t word_at(uint32_t addr) const {
+        const uint8_t* p = memory.data() + addr;
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    // Guest words are little-endian in memory; swaps on big-endian hosts
+    static uint32_t guest_word(uint32_t host) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_bswap32(host);
+#else
+        return host;
+#endif
+    }
 };
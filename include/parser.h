@@ -49,14 +49,61 @@ struct LabelInfo {
     LabelInfo(const std::string& n, uint32_t addr) : name(n), address(addr) {}
 };
 
+// Source line (1-based) an instruction was assembled from
+struct SourceLine {
+    uint32_t address;
+    uint32_t line;
+};
+
 // Parse result containing instructions/directives and labels
 struct ParseResult {
     std::vector<ParsedLine> lines;
     std::unordered_map<std::string, uint32_t> labels;
     uint32_t main_address;  // Address of main label
     bool has_main;
+    // Section sizes from the first pass; data follows text at address text_size
+    uint32_t text_size;
+    uint32_t data_size;
+    // One entry per instruction, in address order
+    std::vector<SourceLine> source_lines;
+
+    ParseResult() : main_address(0), has_main(false), text_size(0), data_size(0) {}
+};
+
+// Where generate_binary puts the image, in address order from the sink's start
+class BinaryEmitter {
+public:
+    virtual ~BinaryEmitter() = default;
+
+    virtual void emit(const uint8_t* bytes, size_t count) = 0;
+    // `count` zero bytes (.space, .align padding)
+    virtual void emit_zeros(size_t count) = 0;
+    // Bytes emitted so far
+    virtual size_t size() const = 0;
+
+    // Little-endian, as guest memory holds it
+    void emit32(uint32_t value) {
+        uint8_t bytes[4] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+                            static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+        emit(bytes, 4);
+    }
+};
+
+// Emits straight into guest memory from `base`. Zeros are not written, so
+// the memory must be fresh (or already zero there). Throws
+// std::out_of_range if the image would not fit.
+class MemoryEmitter : public BinaryEmitter {
+public:
+    explicit MemoryEmitter(machine_state& state, uint32_t base = 0) : state(state), base(base) {}
+
+    void emit(const uint8_t* bytes, size_t count) override;
+    void emit_zeros(size_t count) override;
+    size_t size() const override { return at; }
 
-    ParseResult() : main_address(0), has_main(false) {}
+private:
+    machine_state& state;
+    uint32_t base;
+    size_t at = 0;
 };
 
 class Parser {
@@ -74,6 +121,8 @@ public:
 
     // Generate binary data from parse result
     std::vector<uint8_t> generate_binary(const ParseResult& result);
+    // Same bytes, handed to `out` as they are encoded
+    void generate_binary(const ParseResult& result, BinaryEmitter& out);
 
     // Get memory size needed for the program
     uint32_t calculate_memory_size(const ParseResult& result);
@@ -136,6 +185,7 @@ private:
     void first_pass(const std::vector<std::string>& lines,
                     std::vector<std::tuple<std::string,bool,uint32_t,bool>>& items,
                     std::vector<std::tuple<std::string,bool,uint32_t>>& labels_raw,
+                    std::vector<SourceLine>& source_lines,
                     uint32_t& text_size,
                     uint32_t& data_size);
 
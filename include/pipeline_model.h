@@ -0,0 +1,94 @@
+#pragma once
+
+#include "instruction.h"
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+// Guesses the direction of conditional branches for PipelineModel
+class BranchPredictor {
+public:
+    virtual ~BranchPredictor() = default;
+    virtual const char* name() const = 0;
+    // `target` is where the branch goes if taken
+    virtual bool predict(uint32_t pc, uint32_t target) = 0;
+    virtual void update(uint32_t pc, bool taken) = 0;
+
+    // "static" (backward taken, forward not), "2bit" (per-PC saturating
+    // counters) or "gshare" (counters indexed by PC xor global history);
+    // `bits` sizes the counter tables. Throws std::runtime_error otherwise.
+    static std::unique_ptr<BranchPredictor> create(const std::string& name, unsigned bits = 12);
+};
+
+// Latencies and penalties in cycles
+struct PipelineConfig {
+    uint32_t mult_latency = 4;      // mult/multu until hi/lo can be read
+    uint32_t div_latency = 32;      // div/divu likewise; the unit takes one operation at a time
+    uint32_t mispredict_penalty = 2;    // branches resolve in EX
+    uint32_t jump_penalty = 1;          // j/jal targets are known in ID
+    uint32_t indirect_penalty = 2;      // jr/jalr targets come from EX
+};
+
+// Cycle-approximate timing of a classic IF/ID/EX/MEM/WB pipeline, fed
+// each retired instruction by the run loop (ExecutorOptions::timing). It is
+// single-issue and in order, and has full forwarding, so an instruction
+// waits only when:
+// - it uses a register loaded by the instruction just before it;
+// - it reads hi/lo, or starts a mult/div, before the previous one is done;
+// - it follows a mispredicted branch or a jump.
+// Stall cycles are charged to the PC that waited, bubbles after a branch or
+// jump to that branch or jump.
+class PipelineModel {
+public:
+    enum Stall { LOAD_USE, HILO, MISPREDICT, JUMP, STALL_KINDS };
+
+    PipelineModel(const PipelineConfig& config, std::unique_ptr<BranchPredictor> predictor);
+
+    // `taken` is the direction a conditional branch went, as the executor
+    // evaluated it (InstructionExecutor::last_branch_taken); other
+    // instructions ignore it
+    void retire(uint32_t pc, const DecodedInstruction& instr, bool taken);
+
+    struct PcTiming {
+        uint64_t executed = 0;
+        std::array<uint64_t, STALL_KINDS> stalls{};
+    };
+
+    uint64_t instructions() const { return retired; }
+    // Including the four cycles to fill the pipeline
+    uint64_t cycles() const { return retired ? retired + total_stalls() + 4 : 0; }
+    double cpi() const { return retired ? static_cast<double>(cycles()) / retired : 0.0; }
+    uint64_t stalls(Stall kind) const { return stall_cycles[kind]; }
+    uint64_t total_stalls() const;
+    uint64_t branches() const { return branch_count; }
+    uint64_t mispredictions() const { return mispredict_count; }
+    // Keyed by PC; only PCs that retired have an entry
+    const std::unordered_map<uint32_t, PcTiming>& pc_timing() const { return per_pc; }
+    const BranchPredictor& branch_predictor() const { return *predictor; }
+
+    // CPI, the stall breakdown and the `top` PCs that waited longest
+    void report(std::ostream& out, size_t top = 10) const;
+
+    static const char* stall_name(Stall kind);
+
+private:
+    void stall(Stall kind, uint64_t cycles, PcTiming& at);
+
+    PipelineConfig config;
+    std::unique_ptr<BranchPredictor> predictor;
+    std::unordered_map<uint32_t, PcTiming> per_pc;
+
+    uint64_t now = 0;               // cycle the current instruction enters EX
+    uint64_t retired = 0;
+    uint64_t hilo_ready = 0;        // first cycle hi/lo may be read
+    uint64_t load_issue = 0;        // EX cycle of the last load
+    uint8_t load_target = 0;        // its destination; 0 when the last instruction was no load
+    uint64_t branch_count = 0;
+    uint64_t mispredict_count = 0;
+    std::array<uint64_t, STALL_KINDS> stall_cycles{};
+};
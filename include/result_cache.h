@@ -0,0 +1,53 @@
+#pragma once
+
+#include "executor.h"
+#include <array>
+#include <string>
+#include <cstdint>
+
+// One finished run, as mips_executor reports it
+struct RunRecord {
+    std::string output;                     // guest stdout
+    std::string error;                      // what Executor threw; empty after trap 5
+    std::array<uint32_t, 32> registers{};   // final state, all zero after an error
+    uint32_t pc = 0;
+    uint32_t hi = 0;
+    uint32_t lo = 0;
+
+    bool failed() const { return !error.empty(); }
+};
+
+// Results of deterministic runs kept on disk, so repeating a run replays it
+// without executing anything. Entries are keyed by XXH64 of the image, the
+// stdin bytes, max_steps and the start PC; a second digest with another
+// seed is stored inside to catch collisions. Unreadable or mismatched
+// entries count as misses. Entries are written to a temporary file and
+// renamed, so processes sharing a directory never see half an entry.
+class ResultCache {
+public:
+    struct Key {
+        uint64_t name;      // file name
+        uint64_t check;     // stored in the file
+    };
+
+    explicit ResultCache(std::string directory);
+
+    // Only single-hart runs without a trace, model, profiler, coverage map, time limit or usage report
+    // depend on nothing but the key
+    static bool cacheable(const ExecutorOptions& options);
+    static Key key(const Program& program, const std::string& input, const ExecutorOptions& options);
+
+    bool lookup(const Key& key, RunRecord& record) const;
+    // False if the entry could not be written; the run itself is unaffected
+    bool store(const Key& key, const RunRecord& record) const;
+
+    // Runs `program` with `input` as stdin, or replays the cached result.
+    // options.input/output are ignored; `hit` reports whether it replayed.
+    RunRecord run(const Program& program, const std::string& input, const ExecutorOptions& options,
+                  bool* hit = nullptr) const;
+
+private:
+    std::string path(const Key& key) const;
+
+    std::string directory;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "machine_state.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <cstdint>
+
+// How a run loop ended
+enum class RunStop : uint8_t {
+    EXITED,         // trap 5
+    FAULTED,        // a guest fault nobody handled (machine_state::faulted)
+    STEP_LIMIT,     // max_steps instructions ran
+    TIME_LIMIT,     // the Watchdog fired
+    STOPPED,        // asked to by its HartGroup
+    REACHED,        // a Vm::run_until target
+};
+
+const char* run_stop_name(RunStop stop);
+
+// Guest memory is sized and reported in pages of this many bytes
+constexpr uint32_t kGuestPageSize = 4096;
+
+// What one Executor or Interpreter run used, filled in whether it returns
+// or throws
+struct ResourceUsage {
+    RunStop stop = RunStop::EXITED;             // how the main hart's run ended
+    uint64_t instructions = 0;                  // run by the main hart
+    uint64_t max_steps = 0;
+    std::chrono::nanoseconds wall_time{0};
+    std::chrono::milliseconds time_limit{0};    // 0: none
+    uint32_t pages_touched = 0;                 // guest pages the host has backed with memory
+    uint32_t memory_pages = 0;
+    GuestFault fault;                           // what ended a FAULTED run; cause NONE otherwise
+
+    // One line per resource, for stderr
+    void report(std::ostream& out) const;
+};
+
+// Run loops count their step budget down a slice at a time and look at the
+// stop flags only between slices (and between blocks), so the limits cost
+// nothing per instruction. A raised flag is seen within kBudgetSlice steps.
+constexpr uint64_t kBudgetSlice = 4096;
+
+// Steps a loop may run before it checks again, having run `steps` of
+// `max_steps`; 0 once the budget is spent
+inline uint64_t budget_slice(uint64_t steps, uint64_t max_steps) {
+    if (steps >= max_steps) return 0;
+    return max_steps - steps < kBudgetSlice ? max_steps - steps : kBudgetSlice;
+}
+
+// A step loop's instruction count. Only `countdown` moves per instruction;
+// `steps` is derived from it at the end of each slice and when the loop
+// returns. A trapped guarded-memory fault leaves the loop mid-slice, so
+// whoever traps it calls trapped() first.
+struct StepCountdown {
+    explicit StepCountdown(uint64_t& steps) : steps(steps) {}
+
+    // Opens the next slice of the `max_steps` budget; false once it is spent
+    bool next_slice(uint64_t max_steps) {
+        countdown = budget_slice(steps, max_steps);
+        end = steps + countdown;
+        return countdown != 0;
+    }
+    // `steps` with the instruction in flight counted
+    uint64_t running() const { return end - countdown + 1; }
+    // After the last instruction of a slice
+    void finish_slice() { steps = end; }
+    // Ends the slice in the middle of an instruction, which counts
+    RunStop leave(RunStop why) {
+        steps = running();
+        countdown = 0;
+        return why;
+    }
+    void trapped() {
+        if (countdown) leave(RunStop::FAULTED);
+    }
+
+    uint64_t& steps;
+    uint64_t end = 0;           // `steps` once the slice is done
+    uint64_t countdown = 0;     // instructions left in it, the one in flight included
+};
+
+// Raises expired() once `limit` has passed, from a thread of its own, so
+// run loops poll a flag instead of reading the clock. A zero limit starts
+// no thread. Destroying it before then cancels it. A guest blocked reading
+// stdin is not interrupted.
+class Watchdog {
+public:
+    explicit Watchdog(std::chrono::milliseconds limit);
+    ~Watchdog();
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+    // Null without a limit
+    const std::atomic<bool>* flag() const { return armed ? &fired : nullptr; }
+    bool expired() const { return fired.load(std::memory_order_relaxed); }
+
+private:
+    bool armed;
+    std::atomic<bool> fired{false};
+    std::mutex lock;
+    std::condition_variable wake;
+    bool cancelled = false;
+    std::thread thread;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "executor.h"
+#include "run_budget.h"
+#include <array>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// Settings for a Vm, applied by each load()
+struct VmOptions {
+    uint32_t memory_pages = 256;                    // guest memory size in kGuestPageSize pages
+    MemoryBackend memory = MemoryBackend::CHECKED;
+    uint32_t start_address = UINT32_MAX;            // UINT32_MAX: header main address, else 0
+    std::istream* input = nullptr;                  // guest stdin; null: std::cin
+    std::ostream* output = nullptr;                 // guest stdout; null: std::cout
+};
+
+// One guest hart for embedding: load a program, then drive it in bounded
+// slices from the caller's own loop. Unlike Executor a run never throws for
+// the guest's sake; step() and run_until() return how they ended and leave
+// the state in place for the caller to inspect, change and resume.
+//
+// Each instruction is stepped as in Executor's STEP mode. Not thread-safe;
+// the spawn and join syscalls fail as they do for a single hart.
+class Vm {
+public:
+    // Replaces the syscall `trap <code>` would make. It reads its arguments
+    // from the registers and leaves results there; the PC then moves past
+    // the trap unless the hook changed it. A hook must not run the Vm.
+    using SyscallHook = std::function<void(Vm&)>;
+    // Tested after every instruction by run_until()
+    using Condition = std::function<bool(const machine_state&)>;
+
+    explicit Vm(VmOptions options = VmOptions());
+    ~Vm();
+
+    Vm(const Vm&) = delete;
+    Vm& operator=(const Vm&) = delete;
+
+    // Fresh memory and registers holding `program`, at its entry point.
+    // Throws std::runtime_error for an unreadable image or a bad start PC.
+    void load(std::shared_ptr<const Program> program);
+    void load(std::istream& binary);
+    void load_file(const std::string& filename);
+
+    // Run at most `n` instructions: EXITED, FAULTED or STEP_LIMIT once all
+    // `n` ran. An exited or faulted Vm returns at once without running.
+    RunStop step(uint64_t n = 1);
+    // As step(max_steps), but REACHED as soon as the next instruction is at
+    // `pc` or `condition` holds. At least one instruction runs.
+    RunStop run_until(uint32_t pc, uint64_t max_steps = UINT64_MAX);
+    RunStop run_until(const Condition& condition, uint64_t max_steps = UINT64_MAX);
+
+    // Hooks apply from the next instruction on; an empty hook removes one.
+    // A hook on trap 5 runs before the exit.
+    void on_syscall(uint32_t code, SyscallHook hook);
+
+    bool loaded() const { return machine != nullptr; }
+    bool exited() const { return done; }
+    bool faulted() const { return machine && machine->faulted(); }
+    // The error Executor would have thrown for the fault
+    std::string fault_message() const;
+    // Instructions run since load()
+    uint64_t steps() const { return count; }
+
+    // Views into the guest, valid until the next load(); nothing is copied.
+    // The state can be changed between runs, e.g. clear_fault() to retry.
+    machine_state& state();
+    const machine_state& state() const;
+    const std::array<uint32_t, 32>& registers() const { return state().register_file(); }
+    uint32_t reg(Register r) const { return state().get_register(r); }
+    void set_reg(Register r, uint32_t value) { state().set_register(r, value); }
+    uint32_t pc() const { return state().get_pc(); }
+    // Guest bytes [addr, addr + size), or std::out_of_range
+    uint8_t* memory(uint32_t addr, size_t size) { return state().host_range(addr, size); }
+    size_t memory_size() const { return state().get_memory_size(); }
+
+private:
+    // Stop policies for run(), tested after each instruction
+    struct Unbounded;
+    struct AtPc;
+    struct When;
+
+    template <typename Until>
+    RunStop run(uint64_t max_steps, const Until& until);
+    template <typename Until>
+    RunStop run_trapped(uint64_t limit, const Until& until);
+    template <bool Checked, typename Until>
+    RunStop run_loop(uint64_t limit, const Until& until);
+
+    VmOptions options;
+    std::shared_ptr<const Program> program;
+    std::unique_ptr<machine_state> machine;
+    InstructionExecutor executor;
+    std::unordered_map<uint32_t, SyscallHook> hooks;
+    uint64_t count = 0;
+    bool done = false;
+    uint32_t hooked_trap = 0;       // code of the trap a loop stopped in front of
+};
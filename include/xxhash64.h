@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// XXH64 (xxHash, 64-bit variant), fed incrementally. Digests match the
+// reference implementation for the same bytes and seed.
+class XXHash64 {
+public:
+    explicit XXHash64(uint64_t seed = 0);
+
+    void update(const void* data, size_t size);
+    void update(const std::string& bytes) { update(bytes.data(), bytes.size()); }
+    template <typename T>
+    void update_value(T value) { update(&value, sizeof(value)); }  // host byte order
+
+    uint64_t digest() const;
+
+    static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+
+private:
+    uint64_t lanes[4];
+    uint8_t buffer[32];     // bytes not yet forming a whole 32-byte stripe
+    size_t buffered = 0;
+    uint64_t total = 0;
+    uint64_t seed;
+};
@@ -0,0 +1,113 @@
+#include "../../include/aot_runtime.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Checks and sizes guest memory as Executor::run does, so a translated
+// program fails with the same errors
+static size_t memory_size(uint32_t memory_pages) {
+    if (memory_pages == 0 || memory_pages > (uint64_t{1} << 32) / kGuestPageSize) {
+        throw std::runtime_error("Executor error: invalid guest memory size: " + std::to_string(memory_pages) +
+                                 " pages");
+    }
+    return size_t{memory_pages} * kGuestPageSize;
+}
+
+AotMachine::AotMachine(const AotImage& image, uint64_t max_steps, uint32_t memory_pages,
+                       std::chrono::milliseconds time_limit)
+    : state(memory_size(memory_pages)), max_steps(max_steps), watchdog(time_limit),
+      code_lo(image.code_lo), code_hi(image.code_hi) {
+    state.load_memory(0, std::vector<uint8_t>(image.bytes, image.bytes + image.size));
+    if (!state.is_valid_address(image.entry, 0)) {
+        throw std::runtime_error("Start PC is outside loaded binary memory: " + std::to_string(image.entry));
+    }
+    state.set_pc(image.entry);
+}
+
+void AotMachine::fail() const {
+    throw std::runtime_error(InstructionExecutor::fault_message(state));
+}
+
+// The limits are looked at a slice of steps at a time, as in mips_executor
+void AotMachine::next_slice() {
+    if (watchdog.expired()) {
+        throw std::runtime_error("Executor error: time limit exceeded.");
+    }
+    uint64_t slice = budget_slice(steps, max_steps);
+    if (slice == 0) {
+        throw std::runtime_error("Executor error: reached maximum instruction count limit.");
+    }
+    slice_end = steps + slice;
+}
+
+bool AotMachine::hits_code(const DecodedInstruction& instr) const {
+    uint32_t size;
+    switch (instr.op) {
+        case Operation::SB: size = 1; break;
+        case Operation::SH: size = 2; break;
+        case Operation::SW: case Operation::SC: size = 4; break;
+        default: return false;
+    }
+    uint32_t addr = state.reg(instr.rs) + instr.imm;
+    return addr < code_hi && uint64_t{addr} + size > code_lo;
+}
+
+bool AotMachine::interpret(bool to_exit) {
+    while (true) {
+        if (steps >= slice_end) next_slice();
+        ++steps;
+        uint32_t pc = state.get_pc();
+        if (!state.is_valid_address(pc, 4)) {
+            state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+            if (state.faulted()) fail();
+            continue;
+        }
+
+        DecodedInstruction instr = InstructionUtils::predecode(state.fetch32(pc));
+        code_dirty |= hits_code(instr);
+        executor.execute<true>(state, instr);
+        if (state.get_pc() == pc) {
+            if (state.faulted()) fail();
+            state.increment_pc();
+        }
+
+        if (instr.op == Operation::TRAP && instr.imm == 5) return true;
+        bool transfer = (instr.op >= Operation::BEQ && instr.op <= Operation::BGTZ) || instr.op == Operation::J ||
+                        instr.op == Operation::JAL || instr.op == Operation::JR || instr.op == Operation::JALR;
+        if (transfer && !to_exit) return false;
+    }
+}
+
+int aot_main(int argc, char** argv, const AotImage& image, void (*run)(AotMachine&)) {
+    uint64_t max_steps = 100000;
+    uint64_t time_limit = 0;
+    uint32_t memory_pages = 256;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            max_steps = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            time_limit = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            memory_pages = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [-m <N>] [-T <ms>] [-M <N>]\n"
+                      << "  -m <N>    max instruction steps (default 100000)\n"
+                      << "  -T <ms>   stop after <ms> milliseconds of wall-clock time\n"
+                      << "  -M <N>    N pages of 4 KiB guest memory (default 256)\n";
+            return 1;
+        }
+    }
+
+    try {
+        AotMachine machine(image, max_steps, memory_pages, std::chrono::milliseconds(time_limit));
+        run(machine);
+    } catch (const std::exception& e) {
+        std::cout << std::flush;
+        std::cerr << "Executor error: " << e.what() << std::endl;
+        return 2;
+    }
+    std::cout << std::flush;
+    return 0;
+}
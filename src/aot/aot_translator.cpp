@@ -0,0 +1,253 @@
+#include "../../include/aot_translator.h"
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Largest guest memory mips_executor accepts (-M): the 32-bit address space
+constexpr uint64_t kMaxMemory = uint64_t{1} << 32;
+
+// Head of every generated file: the runtime is AotMachine, from libmips
+const char* const kPrologue = R"(#include "aot_runtime.h"
+
+namespace {
+
+)";
+
+std::string hex(uint32_t value) {
+    std::ostringstream os;
+    os << "0x" << std::hex << std::setw(8) << std::setfill('0') << value << "u";
+    return os.str();
+}
+
+std::string label(uint32_t addr) {
+    std::ostringstream os;
+    os << "B_" << std::hex << std::setw(8) << std::setfill('0') << addr;
+    return os.str();
+}
+
+bool is_branch(Operation op) {
+    return op == Operation::BEQ || op == Operation::BNE || op == Operation::BLEZ || op == Operation::BGTZ;
+}
+
+bool is_store(Operation op) {
+    return op == Operation::SB || op == Operation::SH || op == Operation::SW || op == Operation::SC;
+}
+
+bool ends_block(const DecodedInstruction& d) {
+    switch (d.op) {
+        case Operation::BEQ: case Operation::BNE: case Operation::BLEZ: case Operation::BGTZ:
+        case Operation::J: case Operation::JAL: case Operation::JR: case Operation::JALR:
+        case Operation::INVALID:
+            return true;
+        case Operation::TRAP:
+            return d.imm == 5;
+        default:
+            return false;
+    }
+}
+
+uint32_t jump_target(uint32_t pc, const DecodedInstruction& d) {
+    return ((pc + 4) & 0xF0000000u) | d.imm;
+}
+
+// The decoded instruction as a C++ initializer, named in a comment
+std::string decoded(const DecodedInstruction& d) {
+    std::ostringstream os;
+    os << "{static_cast<Operation>(" << int(d.op) << "), " << int(d.rs) << ", " << int(d.rt) << ", " << int(d.rd)
+       << ", " << hex(d.imm) << "}";
+    return os.str();
+}
+
+} // namespace
+
+AotTranslator::AotTranslator(std::vector<uint8_t> image, uint32_t entry)
+    : bytes(std::move(image)), entry(entry) {
+    // Whether the image and entry fit the guest memory is up to -M at run time
+    if (bytes.size() > kMaxMemory) {
+        throw std::out_of_range("Memory load would exceed bounds");
+    }
+    discover();
+}
+
+bool AotTranslator::in_image(uint32_t addr) const {
+    return addr + size_t{4} <= bytes.size();
+}
+
+uint32_t AotTranslator::word_at(uint32_t addr) const {
+    return bytes[addr] | (bytes[addr + 1] << 8) | (bytes[addr + 2] << 16) |
+           (static_cast<uint32_t>(bytes[addr + 3]) << 24);
+}
+
+void AotTranslator::discover() {
+    // Pass 1: leaders reachable from the entry through static control flow.
+    // A transfer to the instruction itself falls through, as in the executor.
+    std::set<uint32_t> leaders;
+    std::vector<uint32_t> work;
+    auto add = [&](uint32_t addr) {
+        if (in_image(addr) && leaders.insert(addr).second) work.push_back(addr);
+    };
+    add(entry);
+
+    while (!work.empty()) {
+        uint32_t start = work.back();
+        work.pop_back();
+        for (uint32_t pc = start; in_image(pc); pc += 4) {
+            if (pc != start && leaders.count(pc)) break;
+            DecodedInstruction d = InstructionUtils::predecode(word_at(pc));
+            if (!ends_block(d)) continue;
+            if (is_branch(d.op)) {
+                add(pc + d.imm);
+                add(pc + 4);
+            } else if (d.op == Operation::J || d.op == Operation::JAL) {
+                add(jump_target(pc, d));
+                add(pc + 4);    // self-jump fallthrough, jal return address
+            } else if (d.op == Operation::JALR) {
+                add(pc + 4);
+            }
+            break;
+        }
+    }
+
+    // Pass 2: cut blocks at terminators and at the next leader
+    for (uint32_t start : leaders) {
+        AotBlock block{start, {}};
+        for (uint32_t pc = start; in_image(pc); pc += 4) {
+            if (pc != start && leaders.count(pc)) break;
+            DecodedInstruction d = InstructionUtils::predecode(word_at(pc));
+            block.code.push_back(d);
+            if (ends_block(d)) break;
+        }
+        code_lo = std::min(code_lo, start);
+        code_hi = std::max(code_hi, static_cast<uint32_t>(start + 4 * block.code.size()));
+        cfg.emplace(start, std::move(block));
+    }
+}
+
+void AotTranslator::emit_goto(std::ostream& out, uint32_t target) const {
+    if (cfg.count(target)) {
+        out << "goto " << label(target) << ";";
+    } else {
+        out << "{ m.set_pc(" << hex(target) << "); goto interpret; }";
+    }
+}
+
+void AotTranslator::emit_block(std::ostream& out, const AotBlock& block) const {
+    const size_t count = block.code.size();
+    out << label(block.start) << ":\n";
+    out << "    if (m.slice_end - m.steps < " << count << ") { m.set_pc(" << hex(block.start)
+        << "); goto interpret; }\n";
+    out << "    m.steps += " << count << ";\n";
+
+    uint32_t pc = block.start;
+    for (size_t i = 0; i < count; ++i, pc += 4) {
+        const DecodedInstruction& d = block.code[i];
+        const std::string name = InstructionUtils::get_name(d);
+        const std::string args = "(" + hex(pc) + ", " + decoded(d) + ")";
+
+        out << "    ";
+        switch (d.op) {
+            case Operation::BEQ: case Operation::BNE: case Operation::BLEZ: case Operation::BGTZ: {
+                uint32_t target = pc + d.imm;
+                if (target == pc) {
+                    out << "// " << name << " to itself falls through\n";
+                } else {
+                    out << "if (m.branch" << args << ") ";
+                    emit_goto(out, target);
+                    out << "  // " << name << "\n";
+                }
+                break;
+            }
+            case Operation::J:
+            case Operation::JAL: {
+                uint32_t target = jump_target(pc, d);
+                out << "m.step" << args << ";  // " << name << "\n";
+                if (target != pc) {
+                    out << "    ";
+                    emit_goto(out, target);
+                    out << "\n";
+                }
+                break;
+            }
+            case Operation::JR:
+            case Operation::JALR:
+                out << "m.jump" << args << ";  // " << name << "\n";
+                out << "    goto dispatch;\n";
+                break;
+            case Operation::TRAP:
+                if (d.imm == 5) {
+                    out << "m.step" << args << ";  // " << name << "\n";
+                    out << "    return;\n";
+                } else if ((d.imm & 0xFF) == 8 || (d.imm & 0xFF) == 9) {
+                    // Vectors and handlers are the interpreter's (see translatable); it runs this trap
+                    out << "{ m.steps -= " << (count - i) << "; m.set_pc(" << hex(pc) << "); goto interpret; }\n";
+                } else {
+                    out << "m.step" << args << ";  // " << name << "\n";
+                }
+                break;
+            default:
+                if (is_store(d.op)) {
+                    // Self-modifying code: finish in the interpreter with an exact step count
+                    out << "if (m.store" << args << ") { m.steps -= " << (count - i - 1) << "; m.set_pc("
+                        << hex(pc + 4) << "); goto interpret; }  // " << name << "\n";
+                } else {
+                    out << "m.step" << args << ";  // " << name << "\n";
+                }
+                break;
+        }
+    }
+
+    const DecodedInstruction& last = block.code.back();
+    bool open_end = !ends_block(last) || is_branch(last.op) ||
+                    ((last.op == Operation::J || last.op == Operation::JAL) && jump_target(pc - 4, last) == pc - 4);
+    if (open_end) {
+        out << "    ";
+        emit_goto(out, pc);
+        out << "\n";
+    }
+    out << "\n";
+}
+
+void AotTranslator::emit(std::ostream& out) const {
+    out << "// Generated by mips_aot: " << bytes.size() << "-byte image, entry " << hex(entry)
+        << ", " << cfg.size() << " blocks\n";
+    out << kPrologue;
+
+    // A header-only image still needs a non-empty array
+    out << "const unsigned char kImage[" << std::max<size_t>(bytes.size(), 1) << "] = {";
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        out << (i % 16 == 0 ? "\n    " : " ") << int(bytes[i]) << ",";
+    }
+    out << "\n};\n\n";
+
+    out << "void run(AotMachine& m) {\n";
+    out << "    goto dispatch;\n\n";
+    for (const auto& entry_block : cfg) {
+        emit_block(out, entry_block.second);
+    }
+
+    out << "dispatch:\n";
+    out << "    switch (m.pc()) {\n";
+    for (const auto& entry_block : cfg) {
+        out << "        case " << hex(entry_block.first) << ": goto " << label(entry_block.first) << ";\n";
+    }
+    out << "        default: goto interpret;\n";
+    out << "    }\n\n";
+    // What the interpreter ran may have dirtied translated code or installed
+    // a vector: only go back while it is still translatable
+    out << "interpret:\n";
+    out << "    if (m.translatable() && m.interpret(false)) return;\n";
+    out << "    if (m.translatable()) goto dispatch;\n";
+    out << "    m.interpret(true);\n";
+    out << "}\n\n";
+    out << "} // namespace\n\n";
+
+    out << "int main(int argc, char** argv) {\n";
+    out << "    const AotImage image{kImage, " << bytes.size() << ", " << hex(entry) << ", " << hex(code_lo) << ", "
+        << hex(code_hi) << "};\n";
+    out << "    return aot_main(argc, argv, image, run);\n";
+    out << "}\n";
+}
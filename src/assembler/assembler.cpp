@@ -1,5 +1,6 @@
 #include "../../include/assembler.h"
 #include "../../include/parser.h"
+#include "../../include/debug_info.h"
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -10,7 +11,11 @@ Assembler::Assembler() {
 std::vector<uint8_t> Assembler::assemble_stream(std::istream& input) {
     Parser parser;
     ParseResult result = parser.parse_assembly(input);
-    return parser.generate_binary(result);
+    std::vector<uint8_t> bytes = parser.generate_binary(result);
+    labels = std::move(result.labels);
+    lines = std::move(result.source_lines);
+    source.clear();
+    return bytes;
 }
 
 std::vector<uint8_t> Assembler::assemble_file(const std::string& filename) {
@@ -18,7 +23,9 @@ std::vector<uint8_t> Assembler::assemble_file(const std::string& filename) {
     if (!file) {
         throw std::runtime_error("Cannot open input file: " + filename);
     }
-    return assemble_stream(file);
+    std::vector<uint8_t> bytes = assemble_stream(file);
+    source = filename;
+    return bytes;
 }
 
 void Assembler::write_binary_to_stream(const std::vector<uint8_t>& bytes, std::ostream& out) {
@@ -32,3 +39,7 @@ void Assembler::write_binary_to_stream(const std::vector<uint8_t>& bytes, std::o
         }
     }
 }
+
+void Assembler::write_debug_section(std::ostream& out, uint64_t offset) const {
+    DebugInfo::write(out, offset, labels, lines, source);
+}
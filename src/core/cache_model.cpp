@@ -0,0 +1,175 @@
+#include "../../include/cache_model.h"
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+bool power_of_two(uint64_t v) {
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+uint32_t log2_of(uint64_t v) {
+    uint32_t shift = 0;
+    while ((uint64_t{1} << shift) < v) ++shift;
+    return shift;
+}
+
+uint32_t parse_size(const std::string& text, const std::string& spec) {
+    size_t used = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &used, 0);
+    } catch (const std::exception&) {
+        throw std::runtime_error("Cache model: bad size '" + text + "' in '" + spec + "'");
+    }
+    std::string suffix = text.substr(used);
+    if (suffix == "K" || suffix == "k") value <<= 10;
+    else if (suffix == "M" || suffix == "m") value <<= 20;
+    else if (!suffix.empty()) throw std::runtime_error("Cache model: bad size '" + text + "' in '" + spec + "'");
+    if (value > UINT32_MAX) throw std::runtime_error("Cache model: size too large in '" + spec + "'");
+    return static_cast<uint32_t>(value);
+}
+
+std::string percent(uint64_t part, uint64_t whole) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(2) << (whole ? 100.0 * part / whole : 0.0) << "%";
+    return os.str();
+}
+
+const char* policy_name(ReplacementPolicy policy) {
+    switch (policy) {
+        case ReplacementPolicy::LRU: return "lru";
+        case ReplacementPolicy::FIFO: return "fifo";
+        case ReplacementPolicy::RANDOM: return "random";
+    }
+    return "?";
+}
+
+} // namespace
+
+CacheHierarchyConfig CacheHierarchyConfig::parse(const std::string& spec) {
+    CacheHierarchyConfig config;
+    if (spec == "default" || spec.empty()) return config;
+
+    std::istringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) throw std::runtime_error("Cache model: expected name=value in '" + spec + "'");
+        std::string name = item.substr(0, eq);
+        std::vector<std::string> fields;
+        std::istringstream values(item.substr(eq + 1));
+        std::string field;
+        while (std::getline(values, field, ':')) fields.push_back(field);
+
+        if (name == "region") {
+            if (fields.size() != 1) throw std::runtime_error("Cache model: region takes one size in '" + spec + "'");
+            config.region = parse_size(fields[0], spec);
+            continue;
+        }
+        CacheConfig* level = name == "l1i" ? &config.l1i : name == "l1d" ? &config.l1d
+                           : name == "l2" ? &config.l2 : nullptr;
+        if (!level) throw std::runtime_error("Cache model: unknown level '" + name + "'");
+        if (fields.size() < 3 || fields.size() > 4) {
+            throw std::runtime_error("Cache model: expected size:ways:line[:policy] for " + name);
+        }
+        level->size = parse_size(fields[0], spec);
+        level->ways = parse_size(fields[1], spec);
+        level->line = parse_size(fields[2], spec);
+        if (fields.size() == 4) {
+            if (fields[3] == "lru") level->policy = ReplacementPolicy::LRU;
+            else if (fields[3] == "fifo") level->policy = ReplacementPolicy::FIFO;
+            else if (fields[3] == "random") level->policy = ReplacementPolicy::RANDOM;
+            else throw std::runtime_error("Cache model: unknown policy '" + fields[3] + "'");
+        }
+    }
+    return config;
+}
+
+CacheLevel::CacheLevel(const CacheConfig& config)
+    : geometry(config), policy(config.policy), ways(config.ways) {
+    if (!power_of_two(config.line) || config.line < 4 || !power_of_two(config.ways) ||
+        !power_of_two(config.size) || config.size < static_cast<uint64_t>(config.ways) * config.line) {
+        throw std::runtime_error("Cache model: size, ways and line must be powers of two, line at least 4 bytes, "
+                                 "and size at least ways * line");
+    }
+    line_shift = log2_of(config.line);
+    uint32_t sets = config.size / (config.ways * config.line);
+    set_mask = sets - 1;
+    tags.assign(static_cast<size_t>(sets) * ways, kEmpty);
+    stamps.assign(static_cast<size_t>(sets) * ways, 0);
+}
+
+uint32_t CacheLevel::choose_victim(const uint64_t* stamp) {
+    const uint32_t* tag = tags.data() + (stamp - stamps.data());
+    for (uint32_t w = 0; w < ways; ++w) {
+        if (tag[w] == kEmpty) return w;
+    }
+    if (policy == ReplacementPolicy::RANDOM) {
+        // xorshift64
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        return static_cast<uint32_t>(random_state % ways);
+    }
+    // Oldest use (LRU) or oldest fill (FIFO)
+    uint32_t victim = 0;
+    for (uint32_t w = 1; w < ways; ++w) {
+        if (stamp[w] < stamp[victim]) victim = w;
+    }
+    return victim;
+}
+
+CacheHierarchy::CacheHierarchy(const CacheHierarchyConfig& config, size_t memory_size)
+    : settings(config), l1i(config.l1i), l1d(config.l1d), l2(config.l2) {
+    if (!power_of_two(config.region)) {
+        throw std::runtime_error("Cache model: region size must be a power of two");
+    }
+    region_shift = log2_of(config.region);
+    per_region.resize((memory_size + config.region - 1) / config.region);
+}
+
+void CacheHierarchy::report(std::ostream& out, size_t top) const {
+    auto level = [&](const char* name, const CacheLevel& cache) {
+        const CacheConfig& c = cache.config();
+        uint64_t accesses = cache.hit_count() + cache.miss_count();
+        out << std::left << std::setw(4) << name << std::right << (c.size >> 10) << "K " << c.ways << "-way "
+            << c.line << "B " << policy_name(c.policy) << ": " << accesses << " accesses, " << cache.miss_count() << " misses ("
+            << percent(cache.miss_count(), accesses) << ")\n";
+    };
+    level("L1I", l1i);
+    level("L1D", l1d);
+    level("L2", l2);
+
+    // Most misses first, lower PCs first among equals
+    std::vector<std::pair<uint64_t, uint32_t>> pcs;
+    for (const auto& [pc, c] : per_pc) {
+        uint64_t misses = c.fetch.l1_misses + c.data.l1_misses;
+        if (misses) pcs.emplace_back(misses, pc);
+    }
+    std::sort(pcs.begin(), pcs.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    if (pcs.size() > top) pcs.resize(top);
+
+    out << "PCs by L1 misses:\n";
+    for (const auto& [misses, pc] : pcs) {
+        const PcCounts& c = per_pc.at(pc);
+        out << "  0x" << std::hex << std::setw(8) << std::setfill('0') << pc << std::dec << std::setfill(' ')
+            << "  fetch " << c.fetch.accesses << " (miss " << percent(c.fetch.l1_misses, c.fetch.accesses) << ")"
+            << "  data " << c.data.accesses << " (L1 miss " << percent(c.data.l1_misses, c.data.accesses)
+            << ", L2 miss " << percent(c.data.l2_misses, c.data.accesses) << ")\n";
+    }
+
+    out << "Data regions (" << settings.region << " bytes):\n";
+    for (size_t r = 0; r < per_region.size(); ++r) {
+        const CacheCounts& c = per_region[r];
+        if (!c.accesses) continue;
+        out << "  0x" << std::hex << std::setw(8) << std::setfill('0') << (r << region_shift) << std::dec
+            << std::setfill(' ') << "  " << c.accesses << " accesses (L1 miss " << percent(c.l1_misses, c.accesses)
+            << ", L2 miss " << percent(c.l2_misses, c.accesses) << ")\n";
+    }
+}
@@ -0,0 +1,53 @@
+#include "../../include/cache_record.h"
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <unistd.h>
+
+void put32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void put64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+uint64_t RecordReader::get(int size) {
+    if (!ok || bytes.size() - at < static_cast<size_t>(size)) {
+        ok = false;
+        return 0;
+    }
+    uint64_t v = 0;
+    for (int i = size - 1; i >= 0; --i) v = (v << 8) | static_cast<uint8_t>(bytes[at + i]);
+    at += size;
+    return v;
+}
+
+std::string RecordReader::text(uint64_t size) {
+    if (!ok || bytes.size() - at < size) {
+        ok = false;
+        return {};
+    }
+    std::string s = bytes.substr(at, size);
+    at += size;
+    return s;
+}
+
+bool write_entry(const std::string& path, const std::string& bytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    std::string temp = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,142 @@
+#include "../../include/call_profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <map>
+#include <ostream>
+
+CallProfiler::CallProfiler(const std::unordered_map<std::string, uint32_t>& labels) {
+    set_symbols(labels);
+}
+
+void CallProfiler::set_symbols(const std::unordered_map<std::string, uint32_t>& labels) {
+    names.clear();
+    // Of several labels on one address the alphabetically first wins, so
+    // names do not depend on hash order
+    for (const auto& label : labels) {
+        auto it = names.find(label.second);
+        if (it == names.end() || label.first < it->second) names[label.second] = label.first;
+    }
+}
+
+std::string CallProfiler::name_of(uint32_t address) const {
+    auto it = names.find(address);
+    if (it != names.end()) return it->second;
+    char hex[16];
+    std::snprintf(hex, sizeof(hex), "0x%08x", address);
+    return hex;
+}
+
+uint32_t CallProfiler::child(uint32_t parent, uint32_t function) {
+    uint64_t key = (static_cast<uint64_t>(parent) << 32) | function;
+    auto it = children.find(key);
+    if (it != children.end()) return it->second;
+    uint32_t id = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({function, parent});
+    children.emplace(key, id);
+    return id;
+}
+
+void CallProfiler::charge() {
+    uint64_t now = *clock;
+    if (!stack.empty()) nodes[stack.back().node].self += now - last_event;
+    last_event = now;
+}
+
+void CallProfiler::start(uint32_t entry, const uint64_t* retired) {
+    clock = retired;
+    last_event = *clock;
+    stack.clear();
+    uint32_t root = child(kNoNode, entry);
+    ++nodes[root].calls;
+    stack.push_back({root, UINT32_MAX});
+}
+
+void CallProfiler::finish() {
+    if (!clock) return;
+    charge();
+    stack.clear();
+    clock = nullptr;
+}
+
+void CallProfiler::call(uint32_t target, uint32_t return_address) {
+    if (!clock) return;
+    charge();
+    uint32_t node = child(stack.back().node, target);
+    ++nodes[node].calls;
+    stack.push_back({node, return_address});
+}
+
+void CallProfiler::ret(uint32_t target) {
+    if (!clock) return;
+    // The root frame is never returned from
+    for (size_t depth = stack.size(); depth-- > 1;) {
+        if (stack[depth].return_address == target) {
+            charge();
+            stack.resize(depth);
+            return;
+        }
+    }
+}
+
+std::string CallProfiler::path_of(uint32_t node) const {
+    std::vector<uint32_t> path;
+    for (uint32_t n = node; n != kNoNode; n = nodes[n].parent) path.push_back(nodes[n].function);
+    std::string text;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        if (!text.empty()) text += ';';
+        text += name_of(*it);
+    }
+    return text;
+}
+
+std::vector<CallProfiler::FunctionProfile> CallProfiler::functions() const {
+    std::map<uint32_t, FunctionProfile> by_address;
+    std::vector<uint32_t> seen;
+    for (uint32_t id = 0; id < nodes.size(); ++id) {
+        const Node& node = nodes[id];
+        FunctionProfile& f = by_address[node.function];
+        f.calls += node.calls;
+        f.exclusive += node.self;
+        // Inclusive: once to every distinct function on the path
+        seen.clear();
+        for (uint32_t n = id; n != kNoNode; n = nodes[n].parent) {
+            uint32_t function = nodes[n].function;
+            if (std::find(seen.begin(), seen.end(), function) != seen.end()) continue;
+            seen.push_back(function);
+            by_address[function].inclusive += node.self;
+        }
+    }
+
+    std::vector<FunctionProfile> result;
+    for (auto& entry : by_address) {
+        entry.second.address = entry.first;
+        entry.second.name = name_of(entry.first);
+        result.push_back(std::move(entry.second));
+    }
+    std::stable_sort(result.begin(), result.end(), [](const FunctionProfile& a, const FunctionProfile& b) {
+        return a.inclusive > b.inclusive;
+    });
+    return result;
+}
+
+void CallProfiler::write_collapsed(std::ostream& out) const {
+    std::map<std::string, uint64_t> lines;
+    for (uint32_t id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].self) lines[path_of(id)] += nodes[id].self;
+    }
+    for (const auto& line : lines) out << line.first << " " << line.second << "\n";
+}
+
+void CallProfiler::report(std::ostream& out, size_t top) const {
+    std::vector<FunctionProfile> all = functions();
+    uint64_t total = 0;
+    for (const FunctionProfile& f : all) total += f.exclusive;
+    out << "Function profile (" << total << " instructions):\n";
+    out << std::setw(14) << "inclusive" << std::setw(14) << "exclusive" << std::setw(10) << "calls" << "  function\n";
+    for (size_t i = 0; i < all.size() && i < top; ++i) {
+        const FunctionProfile& f = all[i];
+        out << std::setw(14) << f.inclusive << std::setw(14) << f.exclusive << std::setw(10) << f.calls << "  "
+            << f.name << "\n";
+    }
+}
@@ -0,0 +1,105 @@
+#include "../../include/coverage.h"
+#include <cstring>
+#include <iomanip>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPS_COVERAGE_SSE2 1
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'I', 'P', 'S', 'C', 'O', 'V', '1'};
+
+} // namespace
+
+CoverageMap::CoverageMap(size_t memory_size)
+    : slots(memory_size / 4), words((slots + 63) / 64), bits(3 * words) {}
+
+void CoverageMap::merge(const CoverageMap& other) {
+    if (other.slots != slots) {
+        throw std::runtime_error("Cannot merge coverage of different memory sizes");
+    }
+    uint64_t* dst = bits.data();
+    const uint64_t* src = other.bits.data();
+    size_t n = bits.size();
+    size_t i = 0;
+#ifdef MIPS_COVERAGE_SSE2
+    for (; i + 2 <= n; i += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(a, b));
+    }
+#endif
+    for (; i < n; ++i) dst[i] |= src[i];
+}
+
+void CoverageMap::save(std::ostream& out) const {
+    uint64_t size = memory_size();
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(bits.data()), static_cast<std::streamsize>(bits.size() * 8));
+    if (!out.good()) {
+        throw std::runtime_error("Failed to write coverage");
+    }
+}
+
+CoverageMap CoverageMap::load(std::istream& in) {
+    char magic[sizeof(kMagic)];
+    uint64_t size = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+        !in.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > (uint64_t{1} << 32)) {
+        throw std::runtime_error("Not a coverage file");
+    }
+    CoverageMap map(static_cast<size_t>(size));
+    if (!in.read(reinterpret_cast<char*>(map.bits.data()), static_cast<std::streamsize>(map.bits.size() * 8))) {
+        throw std::runtime_error("Truncated coverage file");
+    }
+    return map;
+}
+
+void CoverageMap::report(std::ostream& out, const std::vector<SourceLine>& lines, std::istream& source) const {
+    std::map<uint32_t, std::vector<uint32_t>> by_line;
+    for (const SourceLine& line : lines) by_line[line.line].push_back(line.address);
+
+    size_t instructions = lines.size(), ran = 0, branches = 0, directions = 0;
+    for (const SourceLine& line : lines) {
+        if (!executed(line.address)) continue;
+        ++ran;
+        bool yes = taken(line.address), no = not_taken(line.address);
+        if (yes || no) {
+            ++branches;
+            directions += yes + no;
+        }
+    }
+
+    auto percent = [](size_t part, size_t whole) { return whole ? 100.0 * part / whole : 100.0; };
+    out << std::fixed << std::setprecision(1);
+    out << "Instructions: " << ran << " of " << instructions << " (" << percent(ran, instructions) << "%)\n";
+    out << "Branch directions: " << directions << " of " << 2 * branches << " at branches that ran ("
+        << percent(directions, 2 * branches) << "%)\n";
+    out << std::defaultfloat;
+
+    std::string text;
+    for (uint32_t number = 1; std::getline(source, text); ++number) {
+        char mark = '-';
+        const char* missing = "";
+        auto it = by_line.find(number);
+        if (it != by_line.end()) {
+            size_t hit = 0;
+            for (uint32_t address : it->second) {
+                if (!executed(address)) continue;
+                ++hit;
+                bool yes = taken(address), no = not_taken(address);
+                if (yes != no) missing = yes ? "  [never falls through]" : "  [never taken]";
+            }
+            mark = hit == 0 ? '#' : hit < it->second.size() || *missing ? '~' : '+';
+        }
+        out << "  " << mark << std::setw(6) << number << ": " << text << missing << "\n";
+    }
+}
@@ -0,0 +1,215 @@
+#include "../../include/debug_info.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'I', 'P', 'S', 'D', 'B', 'G', '1'};
+constexpr uint32_t kNoSource = UINT32_MAX;
+constexpr size_t kHeaderSize = 16;
+
+uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void append32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) out.push_back(static_cast<char>(value >> shift));
+}
+
+} // namespace
+
+struct DebugInfo::Section {
+    const uint8_t* labels;      // {address, name} pairs
+    uint32_t label_count;
+    const uint8_t* lines;       // {address, line} pairs
+    uint32_t line_count;
+    const char* strings;
+    uint32_t strings_size;
+    uint32_t source;
+
+    const char* name(uint32_t offset) const { return strings + offset; }
+};
+
+void DebugInfo::write(std::ostream& out, uint64_t offset, const std::unordered_map<std::string, uint32_t>& labels,
+                      const std::vector<SourceLine>& lines, const std::string& source) {
+    std::vector<std::pair<uint32_t, std::string>> sorted;
+    for (const auto& label : labels) sorted.emplace_back(label.second, label.first);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string strings;
+    uint32_t source_name = kNoSource;
+    if (!source.empty()) {
+        source_name = 0;
+        strings.append(source).push_back('\0');
+    }
+    std::string table;
+    for (const auto& label : sorted) {
+        append32(table, label.first);
+        append32(table, static_cast<uint32_t>(strings.size()));
+        strings.append(label.second).push_back('\0');
+    }
+    for (const SourceLine& line : lines) {
+        append32(table, line.address);
+        append32(table, line.line);
+    }
+
+    std::string section;
+    append32(section, static_cast<uint32_t>(sorted.size()));
+    append32(section, static_cast<uint32_t>(lines.size()));
+    append32(section, source_name);
+    append32(section, static_cast<uint32_t>(strings.size()));
+    section += table;
+    section += strings;
+
+    if (offset > UINT32_MAX || section.size() > UINT32_MAX - offset) {
+        throw std::runtime_error("Binary too large for a debug section");
+    }
+    uint32_t size = static_cast<uint32_t>(section.size());
+    append32(section, static_cast<uint32_t>(offset));
+    append32(section, size);
+    section.append(kMagic, sizeof(kMagic));
+
+    out.write(section.data(), static_cast<std::streamsize>(section.size()));
+    if (!out.good()) {
+        throw std::runtime_error("Failed to write debug section");
+    }
+}
+
+uint64_t DebugInfo::image_end(const uint8_t* tail, uint64_t file_size) {
+    if (file_size < kTrailerSize || std::memcmp(tail + 8, kMagic, sizeof(kMagic)) != 0) return file_size;
+    uint64_t offset = read32(tail);
+    uint64_t size = read32(tail + 4);
+    if (offset + size + kTrailerSize != file_size) return file_size;
+    return offset;
+}
+
+DebugInfo::DebugInfo(const std::string& path) : path(path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::runtime_error("Cannot open binary file: " + path);
+    }
+    std::streamoff size = in.tellg();
+    if (size < static_cast<std::streamoff>(kTrailerSize)) return;
+    uint8_t tail[kTrailerSize];
+    in.seekg(size - static_cast<std::streamoff>(kTrailerSize));
+    if (!in.read(reinterpret_cast<char*>(tail), kTrailerSize)) {
+        throw std::runtime_error("Cannot read binary file: " + path);
+    }
+    uint64_t end = image_end(tail, static_cast<uint64_t>(size));
+    if (end == static_cast<uint64_t>(size)) return;
+    section_offset = end;
+    section_size = read32(tail + 4);
+}
+
+DebugInfo::~DebugInfo() = default;
+
+const DebugInfo::Section* DebugInfo::section() const {
+    if (parsed || !available()) return parsed.get();
+
+    // Mappings start on a page boundary
+    size_t page = SharedImage::page_size();
+    uint64_t start = section_offset / page * page;
+    size_t skip = static_cast<size_t>(section_offset - start);
+    mapping = std::make_unique<SharedImage>(path, static_cast<size_t>(start), skip + section_size);
+    const uint8_t* p = mapping->data() + skip;
+
+    auto malformed = [&]() { return std::runtime_error("Malformed debug section in " + path); };
+    if (section_size < kHeaderSize) throw malformed();
+    auto s = std::make_unique<Section>();
+    s->label_count = read32(p);
+    s->line_count = read32(p + 4);
+    s->source = read32(p + 8);
+    s->strings_size = read32(p + 12);
+    uint64_t tables = (uint64_t{s->label_count} + s->line_count) * 8;
+    if (kHeaderSize + tables + s->strings_size != section_size) throw malformed();
+    s->labels = p + kHeaderSize;
+    s->lines = s->labels + uint64_t{s->label_count} * 8;
+    s->strings = reinterpret_cast<const char*>(s->lines + uint64_t{s->line_count} * 8);
+    // Every name must end inside the table
+    if (s->strings_size && s->strings[s->strings_size - 1] != '\0') throw malformed();
+    for (uint32_t i = 0; i < s->label_count; ++i) {
+        if (read32(s->labels + i * 8 + 4) >= s->strings_size) throw malformed();
+    }
+    if (s->source != kNoSource && s->source >= s->strings_size) throw malformed();
+    parsed = std::move(s);
+    return parsed.get();
+}
+
+std::unordered_map<std::string, uint32_t> DebugInfo::labels() const {
+    std::unordered_map<std::string, uint32_t> result;
+    const Section* s = section();
+    if (!s) return result;
+    for (uint32_t i = 0; i < s->label_count; ++i) {
+        const uint8_t* entry = s->labels + i * 8;
+        result.emplace(s->name(read32(entry + 4)), read32(entry));
+    }
+    return result;
+}
+
+std::vector<SourceLine> DebugInfo::lines() const {
+    std::vector<SourceLine> result;
+    const Section* s = section();
+    if (!s) return result;
+    result.reserve(s->line_count);
+    for (uint32_t i = 0; i < s->line_count; ++i) {
+        result.push_back({read32(s->lines + i * 8), read32(s->lines + i * 8 + 4)});
+    }
+    return result;
+}
+
+std::string DebugInfo::source() const {
+    const Section* s = section();
+    if (!s || s->source == kNoSource) return "";
+    return s->name(s->source);
+}
+
+uint32_t DebugInfo::line_of(uint32_t address) const {
+    const Section* s = section();
+    if (!s) return 0;
+    uint32_t lo = 0;
+    uint32_t hi = s->line_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (read32(s->lines + mid * 8) < address) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < s->line_count && read32(s->lines + lo * 8) == address) return read32(s->lines + lo * 8 + 4);
+    return 0;
+}
+
+std::string DebugInfo::symbolize(uint32_t address) const {
+    const Section* s = section();
+    if (!s) return "";
+
+    std::string text;
+    // Last label at or below the address; of several there, the first by name
+    uint32_t lo = 0;
+    uint32_t hi = s->label_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (read32(s->labels + mid * 8) <= address) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0) {
+        uint32_t base = read32(s->labels + (lo - 1) * 8);
+        while (lo > 1 && read32(s->labels + (lo - 2) * 8) == base) --lo;
+        text = s->name(read32(s->labels + (lo - 1) * 8 + 4));
+        if (address != base) {
+            char offset[16];
+            std::snprintf(offset, sizeof(offset), "+0x%x", address - base);
+            text += offset;
+        }
+    }
+
+    uint32_t line = line_of(address);
+    if (line) {
+        std::string where = source();
+        where += (where.empty() ? "line " : ":") + std::to_string(line);
+        text += text.empty() ? where : " (" + where + ")";
+    }
+    return text;
+}
@@ -0,0 +1,216 @@
+#include "../../include/decode_batch.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#define MIPS_BATCH_X86 1
+#endif
+
+#if defined(MIPS_BATCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MIPS_BATCH_AVX2 1
+#endif
+
+namespace {
+
+// Operation ids indexed by (opcode == 0 ? 64 + funct : opcode).
+// Built from InstructionUtils::predecode so the tables have a single source of truth.
+const std::array<int32_t, 128>& operation_table() {
+    static const std::array<int32_t, 128> table = [] {
+        std::array<int32_t, 128> t{};
+        for (uint32_t i = 0; i < 64; ++i) {
+            // slot 0 (R-type) is never used; those words index 64 + funct
+            t[i] = static_cast<int32_t>(i == 0 ? Operation::INVALID : InstructionUtils::predecode(i << 26).op);
+            t[64 + i] = static_cast<int32_t>(InstructionUtils::predecode(i).op);
+        }
+        return t;
+    }();
+    return table;
+}
+
+inline uint32_t table_index(uint32_t word) {
+    uint32_t opcode = word >> 26;
+    return opcode == 0 ? 64 + (word & 0x3F) : opcode;
+}
+
+void decode_scalar(const uint32_t* words, size_t begin, size_t end, DecodedFields& out) {
+    const auto& table = operation_table();
+    for (size_t i = begin; i < end; ++i) {
+        uint32_t w = words[i];
+        out.op[i] = static_cast<uint8_t>(table[table_index(w)]);
+        out.opcode[i] = static_cast<uint8_t>(w >> 26);
+        out.rs[i] = (w >> 21) & 0x1F;
+        out.rt[i] = (w >> 16) & 0x1F;
+        out.rd[i] = (w >> 11) & 0x1F;
+        out.shamt[i] = (w >> 6) & 0x1F;
+        out.funct[i] = w & 0x3F;
+        out.imm[i] = InstructionUtils::sign_extend_16(static_cast<uint16_t>(w & 0xFFFF));
+    }
+}
+
+#ifdef MIPS_BATCH_X86
+
+// Narrow four 32-bit lanes (each < 256) to bytes and store them
+inline void store4(uint8_t* dst, __m128i v) {
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+    uint32_t bytes = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+    std::memcpy(dst, &bytes, 4);
+}
+
+size_t decode_sse2(const uint32_t* words, size_t count, DecodedFields& out) {
+    const auto& table = operation_table();
+    const __m128i mask5 = _mm_set1_epi32(0x1F);
+    const __m128i mask6 = _mm_set1_epi32(0x3F);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+        store4(&out.opcode[i], _mm_srli_epi32(w, 26));
+        store4(&out.rs[i], _mm_and_si128(_mm_srli_epi32(w, 21), mask5));
+        store4(&out.rt[i], _mm_and_si128(_mm_srli_epi32(w, 16), mask5));
+        store4(&out.rd[i], _mm_and_si128(_mm_srli_epi32(w, 11), mask5));
+        store4(&out.shamt[i], _mm_and_si128(_mm_srli_epi32(w, 6), mask5));
+        store4(&out.funct[i], _mm_and_si128(w, mask6));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&out.imm[i]), _mm_srai_epi32(_mm_slli_epi32(w, 16), 16));
+        // SSE2 has no gather; the 512-byte table stays in L1
+        for (size_t k = i; k < i + 4; ++k) {
+            out.op[k] = static_cast<uint8_t>(table[table_index(words[k])]);
+        }
+    }
+    return i;
+}
+
+#endif
+
+#ifdef MIPS_BATCH_AVX2
+
+__attribute__((target("avx2")))
+inline void store8(uint8_t* dst, __m256i v) {
+    // byte 0 of each dword, per 128-bit lane, then join the two lanes
+    const __m256i pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i packed = _mm256_shuffle_epi8(v, pick);
+    uint32_t lo = static_cast<uint32_t>(_mm256_extract_epi32(packed, 0));
+    uint32_t hi = static_cast<uint32_t>(_mm256_extract_epi32(packed, 4));
+    std::memcpy(dst, &lo, 4);
+    std::memcpy(dst + 4, &hi, 4);
+}
+
+__attribute__((target("avx2")))
+size_t decode_avx2(const uint32_t* words, size_t count, DecodedFields& out) {
+    const int32_t* table = operation_table().data();
+    const __m256i mask5 = _mm256_set1_epi32(0x1F);
+    const __m256i mask6 = _mm256_set1_epi32(0x3F);
+    const __m256i sixty_four = _mm256_set1_epi32(64);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        __m256i opcode = _mm256_srli_epi32(w, 26);
+        __m256i funct = _mm256_and_si256(w, mask6);
+
+        // index = opcode == 0 ? 64 + funct : opcode
+        __m256i is_r = _mm256_cmpeq_epi32(opcode, zero);
+        __m256i index = _mm256_blendv_epi8(opcode, _mm256_add_epi32(funct, sixty_four), is_r);
+        store8(&out.op[i], _mm256_i32gather_epi32(table, index, 4));
+
+        store8(&out.opcode[i], opcode);
+        store8(&out.rs[i], _mm256_and_si256(_mm256_srli_epi32(w, 21), mask5));
+        store8(&out.rt[i], _mm256_and_si256(_mm256_srli_epi32(w, 16), mask5));
+        store8(&out.rd[i], _mm256_and_si256(_mm256_srli_epi32(w, 11), mask5));
+        store8(&out.shamt[i], _mm256_and_si256(_mm256_srli_epi32(w, 6), mask5));
+        store8(&out.funct[i], funct);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out.imm[i]),
+                            _mm256_srai_epi32(_mm256_slli_epi32(w, 16), 16));
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+void DecodedFields::resize(size_t n) {
+    op.resize(n);
+    opcode.resize(n);
+    rs.resize(n);
+    rt.resize(n);
+    rd.resize(n);
+    shamt.resize(n);
+    funct.resize(n);
+    imm.resize(n);
+}
+
+bool BatchDecoder::backend_available(DecodeBackend backend) {
+    switch (backend) {
+        case DecodeBackend::AVX2:
+#ifdef MIPS_BATCH_AVX2
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case DecodeBackend::SSE2:
+#ifdef MIPS_BATCH_X86
+            return true;
+#else
+            return false;
+#endif
+        case DecodeBackend::SCALAR:
+            return true;
+    }
+    return false;
+}
+
+DecodeBackend BatchDecoder::best_backend() {
+    static const DecodeBackend best = backend_available(DecodeBackend::AVX2) ? DecodeBackend::AVX2
+                                    : backend_available(DecodeBackend::SSE2) ? DecodeBackend::SSE2
+                                    : DecodeBackend::SCALAR;
+    return best;
+}
+
+const char* BatchDecoder::backend_name(DecodeBackend backend) {
+    switch (backend) {
+        case DecodeBackend::AVX2: return "avx2";
+        case DecodeBackend::SSE2: return "sse2";
+        case DecodeBackend::SCALAR: return "scalar";
+    }
+    return "unknown";
+}
+
+void BatchDecoder::decode(const uint32_t* words, size_t count, DecodedFields& out) {
+    decode(words, count, out, best_backend());
+}
+
+void BatchDecoder::decode(const uint32_t* words, size_t count, DecodedFields& out, DecodeBackend backend) {
+    out.resize(count);
+    if (!backend_available(backend)) backend = DecodeBackend::SCALAR;
+
+    size_t done = 0;
+    switch (backend) {
+#ifdef MIPS_BATCH_AVX2
+        case DecodeBackend::AVX2: done = decode_avx2(words, count, out); break;
+#endif
+#ifdef MIPS_BATCH_X86
+        case DecodeBackend::SSE2: done = decode_sse2(words, count, out); break;
+#endif
+        default: break;
+    }
+    // tail (or everything, for the scalar backend)
+    decode_scalar(words, done, count, out);
+}
+
+void BatchDecoder::decode_image(const std::vector<uint8_t>& bytes, DecodedFields& out) {
+    size_t count = bytes.size() / 4;
+    std::vector<uint32_t> words(count);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* b = &bytes[i * 4];
+        words[i] = static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) |
+                   (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    }
+    decode(words.data(), count, out);
+}
+
+void BatchDecoder::predecode(const uint32_t* words, size_t count, DecodedInstruction* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = InstructionUtils::predecode(words[i]);
+    }
+}
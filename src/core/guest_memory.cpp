@@ -0,0 +1,371 @@
+#include "../../include/guest_memory.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#if (defined(__unix__) || defined(__APPLE__)) && UINTPTR_MAX > 0xFFFFFFFFu
+#define MIPS_GUARD_PAGES 1
+#include <csignal>
+#include <setjmp.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(MIPS_GUARD_PAGES) && defined(__linux__)
+#define MIPS_SHARED_IMAGES 1
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef MIPS_GUARD_PAGES
+
+namespace {
+
+// 32-bit address space plus room for a 4-byte access starting at 0xFFFFFFFF
+constexpr size_t kGuestSpace = size_t{1} << 32;
+
+size_t page_size() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+size_t reservation_size() {
+    return kGuestSpace + page_size();
+}
+
+size_t round_to_page(size_t n) {
+    size_t page = page_size();
+    return (n + page - 1) & ~(page - 1);
+}
+
+// The innermost run_trapped() call on this thread
+struct TrapFrame {
+    sigjmp_buf env;
+    const uint8_t* base;
+    size_t committed;
+    volatile uintptr_t fault;
+    TrapFrame* previous;
+};
+
+thread_local TrapFrame* t_trap = nullptr;
+
+struct sigaction g_previous_segv;
+struct sigaction g_previous_bus;
+
+void chain(int sig, siginfo_t* info, void* uctx) {
+    const struct sigaction& prev = sig == SIGBUS ? g_previous_bus : g_previous_segv;
+    if (prev.sa_flags & SA_SIGINFO) {
+        prev.sa_sigaction(sig, info, uctx);
+    } else if (prev.sa_handler != SIG_IGN && prev.sa_handler != SIG_DFL) {
+        prev.sa_handler(sig);
+    } else {
+        // Re-executing the faulting instruction crashes with the default action
+        signal(sig, SIG_DFL);
+    }
+}
+
+void on_fault(int sig, siginfo_t* info, void* uctx) {
+    TrapFrame* frame = t_trap;
+    uintptr_t addr = reinterpret_cast<uintptr_t>(info->si_addr);
+    if (frame) {
+        uintptr_t lo = reinterpret_cast<uintptr_t>(frame->base);
+        if (addr >= lo + frame->committed && addr < lo + reservation_size()) {
+            frame->fault = addr - lo;
+            siglongjmp(frame->env, 1);
+        }
+    }
+    chain(sig, info, uctx);
+}
+
+void install_fault_handler() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = on_fault;
+        sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGSEGV, &sa, &g_previous_segv);
+        sigaction(SIGBUS, &sa, &g_previous_bus);
+    });
+}
+
+} // namespace
+
+#endif
+
+SharedImage::SharedImage(std::vector<uint8_t> contents)
+    : bytes(std::move(contents)), base(bytes.data()), length(bytes.size()) {
+#ifdef MIPS_SHARED_IMAGES
+    if (bytes.empty()) return;
+    fd = memfd_create("mips-image", MFD_CLOEXEC);
+    if (fd < 0) return;
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = write(fd, bytes.data() + written, bytes.size() - written);
+        if (n <= 0) {
+            // Copying still works; mapping just is not worth a half-written file
+            close(fd);
+            fd = -1;
+            return;
+        }
+        written += static_cast<size_t>(n);
+    }
+#endif
+}
+
+SharedImage::SharedImage(const std::string& path, size_t offset, size_t size) : length(size) {
+#ifdef MIPS_SHARED_IMAGES
+    if (size && offset % page_size() == 0) {
+        int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (file >= 0 && fstat(file, &st) == 0 && offset + size <= static_cast<uint64_t>(st.st_size)) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, static_cast<off_t>(offset));
+            if (p != MAP_FAILED) {
+                mapping = p;
+                base = static_cast<const uint8_t*>(p);
+                fd = file;
+                this->offset = offset;
+                return;
+            }
+        }
+        if (file >= 0) close(file);
+    }
+#endif
+    std::ifstream in(path, std::ios::binary);
+    bytes.resize(size);
+    if (!in.seekg(static_cast<std::streamoff>(offset)) ||
+        !in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(size))) {
+        throw std::runtime_error("Cannot read image from " + path);
+    }
+    base = bytes.data();
+}
+
+SharedImage::~SharedImage() {
+#ifdef MIPS_SHARED_IMAGES
+    if (mapping) munmap(mapping, length);
+    if (fd >= 0) close(fd);
+#endif
+}
+
+size_t SharedImage::page_size() {
+#ifdef MIPS_GUARD_PAGES
+    return ::page_size();
+#else
+    return 4096;
+#endif
+}
+
+GuestMemory::GuestMemory(size_t size, MemoryBackend backend)
+    : kind(backend_available(backend) ? backend : MemoryBackend::CHECKED) {
+#ifdef MIPS_GUARD_PAGES
+    if (kind == MemoryBackend::GUARDED) {
+        void* p = mmap(nullptr, reservation_size(), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            // Address space limits (e.g. ulimit -v) can forbid the reservation
+            kind = MemoryBackend::CHECKED;
+        } else {
+            base = static_cast<uint8_t*>(p);
+        }
+    }
+#endif
+    resize(size);
+}
+
+GuestMemory::~GuestMemory() {
+    release();
+}
+
+void GuestMemory::release() {
+#ifdef MIPS_GUARD_PAGES
+    if (owner && kind == MemoryBackend::GUARDED && base) {
+        munmap(base, reservation_size());
+    }
+#endif
+    base = nullptr;
+    length = 0;
+    heap.reset();
+}
+
+GuestMemory::GuestMemory(const GuestMemory& other) : GuestMemory(other.length, other.kind) {
+    if (length) std::memcpy(base, other.base, length);
+}
+
+GuestMemory& GuestMemory::operator=(const GuestMemory& other) {
+    if (this != &other) {
+        GuestMemory copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+GuestMemory::GuestMemory(GuestMemory&& other) noexcept
+    : kind(other.kind), base(other.base), length(other.length), heap(std::move(other.heap)), owner(other.owner) {
+    other.base = nullptr;
+    other.length = 0;
+    other.owner = true;
+}
+
+GuestMemory& GuestMemory::operator=(GuestMemory&& other) noexcept {
+    if (this != &other) {
+        release();
+        kind = other.kind;
+        base = other.base;
+        length = other.length;
+        heap = std::move(other.heap);
+        owner = other.owner;
+        other.base = nullptr;
+        other.length = 0;
+        other.owner = true;
+    }
+    return *this;
+}
+
+GuestMemory GuestMemory::view() {
+    GuestMemory alias;
+    alias.kind = kind;
+    alias.base = base;
+    alias.length = length;
+    alias.owner = false;
+    return alias;
+}
+
+void GuestMemory::resize(size_t new_size) {
+    if (!owner) {
+        throw std::logic_error("Cannot resize a guest memory view");
+    }
+#ifdef MIPS_GUARD_PAGES
+    if (kind == MemoryBackend::GUARDED) {
+        if (new_size > kGuestSpace) {
+            throw std::length_error("Guest memory larger than 4 GiB");
+        }
+        size_t committed = round_to_page(length);
+        size_t wanted = round_to_page(new_size);
+        if (wanted > committed) {
+            if (mprotect(base + committed, wanted - committed, PROT_READ | PROT_WRITE) != 0) {
+                throw std::bad_alloc();
+            }
+        } else if (wanted < committed) {
+            // Fresh anonymous pages, so a later grow reads zeros again even
+            // where a mapped image was
+            void* p = mmap(base + wanted, committed - wanted, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+        }
+        length = wanted;
+        return;
+    }
+#endif
+    if (new_size == 0) {
+        heap.reset();
+    } else if (!heap) {
+        heap.reset(static_cast<uint8_t*>(std::calloc(new_size, 1)));
+        if (!heap) throw std::bad_alloc();
+    } else if (new_size != length) {
+        void* p = std::realloc(heap.get(), new_size);
+        if (!p) throw std::bad_alloc();
+        heap.release();
+        heap.reset(static_cast<uint8_t*>(p));
+        if (new_size > length) std::memset(heap.get() + length, 0, new_size - length);
+    }
+    base = heap.get();
+    length = new_size;
+}
+
+size_t GuestMemory::resident_bytes() const {
+#if defined(MIPS_GUARD_PAGES) && defined(__linux__)
+    if (!base || !length) return 0;
+    size_t page = page_size();
+    uintptr_t first = reinterpret_cast<uintptr_t>(base) & ~(page - 1);
+    size_t span = round_to_page(reinterpret_cast<uintptr_t>(base) + length - first);
+    std::vector<unsigned char> resident(span / page);
+    if (mincore(reinterpret_cast<void*>(first), span, resident.data()) != 0) return length;
+    size_t pages = 0;
+    for (unsigned char r : resident) pages += r & 1;
+    return std::min(pages * page, length);
+#else
+    return length;
+#endif
+}
+
+void GuestMemory::Free::operator()(uint8_t* p) const {
+    std::free(p);
+}
+
+void GuestMemory::map_image(const SharedImage& image) {
+    if (!owner) {
+        throw std::logic_error("Cannot map an image into a guest memory view");
+    }
+    if (image.size() > length) {
+        throw std::out_of_range("Memory load would exceed bounds");
+    }
+#ifdef MIPS_SHARED_IMAGES
+    if (kind == MemoryBackend::GUARDED && image.mappable()) {
+        // Bytes past the end of the file in its last page read as zero
+        void* p = mmap(base, round_to_page(image.size()), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                       image.fd, static_cast<off_t>(image.offset));
+        if (p != MAP_FAILED) return;
+    }
+#endif
+    std::memcpy(base, image.data(), image.size());
+}
+
+bool GuestMemory::run_trapped_impl(void (*fn)(void*), void* ctx, uint32_t& fault_address) const {
+#ifdef MIPS_GUARD_PAGES
+    if (kind == MemoryBackend::GUARDED) {
+        install_fault_handler();
+
+        TrapFrame frame;
+        frame.base = base;
+        frame.committed = length;
+        frame.fault = 0;
+        frame.previous = t_trap;
+
+        // Restores the enclosing frame on both normal return and exceptions
+        struct Arm {
+            TrapFrame& f;
+            explicit Arm(TrapFrame& f) : f(f) { t_trap = &f; }
+            ~Arm() { t_trap = f.previous; }
+        } arm(frame);
+
+        if (sigsetjmp(frame.env, 1) != 0) {
+            uintptr_t fault = frame.fault;
+            fault_address = fault > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(fault);
+            return false;
+        }
+        fn(ctx);
+        return true;
+    }
+#endif
+    (void)fault_address;
+    fn(ctx);
+    return true;
+}
+
+bool GuestMemory::backend_available(MemoryBackend backend) {
+    switch (backend) {
+        case MemoryBackend::CHECKED:
+            return true;
+        case MemoryBackend::GUARDED:
+#ifdef MIPS_GUARD_PAGES
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char* GuestMemory::backend_name(MemoryBackend backend) {
+    switch (backend) {
+        case MemoryBackend::CHECKED: return "checked";
+        case MemoryBackend::GUARDED: return "guarded";
+    }
+    return "unknown";
+}
@@ -1,7 +1,9 @@
 #include "../../include/instruction.h"
 #include "../../include/machine_state.h"
+#include "../../include/call_profiler.h"
 #include <variant>
 #include <stdexcept>
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -81,6 +83,7 @@ std::string InstructionUtils::get_name(const Instruction& instr) {
                 case FunctionCode::NOR: return "nor";
                 case FunctionCode::SLT: return "slt";
                 case FunctionCode::SLTU: return "sltu";
+                case FunctionCode::SYNC: return "sync";
                 default: return "unknown_r";
             }
         } else if constexpr (std::is_same_v<T, IInstruction>) {
@@ -106,6 +109,8 @@ std::string InstructionUtils::get_name(const Instruction& instr) {
                 case Opcode::SB: return "sb";
                 case Opcode::SH: return "sh";
                 case Opcode::SW: return "sw";
+                case Opcode::LL: return "ll";
+                case Opcode::SC: return "sc";
                 case Opcode::TRAP: return "trap";
                 default: return "unknown_i";
             }
@@ -189,282 +194,390 @@ JInstruction InstructionUtils::decode_j_type(uint32_t binary) {
     return JInstruction(opcode, address);
 }
 
+namespace {
+
+using Op = Operation;
+constexpr Op X = Op::INVALID;
+
+// How DecodedInstruction::imm is derived from the raw word
+enum class ImmKind : uint8_t {
+    NONE,       // unused
+    SHAMT,      // 5-bit shift amount
+    SIGNED,     // sign-extended 16-bit immediate
+    UNSIGNED,   // zero-extended 16-bit immediate
+    HIGH,       // 16-bit immediate shifted into the upper half (lhi)
+    BRANCH,     // sign-extended word offset, converted to bytes
+    JUMP        // 26-bit target, converted to bytes
+};
+
+// Indexed by the 6-bit function field of R-type words
+const Op kFunctTable[64] = {
+    Op::SLL,  X,         Op::SRL,  Op::SRA,   Op::SLLV, X,       Op::SRLV, Op::SRAV,   // 0x00
+    Op::JR,   Op::JALR,  X,        X,         X,        X,       X,        Op::SYNC,   // 0x08
+    Op::MFHI, Op::MTHI,  Op::MFLO, Op::MTLO,  X,        X,       X,        X,          // 0x10
+    Op::MULT, Op::MULTU, Op::DIV,  Op::DIVU,  X,        X,       X,        X,          // 0x18
+    Op::ADD,  Op::ADDU,  Op::SUB,  Op::SUBU,  Op::AND,  Op::OR,  Op::XOR,  Op::NOR,    // 0x20
+    X,        X,         Op::SLT,  Op::SLTU,  X,        X,       X,        X,          // 0x28
+    X,        X,         X,        X,         X,        X,       X,        X,          // 0x30
+    X,        X,         X,        X,         X,        X,       X,        X           // 0x38
+};
+
+// Indexed by the 6-bit opcode field (0x00 is resolved through kFunctTable)
+const Op kOpcodeTable[64] = {
+    X,        X,         Op::J,    Op::JAL,   Op::BEQ,  Op::BNE, Op::BLEZ, Op::BGTZ,   // 0x00
+    Op::ADDI, Op::ADDIU, Op::SLTI, Op::SLTIU, Op::ANDI, Op::ORI, Op::XORI, X,          // 0x08
+    X,        X,         X,        X,         X,        X,       X,        X,          // 0x10
+    Op::LLO,  Op::LHI,   Op::TRAP, X,         X,        X,       X,        X,          // 0x18
+    Op::LB,   Op::LH,    X,        Op::LW,    Op::LBU,  Op::LHU, X,        X,          // 0x20
+    Op::SB,   Op::SH,    X,        Op::SW,    X,        X,       X,        X,          // 0x28
+    Op::LL,   X,         X,        X,         X,        X,       X,        X,          // 0x30
+    Op::SC,   X,         X,        X,         X,        X,       X,        X           // 0x38
+};
+
+// Indexed by Operation
+const ImmKind kImmKinds[] = {
+    ImmKind::SHAMT, ImmKind::SHAMT, ImmKind::SHAMT,                             // sll srl sra
+    ImmKind::NONE, ImmKind::NONE, ImmKind::NONE, ImmKind::NONE, ImmKind::NONE,  // sllv srlv srav jr jalr
+    ImmKind::NONE, ImmKind::NONE, ImmKind::NONE, ImmKind::NONE,                 // mfhi mthi mflo mtlo
+    ImmKind::NONE, ImmKind::NONE, ImmKind::NONE, ImmKind::NONE,                 // mult multu div divu
+    ImmKind::NONE, ImmKind::NONE, ImmKind::NONE, ImmKind::NONE,                 // add addu sub subu
+    ImmKind::NONE, ImmKind::NONE, ImmKind::NONE, ImmKind::NONE,                 // and or xor nor
+    ImmKind::NONE, ImmKind::NONE, ImmKind::NONE,                                // slt sltu sync
+    ImmKind::BRANCH, ImmKind::BRANCH, ImmKind::BRANCH, ImmKind::BRANCH,         // beq bne blez bgtz
+    ImmKind::SIGNED, ImmKind::SIGNED, ImmKind::SIGNED, ImmKind::SIGNED,         // addi addiu slti sltiu
+    ImmKind::UNSIGNED, ImmKind::UNSIGNED, ImmKind::UNSIGNED,                    // andi ori xori
+    ImmKind::UNSIGNED, ImmKind::HIGH, ImmKind::UNSIGNED,                        // llo lhi trap
+    ImmKind::SIGNED, ImmKind::SIGNED, ImmKind::SIGNED, ImmKind::SIGNED,         // lb lh lw lbu
+    ImmKind::SIGNED, ImmKind::SIGNED, ImmKind::SIGNED, ImmKind::SIGNED,         // lhu sb sh sw
+    ImmKind::SIGNED, ImmKind::SIGNED,                                           // ll sc
+    ImmKind::JUMP, ImmKind::JUMP,                                               // j jal
+    ImmKind::NONE                                                               // invalid
+};
+static_assert(sizeof(kImmKinds) / sizeof(kImmKinds[0]) == static_cast<size_t>(Op::COUNT),
+              "kImmKinds must cover every Operation");
+
+// Indexed by Operation
+const char* const kOperationNames[] = {
+    "sll", "srl", "sra", "sllv", "srlv", "srav", "jr", "jalr",
+    "mfhi", "mthi", "mflo", "mtlo", "mult", "multu", "div", "divu",
+    "add", "addu", "sub", "subu", "and", "or", "xor", "nor", "slt", "sltu", "sync",
+    "beq", "bne", "blez", "bgtz", "addi", "addiu", "slti", "sltiu",
+    "andi", "ori", "xori", "llo", "lhi", "trap",
+    "lb", "lh", "lw", "lbu", "lhu", "sb", "sh", "sw", "ll", "sc",
+    "j", "jal",
+    "unknown"
+};
+static_assert(sizeof(kOperationNames) / sizeof(kOperationNames[0]) == static_cast<size_t>(Op::COUNT),
+              "kOperationNames must cover every Operation");
+
+DecodedInstruction make_invalid(InstructionFormat fmt, uint32_t binary) {
+    return DecodedInstruction{Op::INVALID, 0, 0, static_cast<uint8_t>(fmt), binary};
+}
+
+} // namespace
+
+DecodedInstruction InstructionUtils::predecode(uint32_t binary) {
+    uint32_t opcode = binary >> 26;
+    Operation op = (opcode == 0) ? kFunctTable[binary & 0x3F] : kOpcodeTable[opcode];
+    InstructionFormat fmt = (opcode == 0) ? InstructionFormat::R_TYPE
+                          : (opcode == 0x02 || opcode == 0x03) ? InstructionFormat::J_TYPE
+                          : InstructionFormat::I_TYPE;
+    if (op == Op::INVALID) {
+        return make_invalid(fmt, binary);
+    }
+
+    DecodedInstruction d{op, 0, 0, 0, 0};
+    if (fmt != InstructionFormat::J_TYPE) {
+        d.rs = (binary >> 21) & 0x1F;
+        d.rt = (binary >> 16) & 0x1F;
+    }
+    if (fmt == InstructionFormat::R_TYPE) {
+        d.rd = (binary >> 11) & 0x1F;
+    }
+
+    uint16_t imm16 = binary & 0xFFFF;
+    switch (kImmKinds[static_cast<size_t>(op)]) {
+        case ImmKind::NONE:     break;
+        case ImmKind::SHAMT:    d.imm = (binary >> 6) & 0x1F; break;
+        case ImmKind::SIGNED:   d.imm = sign_extend_16(imm16); break;
+        case ImmKind::UNSIGNED: d.imm = imm16; break;
+        case ImmKind::HIGH:     d.imm = static_cast<uint32_t>(imm16) << 16; break;
+        case ImmKind::BRANCH:   d.imm = sign_extend_16(imm16) << 2; break;
+        case ImmKind::JUMP:     d.imm = (binary & 0x3FFFFFF) << 2; break;
+    }
+    return d;
+}
+
+DecodedInstruction InstructionUtils::predecode(const Instruction& instr) {
+    return std::visit([](const auto& i) {
+        using T = std::decay_t<decltype(i)>;
+        if constexpr (std::is_same_v<T, RInstruction>) {
+            // R-type handlers are selected by funct alone
+            return predecode(encode_r_type(i) & 0x03FFFFFF);
+        } else if constexpr (std::is_same_v<T, IInstruction>) {
+            if (i.opcode == Opcode::RTYPE || i.opcode == Opcode::J || i.opcode == Opcode::JAL) {
+                return make_invalid(InstructionFormat::I_TYPE, encode_i_type(i));
+            }
+            return predecode(encode_i_type(i));
+        } else {
+            if (i.opcode != Opcode::J && i.opcode != Opcode::JAL) {
+                return make_invalid(InstructionFormat::J_TYPE, encode_j_type(i));
+            }
+            return predecode(encode_j_type(i));
+        }
+    }, instr);
+}
+
+InstructionFormat InstructionUtils::get_format(const DecodedInstruction& instr) {
+    if (instr.op == Op::INVALID) return static_cast<InstructionFormat>(instr.rd);
+    if (instr.op <= Op::SYNC) return InstructionFormat::R_TYPE;
+    if (instr.op == Op::J || instr.op == Op::JAL) return InstructionFormat::J_TYPE;
+    return InstructionFormat::I_TYPE;
+}
+
+std::string InstructionUtils::get_name(const DecodedInstruction& instr) {
+    if (instr.op == Op::INVALID) {
+        switch (get_format(instr)) {
+            case InstructionFormat::R_TYPE: return "unknown_r";
+            case InstructionFormat::I_TYPE: return "unknown_i";
+            case InstructionFormat::J_TYPE: return "unknown_j";
+        }
+    }
+    return kOperationNames[static_cast<size_t>(instr.op)];
+}
+
 InstructionExecutor::InstructionExecutor(std::istream& input, std::ostream& output)
     : input_stream(input), output_stream(output) {
-    init_handlers();
 }
 
 void InstructionExecutor::set_io_streams(std::istream& /* input */, std::ostream& /* output */) {
 }
 
+void InstructionExecutor::raise_trapped_fault(machine_state& state, uint32_t fault_address) {
+    uint32_t pc = state.get_pc();
+    if (!state.is_valid_address(pc, 4)) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+        return;
+    }
+    // Unmodelled: the cache model already saw the access that faulted
+    DecodedInstruction instr = InstructionUtils::predecode(state.fetch32(pc));
+    Operation op = instr.op;
+    bool store = op == Operation::SB || op == Operation::SH || op == Operation::SW || op == Operation::SC;
+    // BadVAddr is the guest's effective address, as the checked handlers
+    // raise it, not where in the reservation the host access landed
+    bool access = op >= Operation::LB && op <= Operation::SC;
+    uint32_t bad_address = access ? state.reg(instr.rs) + instr.imm : fault_address;
+    state.raise_exception(store ? ExceptionCause::ADDRESS_STORE : ExceptionCause::ADDRESS_LOAD, bad_address);
+}
+
+std::string InstructionExecutor::fault_message(const machine_state& state) {
+    const GuestFault& fault = state.fault();
+    if (fault.on_fetch()) {
+        return "Executor error: PC out of bounds at " + std::to_string(fault.epc);
+    }
+    DecodedInstruction instr = InstructionUtils::predecode(state.read_memory32(fault.epc));
+    std::string name = InstructionUtils::get_name(instr);
+    switch (fault.cause) {
+        case ExceptionCause::RESERVED_INSTRUCTION:
+            return "Unsupported instruction: " + name;
+        case ExceptionCause::SYSCALL:
+            return "Unknown syscall: " + std::to_string(static_cast<int>(static_cast<Syscall>(instr.imm)));
+        case ExceptionCause::OVERFLOW:
+            return "Arithmetic overflow in " + name + " instruction";
+        default:
+            break;
+    }
+    if (instr.op == Operation::TRAP) {
+        return "Memory access violation in print_string syscall";
+    }
+    if ((instr.op == Operation::LL || instr.op == Operation::SC) && (fault.bad_address & 3)) {
+        return "Unaligned address in " + name + " instruction";
+    }
+    return "Memory access violation in " + name + " instruction";
+}
+
 void InstructionExecutor::execute(machine_state& state, const Instruction& instr) {
-    std::string key = get_instruction_key(instr);
-    
-    auto it = handlers.find(key);
-    if (it != handlers.end()) {
-        it->second(state, instr);
+    execute(state, InstructionUtils::predecode(instr));
+}
+
+void InstructionExecutor::execute(machine_state& state, const DecodedInstruction& instr) {
+    if (state.bounds_checked()) {
+        execute<true>(state, instr);
     } else {
-        throw std::runtime_error("Unsupported instruction: " + key);
-    }
-}
-
-std::string InstructionExecutor::get_instruction_key(const Instruction& instr) {
-    return InstructionUtils::get_name(instr);
-}
-
-void InstructionExecutor::init_handlers() {
-    // R-type handlers
-    handlers["sll"] = [this](machine_state& s, const Instruction& i) {
-        execute_sll(s, std::get<RInstruction>(i));
-    };
-    handlers["srl"] = [this](machine_state& s, const Instruction& i) {
-        execute_srl(s, std::get<RInstruction>(i));
-    };
-    handlers["sra"] = [this](machine_state& s, const Instruction& i) {
-        execute_sra(s, std::get<RInstruction>(i));
-    };
-    handlers["sllv"] = [this](machine_state& s, const Instruction& i) {
-        execute_sllv(s, std::get<RInstruction>(i));
-    };
-    handlers["srlv"] = [this](machine_state& s, const Instruction& i) {
-        execute_srlv(s, std::get<RInstruction>(i));
-    };
-    handlers["srav"] = [this](machine_state& s, const Instruction& i) {
-        execute_srav(s, std::get<RInstruction>(i));
-    };
-    handlers["jr"] = [this](machine_state& s, const Instruction& i) {
-        execute_jr(s, std::get<RInstruction>(i));
-    };
-    handlers["jalr"] = [this](machine_state& s, const Instruction& i) {
-        execute_jalr(s, std::get<RInstruction>(i));
-    };
-    handlers["mfhi"] = [this](machine_state& s, const Instruction& i) {
-        execute_mfhi(s, std::get<RInstruction>(i));
-    };
-    handlers["mthi"] = [this](machine_state& s, const Instruction& i) {
-        execute_mthi(s, std::get<RInstruction>(i));
-    };
-    handlers["mflo"] = [this](machine_state& s, const Instruction& i) {
-        execute_mflo(s, std::get<RInstruction>(i));
-    };
-    handlers["mtlo"] = [this](machine_state& s, const Instruction& i) {
-        execute_mtlo(s, std::get<RInstruction>(i));
-    };
-    handlers["mult"] = [this](machine_state& s, const Instruction& i) {
-        execute_mult(s, std::get<RInstruction>(i));
-    };
-    handlers["multu"] = [this](machine_state& s, const Instruction& i) {
-        execute_multu(s, std::get<RInstruction>(i));
-    };
-    handlers["div"] = [this](machine_state& s, const Instruction& i) {
-        execute_div(s, std::get<RInstruction>(i));
-    };
-    handlers["divu"] = [this](machine_state& s, const Instruction& i) {
-        execute_divu(s, std::get<RInstruction>(i));
-    };
-    handlers["add"] = [this](machine_state& s, const Instruction& i) {
-        execute_add(s, std::get<RInstruction>(i));
-    };
-    handlers["addu"] = [this](machine_state& s, const Instruction& i) {
-        execute_addu(s, std::get<RInstruction>(i));
-    };
-    handlers["sub"] = [this](machine_state& s, const Instruction& i) {
-        execute_sub(s, std::get<RInstruction>(i));
-    };
-    handlers["subu"] = [this](machine_state& s, const Instruction& i) {
-        execute_subu(s, std::get<RInstruction>(i));
-    };
-    handlers["and"] = [this](machine_state& s, const Instruction& i) {
-        execute_and(s, std::get<RInstruction>(i));
-    };
-    handlers["or"] = [this](machine_state& s, const Instruction& i) {
-        execute_or(s, std::get<RInstruction>(i));
-    };
-    handlers["xor"] = [this](machine_state& s, const Instruction& i) {
-        execute_xor(s, std::get<RInstruction>(i));
-    };
-    handlers["nor"] = [this](machine_state& s, const Instruction& i) {
-        execute_nor(s, std::get<RInstruction>(i));
-    };
-    handlers["slt"] = [this](machine_state& s, const Instruction& i) {
-        execute_slt(s, std::get<RInstruction>(i));
-    };
-    handlers["sltu"] = [this](machine_state& s, const Instruction& i) {
-        execute_sltu(s, std::get<RInstruction>(i));
-    };
-
-    // I-type handlers
-    handlers["beq"] = [this](machine_state& s, const Instruction& i) {
-        execute_beq(s, std::get<IInstruction>(i));
-    };
-    handlers["bne"] = [this](machine_state& s, const Instruction& i) {
-        execute_bne(s, std::get<IInstruction>(i));
-    };
-    handlers["blez"] = [this](machine_state& s, const Instruction& i) {
-        execute_blez(s, std::get<IInstruction>(i));
-    };
-    handlers["bgtz"] = [this](machine_state& s, const Instruction& i) {
-        execute_bgtz(s, std::get<IInstruction>(i));
-    };
-    handlers["addi"] = [this](machine_state& s, const Instruction& i) {
-        execute_addi(s, std::get<IInstruction>(i));
-    };
-    handlers["addiu"] = [this](machine_state& s, const Instruction& i) {
-        execute_addiu(s, std::get<IInstruction>(i));
-    };
-    handlers["slti"] = [this](machine_state& s, const Instruction& i) {
-        execute_slti(s, std::get<IInstruction>(i));
-    };
-    handlers["sltiu"] = [this](machine_state& s, const Instruction& i) {
-        execute_sltiu(s, std::get<IInstruction>(i));
-    };
-    handlers["andi"] = [this](machine_state& s, const Instruction& i) {
-        execute_andi(s, std::get<IInstruction>(i));
-    };
-    handlers["ori"] = [this](machine_state& s, const Instruction& i) {
-        execute_ori(s, std::get<IInstruction>(i));
-    };
-    handlers["xori"] = [this](machine_state& s, const Instruction& i) {
-        execute_xori(s, std::get<IInstruction>(i));
-    };
-    handlers["llo"] = [this](machine_state& s, const Instruction& i) {
-        execute_llo(s, std::get<IInstruction>(i));
-    };
-    handlers["lhi"] = [this](machine_state& s, const Instruction& i) {
-        execute_lhi(s, std::get<IInstruction>(i));
-    };
-    handlers["lb"] = [this](machine_state& s, const Instruction& i) {
-        execute_lb(s, std::get<IInstruction>(i));
-    };
-    handlers["lh"] = [this](machine_state& s, const Instruction& i) {
-        execute_lh(s, std::get<IInstruction>(i));
-    };
-    handlers["lw"] = [this](machine_state& s, const Instruction& i) {
-        execute_lw(s, std::get<IInstruction>(i));
-    };
-    handlers["lbu"] = [this](machine_state& s, const Instruction& i) {
-        execute_lbu(s, std::get<IInstruction>(i));
-    };
-    handlers["lhu"] = [this](machine_state& s, const Instruction& i) {
-        execute_lhu(s, std::get<IInstruction>(i));
-    };
-    handlers["sb"] = [this](machine_state& s, const Instruction& i) {
-        execute_sb(s, std::get<IInstruction>(i));
-    };
-    handlers["sh"] = [this](machine_state& s, const Instruction& i) {
-        execute_sh(s, std::get<IInstruction>(i));
-    };
-    handlers["sw"] = [this](machine_state& s, const Instruction& i) {
-        execute_sw(s, std::get<IInstruction>(i));
-    };
-    handlers["trap"] = [this](machine_state& s, const Instruction& i) {
-        execute_trap(s, std::get<IInstruction>(i));
-    };
-
-    // J-type handlers
-    handlers["j"] = [this](machine_state& s, const Instruction& i) {
-        execute_j(s, std::get<JInstruction>(i));
-    };
-    handlers["jal"] = [this](machine_state& s, const Instruction& i) {
-        execute_jal(s, std::get<JInstruction>(i));
-    };
+        execute<false>(state, instr);
+    }
 }
 
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute(machine_state& state, const DecodedInstruction& instr) {
+    switch (instr.op) {
+        case Operation::SLL: execute_sll(state, instr); break;
+        case Operation::SRL: execute_srl(state, instr); break;
+        case Operation::SRA: execute_sra(state, instr); break;
+        case Operation::SLLV: execute_sllv(state, instr); break;
+        case Operation::SRLV: execute_srlv(state, instr); break;
+        case Operation::SRAV: execute_srav(state, instr); break;
+        case Operation::JR: execute_jr<Observed>(state, instr); break;
+        case Operation::JALR: execute_jalr<Observed>(state, instr); break;
+        case Operation::MFHI: execute_mfhi(state, instr); break;
+        case Operation::MTHI: execute_mthi(state, instr); break;
+        case Operation::MFLO: execute_mflo(state, instr); break;
+        case Operation::MTLO: execute_mtlo(state, instr); break;
+        case Operation::MULT: execute_mult(state, instr); break;
+        case Operation::MULTU: execute_multu(state, instr); break;
+        case Operation::DIV: execute_div(state, instr); break;
+        case Operation::DIVU: execute_divu(state, instr); break;
+        case Operation::ADD: execute_add(state, instr); break;
+        case Operation::ADDU: execute_addu(state, instr); break;
+        case Operation::SUB: execute_sub(state, instr); break;
+        case Operation::SUBU: execute_subu(state, instr); break;
+        case Operation::AND: execute_and(state, instr); break;
+        case Operation::OR: execute_or(state, instr); break;
+        case Operation::XOR: execute_xor(state, instr); break;
+        case Operation::NOR: execute_nor(state, instr); break;
+        case Operation::SLT: execute_slt(state, instr); break;
+        case Operation::SLTU: execute_sltu(state, instr); break;
+        case Operation::SYNC: execute_sync(state, instr); break;
+        case Operation::BEQ: execute_beq<Observed>(state, instr); break;
+        case Operation::BNE: execute_bne<Observed>(state, instr); break;
+        case Operation::BLEZ: execute_blez<Observed>(state, instr); break;
+        case Operation::BGTZ: execute_bgtz<Observed>(state, instr); break;
+        case Operation::ADDI: execute_addi(state, instr); break;
+        case Operation::ADDIU: execute_addiu(state, instr); break;
+        case Operation::SLTI: execute_slti(state, instr); break;
+        case Operation::SLTIU: execute_sltiu(state, instr); break;
+        case Operation::ANDI: execute_andi(state, instr); break;
+        case Operation::ORI: execute_ori(state, instr); break;
+        case Operation::XORI: execute_xori(state, instr); break;
+        case Operation::LLO: execute_llo(state, instr); break;
+        case Operation::LHI: execute_lhi(state, instr); break;
+        case Operation::TRAP: execute_trap<Observed>(state, instr); break;
+        case Operation::LB: execute_lb<Checked, Observed>(state, instr); break;
+        case Operation::LH: execute_lh<Checked, Observed>(state, instr); break;
+        case Operation::LW: execute_lw<Checked, Observed>(state, instr); break;
+        case Operation::LBU: execute_lbu<Checked, Observed>(state, instr); break;
+        case Operation::LHU: execute_lhu<Checked, Observed>(state, instr); break;
+        case Operation::SB: execute_sb<Checked, Observed>(state, instr); break;
+        case Operation::SH: execute_sh<Checked, Observed>(state, instr); break;
+        case Operation::SW: execute_sw<Checked, Observed>(state, instr); break;
+        case Operation::LL: execute_ll<Checked, Observed>(state, instr); break;
+        case Operation::SC: execute_sc<Checked, Observed>(state, instr); break;
+        case Operation::J: execute_j(state, instr); break;
+        case Operation::JAL: execute_jal<Observed>(state, instr); break;
+        default:
+            state.raise_exception(ExceptionCause::RESERVED_INSTRUCTION);
+            break;
+    }
+}
+
+template void InstructionExecutor::execute<true, false>(machine_state& state, const DecodedInstruction& instr);
+template void InstructionExecutor::execute<false, false>(machine_state& state, const DecodedInstruction& instr);
+template void InstructionExecutor::execute<true, true>(machine_state& state, const DecodedInstruction& instr);
+template void InstructionExecutor::execute<false, true>(machine_state& state, const DecodedInstruction& instr);
+
 // R-type instruction implementations
-void InstructionExecutor::execute_sll(machine_state& state, const RInstruction& instr) {
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    uint32_t result = rt_val << instr.shamt;
-    state.set_register(static_cast<Register>(instr.rd), result);
+void InstructionExecutor::execute_sll(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rt_val = state.reg(instr.rt);
+    uint32_t result = rt_val << instr.imm;
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_srl(machine_state& state, const RInstruction& instr) {
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    uint32_t result = rt_val >> instr.shamt;
-    state.set_register(static_cast<Register>(instr.rd), result);
+void InstructionExecutor::execute_srl(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rt_val = state.reg(instr.rt);
+    uint32_t result = rt_val >> instr.imm;
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_sra(machine_state& state, const RInstruction& instr) {
-    int32_t rt_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rt)));
-    int32_t result = rt_val >> instr.shamt;
-    state.set_register(static_cast<Register>(instr.rd), static_cast<uint32_t>(result));
+void InstructionExecutor::execute_sra(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rt_val = static_cast<int32_t>(state.reg(instr.rt));
+    int32_t result = rt_val >> instr.imm;
+    state.set_reg(instr.rd, static_cast<uint32_t>(result));
 }
 
-void InstructionExecutor::execute_sllv(machine_state& state, const RInstruction& instr) {
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
+void InstructionExecutor::execute_sllv(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rt_val = state.reg(instr.rt);
+    uint32_t rs_val = state.reg(instr.rs);
     uint32_t shift_amount = rs_val & 0x1F; // Only use lower 5 bits
     uint32_t result = rt_val << shift_amount;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_srlv(machine_state& state, const RInstruction& instr) {
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
+void InstructionExecutor::execute_srlv(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rt_val = state.reg(instr.rt);
+    uint32_t rs_val = state.reg(instr.rs);
     uint32_t shift_amount = rs_val & 0x1F; // Only use lower 5 bits
     uint32_t result = rt_val >> shift_amount;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_srav(machine_state& state, const RInstruction& instr) {
-    int32_t rt_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rt)));
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
+void InstructionExecutor::execute_srav(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rt_val = static_cast<int32_t>(state.reg(instr.rt));
+    uint32_t rs_val = state.reg(instr.rs);
     uint32_t shift_amount = rs_val & 0x1F; // Only use lower 5 bits
     int32_t result = rt_val >> shift_amount;
-    state.set_register(static_cast<Register>(instr.rd), static_cast<uint32_t>(result));
+    state.set_reg(instr.rd, static_cast<uint32_t>(result));
 }
 
-void InstructionExecutor::execute_jr(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
+template <bool Observed>
+void InstructionExecutor::execute_jr(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    if constexpr (Observed) {
+        if (profiler && instr.rs == static_cast<uint8_t>(Register::RA)) profiler->ret(rs_val);
+    }
     state.set_pc(rs_val);
 }
 
-void InstructionExecutor::execute_jalr(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
+template <bool Observed>
+void InstructionExecutor::execute_jalr(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
     state.set_register(Register::RA, state.get_pc() + 4);
+    if constexpr (Observed) {
+        if (profiler) profiler->call(rs_val, state.get_pc() + 4);
+    }
     state.set_pc(rs_val);
 }
 
-void InstructionExecutor::execute_mfhi(machine_state& state, const RInstruction& instr) {
+void InstructionExecutor::execute_mfhi(machine_state& state, const DecodedInstruction& instr) {
     uint32_t hi_val = state.get_hi();
-    state.set_register(static_cast<Register>(instr.rd), hi_val);
+    state.set_reg(instr.rd, hi_val);
 }
 
-void InstructionExecutor::execute_mthi(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
+void InstructionExecutor::execute_mthi(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
     state.set_hi(rs_val);
 }
 
-void InstructionExecutor::execute_mflo(machine_state& state, const RInstruction& instr) {
+void InstructionExecutor::execute_mflo(machine_state& state, const DecodedInstruction& instr) {
     uint32_t lo_val = state.get_lo();
-    state.set_register(static_cast<Register>(instr.rd), lo_val);
+    state.set_reg(instr.rd, lo_val);
 }
 
-void InstructionExecutor::execute_mtlo(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
+void InstructionExecutor::execute_mtlo(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
     state.set_lo(rs_val);
 }
 
-void InstructionExecutor::execute_mult(machine_state& state, const RInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    int32_t rt_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rt)));
+void InstructionExecutor::execute_mult(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    int32_t rt_val = static_cast<int32_t>(state.reg(instr.rt));
     int64_t result = static_cast<int64_t>(rs_val) * static_cast<int64_t>(rt_val);
     
     state.set_lo(static_cast<uint32_t>(result & 0xFFFFFFFF));
     state.set_hi(static_cast<uint32_t>((result >> 32) & 0xFFFFFFFF));
 }
 
-void InstructionExecutor::execute_multu(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_multu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint64_t result = static_cast<uint64_t>(rs_val) * static_cast<uint64_t>(rt_val);
     
     state.set_lo(static_cast<uint32_t>(result & 0xFFFFFFFF));
     state.set_hi(static_cast<uint32_t>((result >> 32) & 0xFFFFFFFF));
 }
 
-void InstructionExecutor::execute_div(machine_state& state, const RInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    int32_t rt_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rt)));
+void InstructionExecutor::execute_div(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    int32_t rt_val = static_cast<int32_t>(state.reg(instr.rt));
     
     if (rt_val != 0) {
         state.set_lo(static_cast<uint32_t>(rs_val / rt_val));
@@ -472,9 +585,9 @@ void InstructionExecutor::execute_div(machine_state& state, const RInstruction&
     }
 }
 
-void InstructionExecutor::execute_divu(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_divu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     
     if (rt_val != 0) {
         state.set_lo(rs_val / rt_val);
@@ -482,311 +595,374 @@ void InstructionExecutor::execute_divu(machine_state& state, const RInstruction&
     }
 }
 
-void InstructionExecutor::execute_add(machine_state& state, const RInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    int32_t rt_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rt)));
-    int32_t result = rs_val + rt_val;
-    state.set_register(static_cast<Register>(instr.rd), static_cast<uint32_t>(result));
+void InstructionExecutor::execute_add(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    int32_t rt_val = static_cast<int32_t>(state.reg(instr.rt));
+    int32_t result;
+    if (__builtin_add_overflow(rs_val, rt_val, &result) && state.has_exception_vector()) {
+        state.raise_exception(ExceptionCause::OVERFLOW);
+        return;
+    }
+    state.set_reg(instr.rd, static_cast<uint32_t>(result));
 }
 
-void InstructionExecutor::execute_addu(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_addu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint32_t result = rs_val + rt_val;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_sub(machine_state& state, const RInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    int32_t rt_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rt)));
-    int32_t result = rs_val - rt_val;
-    // TODO: Check for overflow exception in real MIPS
-    state.set_register(static_cast<Register>(instr.rd), static_cast<uint32_t>(result));
+void InstructionExecutor::execute_sub(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    int32_t rt_val = static_cast<int32_t>(state.reg(instr.rt));
+    int32_t result;
+    if (__builtin_sub_overflow(rs_val, rt_val, &result) && state.has_exception_vector()) {
+        state.raise_exception(ExceptionCause::OVERFLOW);
+        return;
+    }
+    state.set_reg(instr.rd, static_cast<uint32_t>(result));
 }
 
-void InstructionExecutor::execute_subu(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_subu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint32_t result = rs_val - rt_val;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_and(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_and(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint32_t result = rs_val & rt_val;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_or(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_or(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint32_t result = rs_val | rt_val;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_xor(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_xor(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint32_t result = rs_val ^ rt_val;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_nor(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_nor(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint32_t result = ~(rs_val | rt_val);
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_slt(machine_state& state, const RInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    int32_t rt_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rt)));
+void InstructionExecutor::execute_slt(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    int32_t rt_val = static_cast<int32_t>(state.reg(instr.rt));
     uint32_t result = (rs_val < rt_val) ? 1 : 0;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
 }
 
-void InstructionExecutor::execute_sltu(machine_state& state, const RInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
+void InstructionExecutor::execute_sltu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
     uint32_t result = (rs_val < rt_val) ? 1 : 0;
-    state.set_register(static_cast<Register>(instr.rd), result);
+    state.set_reg(instr.rd, result);
+}
+
+void InstructionExecutor::execute_sync(machine_state& /* state */, const DecodedInstruction& /* instr */) {
+    // Orders this hart's memory accesses against every other hart's
+    std::atomic_thread_fence(std::memory_order_seq_cst);
 }
 
 // I-type instruction implementations
-void InstructionExecutor::execute_beq(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    
-    if (rs_val == rt_val) {
-        int32_t offset = InstructionUtils::sign_extend_16(instr.immediate) << 2;
-        state.set_pc(state.get_pc() + offset);
+template <bool Observed>
+void InstructionExecutor::execute_beq(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
+    bool taken = rs_val == rt_val;
+    if constexpr (Observed) branch_taken = taken;
+    if (taken) {
+        state.set_pc(state.get_pc() + instr.imm);
     }
 }
 
-void InstructionExecutor::execute_bne(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    
-    if (rs_val != rt_val) {
-        int32_t offset = InstructionUtils::sign_extend_16(instr.immediate) << 2;
-        state.set_pc(state.get_pc() + offset);
+template <bool Observed>
+void InstructionExecutor::execute_bne(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
+    bool taken = rs_val != rt_val;
+    if constexpr (Observed) branch_taken = taken;
+    if (taken) {
+        state.set_pc(state.get_pc() + instr.imm);
     }
 }
 
-void InstructionExecutor::execute_blez(machine_state& state, const IInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    
-    if (rs_val <= 0) {
-        int32_t offset = InstructionUtils::sign_extend_16(instr.immediate) << 2;
-        state.set_pc(state.get_pc() + offset);
+template <bool Observed>
+void InstructionExecutor::execute_blez(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    bool taken = rs_val <= 0;
+    if constexpr (Observed) branch_taken = taken;
+    if (taken) {
+        state.set_pc(state.get_pc() + instr.imm);
     }
 }
 
-void InstructionExecutor::execute_bgtz(machine_state& state, const IInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    
-    if (rs_val > 0) {
-        int32_t offset = InstructionUtils::sign_extend_16(instr.immediate) << 2;
-        state.set_pc(state.get_pc() + offset);
+template <bool Observed>
+void InstructionExecutor::execute_bgtz(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    bool taken = rs_val > 0;
+    if constexpr (Observed) branch_taken = taken;
+    if (taken) {
+        state.set_pc(state.get_pc() + instr.imm);
     }
 }
 
-void InstructionExecutor::execute_addi(machine_state& state, const IInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    int32_t imm_val = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
-    int32_t result = rs_val + imm_val;
-    // TODO: Check for overflow exception in real MIPS
-    state.set_register(static_cast<Register>(instr.rt), static_cast<uint32_t>(result));
+void InstructionExecutor::execute_addi(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    int32_t imm_val = static_cast<int32_t>(instr.imm);
+    int32_t result;
+    if (__builtin_add_overflow(rs_val, imm_val, &result) && state.has_exception_vector()) {
+        state.raise_exception(ExceptionCause::OVERFLOW);
+        return;
+    }
+    state.set_reg(instr.rt, static_cast<uint32_t>(result));
 }
 
-void InstructionExecutor::execute_addiu(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t imm_val = InstructionUtils::sign_extend_16(instr.immediate);
+void InstructionExecutor::execute_addiu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t imm_val = instr.imm;
     uint32_t result = rs_val + imm_val;
-    state.set_register(static_cast<Register>(instr.rt), result);
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_slti(machine_state& state, const IInstruction& instr) {
-    int32_t rs_val = static_cast<int32_t>(state.get_register(static_cast<Register>(instr.rs)));
-    int32_t imm_val = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+void InstructionExecutor::execute_slti(machine_state& state, const DecodedInstruction& instr) {
+    int32_t rs_val = static_cast<int32_t>(state.reg(instr.rs));
+    int32_t imm_val = static_cast<int32_t>(instr.imm);
     uint32_t result = (rs_val < imm_val) ? 1 : 0;
-    state.set_register(static_cast<Register>(instr.rt), result);
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_sltiu(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t imm_val = InstructionUtils::sign_extend_16(instr.immediate);
+void InstructionExecutor::execute_sltiu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t imm_val = instr.imm;
     uint32_t result = (rs_val < imm_val) ? 1 : 0;
-    state.set_register(static_cast<Register>(instr.rt), result);
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_andi(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t imm_val = InstructionUtils::zero_extend_16(instr.immediate);
+void InstructionExecutor::execute_andi(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t imm_val = instr.imm;
     uint32_t result = rs_val & imm_val;
-    state.set_register(static_cast<Register>(instr.rt), result);
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_ori(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t imm_val = InstructionUtils::zero_extend_16(instr.immediate);
+void InstructionExecutor::execute_ori(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t imm_val = instr.imm;
     uint32_t result = rs_val | imm_val;
-    state.set_register(static_cast<Register>(instr.rt), result);
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_xori(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t imm_val = InstructionUtils::zero_extend_16(instr.immediate);
+void InstructionExecutor::execute_xori(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t imm_val = instr.imm;
     uint32_t result = rs_val ^ imm_val;
-    state.set_register(static_cast<Register>(instr.rt), result);
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_llo(machine_state& state, const IInstruction& instr) {
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    uint32_t result = (rt_val & 0xFFFF0000) | instr.immediate;
-    state.set_register(static_cast<Register>(instr.rt), result);
+void InstructionExecutor::execute_llo(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rt_val = state.reg(instr.rt);
+    uint32_t result = (rt_val & 0xFFFF0000) | instr.imm;
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_lhi(machine_state& state, const IInstruction& instr) {
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    uint32_t result = (rt_val & 0x0000FFFF) | (static_cast<uint32_t>(instr.immediate) << 16);
-    state.set_register(static_cast<Register>(instr.rt), result);
+void InstructionExecutor::execute_lhi(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rt_val = state.reg(instr.rt);
+    uint32_t result = (rt_val & 0x0000FFFF) | instr.imm;
+    state.set_reg(instr.rt, result);
 }
 
-void InstructionExecutor::execute_lb(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_lb(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        uint8_t byte_val = state.read_memory8(addr);
-        uint32_t result = InstructionUtils::sign_extend_8(byte_val);
-        state.set_register(static_cast<Register>(instr.rt), result);
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in lb instruction");
+
+    // Validated once here; the access itself is the unchecked one
+    if (Checked && !state.is_valid_address(addr, 1)) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+        return;
     }
+    state.set_reg(instr.rt, InstructionUtils::sign_extend_8(state.load8<Observed>(addr)));
 }
 
-void InstructionExecutor::execute_lh(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_lh(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        uint16_t half_val = state.read_memory16(addr);
-        uint32_t result = InstructionUtils::sign_extend_16(half_val);
-        state.set_register(static_cast<Register>(instr.rt), result);
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in lh instruction");
+
+    // Validated once here; the access itself is the unchecked one
+    if (Checked && !state.is_valid_address(addr, 2)) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+        return;
     }
+    state.set_reg(instr.rt, InstructionUtils::sign_extend_16(state.load16<Observed>(addr)));
 }
 
-void InstructionExecutor::execute_lw(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_lw(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        uint32_t word_val = state.read_memory32(addr);
-        state.set_register(static_cast<Register>(instr.rt), word_val);
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in lw instruction");
+
+    // Validated once here; the access itself is the unchecked one
+    if (Checked && !state.is_valid_address(addr, 4)) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+        return;
     }
+    state.set_reg(instr.rt, state.load32<Observed>(addr));
 }
 
-void InstructionExecutor::execute_lbu(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_lbu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        uint8_t byte_val = state.read_memory8(addr);
-        uint32_t result = InstructionUtils::zero_extend_8(byte_val);
-        state.set_register(static_cast<Register>(instr.rt), result);
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in lbu instruction");
+
+    // Validated once here; the access itself is the unchecked one
+    if (Checked && !state.is_valid_address(addr, 1)) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+        return;
     }
+    state.set_reg(instr.rt, InstructionUtils::zero_extend_8(state.load8<Observed>(addr)));
 }
 
-void InstructionExecutor::execute_lhu(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_lhu(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        uint16_t half_val = state.read_memory16(addr);
-        uint32_t result = InstructionUtils::zero_extend_16(half_val);
-        state.set_register(static_cast<Register>(instr.rt), result);
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in lhu instruction");
+
+    // Validated once here; the access itself is the unchecked one
+    if (Checked && !state.is_valid_address(addr, 2)) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+        return;
     }
+    state.set_reg(instr.rt, InstructionUtils::zero_extend_16(state.load16<Observed>(addr)));
 }
 
-void InstructionExecutor::execute_sb(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_sb(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        state.write_memory8(addr, static_cast<uint8_t>(rt_val & 0xFF));
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in sb instruction");
+
+    if (Checked && !state.is_valid_address(addr, 1)) {
+        state.raise_exception(ExceptionCause::ADDRESS_STORE, addr);
+        return;
     }
+    state.store8<Observed>(addr, static_cast<uint8_t>(rt_val & 0xFF));
 }
 
-void InstructionExecutor::execute_sh(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_sh(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        state.write_memory16(addr, static_cast<uint16_t>(rt_val & 0xFFFF));
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in sh instruction");
+
+    if (Checked && !state.is_valid_address(addr, 2)) {
+        state.raise_exception(ExceptionCause::ADDRESS_STORE, addr);
+        return;
     }
+    state.store16<Observed>(addr, static_cast<uint16_t>(rt_val & 0xFFFF));
 }
 
-void InstructionExecutor::execute_sw(machine_state& state, const IInstruction& instr) {
-    uint32_t rs_val = state.get_register(static_cast<Register>(instr.rs));
-    uint32_t rt_val = state.get_register(static_cast<Register>(instr.rt));
-    int32_t offset = static_cast<int32_t>(InstructionUtils::sign_extend_16(instr.immediate));
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_sw(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t rs_val = state.reg(instr.rs);
+    uint32_t rt_val = state.reg(instr.rt);
+    int32_t offset = static_cast<int32_t>(instr.imm);
     uint32_t addr = rs_val + offset;
-    
-    try {
-        state.write_memory32(addr, rt_val);
-    } catch (const std::out_of_range&) {
-        throw std::runtime_error("Memory access violation in sw instruction");
+
+    if (Checked && !state.is_valid_address(addr, 4)) {
+        state.raise_exception(ExceptionCause::ADDRESS_STORE, addr);
+        return;
+    }
+    state.store32<Observed>(addr, rt_val);
+}
+
+// ll/sc need a naturally aligned word: the link and the compare-and-swap
+// that implements sc are host word atomics
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_ll(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t addr = state.reg(instr.rs) + instr.imm;
+    if ((addr & 3) || (Checked && !state.is_valid_address(addr, 4))) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+        return;
+    }
+    uint32_t value = state.atomic_load32<Observed>(addr);
+    state.set_link(addr, value);
+    state.set_reg(instr.rt, value);
+}
+
+// Stores only if this hart's last ll was to `addr` and the word still holds
+// the value it read; every sc clears the link
+template <bool Checked, bool Observed>
+void InstructionExecutor::execute_sc(machine_state& state, const DecodedInstruction& instr) {
+    uint32_t addr = state.reg(instr.rs) + instr.imm;
+    if ((addr & 3) || (Checked && !state.is_valid_address(addr, 4))) {
+        state.raise_exception(ExceptionCause::ADDRESS_STORE, addr);
+        return;
     }
+    uint32_t expected = 0;
+    bool stored = state.take_link(addr, expected) && state.atomic_cas32<Observed>(addr, expected, state.reg(instr.rt));
+    state.set_reg(instr.rt, stored ? 1 : 0);
 }
 
 // J-type instruction implementations
-void InstructionExecutor::execute_j(machine_state& state, const JInstruction& instr) {
-    // Jump address is shifted left by 2 and combined with upper 4 bits of PC+4
+void InstructionExecutor::execute_j(machine_state& state, const DecodedInstruction& instr) {
+    // Target was shifted left by 2 at decode time; combine with upper 4 bits of PC+4
     uint32_t pc_plus_4 = state.get_pc() + 4;
-    uint32_t jump_addr = (pc_plus_4 & 0xF0000000) | (instr.address << 2);
+    uint32_t jump_addr = (pc_plus_4 & 0xF0000000) | instr.imm;
     state.set_pc(jump_addr);
 }
 
-void InstructionExecutor::execute_jal(machine_state& state, const JInstruction& instr) {
+template <bool Observed>
+void InstructionExecutor::execute_jal(machine_state& state, const DecodedInstruction& instr) {
     // Save return address (PC + 4) to $ra
     state.set_register(Register::RA, state.get_pc() + 4);
     
-    // Jump address is shifted left by 2 and combined with upper 4 bits of PC+4
+    // Target was shifted left by 2 at decode time; combine with upper 4 bits of PC+4
     uint32_t pc_plus_4 = state.get_pc() + 4;
-    uint32_t jump_addr = (pc_plus_4 & 0xF0000000) | (instr.address << 2);
+    uint32_t jump_addr = (pc_plus_4 & 0xF0000000) | instr.imm;
+    if constexpr (Observed) {
+        if (profiler) profiler->call(jump_addr, pc_plus_4);
+    }
     state.set_pc(jump_addr);
 }
 
 // Syscall handling
-void InstructionExecutor::execute_trap(machine_state& state, const IInstruction& instr) {
-    Syscall syscall_num = static_cast<Syscall>(instr.immediate);
-    handle_syscall(state, syscall_num);
+template <bool Observed>
+void InstructionExecutor::execute_trap(machine_state& state, const DecodedInstruction& instr) {
+    Syscall syscall_num = static_cast<Syscall>(instr.imm);
+    handle_syscall<Observed>(state, syscall_num);
 }
 
+template <bool Observed>
 void InstructionExecutor::handle_syscall(machine_state& state, Syscall syscall_num) {
+    // join can block for long and spawn never touches the streams
+    std::unique_lock<std::mutex> io;
+    if (harts && syscall_num != Syscall::SPAWN && syscall_num != Syscall::JOIN) {
+        io = std::unique_lock<std::mutex>(harts->io_mutex());
+    }
+
     switch (syscall_num) {
         case Syscall::PRINT_INT: {
             int32_t value = static_cast<int32_t>(state.get_register(Register::A0));
@@ -801,17 +977,18 @@ void InstructionExecutor::handle_syscall(machine_state& state, Syscall syscall_n
         }
         case Syscall::PRINT_STRING: {
             uint32_t addr = state.get_register(Register::A0);
-            try {
-                while (true) {
-                    uint8_t ch = state.read_memory8(addr);
-                    if (ch == 0) break; // Null terminator
-                    output_stream << static_cast<char>(ch);
-                    addr++;
+            while (true) {
+                if (!state.is_valid_address(addr, 1)) {
+                    output_stream.flush();
+                    state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+                    return;
                 }
-                output_stream.flush();  // Add flush
-            } catch (const std::out_of_range&) {
-                throw std::runtime_error("Memory access violation in print_string syscall");
+                uint8_t ch = state.load8<Observed>(addr);
+                if (ch == 0) break; // Null terminator
+                output_stream << static_cast<char>(ch);
+                addr++;
             }
+            output_stream.flush();  // Add flush
             break;
         }
         case Syscall::READ_INT: {
@@ -829,8 +1006,36 @@ void InstructionExecutor::handle_syscall(machine_state& state, Syscall syscall_n
         case Syscall::EXIT: {
             break;
         }
+        case Syscall::SPAWN: {
+            uint32_t id = UINT32_MAX;
+            if (harts) {
+                id = harts->spawn(state, state.get_register(Register::A0), state.get_register(Register::A1),
+                                  state.get_register(Register::A2));
+            }
+            state.set_register(Register::V0, id);
+            break;
+        }
+        case Syscall::JOIN: {
+            uint32_t result = harts ? harts->join(state, state.get_register(Register::A0)) : UINT32_MAX;
+            state.set_register(Register::V0, result);
+            break;
+        }
+        case Syscall::SET_EXCEPTION_VECTOR: {
+            state.set_register(Register::V0, state.get_exception_vector());
+            state.set_exception_vector(state.get_register(Register::A0));
+            break;
+        }
+        case Syscall::EXCEPTION_RETURN: {
+            state.return_from_exception();
+            break;
+        }
+        case Syscall::BAD_ADDRESS: {
+            state.set_register(Register::K1, state.fault().bad_address);
+            break;
+        }
         default:
-            throw std::runtime_error("Unknown syscall: " + std::to_string(static_cast<int>(syscall_num)));
+            state.raise_exception(ExceptionCause::SYSCALL);
+            break;
     }
 
 }
\ No newline at end of file
@@ -3,32 +3,24 @@
 #include <vector>
 #include <cstdint>
 #include <stdexcept>
+#include <utility>
 
-machine_state::machine_state(size_t memory_size) 
-    : memory(memory_size, 0),
+machine_state::machine_state(size_t memory_size, MemoryBackend backend)
+    : memory(memory_size, backend),
       pc(0),
       hi(0),
       lo(0)
     {}
 
-// Register access
-uint32_t machine_state::get_register(Register reg) const {
-    uint8_t index = static_cast<uint8_t>(reg);
-    // $zero always returns 0
-    if (index == 0) {
-        return 0;
-    }
-    return registers[index];
-}
+machine_state::machine_state(GuestMemory shared)
+    : memory(std::move(shared)),
+      pc(0),
+      hi(0),
+      lo(0)
+    {}
 
-void machine_state::set_register(Register reg, uint32_t value) {
-    uint8_t index = static_cast<uint8_t>(reg);
-    // $zero register ignored
-    if (index == 0) {
-        return;
-    }
-    
-    registers[index] = value;
+machine_state machine_state::share_memory() {
+    return machine_state(memory.view());
 }
 
 // Memory access
@@ -95,9 +87,21 @@ void machine_state::write_memory32(uint32_t addr, uint32_t value) {
     memory[addr + 3] = (value >> 24) & 0xFF;
 }
 
+void machine_state::raise_exception(ExceptionCause cause, uint32_t bad_address) {
+    last_fault = GuestFault{cause, pc, bad_address};
+    if (exception_vector == kNoVector || in_handler) {
+        halted = true;
+        return;
+    }
+    in_handler = true;
+    set_register(Register::K0, pc);
+    set_register(Register::K1, static_cast<uint32_t>(cause));
+    pc = exception_vector;
+}
+
 // Memory management
 void machine_state::resize_memory(size_t new_size) {
-    memory.resize(new_size, 0);
+    memory.resize(new_size);
 }
 
 void machine_state::load_memory(uint32_t addr, const std::vector<uint8_t>& data) {
@@ -105,5 +109,5 @@ void machine_state::load_memory(uint32_t addr, const std::vector<uint8_t>& data)
         throw std::out_of_range("Memory load would exceed bounds");
     }
     
-    std::copy(data.begin(), data.end(), memory.begin() + addr);
+    std::copy(data.begin(), data.end(), memory.data() + addr);
 }
\ No newline at end of file
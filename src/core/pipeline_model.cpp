@@ -0,0 +1,230 @@
+#include "../../include/pipeline_model.h"
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+
+// What the timing of an operation depends on
+enum Reads : uint8_t { READS_NONE, READS_RS, READS_RT, READS_RS_RT, READS_A0 };
+
+enum Kind : uint8_t {
+    PLAIN,
+    LOAD,           // result available after MEM
+    MULT,           // starts the hi/lo unit
+    DIV,
+    HILO_MOVE,      // reads or writes hi/lo
+    BRANCH,         // conditional, resolved in EX
+    JUMP_DIRECT,
+    JUMP_INDIRECT
+};
+
+struct OpTiming {
+    Reads reads;
+    Kind kind;
+};
+
+// Indexed by Operation; stores read rt only in MEM, where a loaded value
+// is forwarded in time, so only their base register can stall
+constexpr OpTiming kOps[] = {
+    {READS_RT, PLAIN}, {READS_RT, PLAIN}, {READS_RT, PLAIN},                        // SLL SRL SRA
+    {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN},               // SLLV SRLV SRAV
+    {READS_RS, JUMP_INDIRECT}, {READS_RS, JUMP_INDIRECT},                           // JR JALR
+    {READS_NONE, HILO_MOVE}, {READS_RS, HILO_MOVE},                                 // MFHI MTHI
+    {READS_NONE, HILO_MOVE}, {READS_RS, HILO_MOVE},                                 // MFLO MTLO
+    {READS_RS_RT, MULT}, {READS_RS_RT, MULT}, {READS_RS_RT, DIV}, {READS_RS_RT, DIV},   // MULT MULTU DIV DIVU
+    {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN},    // ADD ADDU SUB SUBU
+    {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN},    // AND OR XOR NOR
+    {READS_RS_RT, PLAIN}, {READS_RS_RT, PLAIN}, {READS_NONE, PLAIN},                // SLT SLTU SYNC
+    {READS_RS_RT, BRANCH}, {READS_RS_RT, BRANCH}, {READS_RS, BRANCH}, {READS_RS, BRANCH},   // BEQ BNE BLEZ BGTZ
+    {READS_RS, PLAIN}, {READS_RS, PLAIN}, {READS_RS, PLAIN}, {READS_RS, PLAIN},     // ADDI ADDIU SLTI SLTIU
+    {READS_RS, PLAIN}, {READS_RS, PLAIN}, {READS_RS, PLAIN},                        // ANDI ORI XORI
+    {READS_RT, PLAIN}, {READS_RT, PLAIN}, {READS_A0, PLAIN},                        // LLO LHI TRAP
+    {READS_RS, LOAD}, {READS_RS, LOAD}, {READS_RS, LOAD}, {READS_RS, LOAD}, {READS_RS, LOAD},  // LB LH LW LBU LHU
+    {READS_RS, PLAIN}, {READS_RS, PLAIN}, {READS_RS, PLAIN},                        // SB SH SW
+    {READS_RS, LOAD}, {READS_RS, PLAIN},                                            // LL SC
+    {READS_NONE, JUMP_DIRECT}, {READS_NONE, JUMP_DIRECT},                           // J JAL
+    {READS_NONE, PLAIN},                                                            // INVALID
+};
+static_assert(sizeof(kOps) / sizeof(kOps[0]) == static_cast<size_t>(Operation::COUNT),
+              "one timing entry per operation");
+
+bool reads(const OpTiming& op, const DecodedInstruction& instr, uint8_t reg) {
+    switch (op.reads) {
+        case READS_NONE: return false;
+        case READS_RS: return instr.rs == reg;
+        case READS_RT: return instr.rt == reg;
+        case READS_RS_RT: return instr.rs == reg || instr.rt == reg;
+        case READS_A0: return reg == static_cast<uint8_t>(Register::A0);
+    }
+    return false;
+}
+
+// Backward taken, forward not taken
+class StaticPredictor : public BranchPredictor {
+public:
+    const char* name() const override { return "static"; }
+    bool predict(uint32_t pc, uint32_t target) override { return target <= pc; }
+    void update(uint32_t, bool) override {}
+};
+
+// Saturating 2-bit counters, starting weakly not taken
+class TwoBitPredictor : public BranchPredictor {
+public:
+    explicit TwoBitPredictor(unsigned bits) : counters(size_t{1} << bits, 1), mask((1u << bits) - 1) {}
+    const char* name() const override { return "2bit"; }
+    bool predict(uint32_t pc, uint32_t) override { return counters[index(pc)] >= 2; }
+    void update(uint32_t pc, bool taken) override { train(counters[index(pc)], taken); }
+
+protected:
+    virtual uint32_t index(uint32_t pc) const { return (pc >> 2) & mask; }
+    static void train(uint8_t& counter, bool taken) {
+        if (taken && counter < 3) ++counter;
+        if (!taken && counter > 0) --counter;
+    }
+
+    std::vector<uint8_t> counters;
+    uint32_t mask;
+};
+
+// 2-bit counters indexed by the PC xor the outcomes of the last branches
+class GSharePredictor : public TwoBitPredictor {
+public:
+    explicit GSharePredictor(unsigned bits) : TwoBitPredictor(bits) {}
+    const char* name() const override { return "gshare"; }
+    void update(uint32_t pc, bool taken) override {
+        train(counters[index(pc)], taken);
+        history = ((history << 1) | (taken ? 1u : 0u)) & mask;
+    }
+
+private:
+    uint32_t index(uint32_t pc) const override { return ((pc >> 2) ^ history) & mask; }
+
+    uint32_t history = 0;
+};
+
+} // namespace
+
+std::unique_ptr<BranchPredictor> BranchPredictor::create(const std::string& name, unsigned bits) {
+    if (bits == 0 || bits > 24) {
+        throw std::runtime_error("Branch predictor table bits must be between 1 and 24");
+    }
+    if (name == "static") return std::make_unique<StaticPredictor>();
+    if (name == "2bit") return std::make_unique<TwoBitPredictor>(bits);
+    if (name == "gshare") return std::make_unique<GSharePredictor>(bits);
+    throw std::runtime_error("Unknown branch predictor: " + name + " (static, 2bit or gshare)");
+}
+
+PipelineModel::PipelineModel(const PipelineConfig& config, std::unique_ptr<BranchPredictor> predictor)
+    : config(config), predictor(std::move(predictor)) {
+    if (!this->predictor) {
+        throw std::runtime_error("PipelineModel needs a branch predictor");
+    }
+}
+
+void PipelineModel::stall(Stall kind, uint64_t cycles, PcTiming& at) {
+    now += cycles;
+    stall_cycles[kind] += cycles;
+    at.stalls[kind] += cycles;
+}
+
+void PipelineModel::retire(uint32_t pc, const DecodedInstruction& instr, bool taken) {
+    if (retired++) ++now;
+    const OpTiming& op = kOps[static_cast<size_t>(instr.op)];
+    PcTiming& at = per_pc[pc];
+    ++at.executed;
+
+    if (load_target && load_issue + 1 == now && reads(op, instr, load_target)) {
+        stall(LOAD_USE, 1, at);
+    }
+    load_target = 0;
+
+    switch (op.kind) {
+        case LOAD:
+            load_issue = now;
+            load_target = instr.rt;
+            break;
+        case MULT:
+        case DIV:
+        case HILO_MOVE:
+            if (now < hilo_ready) stall(HILO, hilo_ready - now, at);
+            if (op.kind == MULT) hilo_ready = now + config.mult_latency;
+            if (op.kind == DIV) hilo_ready = now + config.div_latency;
+            break;
+        case BRANCH: {
+            bool predicted = predictor->predict(pc, pc + instr.imm);
+            predictor->update(pc, taken);
+            ++branch_count;
+            if (predicted != taken) {
+                ++mispredict_count;
+                stall(MISPREDICT, config.mispredict_penalty, at);
+            }
+            break;
+        }
+        case JUMP_DIRECT:
+            stall(JUMP, config.jump_penalty, at);
+            break;
+        case JUMP_INDIRECT:
+            stall(JUMP, config.indirect_penalty, at);
+            break;
+        case PLAIN:
+            break;
+    }
+}
+
+uint64_t PipelineModel::total_stalls() const {
+    uint64_t total = 0;
+    for (uint64_t c : stall_cycles) total += c;
+    return total;
+}
+
+const char* PipelineModel::stall_name(Stall kind) {
+    switch (kind) {
+        case LOAD_USE: return "load-use";
+        case HILO: return "hi/lo";
+        case MISPREDICT: return "mispredict";
+        case JUMP: return "jump";
+        case STALL_KINDS: break;
+    }
+    return "?";
+}
+
+void PipelineModel::report(std::ostream& out, size_t top) const {
+    out << "Cycles: " << cycles() << "  Instructions: " << retired << "  CPI: " << std::fixed
+        << std::setprecision(3) << cpi() << std::defaultfloat << "\n";
+    out << "Stall cycles:";
+    for (int k = 0; k < STALL_KINDS; ++k) {
+        out << " " << stall_name(static_cast<Stall>(k)) << " " << stall_cycles[k];
+    }
+    out << "\n";
+    out << "Branches (" << predictor->name() << "): " << branch_count << ", mispredicted " << mispredict_count;
+    if (branch_count) {
+        out << " (" << std::fixed << std::setprecision(2) << 100.0 * mispredict_count / branch_count << "%)"
+            << std::defaultfloat;
+    }
+    out << "\n";
+
+    // Longest waits first, lower PCs first among equals
+    std::vector<std::pair<uint64_t, uint32_t>> pcs;
+    for (const auto& [pc, t] : per_pc) {
+        uint64_t waited = 0;
+        for (uint64_t c : t.stalls) waited += c;
+        if (waited) pcs.emplace_back(waited, pc);
+    }
+    std::sort(pcs.begin(), pcs.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    if (pcs.size() > top) pcs.resize(top);
+
+    out << "PCs by stall cycles:\n";
+    for (const auto& [waited, pc] : pcs) {
+        const PcTiming& t = per_pc.at(pc);
+        out << "  0x" << std::hex << std::setw(8) << std::setfill('0') << pc << std::dec << std::setfill(' ')
+            << "  executed " << t.executed << "  stalls " << waited << " (";
+        for (int k = 0; k < STALL_KINDS; ++k) {
+            out << (k ? ", " : "") << stall_name(static_cast<Stall>(k)) << " " << t.stalls[k];
+        }
+        out << ")\n";
+    }
+}
@@ -0,0 +1,109 @@
+#include "../../include/xxhash64.h"
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// The format is little-endian regardless of the host
+uint64_t read64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+uint64_t merge(uint64_t acc, uint64_t lane) {
+    acc ^= round(0, lane);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+XXHash64::XXHash64(uint64_t seed) : seed(seed) {
+    lanes[0] = seed + kPrime1 + kPrime2;
+    lanes[1] = seed + kPrime2;
+    lanes[2] = seed;
+    lanes[3] = seed - kPrime1;
+}
+
+void XXHash64::update(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    total += size;
+
+    if (buffered + size < 32) {
+        std::memcpy(buffer + buffered, p, size);
+        buffered += size;
+        return;
+    }
+    if (buffered) {
+        size_t fill = 32 - buffered;
+        std::memcpy(buffer + buffered, p, fill);
+        for (int i = 0; i < 4; ++i) lanes[i] = round(lanes[i], read64(buffer + 8 * i));
+        p += fill;
+        size -= fill;
+        buffered = 0;
+    }
+    for (; size >= 32; p += 32, size -= 32) {
+        for (int i = 0; i < 4; ++i) lanes[i] = round(lanes[i], read64(p + 8 * i));
+    }
+    std::memcpy(buffer, p, size);
+    buffered = size;
+}
+
+uint64_t XXHash64::digest() const {
+    uint64_t h;
+    if (total >= 32) {
+        h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        for (int i = 0; i < 4; ++i) h = merge(h, lanes[i]);
+    } else {
+        h = seed + kPrime5;
+    }
+    h += total;
+
+    const uint8_t* p = buffer;
+    const uint8_t* end = buffer + buffered;
+    for (; p + 8 <= end; p += 8) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end) {
+        h ^= read32(p) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= *p * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t XXHash64::hash(const void* data, size_t size, uint64_t seed) {
+    XXHash64 state(seed);
+    state.update(data, size);
+    return state.digest();
+}
@@ -0,0 +1,637 @@
+#include "../../include/block_engine.h"
+#include "../../include/executor.h"
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+constexpr size_t kMaxBlockLength = 64;
+constexpr size_t kOps = static_cast<size_t>(Operation::COUNT);
+
+bool ends_block(Operation op) {
+    switch (op) {
+        case Operation::JR:
+        case Operation::JALR:
+        case Operation::BEQ:
+        case Operation::BNE:
+        case Operation::BLEZ:
+        case Operation::BGTZ:
+        case Operation::J:
+        case Operation::JAL:
+        case Operation::TRAP:
+        case Operation::INVALID:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool transfers_control(Operation op) {
+    return ends_block(op) && op != Operation::TRAP && op != Operation::INVALID;
+}
+
+bool is_store(Operation op) {
+    return op == Operation::SB || op == Operation::SH || op == Operation::SW || op == Operation::SC;
+}
+
+// Raises guest exceptions without an exception vector (overflow needs one)
+bool may_fault(Operation op) {
+    switch (op) {
+        case Operation::LB:
+        case Operation::LH:
+        case Operation::LW:
+        case Operation::LBU:
+        case Operation::LHU:
+        case Operation::SB:
+        case Operation::SH:
+        case Operation::SW:
+        case Operation::LL:
+        case Operation::SC:
+        case Operation::TRAP:
+        case Operation::INVALID:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_r_type(Operation op) {
+    return static_cast<uint8_t>(op) <= static_cast<uint8_t>(Operation::SYNC);
+}
+
+// Register written by an ALU operation
+uint8_t alu_dest(const DecodedInstruction& i) {
+    return is_r_type(i.op) ? i.rd : i.rt;
+}
+
+// True if `i` reads general register `r` (r != $zero)
+bool reads(const DecodedInstruction& i, uint8_t r) {
+    if (r == 0) return false;
+    bool rt_is_source = is_r_type(i.op) || i.op == Operation::BEQ || i.op == Operation::BNE;
+    return i.rs == r || (rt_is_source && i.rt == r);
+}
+
+// --- operand constraints ---
+
+bool same_target(const DecodedInstruction& a, const DecodedInstruction& b) {
+    return a.rt == b.rt;
+}
+
+bool uses_result(const DecodedInstruction& a, const DecodedInstruction& b) {
+    return reads(b, alu_dest(a));
+}
+
+bool uses_loaded(const DecodedInstruction& a, const DecodedInstruction& b) {
+    return reads(b, a.rt);
+}
+
+// --- precomputation ---
+
+// lhi/llo each supply one half; together they fix the whole register
+uint32_t combined_halves(const DecodedInstruction& a, const DecodedInstruction& b) {
+    return a.imm | b.imm;
+}
+
+// --- fused handlers ---
+
+template <Operation Op>
+inline void alu(machine_state& state, const DecodedInstruction& i) {
+    uint32_t rs = state.reg(i.rs);
+    if constexpr (Op == Operation::ADD || Op == Operation::ADDU) {
+        state.set_reg(i.rd, rs + state.reg(i.rt));
+    } else if constexpr (Op == Operation::SUB || Op == Operation::SUBU) {
+        state.set_reg(i.rd, rs - state.reg(i.rt));
+    } else if constexpr (Op == Operation::AND) {
+        state.set_reg(i.rd, rs & state.reg(i.rt));
+    } else if constexpr (Op == Operation::OR) {
+        state.set_reg(i.rd, rs | state.reg(i.rt));
+    } else if constexpr (Op == Operation::XOR) {
+        state.set_reg(i.rd, rs ^ state.reg(i.rt));
+    } else if constexpr (Op == Operation::SLT) {
+        state.set_reg(i.rd, static_cast<int32_t>(rs) < static_cast<int32_t>(state.reg(i.rt)) ? 1 : 0);
+    } else if constexpr (Op == Operation::SLTU) {
+        state.set_reg(i.rd, rs < state.reg(i.rt) ? 1 : 0);
+    } else if constexpr (Op == Operation::ADDI || Op == Operation::ADDIU) {
+        state.set_reg(i.rt, rs + i.imm);
+    } else if constexpr (Op == Operation::SLTI) {
+        state.set_reg(i.rt, static_cast<int32_t>(rs) < static_cast<int32_t>(i.imm) ? 1 : 0);
+    } else if constexpr (Op == Operation::SLTIU) {
+        state.set_reg(i.rt, rs < i.imm ? 1 : 0);
+    } else {
+        static_assert(Op != Op, "operation has no fused ALU form");
+    }
+}
+
+template <Operation Op>
+inline bool taken(const machine_state& state, const DecodedInstruction& i) {
+    if constexpr (Op == Operation::BEQ) {
+        return state.reg(i.rs) == state.reg(i.rt);
+    } else {
+        static_assert(Op == Operation::BNE, "operation has no fused branch form");
+        return state.reg(i.rs) != state.reg(i.rt);
+    }
+}
+
+void load_constant(machine_state& state, const BlockSlot& slot) {
+    state.set_reg(slot.first.rt, slot.aux);
+}
+
+template <Operation A, Operation B>
+void alu_branch(machine_state& state, const BlockSlot& slot) {
+    alu<A>(state, slot.first);
+    uint32_t branch_pc = slot.pc + 4;
+    state.set_pc(taken<B>(state, slot.second) ? branch_pc + slot.second.imm : branch_pc);
+}
+
+template <Operation B>
+void load_alu(machine_state& state, const BlockSlot& slot) {
+    uint32_t addr = state.reg(slot.first.rs) + slot.first.imm;
+    if (state.bounds_checked() && !state.is_valid_address(addr, 4)) {
+        state.raise_exception(ExceptionCause::ADDRESS_LOAD, addr);
+        return;
+    }
+    state.set_reg(slot.first.rt, state.load32(addr));
+    alu<B>(state, slot.second);
+}
+
+// --- loop idioms ---
+
+// Registers and offsets of a recognised loop (see LoopIdiom)
+struct IdiomShape {
+    LoopIdiom kind = LoopIdiom::NONE;
+    uint8_t src = 0;        // copy source / string pointer
+    uint8_t dst = 0;        // copy or fill destination
+    uint8_t count = 0;      // down-counter (copy, fill) or length counter (strlen, 0 = none)
+    uint8_t value = 0;      // loaded byte (copy, strlen) or fill byte (fill)
+    int32_t src_offset = 0;
+    int32_t dst_offset = 0;
+    bool sign_extend = false;
+};
+
+bool is_byte_load(Operation op) {
+    return op == Operation::LB || op == Operation::LBU;
+}
+
+bool is_step(const DecodedInstruction& i, uint8_t reg, int32_t delta) {
+    return (i.op == Operation::ADDI || i.op == Operation::ADDIU) && i.rs == reg && i.rt == reg &&
+           static_cast<int32_t>(i.imm) == delta;
+}
+
+// Register a bne compares with $zero (0 if it is not that shape)
+uint8_t tested_against_zero(const DecodedInstruction& b) {
+    if (b.op != Operation::BNE) return 0;
+    return b.rt == 0 ? b.rs : (b.rs == 0 ? b.rt : 0);
+}
+
+bool distinct_nonzero(std::initializer_list<uint8_t> regs) {
+    uint32_t seen = 0;
+    for (uint8_t r : regs) {
+        if (r == 0 || (seen & (1u << r))) return false;
+        seen |= 1u << r;
+    }
+    return true;
+}
+
+// Each instruction in [first, first + n) is exactly one of the wanted increments, in any order
+bool increments(const DecodedInstruction* first, size_t n, std::initializer_list<std::pair<uint8_t, int32_t>> wanted) {
+    if (wanted.size() != n) return false;
+    for (const auto& w : wanted) {
+        size_t hits = 0;
+        for (size_t i = 0; i < n; ++i) hits += is_step(first[i], w.first, w.second);
+        if (hits != 1) return false;
+    }
+    return true;
+}
+
+IdiomShape match_idiom(const std::vector<DecodedInstruction>& body, uint32_t entry) {
+    IdiomShape shape;
+    const DecodedInstruction& branch = body.back();
+    uint32_t branch_pc = entry + 4 * static_cast<uint32_t>(body.size() - 1);
+    if (branch.op != Operation::BNE || branch_pc + branch.imm != entry) return shape;
+
+    const DecodedInstruction& head = body[0];
+    uint8_t tested = tested_against_zero(branch);
+
+    if (body.size() == 6 && is_byte_load(head.op) && body[1].op == Operation::SB && body[1].rt == head.rt) {
+        // lb t, a(src); sb t, b(dst); addi src,1; addi dst,1; addi n,-1; bne n, loop
+        uint8_t src = head.rs, dst = body[1].rs, t = head.rt;
+        if (distinct_nonzero({t, src, dst, tested}) &&
+            increments(&body[2], 3, {{src, 1}, {dst, 1}, {tested, -1}})) {
+            shape.kind = LoopIdiom::BYTE_COPY;
+            shape.src = src;
+            shape.dst = dst;
+            shape.count = tested;
+            shape.value = t;
+            shape.src_offset = static_cast<int32_t>(head.imm);
+            shape.dst_offset = static_cast<int32_t>(body[1].imm);
+            shape.sign_extend = head.op == Operation::LB;
+        }
+    } else if (body.size() == 4 && head.op == Operation::SB) {
+        // sb v, a(dst); addi dst,1; addi n,-1; bne n, loop
+        uint8_t dst = head.rs, v = head.rt;
+        if (distinct_nonzero({dst, tested}) && v != dst && v != tested &&
+            increments(&body[1], 2, {{dst, 1}, {tested, -1}})) {
+            shape.kind = LoopIdiom::BYTE_FILL;
+            shape.dst = dst;
+            shape.count = tested;
+            shape.value = v;
+            shape.dst_offset = static_cast<int32_t>(head.imm);
+        }
+    } else if ((body.size() == 3 || body.size() == 4) && is_byte_load(head.op) && tested == head.rt) {
+        // lb t, a(p); addi p,1; [addi len,1]; bne t, loop
+        uint8_t p = head.rs, t = head.rt;
+        bool matched = false;
+        uint8_t len = 0;
+        if (body.size() == 3) {
+            matched = distinct_nonzero({t, p}) && is_step(body[1], p, 1);
+        } else {
+            len = is_step(body[1], p, 1) ? body[2].rt : body[1].rt;
+            matched = distinct_nonzero({t, p, len}) && increments(&body[1], 2, {{p, 1}, {len, 1}});
+        }
+        if (matched) {
+            shape.kind = LoopIdiom::STRLEN;
+            shape.src = p;
+            shape.count = len;
+            shape.value = t;
+            shape.src_offset = static_cast<int32_t>(head.imm);
+            shape.sign_extend = head.op == Operation::LB;
+        }
+    }
+    return shape;
+}
+
+} // namespace
+
+const std::vector<FusionPattern>& BlockEngine::patterns() {
+    using O = Operation;
+    static const std::vector<FusionPattern> table = {
+        // 32-bit constants
+        {"lhi+llo", O::LHI, O::LLO, same_target, combined_halves, load_constant},
+        {"llo+lhi", O::LLO, O::LHI, same_target, combined_halves, load_constant},
+
+        // compare-and-branch
+        {"slt+bne", O::SLT, O::BNE, uses_result, nullptr, alu_branch<O::SLT, O::BNE>},
+        {"slt+beq", O::SLT, O::BEQ, uses_result, nullptr, alu_branch<O::SLT, O::BEQ>},
+        {"sltu+bne", O::SLTU, O::BNE, uses_result, nullptr, alu_branch<O::SLTU, O::BNE>},
+        {"sltu+beq", O::SLTU, O::BEQ, uses_result, nullptr, alu_branch<O::SLTU, O::BEQ>},
+        {"slti+bne", O::SLTI, O::BNE, uses_result, nullptr, alu_branch<O::SLTI, O::BNE>},
+        {"slti+beq", O::SLTI, O::BEQ, uses_result, nullptr, alu_branch<O::SLTI, O::BEQ>},
+        {"sltiu+bne", O::SLTIU, O::BNE, uses_result, nullptr, alu_branch<O::SLTIU, O::BNE>},
+        {"sltiu+beq", O::SLTIU, O::BEQ, uses_result, nullptr, alu_branch<O::SLTIU, O::BEQ>},
+
+        // loop counters
+        {"addi+bne", O::ADDI, O::BNE, uses_result, nullptr, alu_branch<O::ADDI, O::BNE>},
+        {"addi+beq", O::ADDI, O::BEQ, uses_result, nullptr, alu_branch<O::ADDI, O::BEQ>},
+        {"addiu+bne", O::ADDIU, O::BNE, uses_result, nullptr, alu_branch<O::ADDIU, O::BNE>},
+        {"addiu+beq", O::ADDIU, O::BEQ, uses_result, nullptr, alu_branch<O::ADDIU, O::BEQ>},
+
+        // load followed by a dependent ALU op
+        {"lw+add", O::LW, O::ADD, uses_loaded, nullptr, load_alu<O::ADD>},
+        {"lw+addu", O::LW, O::ADDU, uses_loaded, nullptr, load_alu<O::ADDU>},
+        {"lw+sub", O::LW, O::SUB, uses_loaded, nullptr, load_alu<O::SUB>},
+        {"lw+subu", O::LW, O::SUBU, uses_loaded, nullptr, load_alu<O::SUBU>},
+        {"lw+and", O::LW, O::AND, uses_loaded, nullptr, load_alu<O::AND>},
+        {"lw+or", O::LW, O::OR, uses_loaded, nullptr, load_alu<O::OR>},
+        {"lw+xor", O::LW, O::XOR, uses_loaded, nullptr, load_alu<O::XOR>},
+        {"lw+slt", O::LW, O::SLT, uses_loaded, nullptr, load_alu<O::SLT>},
+        {"lw+sltu", O::LW, O::SLTU, uses_loaded, nullptr, load_alu<O::SLTU>},
+        {"lw+addi", O::LW, O::ADDI, uses_loaded, nullptr, load_alu<O::ADDI>},
+        {"lw+addiu", O::LW, O::ADDIU, uses_loaded, nullptr, load_alu<O::ADDIU>},
+    };
+    return table;
+}
+
+struct BlockEngine::Block {
+    uint32_t entry;
+    uint32_t count;             // guest instructions
+    bool falls_through;         // last instruction is not a jump or branch
+    bool exits;                 // ends in trap 5
+    bool traps;                 // ends in a syscall, which may install an exception vector
+    IdiomShape idiom;           // whole-block loop replaceable by a host routine
+    std::vector<BlockSlot> slots;
+    std::vector<uint16_t> pairs;    // unfused adjacent pairs, first * kOps + second
+    uint64_t executions = 0;
+
+    // Last two successors, to skip the map lookup on hot edges
+    Block* next[2] = {nullptr, nullptr};
+    uint32_t next_pc[2] = {0, 0};
+    unsigned victim = 0;
+};
+
+BlockEngine::BlockEngine(InstructionExecutor& executor, const Program* program)
+    : executor(executor), program(program), flushed_pairs(kOps * kOps, 0) {
+    counters.pattern_hits.assign(patterns().size(), 0);
+}
+
+BlockEngine::~BlockEngine() = default;
+
+void BlockEngine::invalidate() {
+    for (const auto& entry : blocks) {
+        add_pair_counts(*entry.second, flushed_pairs);
+    }
+    blocks.clear();
+    code_lo = UINT32_MAX;
+    code_hi = 0;
+    ++counters.invalidations;
+}
+
+BlockEngine::Block* BlockEngine::lookup(machine_state& state, uint32_t pc) {
+    auto it = blocks.find(pc);
+    if (it != blocks.end()) return it->second.get();
+    return compile(state, pc);
+}
+
+// Null if `pc` is outside memory
+BlockEngine::Block* BlockEngine::compile(machine_state& state, uint32_t pc) {
+    if (!state.is_valid_address(pc, 4)) {
+        return nullptr;
+    }
+
+    std::vector<DecodedInstruction> instrs;
+    uint32_t addr = pc;
+    while (instrs.size() < kMaxBlockLength && state.is_valid_address(addr, 4)) {
+        uint32_t word = state.read_memory32(addr);
+        instrs.push_back(program ? program->decode(addr, word) : InstructionUtils::predecode(word));
+        addr += 4;
+        if (ends_block(instrs.back().op)) break;
+    }
+
+    auto block = std::make_unique<Block>();
+    block->entry = pc;
+    block->count = static_cast<uint32_t>(instrs.size());
+    block->falls_through = !transfers_control(instrs.back().op);
+    block->exits = instrs.back().op == Operation::TRAP && instrs.back().imm == 5;
+    block->traps = instrs.back().op == Operation::TRAP;
+    block->idiom = match_idiom(instrs, pc);
+
+    const std::vector<FusionPattern>& table = patterns();
+    for (size_t i = 0; i < instrs.size();) {
+        BlockSlot slot{};
+        slot.first = instrs[i];
+        slot.pc = pc + static_cast<uint32_t>(i * 4);
+        slot.pattern = -1;
+        slot.length = 1;
+        slot.store = is_store(slot.first.op);
+        slot.faults = may_fault(slot.first.op);
+
+        if (i + 1 < instrs.size()) {
+            const DecodedInstruction& next = instrs[i + 1];
+            for (size_t p = 0; p < table.size(); ++p) {
+                const FusionPattern& pat = table[p];
+                if (pat.first != slot.first.op || pat.second != next.op) continue;
+                if (pat.matches && !pat.matches(slot.first, next)) continue;
+                slot.second = next;
+                slot.aux = pat.prepare ? pat.prepare(slot.first, next) : 0;
+                slot.pattern = static_cast<int16_t>(p);
+                slot.length = 2;
+                slot.faults |= may_fault(next.op);
+                break;
+            }
+            if (slot.pattern < 0) {
+                block->pairs.push_back(static_cast<uint16_t>(static_cast<size_t>(slot.first.op) * kOps +
+                                                             static_cast<size_t>(next.op)));
+            }
+        }
+        block->slots.push_back(slot);
+        i += slot.length;
+    }
+
+    code_lo = std::min(code_lo, pc);
+    code_hi = std::max(code_hi, addr);
+    ++counters.blocks_compiled;
+
+    Block* raw = block.get();
+    blocks[pc] = std::move(block);
+    return raw;
+}
+
+RunStop BlockEngine::run(machine_state& state, uint64_t& steps, uint64_t max_steps,
+                         const std::atomic<bool>* expired) {
+    const std::vector<FusionPattern>& table = patterns();
+    Block* block = nullptr;
+
+    // Blocks neither check overflow nor deliver faults mid-block, so a guest
+    // with an exception vector steps
+    while (!state.has_exception_vector()) {
+        if (expired && expired->load(std::memory_order_relaxed)) return RunStop::TIME_LIMIT;
+        uint32_t pc = state.get_pc();
+        if (!block) {
+            // The step loop checks the budget before the PC, and raises fetch faults
+            if (steps >= max_steps) break;
+            block = lookup(state, pc);
+            if (!block) break;
+        }
+
+        // Not enough budget for the whole block: finish one instruction at a time
+        if (max_steps - steps < block->count) break;
+
+        if (block->idiom.kind != LoopIdiom::NONE && run_idiom(state, *block, steps, max_steps)) {
+            // The loop ran to completion and fell through its closing bne
+            state.set_pc(block->entry + 4 * block->count);
+        } else {
+            ++block->executions;
+            ++counters.blocks_executed;
+
+            // The whole block is charged up front; a fault gives back what did not run
+            steps += block->count;
+            running = block;
+
+            const BlockSlot* slot = block->slots.data();
+            const BlockSlot* end = slot + block->slots.size();
+            bool flush = false;
+            for (; slot != end; ++slot) {
+                state.set_pc(slot->pc);
+                if (slot->pattern >= 0) {
+                    table[slot->pattern].execute(state, *slot);
+                    ++counters.pattern_hits[slot->pattern];
+                } else if (slot->store) {
+                    uint64_t addr = state.reg(slot->first.rs) + slot->first.imm;
+                    addr &= 0xFFFFFFFFu;
+                    executor.execute(state, slot->first);
+                    if (state.faulted()) return stop_at_fault(state, steps);
+                    if (addr < code_hi && addr + 4 > code_lo) {
+                        // Code changed under us: resume after the store with fresh blocks
+                        flush = true;
+                        ++slot;
+                        break;
+                    }
+                } else {
+                    executor.execute(state, slot->first);
+                }
+                // Nothing can handle it: the PC is already on the faulting instruction
+                if (slot->faults && state.faulted()) return stop_at_fault(state, steps);
+            }
+            running = nullptr;
+
+            if (flush) {
+                uint32_t resume = (slot - 1)->pc + 4;
+                steps -= block->count - (resume - block->entry) / 4;
+                state.set_pc(resume);
+                invalidate();
+                block = nullptr;
+                continue;
+            }
+
+            uint32_t last = block->entry + 4 * (block->count - 1);
+            if (block->falls_through || state.get_pc() == last) {
+                state.set_pc(last + 4);
+            }
+        }
+        if (block->exits) return RunStop::EXITED;
+        if (block->traps && state.has_exception_vector()) break;
+
+        uint32_t next = state.get_pc();
+        Block* succ = nullptr;
+        if (block->next[0] && block->next_pc[0] == next) {
+            succ = block->next[0];
+        } else if (block->next[1] && block->next_pc[1] == next) {
+            succ = block->next[1];
+        } else {
+            if (steps >= max_steps) break;
+            succ = lookup(state, next);
+            if (!succ) break;
+            block->next[block->victim] = succ;
+            block->next_pc[block->victim] = next;
+            block->victim ^= 1;
+        }
+        block = succ;
+    }
+
+    return step_until_exit(state, steps, max_steps, expired);
+}
+
+// The running block stopped at a fault on state.get_pc(): give back the
+// steps charged for the instructions after it
+RunStop BlockEngine::stop_at_fault(const machine_state& state, uint64_t& steps) {
+    trapped(state, steps);
+    return RunStop::FAULTED;
+}
+
+void BlockEngine::trapped(const machine_state& state, uint64_t& steps) {
+    if (!running) return;
+    steps -= running->count - ((state.get_pc() - running->entry) / 4 + 1);
+    running = nullptr;
+}
+
+bool BlockEngine::run_idiom(machine_state& state, const Block& block, uint64_t& steps, uint64_t max_steps) {
+    const IdiomShape& shape = block.idiom;
+    const uint64_t memory_size = state.get_memory_size();
+    uint64_t iterations = 0;
+
+    switch (shape.kind) {
+        case LoopIdiom::BYTE_COPY: {
+            uint32_t n = state.reg(shape.count);
+            uint32_t from = state.reg(shape.src) + shape.src_offset;
+            uint32_t to = state.reg(shape.dst) + shape.dst_offset;
+            if (n == 0 || max_steps - steps < uint64_t{n} * block.count) return false;
+            if (from + uint64_t{n} > memory_size || to + uint64_t{n} > memory_size) return false;
+            // A forward byte loop replicates data when the destination starts inside the source
+            if (from < to && to < from + uint64_t{n}) return false;
+            if (to < code_hi && to + uint64_t{n} > code_lo) return false;
+
+            uint8_t last = state.read_memory8(from + n - 1);
+            std::memmove(state.host_range(to, n), state.host_range(from, n), n);
+            state.set_reg(shape.value, shape.sign_extend ? InstructionUtils::sign_extend_8(last) : last);
+            state.set_reg(shape.src, state.reg(shape.src) + n);
+            state.set_reg(shape.dst, state.reg(shape.dst) + n);
+            state.set_reg(shape.count, 0);
+            iterations = n;
+            break;
+        }
+        case LoopIdiom::BYTE_FILL: {
+            uint32_t n = state.reg(shape.count);
+            uint32_t to = state.reg(shape.dst) + shape.dst_offset;
+            if (n == 0 || max_steps - steps < uint64_t{n} * block.count) return false;
+            if (to + uint64_t{n} > memory_size) return false;
+            if (to < code_hi && to + uint64_t{n} > code_lo) return false;
+
+            std::memset(state.host_range(to, n), state.reg(shape.value) & 0xFF, n);
+            state.set_reg(shape.dst, state.reg(shape.dst) + n);
+            state.set_reg(shape.count, 0);
+            iterations = n;
+            break;
+        }
+        case LoopIdiom::STRLEN: {
+            uint32_t from = state.reg(shape.src) + shape.src_offset;
+            if (from >= memory_size) return false;
+            size_t span = static_cast<size_t>(memory_size - from);
+            const uint8_t* start = state.host_range(from, span);
+            const void* nul = std::memchr(start, 0, span);
+            // No terminator: let the byte loop reach the end of memory and fault
+            if (!nul) return false;
+            uint64_t k = static_cast<const uint8_t*>(nul) - start + 1;
+            if (max_steps - steps < k * block.count) return false;
+
+            state.set_reg(shape.src, state.reg(shape.src) + static_cast<uint32_t>(k));
+            if (shape.count) state.set_reg(shape.count, state.reg(shape.count) + static_cast<uint32_t>(k));
+            state.set_reg(shape.value, 0);
+            iterations = k;
+            break;
+        }
+        case LoopIdiom::NONE:
+            return false;
+    }
+
+    steps += iterations * block.count;
+    ++counters.idiom_loops;
+    counters.idiom_bytes += iterations;
+    return true;
+}
+
+RunStop BlockEngine::step_until_exit(machine_state& state, uint64_t& steps, uint64_t max_steps,
+                                     const std::atomic<bool>* expired) {
+    while (!expired || !expired->load(std::memory_order_relaxed)) {
+        uint64_t countdown = budget_slice(steps, max_steps);
+        if (countdown == 0) return RunStop::STEP_LIMIT;
+
+        for (; countdown; --countdown) {
+            ++steps;
+            uint32_t pc = state.get_pc();
+            if (!state.is_valid_address(pc, 4)) {
+                state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+                if (state.faulted()) return RunStop::FAULTED;
+                continue;
+            }
+
+            uint32_t word = state.read_memory32(pc);
+            DecodedInstruction instr = program ? program->decode(pc, word) : InstructionUtils::predecode(word);
+            bool is_exit_trap = instr.op == Operation::TRAP && instr.imm == 5;
+            executor.execute(state, instr);
+
+            if (state.get_pc() == pc) {
+                if (state.faulted()) return RunStop::FAULTED;
+                state.increment_pc();
+            }
+
+            if (is_exit_trap) return RunStop::EXITED;
+        }
+    }
+    return RunStop::TIME_LIMIT;
+}
+
+void BlockEngine::add_pair_counts(const Block& block, std::vector<uint64_t>& counts) const {
+    for (uint16_t pair : block.pairs) {
+        counts[pair] += block.executions;
+    }
+}
+
+std::vector<PairCount> BlockEngine::unfused_pairs(size_t limit) const {
+    std::vector<uint64_t> counts = flushed_pairs;
+    for (const auto& entry : blocks) {
+        add_pair_counts(*entry.second, counts);
+    }
+
+    std::vector<PairCount> result;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0) continue;
+        result.push_back({static_cast<Operation>(i / kOps), static_cast<Operation>(i % kOps), counts[i]});
+    }
+    std::sort(result.begin(), result.end(),
+              [](const PairCount& a, const PairCount& b) { return a.count > b.count; });
+    if (result.size() > limit) result.resize(limit);
+    return result;
+}
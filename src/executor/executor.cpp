@@ -1,10 +1,13 @@
 #include "../../include/executor.h"
 #include "../../include/instruction.h"
+#include "../../include/block_engine.h"
+#include "../../include/hart_group.h"
 #include <fstream>
 #include <stdexcept>
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <cstring>
 
 Executor::Executor() {}
@@ -34,6 +37,8 @@ static std::string instr_summary(const Instruction &instr) {
 }
 
 
+// Reads the image part of a binary; a debug section after it (DebugInfo)
+// is not read at all when the stream can seek
 static std::vector<uint8_t> read_all(std::istream& in) {
     std::vector<uint8_t> buf;
     in.seekg(0, std::ios::end);
@@ -45,99 +50,381 @@ static std::vector<uint8_t> read_all(std::istream& in) {
         while (in.read(reinterpret_cast<char*>(&b), 1)) {
             buf.push_back(b);
         }
+        if (buf.size() >= DebugInfo::kTrailerSize) {
+            buf.resize(DebugInfo::image_end(buf.data() + buf.size() - DebugInfo::kTrailerSize, buf.size()));
+        }
     } else {
+        uint64_t end = static_cast<uint64_t>(size);
+        if (end >= DebugInfo::kTrailerSize) {
+            uint8_t tail[DebugInfo::kTrailerSize];
+            in.seekg(size - static_cast<std::streamoff>(DebugInfo::kTrailerSize));
+            if (!in.read(reinterpret_cast<char*>(tail), sizeof(tail))) {
+                throw std::runtime_error("Failed to read binary file content.");
+            }
+            end = DebugInfo::image_end(tail, end);
+        }
         in.seekg(0);
-        buf.resize(static_cast<size_t>(size));
-        if (!in.read(reinterpret_cast<char*>(buf.data()), size)) {
+        buf.resize(static_cast<size_t>(end));
+        if (!in.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(end))) {
             throw std::runtime_error("Failed to read binary file content.");
         }
     }
     return buf;
 }
 
-machine_state Executor::run_stream(std::istream& in, uint64_t max_steps, bool verbose, uint32_t start_address) {
-    std::vector<uint8_t> bytes = read_all(in);
-    if (bytes.empty()) {
+// What a hart's loop reports each instruction to; only the main hart has any
+struct Observers {
+    bool verbose = false;
+    const DebugInfo* symbols = nullptr;
+    PipelineModel* timing = nullptr;
+    CoverageMap* coverage = nullptr;
+    const CacheHierarchy* caches = nullptr;    // attached to the hart's state
+    const CallProfiler* profiler = nullptr;    // set on the hart's executor
+
+    bool any() const { return verbose || timing || coverage || caches || profiler; }
+};
+
+static Observers observers_of(const ExecutorOptions& options) {
+    return {options.verbose, options.symbols, options.timing, options.coverage, options.caches, options.profiler};
+}
+
+// Everything a run loop takes besides the hart
+struct LoopSettings {
+    uint64_t max_steps;
+    Observers observers;
+    const std::atomic<bool>* stop;      // null for a single hart
+    const std::atomic<bool>* expired;   // Watchdog::flag(); null without a time limit
+};
+
+// Run loop policies. Each loop is instantiated for one memory, trace and
+// budget policy, so a feature that is off costs nothing per step.
+
+// Memory policies: CHECKED memory tests the fetch address and uses the
+// checked load/store handlers; GUARDED skips both and relies on the
+// caller trapping faults
+struct CheckedMemory {
+    static constexpr bool checked = true;
+};
+struct GuardedMemory {
+    static constexpr bool checked = false;
+};
+
+// Trace policies: what sees each instruction. Only a traced loop makes
+// the modelled fetches and accesses an attached cache model counts and
+// reports calls to the profiler; only a verbose one prints each step.
+struct Untraced {
+    static constexpr bool observed = false;
+    explicit Untraced(const Observers&) {}
+    void fetched(uint64_t, uint32_t, uint32_t) {}
+    void retired(uint32_t, const DecodedInstruction&, bool) {}
+};
+template <bool Verbose>
+struct Traced {
+    static constexpr bool observed = true;
+    explicit Traced(const Observers& observers) : observers(observers) {}
+
+    void fetched(uint64_t step, uint32_t pc, uint32_t word) {
+        if constexpr (Verbose) {
+            std::cout << "step " << step << " PC=0x" << std::hex << pc << std::dec
+                      << " word=0x" << std::hex << word << std::dec
+                      << " -> " << instr_summary(InstructionUtils::decode(word));
+            std::string where = observers.symbols ? observers.symbols->symbolize(pc) : std::string();
+            if (!where.empty()) std::cout << " [" << where << "]";
+            std::cout << "\n";
+        }
+    }
+    // `taken`: the executor's direction for a conditional branch
+    void retired(uint32_t pc, const DecodedInstruction& instr, bool taken) {
+        if (observers.timing) observers.timing->retire(pc, instr, taken);
+        if (observers.coverage) observers.coverage->record(pc, instr, taken);
+    }
+
+    Observers observers;
+};
+
+// Budget policies: what ends a loop short of trap 5 besides max_steps,
+// polled between slices. A solo hart stops at its time limit; a shared
+// budget also stops when the hart group asks its harts to.
+struct SoloBudget {
+    explicit SoloBudget(const LoopSettings& settings) : expired(settings.expired) {}
+    bool interrupted(RunStop& why) const {
+        if (!expired || !expired->load(std::memory_order_relaxed)) return false;
+        why = RunStop::TIME_LIMIT;
+        return true;
+    }
+
+    const std::atomic<bool>* expired;
+};
+struct SharedBudget : SoloBudget {
+    explicit SharedBudget(const LoopSettings& settings) : SoloBudget(settings), stop(settings.stop) {}
+    bool interrupted(RunStop& why) const {
+        if (SoloBudget::interrupted(why)) return true;
+        if (!stop->load(std::memory_order_relaxed)) return false;
+        why = RunStop::STOPPED;
+        return true;
+    }
+
+    const std::atomic<bool>* stop;
+};
+
+// Fetch/execute until trap 5, an unhandled fault (state.faulted()) or the
+// budget runs out, counting the budget down a slice at a time. `counter`
+// settles the count of fetched instructions (see StepCountdown); a traced
+// loop keeps it current for the profiler's clock.
+template <typename Memory, typename Trace, typename Budget>
+static RunStop run_loop(machine_state& state, InstructionExecutor& executor, const Program& program,
+                        StepCountdown& counter, const LoopSettings& settings) {
+    Trace trace(settings.observers);
+    Budget budget(settings);
+    RunStop why;
+    while (!budget.interrupted(why)) {
+        if (!counter.next_slice(settings.max_steps)) return RunStop::STEP_LIMIT;
+
+        for (; counter.countdown; --counter.countdown) {
+            uint32_t pc = state.get_pc();
+            if (Memory::checked && !state.is_valid_address(pc, 4)) {
+                state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+                if (state.faulted()) return counter.leave(RunStop::FAULTED);
+                continue;
+            }
+
+            uint32_t word = state.fetch32<Trace::observed>(pc);
+            DecodedInstruction instr = program.decode(pc, word);
+            trace.fetched(counter.running(), pc, word);
+            if constexpr (Trace::observed) counter.steps = counter.running();
+
+            // check TRAP (only trap 5 exits)
+            bool is_exit_trap = instr.op == Operation::TRAP && instr.imm == 5;
+
+            uint32_t old_pc = pc;
+            executor.execute<Memory::checked, Trace::observed>(state, instr);
+
+            if (state.get_pc() == old_pc) {
+                // A fault nobody handles leaves the PC on the faulting instruction
+                if (state.faulted()) return counter.leave(RunStop::FAULTED);
+                state.increment_pc();
+            }
+            trace.retired(old_pc, instr, executor.last_branch_taken());
+
+            if (is_exit_trap) return counter.leave(RunStop::EXITED);
+        }
+        counter.finish_slice();
+    }
+    return why;
+}
+
+using RunLoop = RunStop (*)(machine_state&, InstructionExecutor&, const Program&, StepCountdown&, const LoopSettings&);
+
+// Every policy combination, instantiated here and picked once per hart
+static RunLoop select_loop(bool checked, const Observers& observers, bool shared) {
+    static constexpr RunLoop loops[2][3][2] = {
+        {{run_loop<GuardedMemory, Untraced, SoloBudget>, run_loop<GuardedMemory, Untraced, SharedBudget>},
+         {run_loop<GuardedMemory, Traced<false>, SoloBudget>, run_loop<GuardedMemory, Traced<false>, SharedBudget>},
+         {run_loop<GuardedMemory, Traced<true>, SoloBudget>, run_loop<GuardedMemory, Traced<true>, SharedBudget>}},
+        {{run_loop<CheckedMemory, Untraced, SoloBudget>, run_loop<CheckedMemory, Untraced, SharedBudget>},
+         {run_loop<CheckedMemory, Traced<false>, SoloBudget>, run_loop<CheckedMemory, Traced<false>, SharedBudget>},
+         {run_loop<CheckedMemory, Traced<true>, SoloBudget>, run_loop<CheckedMemory, Traced<true>, SharedBudget>}},
+    };
+    size_t trace = observers.verbose ? 2 : observers.any() ? 1 : 0;
+    return loops[checked][trace][shared];
+}
+
+// Runs `run` over `state`, raising guarded-memory faults as the checked
+// loop would, after `trapped` has seen them. A fault the guest handles
+// resumes `run` at its vector.
+template <typename F, typename T>
+static RunStop run_trapped(machine_state& state, F run, T trapped) {
+    if (state.bounds_checked()) return run();
+    RunStop stop = RunStop::FAULTED;
+    uint32_t fault_address = 0;
+    while (!state.guest_memory().run_trapped([&] { stop = run(); }, fault_address)) {
+        trapped();
+        InstructionExecutor::raise_trapped_fault(state, fault_address);
+        if (state.faulted()) return RunStop::FAULTED;
+    }
+    return stop;
+}
+
+// Where the end of a run becomes a C++ exception
+static void throw_if_failed(const machine_state& state, RunStop stop) {
+    switch (stop) {
+        case RunStop::FAULTED:
+            throw std::runtime_error(InstructionExecutor::fault_message(state));
+        case RunStop::STEP_LIMIT:
+            throw std::runtime_error("Executor error: reached maximum instruction count limit.");
+        case RunStop::TIME_LIMIT:
+            throw std::runtime_error("Executor error: time limit exceeded.");
+        case RunStop::EXITED:
+        case RunStop::STOPPED:
+        case RunStop::REACHED:
+            break;
+    }
+}
+
+ExecutableImage read_executable_image(std::istream& in) {
+    ExecutableImage image;
+    image.bytes = read_all(in);
+    if (image.bytes.empty()) {
         throw std::runtime_error("Binary is empty.");
     }
 
-    uint32_t start_pc = 0;
-    bool header_found = false;
+    std::vector<uint8_t>& bytes = image.bytes;
     if (bytes.size() >= 8) {
         if (bytes[0] == 'M' && bytes[1] == 'I' && bytes[2] == 'P' && bytes[3] == 'S') {
-            uint32_t main_addr = static_cast<uint32_t>(bytes[4]) |
-                                 (static_cast<uint32_t>(bytes[5]) << 8) |
-                                 (static_cast<uint32_t>(bytes[6]) << 16) |
-                                 (static_cast<uint32_t>(bytes[7]) << 24);
-            start_pc = main_addr;
-            header_found = true;
-            std::vector<uint8_t> body(bytes.begin() + 8, bytes.end());
-            bytes.swap(body);
+            image.entry = static_cast<uint32_t>(bytes[4]) |
+                          (static_cast<uint32_t>(bytes[5]) << 8) |
+                          (static_cast<uint32_t>(bytes[6]) << 16) |
+                          (static_cast<uint32_t>(bytes[7]) << 24);
+            image.has_header = true;
+            bytes.erase(bytes.begin(), bytes.begin() + 8);
         }
     }
+    return image;
+}
 
-    if (start_address != UINT32_MAX) {
-        start_pc = start_address;
+Program::Program(ExecutableImage image)
+    : bytes(std::move(image.bytes)), start(image.entry), header(image.has_header) {
+    size_t count = bytes.size() / 4;
+    words.resize(count);
+    decoded.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* p = bytes.data() + i * 4;
+        words[i] = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        decoded[i] = InstructionUtils::predecode(words[i]);
     }
+}
 
-    machine_state state;
-    state.load_memory(0u, bytes);
+std::shared_ptr<const Program> Program::load(std::istream& in) {
+    return std::make_shared<const Program>(read_executable_image(in));
+}
+
+machine_state Executor::run(const Program& program, const ExecutorOptions& options) {
+    uint32_t start_pc = program.entry();
+    bool header_found = program.has_header();
+
+    if (options.start_address != UINT32_MAX) {
+        start_pc = options.start_address;
+    }
+    // Up to the whole 32-bit address space
+    if (options.memory_pages == 0 || options.memory_pages > (uint64_t{1} << 32) / kGuestPageSize) {
+        throw std::runtime_error("Executor error: invalid guest memory size: " +
+                                 std::to_string(options.memory_pages) + " pages");
+    }
+
+    machine_state state(size_t{options.memory_pages} * kGuestPageSize, options.memory);
+    state.map_image(program.image());
 
     if (!state.is_valid_address(start_pc, 0)) {
         throw std::runtime_error("Start PC is outside loaded binary memory: " + std::to_string(start_pc));
     }
 
     state.set_pc(start_pc);
-    InstructionExecutor executor;
+    state.attach_caches(options.caches);
+    std::istream& input = options.input ? *options.input : std::cin;
+    std::ostream& output = options.output ? *options.output : std::cout;
 
+    // The main hart's instruction count, the profiler's clock
     uint64_t steps = 0;
-    while (true) {
-        if (steps++ >= max_steps) {
-            throw std::runtime_error("Executor error: reached maximum instruction count limit.");
-        }
+    struct ProfileScope {
+        CallProfiler* profiler;
+        ~ProfileScope() { if (profiler) profiler->finish(); }
+    } profile{options.profiler};
+    if (options.profiler) options.profiler->start(start_pc, &steps);
 
-        uint32_t pc = state.get_pc();
-        if (!state.is_valid_address(pc, 4)) {
-            throw std::runtime_error("Executor error: PC out of bounds at " + std::to_string(pc));
-        }
+    // Fills in options.usage however the run ends; before `state` is returned or destroyed
+    RunStop stop = RunStop::FAULTED;
+    struct UsageScope {
+        ResourceUsage* usage;
+        const ExecutorOptions& options;
+        const machine_state& state;
+        const uint64_t& steps;
+        const RunStop& stop;
+        std::chrono::steady_clock::time_point started;
 
-        uint32_t word = state.read_memory32(pc);
-        Instruction instr = InstructionUtils::decode(word);
-
-        if (verbose) {
-            std::cout << "step " << steps << " PC=0x" << std::hex << pc << std::dec
-                      << " word=0x" << std::hex << word << std::dec
-                      << " -> " << instr_summary(instr) << "\n";
-        }
-
-        // check TRAP
-        bool is_exit_trap = false;
-        if (InstructionUtils::get_format(instr) == InstructionFormat::I_TYPE) {
-            IInstruction ii = std::get<IInstruction>(instr);
-            if (ii.opcode == Opcode::TRAP && ii.immediate == 5) {
-                is_exit_trap = true;  // Only mark as exit for trap 5
-            }
+        void record() {
+            if (!usage) return;
+            usage->stop = stop;
+            usage->instructions = steps;
+            usage->max_steps = options.max_steps;
+            usage->wall_time = std::chrono::steady_clock::now() - started;
+            usage->time_limit = options.time_limit;
+            size_t touched = (state.guest_memory().resident_bytes() + kGuestPageSize - 1) / kGuestPageSize;
+            usage->pages_touched = static_cast<uint32_t>(std::min<size_t>(touched, options.memory_pages));
+            usage->memory_pages = options.memory_pages;
+            usage->fault = stop == RunStop::FAULTED ? state.fault() : GuestFault();
+            usage = nullptr;
         }
+        ~UsageScope() { record(); }
+    } usage{options.usage, options, state, steps, stop, std::chrono::steady_clock::now()};
+    Watchdog watchdog(options.time_limit);
 
-        uint32_t old_pc = pc;
-        executor.execute(state, instr);
-
-        if (state.get_pc() == old_pc) {
-            state.increment_pc();
-        }
-
-        if (is_exit_trap) break;
+    if (options.harts > 1) {
+        // Blocks cached by one hart would miss code stored by another, so every hart steps
+        HartGroup harts(options.harts, [&](machine_state& hart, InstructionExecutor& executor,
+                                           const std::atomic<bool>& group_stop) {
+            bool main = &hart == &state;
+            LoopSettings settings{options.max_steps, main ? observers_of(options) : Observers(), &group_stop,
+                                  watchdog.flag()};
+            RunLoop loop = select_loop(hart.bounds_checked(), settings.observers, true);
+            if (main) executor.set_profiler(options.profiler);
+            uint64_t spawned_steps = 0;
+            StepCountdown counter(main ? steps : spawned_steps);
+            RunStop ended = run_trapped(hart, [&] { return loop(hart, executor, program, counter, settings); },
+                                        [&] { counter.trapped(); });
+            if (main) stop = ended;
+            throw_if_failed(hart, ended);
+        }, input, output);
+        harts.run(state);
+    } else {
+        InstructionExecutor executor(input, output);
+        executor.set_profiler(options.profiler);
+        BlockEngine blocks(executor, &program);
+        LoopSettings settings{options.max_steps, observers_of(options), nullptr, watchdog.flag()};
+        RunLoop loop = select_loop(state.bounds_checked(), settings.observers, false);
+        bool use_blocks = options.mode == ExecutionMode::BLOCK && !options.verbose && !options.caches &&
+                          !options.timing && !options.profiler && !options.coverage;
+        StepCountdown counter(steps);
+        stop = run_trapped(state, [&] {
+            if (use_blocks) return blocks.run(state, steps, options.max_steps, watchdog.flag());
+            return loop(state, executor, program, counter, settings);
+        }, [&] {
+            blocks.trapped(state, steps);
+            counter.trapped();
+        });
+        throw_if_failed(state, stop);
     }
 
-    if (header_found && verbose) {
+    if (header_found && options.verbose) {
         std::cout << "Header detected: 'MIPS' header used to set main PC.\n";
     }
 
+    state.attach_caches(nullptr);
+    usage.record();
     return state;
 }
 
-machine_state Executor::run_file(const std::string& filename, uint64_t max_steps, bool verbose, uint32_t start_address) {
+machine_state Executor::run_stream(std::istream& in, const ExecutorOptions& options) {
+    return run(Program(read_executable_image(in)), options);
+}
+
+machine_state Executor::run_stream(std::istream& in, uint64_t max_steps, bool verbose, uint32_t start_address) {
+    ExecutorOptions options;
+    options.max_steps = max_steps;
+    options.verbose = verbose;
+    options.start_address = start_address;
+    return run_stream(in, options);
+}
+
+machine_state Executor::run_file(const std::string& filename, const ExecutorOptions& options) {
     std::ifstream ifs(filename, std::ios::binary);
     if (!ifs) throw std::runtime_error("Cannot open binary file: " + filename);
-    return run_stream(ifs, max_steps, verbose, start_address);
+    return run_stream(ifs, options);
+}
+
+machine_state Executor::run_file(const std::string& filename, uint64_t max_steps, bool verbose, uint32_t start_address) {
+    ExecutorOptions options;
+    options.max_steps = max_steps;
+    options.verbose = verbose;
+    options.start_address = start_address;
+    return run_file(filename, options);
 }
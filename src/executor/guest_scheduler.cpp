@@ -0,0 +1,246 @@
+#include "../../include/guest_scheduler.h"
+#include <algorithm>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <cctype>
+
+namespace {
+
+// Stdin that arrives in pieces; reading past what has arrived sees EOF,
+// so the scheduler only lets a guest read once its syscall can complete
+class InputBuffer : public std::streambuf {
+public:
+    InputBuffer() { setg(&data[0], &data[0], &data[0]); }
+
+    void append(const std::string& bytes) {
+        data.erase(0, gptr() - eback());
+        data += bytes;
+        setg(&data[0], &data[0], &data[0] + data.size());
+    }
+
+    const char* begin() const { return gptr(); }
+    const char* end() const { return egptr(); }
+
+private:
+    std::string data;
+};
+
+}
+
+class GuestScheduler::Task {
+public:
+    Task(std::vector<uint8_t> image, uint32_t entry, uint64_t max_steps, size_t memory_size)
+        : state(memory_size), in(&input), executor(in, out), max_steps(max_steps) {
+        state.load_memory(0, image);
+        state.set_pc(entry);
+    }
+
+    enum class Slice { RUNNABLE, WAITING, FINISHED };
+
+    // Runs at most `quantum` instructions, checking the budget once per
+    // slice; throws what Executor would
+    Slice run(uint64_t quantum) {
+        for (uint64_t n = std::min(quantum, max_steps - steps); n; --n) {
+            uint32_t pc = state.get_pc();
+            if (!state.is_valid_address(pc, 4)) {
+                steps++;
+                state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+                if (state.faulted()) throw std::runtime_error(InstructionExecutor::fault_message(state));
+                continue;
+            }
+            DecodedInstruction instr = InstructionUtils::predecode(state.read_memory32(pc));
+            if (instr.op == Operation::TRAP && !input_ready(instr.imm)) {
+                blocked_on = instr.imm;
+                return Slice::WAITING;
+            }
+            steps++;
+            bool exit = instr.op == Operation::TRAP && instr.imm == 5;
+            executor.execute(state, instr);
+            if (state.get_pc() == pc) {
+                if (state.faulted()) throw std::runtime_error(InstructionExecutor::fault_message(state));
+                state.increment_pc();
+            }
+            if (exit) return Slice::FINISHED;
+        }
+        if (steps >= max_steps) {
+            throw std::runtime_error("Executor error: reached maximum instruction count limit.");
+        }
+        return Slice::RUNNABLE;
+    }
+
+    // Moves what feed() and the guest exchanged since the last slice; with `lock` held
+    void swap_io() {
+        if (!incoming.empty()) {
+            input.append(incoming);
+            incoming.clear();
+        }
+        input_closed = incoming_closed;
+        outgoing += out.str();
+        out.str("");
+    }
+
+    // Whether the syscall in trap `code` can run without more input
+    bool input_ready(uint32_t code) const {
+        if (input_closed) return true;
+        const char* p = input.begin();
+        const char* end = input.end();
+        if (code == static_cast<uint32_t>(Syscall::READ_CHARACTER)) return p != end;
+        if (code != static_cast<uint32_t>(Syscall::READ_INT)) return true;
+
+        // operator>> stops at the first character that cannot extend the number
+        while (p != end && std::isspace(static_cast<unsigned char>(*p))) ++p;
+        if (p != end && (*p == '+' || *p == '-')) ++p;
+        if (p == end) return false;
+        while (p != end && std::isdigit(static_cast<unsigned char>(*p))) ++p;
+        return p != end;
+    }
+
+    machine_state state;
+    InputBuffer input;
+    std::istream in;
+    std::ostringstream out;
+    InstructionExecutor executor;
+    uint64_t max_steps;
+    uint64_t steps = 0;
+    bool input_closed = false;
+    uint32_t blocked_on = 0;    // trap code of the read a WAITING slice stopped at
+
+    // Guarded by the scheduler's lock
+    std::string incoming;
+    bool incoming_closed = false;
+    std::string outgoing;
+    std::string error;
+    bool queued = false;        // in `runnable` or running on a worker
+    bool waiting = false;       // parked until feed() or close_input()
+    bool finished = false;
+};
+
+GuestScheduler::GuestScheduler(size_t threads, uint64_t quantum) : quantum(quantum ? quantum : 1) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i) {
+        this->threads.emplace_back([this] { worker(); });
+    }
+}
+
+GuestScheduler::~GuestScheduler() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        shutting_down = true;
+    }
+    work.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+uint64_t GuestScheduler::submit(std::vector<uint8_t> image, uint32_t entry, uint64_t max_steps,
+                                size_t memory_size) {
+    if (image.size() > memory_size) {
+        throw std::runtime_error("Program too large for memory");
+    }
+    auto task = std::make_shared<Task>(std::move(image), entry, max_steps, memory_size);
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t id = next_id++;
+    tasks.emplace(id, task);
+    enqueue(task);
+    return id;
+}
+
+void GuestScheduler::feed(uint64_t id, const std::string& input) {
+    std::shared_ptr<Task> task = find(id);
+    std::lock_guard<std::mutex> guard(lock);
+    if (task->incoming_closed) {
+        throw std::logic_error("Input of guest " + std::to_string(id) + " is already closed");
+    }
+    task->incoming += input;
+    enqueue(task);
+}
+
+void GuestScheduler::close_input(uint64_t id) {
+    std::shared_ptr<Task> task = find(id);
+    std::lock_guard<std::mutex> guard(lock);
+    task->incoming_closed = true;
+    enqueue(task);
+}
+
+std::string GuestScheduler::take_output(uint64_t id) {
+    std::shared_ptr<Task> task = find(id);
+    std::lock_guard<std::mutex> guard(lock);
+    std::string output;
+    output.swap(task->outgoing);
+    return output;
+}
+
+GuestResult GuestScheduler::wait(uint64_t id) {
+    std::shared_ptr<Task> task = find(id);
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [&] { return task->finished; });
+    tasks.erase(id);
+
+    GuestResult result;
+    result.output.swap(task->outgoing);
+    result.error = task->error;
+    result.steps = task->steps;
+    return result;
+}
+
+size_t GuestScheduler::waiting_for_input() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return parked;
+}
+
+std::shared_ptr<GuestScheduler::Task> GuestScheduler::find(uint64_t id) const {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = tasks.find(id);
+    if (it == tasks.end()) {
+        throw std::out_of_range("No guest with id " + std::to_string(id));
+    }
+    return it->second;
+}
+
+void GuestScheduler::enqueue(const std::shared_ptr<Task>& task) {
+    if (task->finished || task->queued) return;
+    if (task->waiting) {
+        task->waiting = false;
+        parked--;
+    }
+    task->queued = true;
+    runnable.push_back(task);
+    work.notify_one();
+}
+
+void GuestScheduler::worker() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        work.wait(guard, [&] { return shutting_down || !runnable.empty(); });
+        if (shutting_down) return;
+        std::shared_ptr<Task> task = std::move(runnable.front());
+        runnable.pop_front();
+        task->swap_io();
+        guard.unlock();
+
+        // Only this worker touches the guest until it is queued again
+        Task::Slice slice;
+        std::string error;
+        try {
+            slice = task->run(quantum);
+        } catch (const std::exception& e) {
+            slice = Task::Slice::FINISHED;
+            error = e.what();
+        }
+
+        guard.lock();
+        task->swap_io();
+        task->queued = false;
+        if (slice == Task::Slice::FINISHED) {
+            task->finished = true;
+            task->error = error;
+            done.notify_all();
+        } else if (slice == Task::Slice::RUNNABLE || task->input_ready(task->blocked_on)) {
+            // Input that arrived during the slice wakes the guest right away
+            enqueue(task);
+        } else {
+            task->waiting = true;
+            parked++;
+        }
+    }
+}
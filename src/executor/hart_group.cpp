@@ -0,0 +1,147 @@
+#include "../../include/hart_group.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr uint32_t kNoHart = UINT32_MAX;
+
+} // namespace
+
+struct HartGroup::Hart {
+    machine_state* state;
+    std::unique_ptr<machine_state> own;     // spawned harts' registers over the shared memory
+    std::thread thread;
+    bool exited = false;
+    bool joined = false;
+    uint32_t result = 0;                    // $v0 at exit
+    std::shared_ptr<Hart> waiting_for;      // hart this one is blocked joining
+};
+
+HartGroup::HartGroup(size_t max_harts, RunHart run_hart, std::istream& input, std::ostream& output)
+    : max_harts(std::max<size_t>(max_harts, 1)), body(std::move(run_hart)), input(input), output(output) {}
+
+HartGroup::~HartGroup() {
+    stop = true;
+    changed.notify_all();
+    for (auto& hart : harts) {
+        if (hart && hart->thread.joinable()) hart->thread.join();
+    }
+}
+
+void HartGroup::run(machine_state& main) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        harts.assign(max_harts, nullptr);
+        harts[0] = std::make_shared<Hart>();
+        harts[0]->state = &main;
+        running = 1;
+        error.clear();
+        stop = false;
+    }
+
+    run_hart(*harts[0]);
+
+    // Harts still running can spawn more, so wait until none is left
+    std::vector<std::thread> threads;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [&] { return running == 0; });
+        for (auto& hart : harts) {
+            if (hart && hart->thread.joinable()) threads.push_back(std::move(hart->thread));
+        }
+    }
+    for (std::thread& thread : threads) thread.join();
+    harts.clear();
+
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+void HartGroup::run_hart(Hart& hart) {
+    InstructionExecutor executor(input, output);
+    executor.set_hart_host(this);
+    std::string failure;
+    try {
+        body(*hart.state, executor, stop);
+    } catch (const std::exception& e) {
+        failure = e.what();
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (!failure.empty()) fail(failure);
+    hart.exited = true;
+    hart.result = hart.state->get_register(Register::V0);
+    --running;
+    changed.notify_all();
+}
+
+void HartGroup::fail(const std::string& message) {
+    if (error.empty()) error = message;
+    stop = true;
+    changed.notify_all();
+}
+
+bool HartGroup::deadlocked() const {
+    bool any = false;
+    for (const auto& hart : harts) {
+        if (!hart || hart->exited) continue;
+        if (!hart->waiting_for || hart->waiting_for->exited) return false;
+        any = true;
+    }
+    return any;
+}
+
+uint32_t HartGroup::spawn(machine_state& parent, uint32_t entry, uint32_t arg, uint32_t stack) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (stop) return kNoHart;
+
+    for (uint32_t id = 1; id < harts.size(); ++id) {
+        if (harts[id] && !harts[id]->joined) continue;
+
+        auto hart = std::make_shared<Hart>();
+        hart->own = std::make_unique<machine_state>(parent.share_memory());
+        hart->state = hart->own.get();
+        hart->state->set_pc(entry);
+        hart->state->set_register(Register::A0, arg);
+        hart->state->set_register(Register::SP, stack);
+        hart->thread = std::thread([this, hart] { run_hart(*hart); });
+        harts[id] = hart;
+        ++running;
+        return id;
+    }
+    return kNoHart;
+}
+
+uint32_t HartGroup::join(machine_state& caller, uint32_t id) {
+    std::unique_lock<std::mutex> guard(lock);
+    if (id == 0 || id >= harts.size() || !harts[id] || harts[id]->joined || harts[id]->state == &caller) {
+        return kNoHart;
+    }
+
+    std::shared_ptr<Hart> target = harts[id];
+    std::shared_ptr<Hart> self;
+    for (const auto& hart : harts) {
+        if (hart && hart->state == &caller) self = hart;
+    }
+
+    if (self) self->waiting_for = target;
+    while (!target->exited && !stop) {
+        if (deadlocked()) {
+            fail("Executor error: every running hart is waiting in join");
+            break;
+        }
+        changed.wait(guard);
+    }
+    if (self) self->waiting_for.reset();
+
+    // Another hart may have joined it first
+    if (!target->exited || target->joined) return kNoHart;
+    target->joined = true;
+    std::thread thread = std::move(target->thread);
+    guard.unlock();
+    thread.join();
+    return target->result;
+}
@@ -0,0 +1,549 @@
+#include "../../include/lockstep_engine.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MIPS_LANE_X86 1
+#endif
+
+namespace {
+
+// Guest memory size of Executor
+constexpr size_t kMemorySize = 1024 * 1024;
+
+// Store tracking granularity for shared instruction fetch
+constexpr unsigned kLineShift = 6;
+
+// Registers of one group, register-major: reg r of lane l is regs[r * width + l]
+struct LaneFrame {
+    uint32_t* regs;
+    uint32_t* hi;
+    uint32_t* lo;
+    uint32_t* pc;
+    const uint32_t* mask;   // all-ones for the lanes taking this step
+    size_t width;           // lanes, a multiple of 8
+};
+
+namespace scalar {
+using vec = uint32_t;
+constexpr size_t kVecLanes = 1;
+inline vec load(const uint32_t* p) { return *p; }
+inline void store(uint32_t* p, vec v) { *p = v; }
+inline vec splat(uint32_t x) { return x; }
+inline vec shl(vec a, vec n) { return a << n; }
+inline vec shr(vec a, vec n) { return a >> n; }
+inline vec sar(vec a, vec n) { return static_cast<uint32_t>(static_cast<int32_t>(a) >> n); }
+inline vec eq(vec a, vec b) { return a == b ? ~0u : 0u; }
+inline vec lt_s(vec a, vec b) { return static_cast<int32_t>(a) < static_cast<int32_t>(b) ? ~0u : 0u; }
+inline vec lt_u(vec a, vec b) { return a < b ? ~0u : 0u; }
+#include "lockstep_kernel.inc"
+} // namespace scalar
+
+#ifdef MIPS_LANE_X86
+
+// GCC/Clang vector extensions: plain operators compile to SSE2 here and to
+// AVX2 inside the target region below.
+#define MIPS_LANE_VECTOR_OPS(BYTES)                                                          \
+    typedef uint32_t vec __attribute__((vector_size(BYTES)));                                \
+    typedef int32_t svec __attribute__((vector_size(BYTES)));                                \
+    constexpr size_t kVecLanes = BYTES / 4;                                                  \
+    inline vec load(const uint32_t* p) { vec v; std::memcpy(&v, p, sizeof v); return v; }   \
+    inline void store(uint32_t* p, vec v) { std::memcpy(p, &v, sizeof v); }                 \
+    inline vec splat(uint32_t x) { return vec{} + x; }                                       \
+    inline vec shl(vec a, vec n) { return a << n; }                                          \
+    inline vec shr(vec a, vec n) { return a >> n; }                                          \
+    inline vec sar(vec a, vec n) { return (vec)((svec)a >> (svec)n); }                       \
+    inline vec eq(vec a, vec b) { return (vec)(a == b); }                                    \
+    inline vec lt_s(vec a, vec b) { return (vec)((svec)a < (svec)b); }                       \
+    inline vec lt_u(vec a, vec b) { return (vec)(a < b); }
+
+namespace sse2 {
+MIPS_LANE_VECTOR_OPS(16)
+#include "lockstep_kernel.inc"
+} // namespace sse2
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+namespace avx2 {
+MIPS_LANE_VECTOR_OPS(32)
+#include "lockstep_kernel.inc"
+} // namespace avx2
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+
+using StepFn = bool (*)(const DecodedInstruction&, uint32_t, const LaneFrame&);
+
+StepFn step_function(DecodeBackend backend) {
+    switch (backend) {
+#ifdef MIPS_LANE_X86
+        case DecodeBackend::AVX2: return avx2::step;
+        case DecodeBackend::SSE2: return sse2::step;
+#endif
+        default: return scalar::step;
+    }
+}
+
+bool lane_backend_available(DecodeBackend backend) {
+    switch (backend) {
+        case DecodeBackend::AVX2:
+#ifdef MIPS_LANE_X86
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        case DecodeBackend::SSE2:
+#ifdef MIPS_LANE_X86
+            return true;
+#else
+            return false;
+#endif
+        case DecodeBackend::SCALAR:
+            return true;
+    }
+    return false;
+}
+
+// Bytes a lane-by-lane load or store touches; 0 for other operations
+unsigned access_size(Operation op) {
+    switch (op) {
+        case Operation::LB:
+        case Operation::LBU:
+        case Operation::SB: return 1;
+        case Operation::LH:
+        case Operation::LHU:
+        case Operation::SH: return 2;
+        case Operation::LW:
+        case Operation::SW: return 4;
+        default: return 0;
+    }
+}
+
+} // namespace
+
+// One guest instance: its memory and the streams its syscalls use
+struct LockstepEngine::Lane {
+    machine_state state;
+    std::istringstream in;
+    std::ostringstream out;
+    InstructionExecutor executor{in, out};
+    LaneResult* result = nullptr;
+    bool fresh = true;      // memory still as constructed (all zero)
+    bool tracked = false;   // differs from the image only in dirty_lines
+};
+
+struct LockstepEngine::Group {
+    size_t width;
+    std::vector<uint32_t> regs, hi, lo, pc, mask;
+    std::vector<uint64_t> steps;
+    std::vector<Lane*> lanes;
+    uint64_t live = 0;      // bit per lane still running
+
+    explicit Group(size_t width)
+        : width(width), regs(32 * width), hi(width), lo(width), pc(width), mask(width),
+          steps(width), lanes(width, nullptr) {}
+
+    LaneFrame frame() {
+        return LaneFrame{regs.data(), hi.data(), lo.data(), pc.data(), mask.data(), width};
+    }
+};
+
+LockstepEngine::LockstepEngine(std::vector<uint8_t> image, uint32_t entry)
+    : image(std::move(image)), entry(entry), vector_backend(DecodeBackend::SCALAR),
+      dirty_lines((kMemorySize >> kLineShift) / 64, 0) {
+    if (this->image.size() > kMemorySize) {
+        throw std::out_of_range("Memory load would exceed bounds");
+    }
+    if (entry > kMemorySize) {
+        throw std::runtime_error("Start PC is outside loaded binary memory: " + std::to_string(entry));
+    }
+    set_backend(BatchDecoder::best_backend());
+}
+
+LockstepEngine::~LockstepEngine() = default;
+
+void LockstepEngine::set_backend(DecodeBackend backend) {
+    vector_backend = lane_backend_available(backend) ? backend : DecodeBackend::SCALAR;
+}
+
+void LockstepEngine::reset_lane(Lane& lane, const std::string& input) {
+    if (lane.fresh) {
+        lane.state.load_memory(0, image);
+        lane.fresh = false;
+    } else if (!lane.tracked) {
+        std::memset(lane.state.host_range(0, kMemorySize), 0, kMemorySize);
+        lane.state.load_memory(0, image);
+    } else {
+        // Only lines some lane stored to can differ from the image
+        uint8_t* mem = lane.state.host_range(0, kMemorySize);
+        for (size_t word = 0; word < dirty_lines.size(); ++word) {
+            for (uint64_t bits = dirty_lines[word]; bits; bits &= bits - 1) {
+                size_t begin = ((word * 64) + __builtin_ctzll(bits)) << kLineShift;
+                size_t end = begin + (size_t{1} << kLineShift);
+                std::memset(mem + begin, 0, end - begin);
+                if (begin < image.size()) {
+                    std::memcpy(mem + begin, image.data() + begin, std::min(end, image.size()) - begin);
+                }
+            }
+        }
+    }
+    lane.tracked = true;
+    lane.state.clear_link();
+    lane.state.reset_exceptions();
+    lane.in.clear();
+    lane.in.str(input);
+    lane.out.str("");
+    lane.out.clear();
+}
+
+std::vector<LaneResult> LockstepEngine::run(const std::vector<std::string>& inputs, uint64_t max_steps,
+                                            size_t lanes) {
+    size_t width = std::min(kMaxLanes, std::max<size_t>(8, (lanes + 7) & ~size_t{7}));
+    std::vector<LaneResult> results(inputs.size());
+
+    while (lane_pool.size() < std::min(width, inputs.size())) {
+        lane_pool.push_back(std::make_unique<Lane>());
+    }
+
+    Group group(width);
+    for (size_t first = 0; first < inputs.size(); first += width) {
+        size_t count = std::min(width, inputs.size() - first);
+        for (size_t l = 0; l < count; ++l) {
+            reset_lane(*lane_pool[l], inputs[first + l]);
+        }
+        // Idle lanes lose track of what they changed when the lines are cleared
+        for (size_t l = count; l < lane_pool.size(); ++l) {
+            lane_pool[l]->tracked = false;
+        }
+        std::fill(dirty_lines.begin(), dirty_lines.end(), 0);
+
+        std::fill(group.regs.begin(), group.regs.end(), 0);
+        std::fill(group.hi.begin(), group.hi.end(), 0);
+        std::fill(group.lo.begin(), group.lo.end(), 0);
+        std::fill(group.pc.begin(), group.pc.end(), entry);
+        std::fill(group.steps.begin(), group.steps.end(), 0);
+        std::fill(group.lanes.begin(), group.lanes.end(), nullptr);
+        group.live = 0;
+        for (size_t l = 0; l < count; ++l) {
+            group.lanes[l] = lane_pool[l].get();
+            group.lanes[l]->result = &results[first + l];
+            group.live |= uint64_t{1} << l;
+        }
+
+        run_group(group, max_steps);
+    }
+    return results;
+}
+
+void LockstepEngine::run_group(Group& group, uint64_t max_steps) {
+    const StepFn step = step_function(vector_backend);
+    const size_t width = group.width;
+    LaneFrame frame = group.frame();
+
+    // The lanes at `pc` step together until one of them branches away, stops,
+    // or reaches a waiting lane; only then are the groups rebuilt. Their PCs
+    // and step counts are written back to the arrays lazily.
+    uint64_t stepping = 0;
+    uint32_t pc = 0;
+    uint32_t waiting_min = UINT32_MAX;  // lowest PC among the other live lanes
+    uint64_t pending = 0;               // steps taken by `stepping` not yet in group.steps
+    uint64_t headroom = 0;              // steps `stepping` may take before any lane can hit the limit
+    bool regroup = true;
+
+    auto lane_bit = [](size_t l) { return uint64_t{1} << l; };
+
+    auto settle = [&] {
+        for (uint64_t bits = stepping; bits; bits &= bits - 1) {
+            size_t l = __builtin_ctzll(bits);
+            group.steps[l] += pending;
+            group.pc[l] = pc;
+        }
+        pending = 0;
+    };
+
+    // Records lane l's result (settle() first) and retires it
+    auto finish = [&](size_t l, const std::string& error) {
+        Lane& lane = *group.lanes[l];
+        LaneResult& result = *lane.result;
+        result.output = lane.out.str();
+        result.error = error;
+        result.fault = lane.state.faulted() ? lane.state.fault() : GuestFault();
+        result.steps = group.steps[l];
+        for (unsigned r = 0; r < 32; ++r) result.registers[r] = group.regs[r * width + l];
+        result.pc = group.pc[l];
+        result.hi = group.hi[l];
+        result.lo = group.lo[l];
+        group.live &= ~lane_bit(l);
+        stepping &= ~lane_bit(l);
+    };
+
+    auto line_dirty = [&](uint32_t addr) {
+        uint32_t line = addr >> kLineShift;
+        return (dirty_lines[line / 64] >> (line % 64)) & 1;
+    };
+
+    auto mark_dirty = [&](uint32_t addr, unsigned size) {
+        for (uint32_t line = addr >> kLineShift; line <= (addr + size - 1) >> kLineShift; ++line) {
+            dirty_lines[line / 64] |= uint64_t{1} << (line % 64);
+        }
+    };
+
+    auto set_mask = [&] {
+        for (size_t l = 0; l < width; ++l) group.mask[l] = (stepping >> l) & 1 ? ~0u : 0u;
+    };
+
+    // Retires lane l, stopped at `pc` by `error`
+    auto stop_lane = [&](size_t l, const std::string& error) {
+        group.steps[l] += pending;
+        group.pc[l] = pc;
+        finish(l, error);
+        regroup = true;
+    };
+
+    // A lane that installed an exception vector leaves the group: the vector
+    // ALU does not check overflow and lane memory ops do not deliver faults.
+    // It runs to the end on its own, as Executor's step loop would.
+    auto run_alone = [&](size_t l) {
+        Lane& lane = *group.lanes[l];
+        machine_state& state = lane.state;
+        lane.tracked = false;   // its stores are not in dirty_lines
+        uint64_t steps = group.steps[l] + pending;
+        std::string error;
+        state.set_pc(pc + 4);
+        while (true) {
+            if (steps++ >= max_steps) {
+                error = "Executor error: reached maximum instruction count limit.";
+                break;
+            }
+            uint32_t at = state.get_pc();
+            if (!state.is_valid_address(at, 4)) {
+                state.raise_exception(ExceptionCause::ADDRESS_LOAD, at);
+                if (state.faulted()) break;
+                continue;
+            }
+            DecodedInstruction instr = InstructionUtils::predecode(state.read_memory32(at));
+            bool exit = instr.op == Operation::TRAP && instr.imm == 5;
+            lane.executor.execute(state, instr);
+            if (state.get_pc() == at) {
+                if (state.faulted()) break;
+                state.increment_pc();
+            }
+            if (exit) break;
+        }
+        if (state.faulted()) error = InstructionExecutor::fault_message(state);
+
+        for (unsigned r = 1; r < 32; ++r) group.regs[r * width + l] = state.reg(r);
+        group.hi[l] = state.get_hi();
+        group.lo[l] = state.get_lo();
+        group.steps[l] = steps;
+        group.pc[l] = state.get_pc();
+        finish(l, error);
+        regroup = true;
+    };
+
+    // Runs one instruction of lane l through InstructionExecutor; false if
+    // the lane left the group (it faulted, or ran on alone)
+    auto execute_scalar = [&](size_t l, const DecodedInstruction& d) {
+        machine_state& state = group.lanes[l]->state;
+        for (unsigned r = 1; r < 32; ++r) state.set_reg(r, group.regs[r * width + l]);
+        state.set_hi(group.hi[l]);
+        state.set_lo(group.lo[l]);
+        state.set_pc(pc);
+        group.lanes[l]->executor.execute(state, d);
+        for (unsigned r = 1; r < 32; ++r) group.regs[r * width + l] = state.reg(r);
+        group.hi[l] = state.get_hi();
+        group.lo[l] = state.get_lo();
+        if (state.faulted()) {
+            stop_lane(l, InstructionExecutor::fault_message(state));
+            return false;
+        }
+        if (state.has_exception_vector()) {
+            run_alone(l);
+            return false;
+        }
+        return true;
+    };
+
+    while (group.live) {
+        bool pc_valid = pc + size_t{4} <= kMemorySize;
+        if (regroup || pending >= headroom || !pc_valid) {
+            settle();
+
+            // The lowest PC runs next, so lanes that jumped ahead wait for the rest
+            pc = UINT32_MAX;
+            for (uint64_t bits = group.live; bits; bits &= bits - 1) {
+                pc = std::min(pc, group.pc[__builtin_ctzll(bits)]);
+            }
+            stepping = 0;
+            waiting_min = UINT32_MAX;
+            for (uint64_t bits = group.live; bits; bits &= bits - 1) {
+                size_t l = __builtin_ctzll(bits);
+                if (group.pc[l] == pc) stepping |= lane_bit(l);
+                else waiting_min = std::min(waiting_min, group.pc[l]);
+            }
+
+            // Step budget and fetch bounds, with Executor's messages and order
+            pc_valid = pc + size_t{4} <= kMemorySize;
+            uint64_t most_steps = 0;
+            for (uint64_t bits = stepping; bits; bits &= bits - 1) {
+                size_t l = __builtin_ctzll(bits);
+                if (group.steps[l] >= max_steps) {
+                    group.steps[l]++;
+                    finish(l, "Executor error: reached maximum instruction count limit.");
+                } else if (!pc_valid) {
+                    group.steps[l]++;
+                    machine_state& state = group.lanes[l]->state;
+                    state.set_pc(pc);
+                    state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+                    finish(l, InstructionExecutor::fault_message(state));
+                } else {
+                    most_steps = std::max(most_steps, group.steps[l]);
+                }
+            }
+            if (!stepping) {
+                regroup = true;
+                continue;
+            }
+            headroom = max_steps - most_steps;
+            set_mask();
+            regroup = false;
+        }
+
+        // Shared fetch unless a store touched the word; then lanes whose copy
+        // differs from the first lane's wait for a later step
+        size_t lead = __builtin_ctzll(stepping);
+        uint32_t word = group.lanes[lead]->state.read_memory32(pc);
+        if (line_dirty(pc) || line_dirty(pc + 3)) {
+            uint64_t differ = 0;
+            for (uint64_t bits = stepping & (stepping - 1); bits; bits &= bits - 1) {
+                size_t l = __builtin_ctzll(bits);
+                if (group.lanes[l]->state.read_memory32(pc) != word) differ |= lane_bit(l);
+            }
+            if (differ) {
+                settle();
+                stepping &= ~differ;
+                set_mask();
+                regroup = true;
+            }
+        }
+        pending++;
+
+        DecodedInstruction d = InstructionUtils::predecode(word);
+        if (step(d, pc, frame)) {
+            bool control = d.op == Operation::BEQ || d.op == Operation::BNE || d.op == Operation::BLEZ ||
+                           d.op == Operation::BGTZ || d.op == Operation::J || d.op == Operation::JAL ||
+                           d.op == Operation::JR || d.op == Operation::JALR;
+            if (control) {
+                // Keep going as one group only if every lane went the same way
+                uint32_t next = group.pc[lead];
+                for (uint64_t bits = stepping; bits; bits &= bits - 1) {
+                    if (group.pc[__builtin_ctzll(bits)] != next) regroup = true;
+                }
+                if (regroup) {
+                    // The kernel already wrote the new PCs; only the steps are owed
+                    for (uint64_t bits = stepping; bits; bits &= bits - 1) {
+                        group.steps[__builtin_ctzll(bits)] += pending;
+                    }
+                    pending = 0;
+                    stepping = 0;
+                    continue;
+                }
+                pc = next;
+            } else {
+                pc += 4;
+            }
+            if (pc >= waiting_min) regroup = true;
+            continue;
+        }
+
+        // Lane-by-lane operations
+        for (uint64_t bits = stepping; bits; bits &= bits - 1) {
+            size_t l = __builtin_ctzll(bits);
+            machine_state& state = group.lanes[l]->state;
+            uint32_t* regs = group.regs.data();
+            auto reg = [&](unsigned r) -> uint32_t& { return regs[r * width + l]; };
+            auto set = [&](unsigned r, uint32_t v) { if (r) reg(r) = v; };
+            uint32_t addr = reg(d.rs) + d.imm;
+
+            // Validated as the checked handlers do; the lane stops at a fault
+            unsigned size = access_size(d.op);
+            if (size && !state.is_valid_address(addr, size)) {
+                state.set_pc(pc);
+                bool store = d.op == Operation::SB || d.op == Operation::SH || d.op == Operation::SW;
+                state.raise_exception(store ? ExceptionCause::ADDRESS_STORE : ExceptionCause::ADDRESS_LOAD, addr);
+                stop_lane(l, InstructionExecutor::fault_message(state));
+                continue;
+            }
+            switch (d.op) {
+                case Operation::LB:  set(d.rt, InstructionUtils::sign_extend_8(state.load8(addr))); break;
+                case Operation::LH:  set(d.rt, InstructionUtils::sign_extend_16(state.load16(addr))); break;
+                case Operation::LW:  set(d.rt, state.load32(addr)); break;
+                case Operation::LBU: set(d.rt, state.load8(addr)); break;
+                case Operation::LHU: set(d.rt, state.load16(addr)); break;
+                case Operation::SB:
+                case Operation::SH:
+                case Operation::SW: {
+                    if (size == 1) state.store8(addr, static_cast<uint8_t>(reg(d.rt)));
+                    else if (size == 2) state.store16(addr, static_cast<uint16_t>(reg(d.rt)));
+                    else state.store32(addr, reg(d.rt));
+                    mark_dirty(addr, size);
+                    break;
+                }
+                case Operation::SC:
+                    // May store; failed ones only mark a line needlessly
+                    if (execute_scalar(l, d)) mark_dirty(addr, 4);
+                    break;
+                case Operation::MULT: {
+                    int64_t p = static_cast<int64_t>(static_cast<int32_t>(reg(d.rs))) *
+                                static_cast<int32_t>(reg(d.rt));
+                    group.lo[l] = static_cast<uint32_t>(p);
+                    group.hi[l] = static_cast<uint32_t>(static_cast<uint64_t>(p) >> 32);
+                    break;
+                }
+                case Operation::MULTU: {
+                    uint64_t p = static_cast<uint64_t>(reg(d.rs)) * reg(d.rt);
+                    group.lo[l] = static_cast<uint32_t>(p);
+                    group.hi[l] = static_cast<uint32_t>(p >> 32);
+                    break;
+                }
+                case Operation::DIV: {
+                    int32_t a = static_cast<int32_t>(reg(d.rs)), b = static_cast<int32_t>(reg(d.rt));
+                    if (b != 0) {
+                        group.lo[l] = static_cast<uint32_t>(a / b);
+                        group.hi[l] = static_cast<uint32_t>(a % b);
+                    }
+                    break;
+                }
+                case Operation::DIVU: {
+                    uint32_t a = reg(d.rs), b = reg(d.rt);
+                    if (b != 0) {
+                        group.lo[l] = a / b;
+                        group.hi[l] = a % b;
+                    }
+                    break;
+                }
+                default:
+                    // Syscalls and invalid words: exactly InstructionExecutor
+                    if (execute_scalar(l, d) && d.op == Operation::TRAP && d.imm == 5) {
+                        group.steps[l] += pending;
+                        group.pc[l] = pc + 4;
+                        finish(l, "");
+                        regroup = true;
+                    }
+                    break;
+            }
+        }
+        pc += 4;
+        if (pc >= waiting_min) regroup = true;
+    }
+}
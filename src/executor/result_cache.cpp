@@ -0,0 +1,119 @@
+#include "../../include/result_cache.h"
+#include "../../include/cache_record.h"
+#include "../../include/xxhash64.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Bump when the key material or the entry layout changes
+constexpr char kMagic[8] = {'M', 'I', 'P', 'S', 'R', 'U', 'N', '1'};
+constexpr uint64_t kCheckSeed = 0x6D6970735F72756EULL;
+
+void hash_run(XXHash64& h, const Program& program, const std::string& input, const ExecutorOptions& options) {
+    const SharedImage& image = program.image();
+    uint32_t start = options.start_address != UINT32_MAX ? options.start_address : program.entry();
+    h.update(kMagic, sizeof(kMagic));
+    h.update_value<uint64_t>(image.size());
+    h.update(image.data(), image.size());
+    h.update_value<uint64_t>(input.size());
+    h.update(input);
+    h.update_value<uint64_t>(options.max_steps);
+    h.update_value<uint32_t>(options.memory_pages);
+    h.update_value<uint32_t>(start);
+}
+
+} // namespace
+
+ResultCache::ResultCache(std::string directory) : directory(std::move(directory)) {}
+
+bool ResultCache::cacheable(const ExecutorOptions& options) {
+    return options.harts <= 1 && !options.verbose && !options.caches && !options.timing &&
+           !options.profiler && !options.coverage && options.time_limit.count() == 0 && !options.usage;
+}
+
+ResultCache::Key ResultCache::key(const Program& program, const std::string& input, const ExecutorOptions& options) {
+    XXHash64 name;
+    XXHash64 check(kCheckSeed);
+    hash_run(name, program, input, options);
+    hash_run(check, program, input, options);
+    return {name.digest(), check.digest()};
+}
+
+std::string ResultCache::path(const Key& key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.run", static_cast<unsigned long long>(key.name));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool ResultCache::lookup(const Key& key, RunRecord& record) const {
+    std::ifstream in(path(key), std::ios::binary);
+    if (!in) return false;
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (bytes.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) return false;
+    RecordReader r{bytes, sizeof(kMagic)};
+    if (r.get(8) != key.check) return false;
+
+    RunRecord found;
+    for (uint32_t& reg : found.registers) reg = static_cast<uint32_t>(r.get(4));
+    found.pc = static_cast<uint32_t>(r.get(4));
+    found.hi = static_cast<uint32_t>(r.get(4));
+    found.lo = static_cast<uint32_t>(r.get(4));
+    found.output = r.text(r.get(8));
+    found.error = r.text(r.get(8));
+    if (!r.ok || r.at != bytes.size()) return false;
+    record = std::move(found);
+    return true;
+}
+
+bool ResultCache::store(const Key& key, const RunRecord& record) const {
+    std::string bytes(kMagic, sizeof(kMagic));
+    put64(bytes, key.check);
+    for (uint32_t reg : record.registers) put32(bytes, reg);
+    put32(bytes, record.pc);
+    put32(bytes, record.hi);
+    put32(bytes, record.lo);
+    put64(bytes, record.output.size());
+    bytes += record.output;
+    put64(bytes, record.error.size());
+    bytes += record.error;
+
+    return write_entry(path(key), bytes);
+}
+
+RunRecord ResultCache::run(const Program& program, const std::string& input, const ExecutorOptions& options,
+                           bool* hit) const {
+    bool cached = cacheable(options);
+    Key k{};
+    RunRecord record;
+    if (cached) {
+        k = key(program, input, options);
+        if (lookup(k, record)) {
+            if (hit) *hit = true;
+            return record;
+        }
+    }
+    if (hit) *hit = false;
+
+    std::istringstream in(input);
+    std::ostringstream out;
+    ExecutorOptions local = options;
+    local.input = &in;
+    local.output = &out;
+    try {
+        machine_state state = Executor().run(program, local);
+        for (unsigned i = 0; i < 32; ++i) record.registers[i] = state.reg(i);
+        record.pc = state.get_pc();
+        record.hi = state.get_hi();
+        record.lo = state.get_lo();
+    } catch (const std::exception& e) {
+        record.error = e.what();
+    }
+    record.output = out.str();
+
+    if (cached) store(k, record);
+    return record;
+}
@@ -0,0 +1,46 @@
+#include "../../include/run_budget.h"
+#include <iomanip>
+
+const char* run_stop_name(RunStop stop) {
+    switch (stop) {
+        case RunStop::EXITED: return "exited";
+        case RunStop::FAULTED: return "faulted";
+        case RunStop::STEP_LIMIT: return "step limit";
+        case RunStop::TIME_LIMIT: return "time limit";
+        case RunStop::STOPPED: return "stopped";
+        case RunStop::REACHED: return "reached";
+    }
+    return "?";
+}
+
+void ResourceUsage::report(std::ostream& out) const {
+    out << "run: " << run_stop_name(stop) << "\n";
+    out << "instructions: " << instructions << " of " << max_steps << "\n";
+    out << "wall time: " << std::fixed << std::setprecision(3)
+        << std::chrono::duration<double, std::milli>(wall_time).count() << " ms";
+    if (time_limit.count()) out << " of " << time_limit.count() << " ms";
+    out << "\n" << std::defaultfloat;
+    out << "memory: " << pages_touched << " of " << memory_pages << " pages touched ("
+        << kGuestPageSize / 1024 << " KiB pages)\n";
+}
+
+Watchdog::Watchdog(std::chrono::milliseconds limit) : armed(limit.count() > 0) {
+    if (!armed) return;
+    auto deadline = std::chrono::steady_clock::now() + limit;
+    thread = std::thread([this, deadline] {
+        std::unique_lock<std::mutex> guard(lock);
+        if (!wake.wait_until(guard, deadline, [this] { return cancelled; })) {
+            fired.store(true, std::memory_order_relaxed);
+        }
+    });
+}
+
+Watchdog::~Watchdog() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        cancelled = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
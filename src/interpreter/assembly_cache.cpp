@@ -0,0 +1,120 @@
+#include "../../include/assembly_cache.h"
+#include "../../include/cache_record.h"
+#include "../../include/xxhash64.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'I', 'P', 'S', 'A', 'S', 'M', '1'};
+constexpr uint64_t kCheckSeed = 0x6D6970735F61736DULL;
+
+uint64_t digest(const std::string& source, uint64_t seed) {
+    XXHash64 h(seed);
+    h.update(AssemblyCache::kToolVersion, std::char_traits<char>::length(AssemblyCache::kToolVersion) + 1);
+    h.update(kMagic, sizeof(kMagic));
+    h.update(source);
+    return h.digest();
+}
+
+} // namespace
+
+AssemblyCache::AssemblyCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string AssemblyCache::path(const std::string& source) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.asmc", static_cast<unsigned long long>(digest(source, 0)));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool AssemblyCache::lookup(const std::string& source, AssembledSource& assembled) const {
+    std::string file = path(source);
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    std::streamoff size = in.tellg();
+    if (size < 8) return false;
+
+    // Only the trailer is read; the binary in front of it gets mapped
+    std::string tail(8, '\0');
+    in.seekg(size - 8);
+    if (!in.read(&tail[0], 8)) return false;
+    uint64_t trailer_at = RecordReader{tail}.get(8);
+    if (trailer_at > static_cast<uint64_t>(size) - 8) return false;
+    std::string trailer(static_cast<size_t>(size - 8 - static_cast<std::streamoff>(trailer_at)), '\0');
+    in.seekg(static_cast<std::streamoff>(trailer_at));
+    if (!in.read(&trailer[0], static_cast<std::streamsize>(trailer.size()))) return false;
+
+    if (trailer.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) return false;
+    RecordReader r{trailer, sizeof(kMagic)};
+    if (r.get(8) != digest(source, kCheckSeed)) return false;
+    uint64_t binary_size = r.get(8);
+    // The padding must cover the mapped last page
+    if (r.get(8) != SharedImage::page_size()) return false;
+
+    AssembledSource found;
+    found.has_main = r.get(1) != 0;
+    found.main_address = static_cast<uint32_t>(r.get(4));
+    uint64_t count = r.get(4);
+    for (uint64_t i = 0; i < count && r.ok; ++i) {
+        std::string name = r.text(r.get(4));
+        found.labels[name] = static_cast<uint32_t>(r.get(4));
+    }
+    if (!r.ok || r.at != trailer.size() || binary_size > trailer_at) return false;
+
+    try {
+        found.image = std::make_shared<const SharedImage>(file, 0, static_cast<size_t>(binary_size));
+    } catch (const std::exception&) {
+        return false;
+    }
+    assembled = std::move(found);
+    return true;
+}
+
+bool AssemblyCache::store(const std::string& source, const ParseResult& parsed,
+                          const std::vector<uint8_t>& binary) const {
+    size_t page = SharedImage::page_size();
+    std::string bytes(binary.begin(), binary.end());
+    bytes.resize((binary.size() + page - 1) / page * page, '\0');
+    uint64_t trailer_at = bytes.size();
+
+    bytes.append(kMagic, sizeof(kMagic));
+    put64(bytes, digest(source, kCheckSeed));
+    put64(bytes, binary.size());
+    put64(bytes, page);
+    bytes.push_back(parsed.has_main ? 1 : 0);
+    put32(bytes, parsed.main_address);
+    // Sorted, so one source always produces the same entry
+    std::vector<std::pair<std::string, uint32_t>> labels(parsed.labels.begin(), parsed.labels.end());
+    std::sort(labels.begin(), labels.end());
+    put32(bytes, static_cast<uint32_t>(labels.size()));
+    for (const auto& label : labels) {
+        put32(bytes, static_cast<uint32_t>(label.first.size()));
+        bytes += label.first;
+        put32(bytes, label.second);
+    }
+    put64(bytes, trailer_at);
+
+    return write_entry(path(source), bytes);
+}
+
+AssembledSource AssemblyCache::assemble(Parser& parser, const std::string& source, bool* hit) const {
+    AssembledSource assembled;
+    if (lookup(source, assembled)) {
+        if (hit) *hit = true;
+        return assembled;
+    }
+    if (hit) *hit = false;
+
+    ParseResult parsed = parser.parse_assembly(source);
+    std::vector<uint8_t> binary = parser.generate_binary(parsed);
+    store(source, parsed, binary);
+
+    assembled.main_address = parsed.main_address;
+    assembled.has_main = parsed.has_main;
+    assembled.labels = parsed.labels;
+    assembled.image = std::make_shared<const SharedImage>(std::move(binary));
+    return assembled;
+}
@@ -1,69 +1,184 @@
 #include "../../include/interpreter.h"
 #include "../../include/instruction.h"
+#include "../../include/run_budget.h"
 #include <fstream>
+#include <iterator>
 #include <stdexcept>
 
 Interpreter::Interpreter() : parser() {
 }
 
-machine_state Interpreter::run_stream(std::istream& input, uint64_t max_steps) {
-    ParseResult result = parser.parse_assembly(input);
+// Fetch/execute until trap 5, an unhandled fault or max_steps, counting the
+// budget down a slice at a time. Unchecked loops skip the fetch bounds test
+// and rely on the caller trapping guarded-memory faults; only observed
+// loops report to an attached cache model, the profiler and `coverage`,
+// and keep the count `counter` settles current for the profiler's clock.
+template <bool Checked, bool Observed>
+static RunStop run_loop(machine_state& state, InstructionExecutor& executor, StepCountdown& counter,
+                        uint64_t max_steps, CoverageMap* coverage) {
+    while (counter.next_slice(max_steps)) {
+        for (; counter.countdown; --counter.countdown) {
+            uint32_t pc = state.get_pc();
+
+            if (Checked && !state.is_valid_address(pc, 4)) {
+                state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+                if (state.faulted()) return counter.leave(RunStop::FAULTED);
+                continue;
+            }
 
-    if (!result.has_main) {
-        throw std::runtime_error("Interpreter error: 'main' label not found in assembly.");
-    }
+            uint32_t instr_word = state.fetch32<Observed>(pc);
+            DecodedInstruction instr = InstructionUtils::predecode(instr_word);
+            if constexpr (Observed) counter.steps = counter.running();
+
+            uint32_t old_pc = pc;
 
-    std::vector<uint8_t> bin = parser.generate_binary(result);
+            executor.execute<Checked, Observed>(state, instr);
 
-    machine_state state;
-    if (!bin.empty()) {
-        state.load_memory(0u, bin);
+            if (state.get_pc() == old_pc) {
+                if (state.faulted()) return counter.leave(RunStop::FAULTED);
+                state.increment_pc();
+            }
+            if constexpr (Observed) {
+                if (coverage) coverage->record(old_pc, instr, executor.last_branch_taken());
+            }
+
+            if (instr.op == Operation::TRAP && instr.imm == 5) {
+                return counter.leave(RunStop::EXITED);
+            }
+        }
+        counter.finish_slice();
     }
+    return RunStop::STEP_LIMIT;
+}
 
-    state.set_pc(result.main_address);
+void Interpreter::set_cache_model(CacheHierarchy* model) {
+    caches = model;
+}
+
+void Interpreter::set_profiler(CallProfiler* p) {
+    profiler = p;
+}
+
+void Interpreter::set_coverage(CoverageMap* map) {
+    coverage = map;
+}
 
+void Interpreter::set_usage(ResourceUsage* u) {
+    usage = u;
+}
+
+void Interpreter::set_cache_directory(const std::string& directory) {
+    cache = directory.empty() ? nullptr : std::make_unique<AssemblyCache>(directory);
+}
+
+// Guest memory of every interpreted program
+static constexpr size_t kMemorySize = 1024 * 1024;
+
+// Run a loaded state from its PC until trap 5; an unhandled guest fault
+// becomes the std::runtime_error here
+static void execute(machine_state& state, uint64_t max_steps, CacheHierarchy* caches, CallProfiler* profiler,
+                    CoverageMap* coverage, ResourceUsage* usage,
+                    const std::unordered_map<std::string, uint32_t>& labels) {
+    auto started = std::chrono::steady_clock::now();
+    state.attach_caches(caches);
     InstructionExecutor executor;
+    uint64_t steps = 0;
+    struct ProfileScope {
+        CallProfiler* profiler;
+        ~ProfileScope() { if (profiler) profiler->finish(); }
+    } profile{profiler};
+    if (profiler) {
+        profiler->set_symbols(labels);
+        profiler->start(state.get_pc(), &steps);
+        executor.set_profiler(profiler);
+    }
 
     // Execution loop
-    uint64_t steps = 0;
-    while (true) {
-        if (steps++ >= max_steps) {
-            throw std::runtime_error("Interpreter error: reached maximum instruction count limit.");
+    using RunLoop = RunStop (*)(machine_state&, InstructionExecutor&, StepCountdown&, uint64_t, CoverageMap*);
+    static constexpr RunLoop loops[2][2] = {
+        {run_loop<false, false>, run_loop<false, true>},
+        {run_loop<true, false>, run_loop<true, true>},
+    };
+    RunLoop loop = loops[state.bounds_checked()][caches || profiler || coverage];
+    StepCountdown counter(steps);
+    RunStop stop = RunStop::FAULTED;
+    if (state.bounds_checked()) {
+        stop = loop(state, executor, counter, max_steps, coverage);
+    } else {
+        // A fault the guest handles resumes the loop at its vector
+        uint32_t fault_address = 0;
+        while (!state.guest_memory().run_trapped([&] {
+            stop = loop(state, executor, counter, max_steps, coverage);
+        }, fault_address)) {
+            counter.trapped();
+            InstructionExecutor::raise_trapped_fault(state, fault_address);
+            if (state.faulted()) break;
         }
-
-        uint32_t pc = state.get_pc();
-
-        if (!state.is_valid_address(pc, 4)) {
-            throw std::runtime_error("Interpreter error: PC points outside valid memory at address " + std::to_string(pc));
+    }
+    if (usage) {
+        usage->stop = stop;
+        usage->instructions = steps;
+        usage->max_steps = max_steps;
+        usage->wall_time = std::chrono::steady_clock::now() - started;
+        usage->time_limit = std::chrono::milliseconds(0);
+        usage->pages_touched = static_cast<uint32_t>(
+            (state.guest_memory().resident_bytes() + kGuestPageSize - 1) / kGuestPageSize);
+        usage->memory_pages = kMemorySize / kGuestPageSize;
+        usage->fault = stop == RunStop::FAULTED ? state.fault() : GuestFault();
+    }
+    if (state.faulted()) {
+        const GuestFault& fault = state.fault();
+        if (fault.on_fetch()) {
+            throw std::runtime_error("Interpreter error: PC points outside valid memory at address " +
+                                     std::to_string(fault.epc));
         }
+        throw std::runtime_error(InstructionExecutor::fault_message(state));
+    }
+    if (stop == RunStop::STEP_LIMIT) {
+        throw std::runtime_error("Interpreter error: reached maximum instruction count limit.");
+    }
+    state.attach_caches(nullptr);
+}
 
-        uint32_t instr_word = state.read_memory32(pc);
-        Instruction instr = InstructionUtils::decode(instr_word);
 
-        uint32_t old_pc = pc;
+machine_state Interpreter::run_stream(std::istream& input, uint64_t max_steps, MemoryBackend memory) {
+    if (cache) {
+        std::string source((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        return run(cache->assemble(parser, source), max_steps, memory);
+    }
 
-        executor.execute(state, instr);
+    ParseResult result = parser.parse_assembly(input);
+    if (!result.has_main) {
+        throw std::runtime_error("Interpreter error: 'main' label not found in assembly.");
+    }
 
-        if (state.get_pc() == old_pc) {
-            state.increment_pc();
-        }
+    // Encode straight into the fresh, zeroed guest memory
+    machine_state state(kMemorySize, memory);
+    MemoryEmitter emitter(state);
+    parser.generate_binary(result, emitter);
 
-        InstructionFormat fmt = InstructionUtils::get_format(instr);
-        if (fmt == InstructionFormat::I_TYPE) {
-            IInstruction iinstr = std::get<IInstruction>(instr);
-            if (iinstr.opcode == Opcode::TRAP && iinstr.immediate == 5) {
-                break;
-            }
-        }
+    state.set_pc(result.main_address);
+    execute(state, max_steps, caches, profiler, coverage, usage, result.labels);
+    return state;
+}
+
+machine_state Interpreter::run(const AssembledSource& program, uint64_t max_steps, MemoryBackend memory) {
+    if (!program.has_main) {
+        throw std::runtime_error("Interpreter error: 'main' label not found in assembly.");
     }
 
+    machine_state state(kMemorySize, memory);
+    state.map_image(*program.image);
+
+    state.set_pc(program.main_address);
+    execute(state, max_steps, caches, profiler, coverage, usage, program.labels);
     return state;
 }
 
-machine_state Interpreter::run_file(const std::string& filename, uint64_t max_steps) {
+machine_state Interpreter::run_file(const std::string& filename, uint64_t max_steps, MemoryBackend memory) {
     std::ifstream ifs(filename);
     if (!ifs) {
         throw std::runtime_error("Cannot open assembly file: " + filename);
     }
-    return run_stream(ifs, max_steps);
+    return run_stream(ifs, max_steps, memory);
 }
@@ -0,0 +1,63 @@
+#include "../../include/aot_translator.h"
+#include "../../include/executor.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+static void usage(const char* prog) {
+    std::cerr << "Usage:\n";
+    std::cerr << "  " << prog << " input.bin              # translate binary, write C++ to stdout\n";
+    std::cerr << "  " << prog << " input.bin out.cpp      # translate binary, write C++ to out.cpp\n";
+    std::cerr << "  " << prog << " input.bin ... -s <addr> # explicitly set start PC (overrides header)\n";
+    std::cerr << "The generated program takes mips_executor's -m <N>, -T <ms> and -M <N>\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string in_file = argv[1];
+    std::string out_file;
+    uint32_t start_address = UINT32_MAX;
+
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-s") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-s requires an address argument\n";
+                return 1;
+            }
+            start_address = static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 0));
+        } else if (out_file.empty() && argv[i][0] != '-') {
+            out_file = argv[i];
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        std::ifstream ifs(in_file, std::ios::binary);
+        if (!ifs) throw std::runtime_error("Cannot open binary file: " + in_file);
+        ExecutableImage image = read_executable_image(ifs);
+        uint32_t entry = start_address != UINT32_MAX ? start_address : image.entry;
+
+        AotTranslator translator(std::move(image.bytes), entry);
+        if (out_file.empty()) {
+            translator.emit(std::cout);
+        } else {
+            std::ofstream ofs(out_file);
+            if (!ofs) {
+                std::cerr << "Cannot open output file: " << out_file << std::endl;
+                return 2;
+            }
+            translator.emit(ofs);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Translator error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -1,15 +1,30 @@
 #include "../../include/assembler.h"
 #include <iostream>
 #include <fstream>
+#include <cstring>
 
 static void print_usage(const char* prog) {
     std::cerr << "Usage:\n";
     std::cerr << "  " << prog << "                 # read assembly from stdin, write binary to stdout\n";
     std::cerr << "  " << prog << " input.asm      # read input.asm, write binary to stdout\n";
     std::cerr << "  " << prog << " input.asm out.bin  # read input.asm, write binary to out.bin\n";
+    std::cerr << "  add -g to append labels and source lines for profilers and traces\n";
 }
 
 int main(int argc, char** argv) {
+    // -g may come anywhere; the rest are the file arguments
+    bool debug = false;
+    std::vector<char*> args{argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-g") == 0) {
+            debug = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+
     try {
         Assembler assembler;
         std::vector<uint8_t> bytes;
@@ -19,6 +34,7 @@ int main(int argc, char** argv) {
             bytes = assembler.assemble_stream(std::cin);
             // write to stdout
             assembler.write_binary_to_stream(bytes, std::cout);
+            if (debug) assembler.write_debug_section(std::cout, bytes.size());
             return 0;
         }
         else if (argc == 2) {
@@ -26,6 +42,7 @@ int main(int argc, char** argv) {
             std::string in_file = argv[1];
             bytes = assembler.assemble_file(in_file);
             assembler.write_binary_to_stream(bytes, std::cout);
+            if (debug) assembler.write_debug_section(std::cout, bytes.size());
             return 0;
         }
         else if (argc == 3) {
@@ -38,6 +55,7 @@ int main(int argc, char** argv) {
                 return 2;
             }
             assembler.write_binary_to_stream(bytes, ofs);
+            if (debug) assembler.write_debug_section(ofs, bytes.size());
             ofs.close();
             return 0;
         }
@@ -0,0 +1,79 @@
+#include "../../include/coverage.h"
+#include "../../include/debug_info.h"
+#include "../../include/parser.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <cstring>
+
+static void usage(const char* prog) {
+    std::cerr << "Usage:\n";
+    std::cerr << "  " << prog << " program run.cov... [-o merged.cov]\n";
+    std::cerr << "    program   the .asm source, or a binary assembled with -g\n";
+    std::cerr << "    run.cov   coverage from mips_executor/mips_interpreter -k, merged\n";
+    std::cerr << "    -o <file> also write the merged coverage\n";
+    std::cerr << "Prints the source with every line marked: + ran, # never ran, ~ partly (branches\n";
+    std::cerr << "that went one way only), - no code.\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string program = argv[1];
+    std::vector<std::string> runs;
+    std::string merged_path;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-o") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-o requires an output file argument\n";
+                return 1;
+            }
+            merged_path = argv[++i];
+        } else {
+            runs.push_back(argv[i]);
+        }
+    }
+    if (runs.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        std::unique_ptr<CoverageMap> merged;
+        for (const std::string& run : runs) {
+            std::ifstream in(run, std::ios::binary);
+            if (!in) throw std::runtime_error("Cannot open coverage file: " + run);
+            CoverageMap map = CoverageMap::load(in);
+            if (merged) merged->merge(map);
+            else merged = std::make_unique<CoverageMap>(std::move(map));
+        }
+        if (!merged_path.empty()) {
+            std::ofstream out(merged_path, std::ios::binary);
+            merged->save(out);
+        }
+
+        // Lines from the binary's debug section, else from parsing the source
+        std::vector<SourceLine> lines;
+        std::string source = program;
+        DebugInfo debug(program);
+        if (debug.available()) {
+            lines = debug.lines();
+            source = debug.source();
+            if (source.empty()) throw std::runtime_error("No source file recorded in " + program);
+        } else {
+            Parser parser;
+            lines = parser.parse_assembly_file(program).source_lines;
+        }
+
+        std::ifstream text(source);
+        if (!text) throw std::runtime_error("Cannot open assembly file: " + source);
+        merged->report(std::cout, lines, text);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Coverage error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -1,5 +1,9 @@
 #include "../../include/executor.h"
+#include "../../include/result_cache.h"
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <cstring>
 
 static void usage(const char* prog) {
@@ -7,7 +11,22 @@ static void usage(const char* prog) {
     std::cerr << "  " << prog << " input.bin            # execute binary, start PC = header/main or 0\n";
     std::cerr << "  " << prog << " input.bin -v         # verbose trace\n";
     std::cerr << "  " << prog << " input.bin -m <N>     # set max instruction steps (default 100000)\n";
+    std::cerr << "  " << prog << " input.bin -T <ms>     # stop after <ms> milliseconds of wall-clock time\n";
+    std::cerr << "  " << prog << " input.bin -M <N>     # N pages of 4 KiB guest memory (default 256)\n";
+    std::cerr << "  " << prog << " input.bin -u         # report instructions, time and memory used to stderr\n";
     std::cerr << "  " << prog << " input.bin -s <addr>  # explicitly set start PC (overrides header)\n";
+    std::cerr << "  " << prog << " input.bin -g         # guard-page memory instead of bounds checks\n";
+    std::cerr << "  " << prog << " input.bin -b         # execute cached basic blocks with fused pairs\n";
+    std::cerr << "  " << prog << " input.bin -j <N>     # up to N harts (threads) for the spawn syscall\n";
+    std::cerr << "  " << prog << " input.bin -c <dir>   # replay identical earlier runs from a result cache\n";
+    std::cerr << "  " << prog << " input.bin -C <spec>  # simulate caches, report to stderr (spec: default or\n";
+    std::cerr << "                                  #   l1i|l1d|l2=size:ways:line[:lru|fifo|random],region=size)\n";
+    std::cerr << "  " << prog << " input.bin -t <pred>  # 5-stage pipeline timing, report to stderr\n";
+    std::cerr << "                                  #   (branch predictor: static, 2bit or gshare)\n";
+    std::cerr << "  " << prog << " input.bin -p <file>  # profile calls: collapsed stacks to <file>, functions\n";
+    std::cerr << "                                  #   to stderr\n";
+    std::cerr << "  " << prog << " input.bin -k <file>  # record coverage bitmaps to <file> (see mips_coverage)\n";
+    std::cerr << "Traces and profiles name code from the debug section of binaries assembled with -g.\n";
 }
 
 int main(int argc, char** argv) {
@@ -17,25 +36,89 @@ int main(int argc, char** argv) {
     }
 
     std::string filename = argv[1];
-    bool verbose = false;
-    uint64_t max_steps = 100000ULL;
-    uint32_t start_addr = UINT32_MAX;
+    ExecutorOptions options;
+    std::string cache_dir;
+    std::unique_ptr<CacheHierarchy> caches;
+    std::unique_ptr<PipelineModel> timing;
+    std::unique_ptr<CallProfiler> profiler;
+    std::string profile_path;
+    std::unique_ptr<CoverageMap> coverage;
+    std::string coverage_path;
+    std::string cache_spec;
+    std::string predictor;
+    ResourceUsage resources;
 
     for (int i = 2; i < argc; ++i) {
         if (std::strcmp(argv[i], "-v") == 0) {
-            verbose = true;
+            options.verbose = true;
         } else if (std::strcmp(argv[i], "-m") == 0) {
             if (i + 1 >= argc) {
                 std::cerr << "-m requires an argument\n";
                 return 1;
             }
-            max_steps = std::stoull(argv[++i]);
+            options.max_steps = std::stoull(argv[++i]);
         } else if (std::strcmp(argv[i], "-s") == 0) {
             if (i + 1 >= argc) {
                 std::cerr << "-s requires an address argument\n";
                 return 1;
             }
-            start_addr = static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 0));
+            options.start_address = static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 0));
+        } else if (std::strcmp(argv[i], "-g") == 0) {
+            options.memory = MemoryBackend::GUARDED;
+        } else if (std::strcmp(argv[i], "-b") == 0) {
+            options.mode = ExecutionMode::BLOCK;
+        } else if (std::strcmp(argv[i], "-j") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-j requires an argument\n";
+                return 1;
+            }
+            options.harts = std::stoul(argv[++i]);
+        } else if (std::strcmp(argv[i], "-c") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-c requires a directory argument\n";
+                return 1;
+            }
+            cache_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "-C") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-C requires a cache spec argument\n";
+                return 1;
+            }
+            cache_spec = argv[++i];
+        } else if (std::strcmp(argv[i], "-t") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-t requires a branch predictor argument\n";
+                return 1;
+            }
+            predictor = argv[++i];
+        } else if (std::strcmp(argv[i], "-p") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-p requires an output file argument\n";
+                return 1;
+            }
+            profile_path = argv[++i];
+            profiler = std::make_unique<CallProfiler>();
+            options.profiler = profiler.get();
+        } else if (std::strcmp(argv[i], "-k") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-k requires an output file argument\n";
+                return 1;
+            }
+            coverage_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-T") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-T requires an argument\n";
+                return 1;
+            }
+            options.time_limit = std::chrono::milliseconds(std::stoull(argv[++i]));
+        } else if (std::strcmp(argv[i], "-M") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "-M requires an argument\n";
+                return 1;
+            }
+            options.memory_pages = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (std::strcmp(argv[i], "-u") == 0) {
+            options.usage = &resources;
         } else {
             std::cerr << "Unknown option: " << argv[i] << "\n";
             usage(argv[0]);
@@ -43,12 +126,91 @@ int main(int argc, char** argv) {
         }
     }
 
+    // Cache regions are counted over the guest memory, which the options above may change
+    size_t memory_size = size_t{options.memory_pages} * kGuestPageSize;
+    try {
+        if (!cache_spec.empty()) {
+            caches = std::make_unique<CacheHierarchy>(CacheHierarchyConfig::parse(cache_spec), memory_size);
+            options.caches = caches.get();
+        }
+        if (!predictor.empty()) {
+            timing = std::make_unique<PipelineModel>(PipelineConfig(), BranchPredictor::create(predictor));
+            options.timing = timing.get();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (!coverage_path.empty()) {
+        coverage = std::make_unique<CoverageMap>(memory_size);
+        options.coverage = coverage.get();
+    }
+
+    if (!cache_dir.empty() && ResultCache::cacheable(options)) {
+        // The whole of stdin is part of the key, so it is read before the run starts
+        try {
+            std::ifstream ifs(filename, std::ios::binary);
+            if (!ifs) throw std::runtime_error("Cannot open binary file: " + filename);
+            Program program(read_executable_image(ifs));
+            std::string input((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+            RunRecord record = ResultCache(cache_dir).run(program, input, options);
+            std::cout << record.output << std::flush;
+            if (record.failed()) {
+                std::cerr << "Executor error: " << record.error << std::endl;
+                return 2;
+            }
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Executor error: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    // Maps the debug section only once a trace line or the profile needs it
+    std::unique_ptr<DebugInfo> symbols;
+    if (options.verbose || profiler) {
+        try {
+            symbols = std::make_unique<DebugInfo>(filename);
+            options.symbols = symbols.get();
+        } catch (const std::exception&) {
+            // run_file reports the unreadable file
+        }
+    }
+
+    int status = 0;
     try {
         Executor exe;
-        machine_state final_state = exe.run_file(filename, max_steps, verbose, start_addr);
-        return 0;
+        machine_state final_state = exe.run_file(filename, options);
     } catch (const std::exception& e) {
         std::cerr << "Executor error: " << e.what() << std::endl;
-        return 2;
+        status = 2;
+    }
+    std::cout << std::flush;
+    if (options.usage) resources.report(std::cerr);
+    if (caches) caches->report(std::cerr);
+    if (timing) timing->report(std::cerr);
+    if (coverage) {
+        std::ofstream out(coverage_path, std::ios::binary);
+        try {
+            coverage->save(out);
+        } catch (const std::exception&) {
+            std::cerr << "Cannot write coverage: " << coverage_path << "\n";
+            return 1;
+        }
+    }
+    if (profiler) {
+        std::ofstream out(profile_path);
+        if (!out) {
+            std::cerr << "Cannot write profile: " << profile_path << "\n";
+            return 1;
+        }
+        try {
+            if (symbols) profiler->set_symbols(symbols->labels());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+        }
+        profiler->write_collapsed(out);
+        profiler->report(std::cerr);
     }
+    return status;
 }
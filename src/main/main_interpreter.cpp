@@ -1,26 +1,75 @@
 #include "../../include/interpreter.h"
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <cstring>
 
 static void usage(const char* prog) {
     std::cerr << "Usage:\n";
-    std::cerr << "  " << prog << " input.asm\n";
+    std::cerr << "  " << prog << " input.asm [-g] [-c <dir>] [-p <file>] [-k <file>]\n";
+    std::cerr << "    -g        guard-page memory instead of bounds checks\n";
+    std::cerr << "    -c <dir>  reuse assembled sources cached in <dir>\n";
+    std::cerr << "    -p <file> profile calls: collapsed stacks to <file>, functions to stderr\n";
+    std::cerr << "    -k <file> record coverage bitmaps to <file> (see mips_coverage)\n";
 }
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
+    if (argc < 2) {
         usage(argv[0]);
         return 1;
     }
 
     std::string filename = argv[1];
+    MemoryBackend memory = MemoryBackend::CHECKED;
+    std::string cache_dir;
+    std::string profile_path;
+    std::string coverage_path;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-g") == 0) {
+            memory = MemoryBackend::GUARDED;
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            coverage_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
+    int status = 0;
+    CallProfiler profiler;
+    CoverageMap coverage(1024 * 1024);
     try {
         Interpreter interp;
-        machine_state final_state = interp.run_file(filename);
-        return 0;
+        interp.set_cache_directory(cache_dir);
+        if (!profile_path.empty()) interp.set_profiler(&profiler);
+        if (!coverage_path.empty()) interp.set_coverage(&coverage);
+        machine_state final_state = interp.run_file(filename, 10000000ULL, memory);
     } catch (const std::exception& e) {
         std::cerr << "Interpreter error: " << e.what() << std::endl;
-        return 2;
+        status = 2;
+    }
+    if (!coverage_path.empty()) {
+        std::ofstream out(coverage_path, std::ios::binary);
+        try {
+            coverage.save(out);
+        } catch (const std::exception&) {
+            std::cerr << "Cannot write coverage: " << coverage_path << "\n";
+            return 1;
+        }
+    }
+    if (!profile_path.empty()) {
+        std::cout << std::flush;
+        std::ofstream out(profile_path);
+        if (!out) {
+            std::cerr << "Cannot write profile: " << profile_path << "\n";
+            return 1;
+        }
+        profiler.write_collapsed(out);
+        profiler.report(std::cerr);
     }
+    return status;
 }
@@ -34,57 +34,80 @@ ParseResult Parser::parse_assembly_file(const std::string& filename) {
     return parse_assembly(file);
 }
 
+namespace {
+
+// Collects the image in a vector
+class VectorEmitter : public BinaryEmitter {
+public:
+    explicit VectorEmitter(std::vector<uint8_t>& binary) : binary(binary) {}
+
+    void emit(const uint8_t* bytes, size_t count) override { binary.insert(binary.end(), bytes, bytes + count); }
+    void emit_zeros(size_t count) override { binary.insert(binary.end(), count, 0); }
+    size_t size() const override { return binary.size(); }
+
+private:
+    std::vector<uint8_t>& binary;
+};
+
+} // namespace
+
+void MemoryEmitter::emit(const uint8_t* bytes, size_t count) {
+    std::memcpy(state.host_range(static_cast<uint32_t>(base + at), count), bytes, count);
+    at += count;
+}
+
+void MemoryEmitter::emit_zeros(size_t count) {
+    state.host_range(static_cast<uint32_t>(base + at), count);
+    at += count;
+}
+
 std::vector<uint8_t> Parser::generate_binary(const ParseResult& result) {
     std::vector<uint8_t> binary;
+    binary.reserve(static_cast<size_t>(result.text_size) + result.data_size);
+    VectorEmitter out(binary);
+    generate_binary(result, out);
+    return binary;
+}
 
+void Parser::generate_binary(const ParseResult& result, BinaryEmitter& out) {
     for (const auto& line : result.lines) {
         if (std::holds_alternative<Instruction>(line)) {
-            uint32_t encoded = InstructionUtils::encode(std::get<Instruction>(line));
-            // Store in little-endian format (LSB first) to match machine_state.
-            binary.push_back(encoded & 0xFF);
-            binary.push_back((encoded >> 8) & 0xFF);
-            binary.push_back((encoded >> 16) & 0xFF);
-            binary.push_back((encoded >> 24) & 0xFF);
+            out.emit32(InstructionUtils::encode(std::get<Instruction>(line)));
         } else {
             const AssemblyDirective& dir = std::get<AssemblyDirective>(line);
             switch (dir.type) {
                 case DirectiveType::BYTE:
-                    for (auto v : dir.values) binary.push_back(static_cast<uint8_t>(v & 0xFF));
+                    for (auto v : dir.values) {
+                        uint8_t byte = static_cast<uint8_t>(v & 0xFF);
+                        out.emit(&byte, 1);
+                    }
                     break;
 
                 case DirectiveType::HALF:
                     for (auto v : dir.values) {
-                        uint16_t val = static_cast<uint16_t>(v & 0xFFFF);
                         // little-endian: low byte first
-                        binary.push_back(val & 0xFF);
-                        binary.push_back((val >> 8) & 0xFF);
+                        uint8_t half[2] = {static_cast<uint8_t>(v & 0xFF), static_cast<uint8_t>((v >> 8) & 0xFF)};
+                        out.emit(half, 2);
                     }
                     break;
 
                 case DirectiveType::WORD:
-                    for (auto v : dir.values) {
-                        uint32_t val = v;
-                        // little-endian: LSB first
-                        binary.push_back(val & 0xFF);
-                        binary.push_back((val >> 8) & 0xFF);
-                        binary.push_back((val >> 16) & 0xFF);
-                        binary.push_back((val >> 24) & 0xFF);
-                    }
+                    for (auto v : dir.values) out.emit32(v);
                     break;
 
                 case DirectiveType::ASCII:
                 case DirectiveType::ASCIIZ:
-                    for (char c : dir.text) binary.push_back(static_cast<uint8_t>(c));
-                    if (dir.type == DirectiveType::ASCIIZ) binary.push_back(0);
+                    out.emit(reinterpret_cast<const uint8_t*>(dir.text.data()), dir.text.size());
+                    if (dir.type == DirectiveType::ASCIIZ) out.emit_zeros(1);
                     break;
 
                 case DirectiveType::SPACE:
-                    if (!dir.values.empty()) binary.insert(binary.end(), dir.values[0], 0);
+                    if (!dir.values.empty()) out.emit_zeros(dir.values[0]);
                     break;
 
                 case DirectiveType::ALIGN:
-                    if (dir.alignment > 0) {
-                        while (binary.size() % dir.alignment != 0) binary.push_back(0);
+                    if (dir.alignment > 0 && out.size() % dir.alignment != 0) {
+                        out.emit_zeros(dir.alignment - out.size() % dir.alignment);
                     }
                     break;
 
@@ -97,11 +120,7 @@ std::vector<uint8_t> Parser::generate_binary(const ParseResult& result) {
                     for (float f : dir.float_values) {
                         uint32_t bits;
                         std::memcpy(&bits, &f, sizeof(float));
-                        // little-endian
-                        binary.push_back(bits & 0xFF);
-                        binary.push_back((bits >> 8) & 0xFF);
-                        binary.push_back((bits >> 16) & 0xFF);
-                        binary.push_back((bits >> 24) & 0xFF);
+                        out.emit32(bits);
                     }
                     break;
 
@@ -109,17 +128,14 @@ std::vector<uint8_t> Parser::generate_binary(const ParseResult& result) {
                     for (double d : dir.double_values) {
                         uint64_t bits;
                         std::memcpy(&bits, &d, sizeof(double));
-                        // little-endian: byte 0 = LSB
-                        for (int i = 0; i < 8; ++i) {
-                            binary.push_back((bits >> (i * 8)) & 0xFF);
-                        }
+                        // little-endian: low word first
+                        out.emit32(static_cast<uint32_t>(bits));
+                        out.emit32(static_cast<uint32_t>(bits >> 32));
                     }
                     break;
             }
         }
     }
-
-    return binary;
 }
 
 uint32_t Parser::calculate_memory_size(const ParseResult& result) {
@@ -233,6 +249,7 @@ void Parser::init_instruction_map() {
     instruction_map["nor"] = {Opcode::RTYPE, FunctionCode::NOR};
     instruction_map["slt"] = {Opcode::RTYPE, FunctionCode::SLT};
     instruction_map["sltu"] = {Opcode::RTYPE, FunctionCode::SLTU};
+    instruction_map["sync"] = {Opcode::RTYPE, FunctionCode::SYNC};
 
     // I-type
     instruction_map["beq"] = {Opcode::BEQ, FunctionCode::ADD};
@@ -257,6 +274,8 @@ void Parser::init_instruction_map() {
     instruction_map["sb"] = {Opcode::SB, FunctionCode::ADD};
     instruction_map["sh"] = {Opcode::SH, FunctionCode::ADD};
     instruction_map["sw"] = {Opcode::SW, FunctionCode::ADD};
+    instruction_map["ll"] = {Opcode::LL, FunctionCode::ADD};
+    instruction_map["sc"] = {Opcode::SC, FunctionCode::ADD};
 
     // J-type
     instruction_map["j"] = {Opcode::J, FunctionCode::ADD};
@@ -585,7 +604,7 @@ ParseResult Parser::two_pass_parse(const std::vector<std::string>& lines) {
     uint32_t text_size = 0;
     uint32_t data_size = 0;
 
-    first_pass(lines, items, labels_raw, text_size, data_size);
+    first_pass(lines, items, labels_raw, result.source_lines, text_size, data_size);
 
     // Now compute absolute addresses: text starts at 0, data starts at text_size
     uint32_t text_base = 0;
@@ -633,6 +652,8 @@ ParseResult Parser::two_pass_parse(const std::vector<std::string>& lines) {
     // call second_pass
     second_pass(second_items, labels, result.lines);
     result.labels = labels;
+    result.text_size = text_size;
+    result.data_size = data_size;
 
     if (labels.find("main") != labels.end()) {
         result.has_main = true;
@@ -646,6 +667,7 @@ ParseResult Parser::two_pass_parse(const std::vector<std::string>& lines) {
 void Parser::first_pass(const std::vector<std::string>& lines,
                         std::vector<std::tuple<std::string,bool,uint32_t,bool>>& items,
                         std::vector<std::tuple<std::string,bool,uint32_t>>& labels_raw,
+                        std::vector<SourceLine>& source_lines,
                         uint32_t& text_size,
                         uint32_t& data_size) {
     // items: content, in_text, offset(within that section), is_directive
@@ -653,8 +675,8 @@ void Parser::first_pass(const std::vector<std::string>& lines,
     uint32_t data_pc = 0;
     bool current_in_text = true; // default to text section unless .data appears
 
-    for (auto raw_line : lines) {
-        auto line = trim(raw_line);
+    for (size_t index = 0; index < lines.size(); ++index) {
+        auto line = trim(lines[index]);
         if (line.empty()) continue;
 
         // extract multiple labels at start of line (e.g., "L1: L2: instruction")
@@ -711,6 +733,7 @@ void Parser::first_pass(const std::vector<std::string>& lines,
             }
             // add instruction item
             items.emplace_back(line, true, text_pc, false);
+            source_lines.push_back({text_pc, static_cast<uint32_t>(index + 1)});
             text_pc += 4;
         }
     }
@@ -803,6 +826,9 @@ RInstruction Parser::parse_r_instruction(const std::string& mnemonic, const std:
         // mthi rs
         std::string rs = get(0);
         return RInstruction(static_cast<uint8_t>(parse_register(rs)), 0, 0, 0, funct);
+    } else if (mnemonic == "sync") {
+        // sync (no operands)
+        return RInstruction(0, 0, 0, 0, funct);
     } else if (mnemonic == "mult" || mnemonic == "multu" || mnemonic == "div" || mnemonic == "divu") {
         // mult rs, rt
         std::string rs = get(0), rt = get(1);
@@ -837,7 +863,7 @@ IInstruction Parser::parse_i_instruction(const std::string& mnemonic, const std:
     // Special-case: memory ops: rt, offset(base)
     if (mnemonic == "lw" || mnemonic == "sw" ||
         mnemonic == "lb" || mnemonic == "lbu" || mnemonic == "lh" || mnemonic == "lhu" ||
-        mnemonic == "sb" || mnemonic == "sh") {
+        mnemonic == "sb" || mnemonic == "sh" || mnemonic == "ll" || mnemonic == "sc") {
         std::string rt = get(0);
         std::string mem = get(1);
         auto mo = parse_memory_operand(mem);
@@ -845,18 +871,19 @@ IInstruction Parser::parse_i_instruction(const std::string& mnemonic, const std:
     }
 
     // Branches using labels: beq, bne
+    // Offsets are relative to the branch itself, matching InstructionExecutor (pc + offset*4)
     if (mnemonic == "beq" || mnemonic == "bne") {
         std::string rs = get(0), rt = get(1), label = get(2);
         if (labels.find(label) == labels.end()) throw_parse_error("Unknown label in branch: " + label);
         uint32_t target = labels.at(label);
-        int32_t diff = static_cast<int32_t>(target) - (static_cast<int32_t>(current_pc) + 4);
+        int32_t diff = static_cast<int32_t>(target) - static_cast<int32_t>(current_pc);
         int32_t offset = diff / 4;
         return IInstruction(opcode, static_cast<uint8_t>(parse_register(rs)), static_cast<uint8_t>(parse_register(rt)), static_cast<uint16_t>(offset & 0xFFFF));
     } else if (mnemonic == "blez" || mnemonic == "bgtz") {
         std::string rs = get(0), label = get(1);
         if (labels.find(label) == labels.end()) throw_parse_error("Unknown label in branch: " + label);
         uint32_t target = labels.at(label);
-        int32_t diff = static_cast<int32_t>(target) - (static_cast<int32_t>(current_pc) + 4);
+        int32_t diff = static_cast<int32_t>(target) - static_cast<int32_t>(current_pc);
         int32_t offset = diff / 4;
         return IInstruction(opcode, static_cast<uint8_t>(parse_register(rs)), 0, static_cast<uint16_t>(offset & 0xFFFF));
     }
@@ -0,0 +1,167 @@
+#include "../../include/vm.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+struct Vm::Unbounded {
+    bool reached(const machine_state&) const { return false; }
+};
+struct Vm::AtPc {
+    uint32_t pc;
+    bool reached(const machine_state& state) const { return state.get_pc() == pc; }
+};
+struct Vm::When {
+    const Condition& condition;
+    bool reached(const machine_state& state) const { return condition(state); }
+};
+
+Vm::Vm(VmOptions options)
+    : options(options),
+      executor(options.input ? *options.input : std::cin, options.output ? *options.output : std::cout) {}
+
+Vm::~Vm() = default;
+
+void Vm::load(std::shared_ptr<const Program> loaded) {
+    if (options.memory_pages == 0 || options.memory_pages > (uint64_t{1} << 32) / kGuestPageSize) {
+        throw std::runtime_error("Vm error: invalid guest memory size: " +
+                                 std::to_string(options.memory_pages) + " pages");
+    }
+    uint32_t start_pc = options.start_address != UINT32_MAX ? options.start_address : loaded->entry();
+    auto fresh = std::make_unique<machine_state>(size_t{options.memory_pages} * kGuestPageSize, options.memory);
+    fresh->map_image(loaded->image());
+    if (!fresh->is_valid_address(start_pc, 0)) {
+        throw std::runtime_error("Start PC is outside loaded binary memory: " + std::to_string(start_pc));
+    }
+    fresh->set_pc(start_pc);
+
+    program = std::move(loaded);
+    machine = std::move(fresh);
+    count = 0;
+    done = false;
+}
+
+void Vm::load(std::istream& binary) {
+    load(Program::load(binary));
+}
+
+void Vm::load_file(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) throw std::runtime_error("Cannot open binary file: " + filename);
+    load(ifs);
+}
+
+void Vm::on_syscall(uint32_t code, SyscallHook hook) {
+    if (hook) {
+        hooks[code] = std::move(hook);
+    } else {
+        hooks.erase(code);
+    }
+}
+
+machine_state& Vm::state() {
+    if (!machine) throw std::runtime_error("Vm error: no program loaded");
+    return *machine;
+}
+
+const machine_state& Vm::state() const {
+    if (!machine) throw std::runtime_error("Vm error: no program loaded");
+    return *machine;
+}
+
+std::string Vm::fault_message() const {
+    return faulted() ? InstructionExecutor::fault_message(*machine) : std::string();
+}
+
+RunStop Vm::step(uint64_t n) {
+    return run(n, Unbounded());
+}
+
+RunStop Vm::run_until(uint32_t pc, uint64_t max_steps) {
+    return run(max_steps, AtPc{pc});
+}
+
+RunStop Vm::run_until(const Condition& condition, uint64_t max_steps) {
+    return run(max_steps, When{condition});
+}
+
+// Runs the loop, and hooked syscalls between its stretches so that a hook
+// never runs inside GuestMemory::run_trapped
+template <typename Until>
+RunStop Vm::run(uint64_t max_steps, const Until& until) {
+    machine_state& state = this->state();
+    if (done) return RunStop::EXITED;
+    if (state.faulted()) return RunStop::FAULTED;
+    const uint64_t limit = count + std::min(max_steps, UINT64_MAX - count);
+
+    while (true) {
+        RunStop stop = run_trapped(limit, until);
+        if (stop == RunStop::EXITED) done = true;
+        if (stop != RunStop::STOPPED) return stop;
+
+        uint32_t pc = state.get_pc();
+        uint32_t code = hooked_trap;
+        ++count;
+        hooks.at(code)(*this);
+        if (state.get_pc() == pc) {
+            if (state.faulted()) return RunStop::FAULTED;
+            state.increment_pc();
+        }
+        if (code == 5) {
+            done = true;
+            return RunStop::EXITED;
+        }
+        if (until.reached(state)) return RunStop::REACHED;
+        if (count >= limit) return RunStop::STEP_LIMIT;
+    }
+}
+
+// GUARDED faults are raised as the checked loop would; a fault the guest
+// handles resumes the loop at its vector
+template <typename Until>
+RunStop Vm::run_trapped(uint64_t limit, const Until& until) {
+    machine_state& state = *machine;
+    if (state.bounds_checked()) return run_loop<true>(limit, until);
+    RunStop stop = RunStop::FAULTED;
+    uint32_t fault_address = 0;
+    while (!state.guest_memory().run_trapped([&] { stop = run_loop<false>(limit, until); }, fault_address)) {
+        InstructionExecutor::raise_trapped_fault(state, fault_address);
+        if (state.faulted()) return RunStop::FAULTED;
+    }
+    return stop;
+}
+
+// Executor's step loop, plus the stop policy and the hook check. Stops
+// with STOPPED in front of a hooked trap, without counting it.
+template <bool Checked, typename Until>
+RunStop Vm::run_loop(uint64_t limit, const Until& until) {
+    machine_state& state = *machine;
+    while (uint64_t countdown = budget_slice(count, limit)) {
+        for (; countdown; --countdown) {
+            uint32_t pc = state.get_pc();
+            if (Checked && !state.is_valid_address(pc, 4)) {
+                ++count;
+                state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+                if (state.faulted()) return RunStop::FAULTED;
+                if (until.reached(state)) return RunStop::REACHED;
+                continue;
+            }
+
+            DecodedInstruction instr = program->decode(pc, state.fetch32(pc));
+            bool trap = instr.op == Operation::TRAP;
+            if (trap && !hooks.empty() && hooks.count(instr.imm)) {
+                hooked_trap = instr.imm;
+                return RunStop::STOPPED;
+            }
+            ++count;
+            executor.execute<Checked>(state, instr);
+
+            if (state.get_pc() == pc) {
+                if (state.faulted()) return RunStop::FAULTED;
+                state.increment_pc();
+            }
+            if (trap && instr.imm == 5) return RunStop::EXITED;
+            if (until.reached(state)) return RunStop::REACHED;
+        }
+    }
+    return RunStop::STEP_LIMIT;
+}
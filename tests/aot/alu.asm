@@ -0,0 +1,66 @@
+# Arithmetic, shifts, sub-word memory access and $zero writes
+    .data
+vals: .word -16, 0x12345678, 7
+    .text
+main:
+    addi $t0, $zero, -7
+    addi $t1, $zero, 3
+    mult $t0, $t1
+    mflo $a0
+    trap 0
+    mfhi $a0
+    trap 0
+    multu $t0, $t1
+    mfhi $a0
+    trap 0
+    div  $t0, $t1
+    mflo $a0
+    trap 0
+    mfhi $a0
+    trap 0
+    divu $t0, $zero
+    mflo $a0
+    trap 0
+    sra  $a0, $t0, 1
+    trap 0
+    srl  $a0, $t0, 28
+    trap 0
+    srav $a0, $t0, $t1
+    trap 0
+    sltiu $a0, $t1, -1
+    trap 0
+    nor  $a0, $t0, $t1
+    trap 0
+    addi $t2, $zero, vals
+    lb   $a0, 0($t2)
+    trap 0
+    lbu  $a0, 0($t2)
+    trap 0
+    lh   $a0, 6($t2)
+    trap 0
+    lhu  $a0, 4($t2)
+    trap 0
+    sh   $t0, 8($t2)
+    lw   $a0, 8($t2)
+    trap 0
+    addi $zero, $zero, 99
+    add  $a0, $zero, $zero
+    trap 0
+    lhi  $a0, $zero, 0x8000
+    llo  $a0, $zero, 1
+    trap 0
+    sc   $t0, 8($t2)
+    add  $a0, $t0, $zero
+    trap 0
+    ll   $a0, 8($t2)
+    trap 0
+    addi $t3, $zero, 77
+    sync
+    sc   $t3, 8($t2)
+    lw   $a0, 8($t2)
+    add  $a0, $a0, $t3
+    trap 0
+    trap 6
+    add  $a0, $v0, $zero
+    trap 0
+    trap 5
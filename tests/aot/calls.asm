@@ -0,0 +1,46 @@
+# Direct and indirect calls, recursion and every print syscall
+    .data
+title: .asciiz "fib"
+    .text
+main:
+    addi $sp, $zero, 30000
+    addi $a0, $zero, title
+    trap 2
+    addi $s0, $zero, 0
+loop:
+    addi $a0, $zero, 32
+    trap 1
+    add  $a0, $s0, $zero
+    jal  fib
+    add  $a0, $v0, $zero
+    trap 0
+    addi $s0, $s0, 1
+    slti $t0, $s0, 15
+    bne  $t0, $zero, loop
+    addi $t9, $zero, newline
+    jalr $t9
+    trap 5
+newline:
+    addi $a0, $zero, 10
+    trap 1
+    jr   $ra
+fib:
+    slti $t0, $a0, 2
+    beq  $t0, $zero, rec
+    add  $v0, $a0, $zero
+    jr   $ra
+rec:
+    addi $sp, $sp, -12
+    sw   $ra, 0($sp)
+    sw   $a0, 4($sp)
+    addi $a0, $a0, -1
+    jal  fib
+    sw   $v0, 8($sp)
+    lw   $a0, 4($sp)
+    addi $a0, $a0, -2
+    jal  fib
+    lw   $t1, 8($sp)
+    add  $v0, $v0, $t1
+    lw   $ra, 0($sp)
+    addi $sp, $sp, 12
+    jr   $ra
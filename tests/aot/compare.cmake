@@ -0,0 +1,18 @@
+# Runs EXECUTOR on BINARY and the TRANSLATED program with the same ARGS and
+# INPUT, and fails unless stdout, stderr and the exit code all match.
+set(input_option)
+if(INPUT)
+    set(input_option INPUT_FILE ${INPUT})
+endif()
+
+execute_process(COMMAND ${EXECUTOR} ${BINARY} ${ARGS} ${input_option}
+                OUTPUT_VARIABLE expected_out ERROR_VARIABLE expected_err RESULT_VARIABLE expected_rc)
+execute_process(COMMAND ${TRANSLATED} ${ARGS} ${input_option}
+                OUTPUT_VARIABLE actual_out ERROR_VARIABLE actual_err RESULT_VARIABLE actual_rc)
+
+foreach(stream out err rc)
+    if(NOT "${expected_${stream}}" STREQUAL "${actual_${stream}}")
+        message(FATAL_ERROR "${stream} differs\nexecutor:   [${expected_${stream}}]\ntranslated: [${actual_${stream}}]")
+    endif()
+endforeach()
+message(STATUS "match (exit ${actual_rc}): ${actual_out}")
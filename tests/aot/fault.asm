@@ -0,0 +1,9 @@
+# Prints, then faults on a store past the end of memory
+    .text
+main:
+    addi $a0, $zero, 1
+    trap 0
+    lhi  $t0, $zero, 0x0010
+    sw   $a0, 0($t0)
+    trap 0
+    trap 5
@@ -0,0 +1,18 @@
+# Rewrites its own loop body after the first iteration
+    .text
+main:
+    addi $t1, $zero, 3
+    llo  $t5, $zero, 0x0064
+    lhi  $t5, $zero, 0x2108
+    addi $t6, $zero, patch
+loop:
+patch:
+    addi $t0, $t0, 1
+    sw   $t5, 0($t6)
+    add  $a0, $t0, $zero
+    trap 0
+    addi $a0, $zero, 10
+    trap 1
+    addi $t1, $t1, -1
+    bne  $t1, $zero, loop
+    trap 5
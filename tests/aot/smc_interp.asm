@@ -0,0 +1,19 @@
+# A stub reached only through jr, so left to the interpreter, rewrites
+# translated code and jumps back into it
+    .text
+main:
+    addi $t0, $zero, 1
+    bne  $t0, $zero, skip
+target:
+    addi $a0, $zero, 1
+    trap 0
+    trap 5
+skip:
+    addi $t1, $zero, stub
+    jr   $t1
+stub:
+    llo  $t2, $zero, 0x0002
+    lhi  $t2, $zero, 0x2004
+    addi $t3, $zero, target
+    sw   $t2, 0($t3)
+    j    target
@@ -0,0 +1,5 @@
+# Never exits: only the step or time limit stops it
+    .text
+main:
+    addi $t0, $t0, 1
+    j    main
@@ -0,0 +1,37 @@
+# Installs a handler, then raises every cause it can recover from; the
+# handler prints "cause:badvaddr " and skips the faulting instruction
+    .text
+main:
+    addi $a0, $zero, handler
+    trap 8
+    lhi  $t0, $zero, 0x7fff
+    add  $t1, $t0, $t0
+    lw   $t1, 4($t0)
+    sw   $t1, 0($t0)
+    ori  $t3, $t0, 0xffff
+    addi $t2, $t3, 1
+    lhi  $t4, $zero, 0x8000
+    sub  $t2, $zero, $t4
+    trap 42
+    .word 0xfc000000
+    addi $a0, $zero, -1
+    trap 8
+    add  $a0, $t0, $t0
+    trap 0
+    addi $a0, $zero, 10
+    trap 1
+    addi $a0, $zero, 127
+    trap 0
+    trap 5
+handler:
+    add  $a0, $k1, $zero
+    trap 0
+    addi $a0, $zero, 58
+    trap 1
+    trap 10
+    add  $a0, $k1, $zero
+    trap 0
+    addi $a0, $zero, 32
+    trap 1
+    addi $k0, $k0, 4
+    trap 9
@@ -0,0 +1,13 @@
+# A fault inside the handler has nobody to go to
+    .text
+main:
+    addi $a0, $zero, handler
+    trap 8
+    lhi  $t0, $zero, 0x7fff
+    lw   $t1, 0($t0)
+    trap 5
+handler:
+    addi $a0, $zero, 1
+    trap 0
+    sb   $t1, 0($t0)
+    trap 9
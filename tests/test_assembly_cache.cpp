@@ -0,0 +1,118 @@
+#include "../include/assembly_cache.h"
+#include "../include/interpreter.h"
+#include "test_support.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+// Output of the interpreter on `source`, or its error
+static std::string interpret(const std::string& source, const std::string& cache_dir,
+                             MemoryBackend memory = MemoryBackend::CHECKED) {
+    std::istringstream in(source);
+    std::ostringstream out;
+    std::streambuf* old_out = std::cout.rdbuf(out.rdbuf());
+    std::string result;
+    try {
+        Interpreter interp;
+        interp.set_cache_directory(cache_dir);
+        interp.run_stream(in, 100000ULL, memory);
+        result = out.str();
+    } catch (const std::exception& e) {
+        result = out.str() + "error: " + e.what();
+    }
+    std::cout.rdbuf(old_out);
+    return result;
+}
+
+// Prints a string, then overwrites the first word of its own code and the string
+static const char* kProgram = R"(
+    .data
+    msg: .asciiz "cached"
+    .text
+    helper:
+        trap 2
+        jr   $ra
+    main:
+        addi $a0, $zero, msg
+        jal  helper
+        addi $t0, $zero, 88
+        sb   $t0, 0($a0)
+        sw   $zero, 0($zero)
+        trap 2
+        trap 5
+)";
+
+void test_hits() {
+    std::filesystem::path dir = fresh_dir("mips_asm_cache_test");
+    AssemblyCache cache(dir.string());
+    Parser parser;
+
+    bool hit = true;
+    AssembledSource first = cache.assemble(parser, kProgram, &hit);
+    assert(!hit && std::filesystem::exists(cache.path(kProgram)));
+    AssembledSource second = cache.assemble(parser, kProgram, &hit);
+    assert(hit);
+
+    // The entry holds what the parser produced
+    ParseResult parsed = parser.parse_assembly(std::string(kProgram));
+    std::vector<uint8_t> binary = parser.generate_binary(parsed);
+    for (const AssembledSource* a : {&first, &second}) {
+        assert(a->has_main && a->main_address == parsed.main_address);
+        assert(a->labels == parsed.labels);
+        assert(a->image->size() == binary.size());
+        assert(std::equal(binary.begin(), binary.end(), a->image->data()));
+    }
+
+    // Another source, or the same one edited, misses
+    std::string edited = std::string(kProgram) + "\n";
+    assert(cache.path(edited) != cache.path(kProgram));
+    AssembledSource other;
+    assert(!cache.lookup(edited, other));
+
+    // A damaged trailer is a miss
+    std::filesystem::resize_file(cache.path(kProgram), std::filesystem::file_size(cache.path(kProgram)) - 3);
+    assert(!cache.lookup(kProgram, other));
+    cache.assemble(parser, kProgram, &hit);
+    assert(!hit && cache.lookup(kProgram, other));
+
+    std::filesystem::remove_all(dir);
+    std::cout << "Assembly cache hit tests passed!\n";
+}
+
+void test_interpreter() {
+    std::filesystem::path dir = fresh_dir("mips_asm_cache_run");
+    std::string expected = interpret(kProgram, "");
+    assert(expected == "cachedXached");
+
+    // Runs from a hit map the entry; guest stores must not reach the file
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (int round = 0; round < 3; ++round) {
+            assert(interpret(kProgram, dir.string(), memory) == expected);
+        }
+    }
+
+    // Sources without main are cached too, and still fail the same way
+    const char* no_main = ".text\nstart:\n    trap 5\n";
+    std::string error = interpret(no_main, "");
+    assert(error == "error: Interpreter error: 'main' label not found in assembly.");
+    assert(interpret(no_main, dir.string()) == error);
+    assert(interpret(no_main, dir.string()) == error);
+
+    std::filesystem::remove_all(dir);
+    std::cout << "Cached interpreter run tests passed!\n";
+}
+
+int main() {
+    try {
+        test_hits();
+        test_interpreter();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
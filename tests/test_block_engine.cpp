@@ -0,0 +1,349 @@
+#include "../include/block_engine.h"
+#include "../include/executor.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <cstring>
+
+static machine_state run(const std::string& image, ExecutionMode mode, uint64_t max_steps = 100000ULL) {
+    Executor exe;
+    ExecutorOptions options;
+    options.max_steps = max_steps;
+    options.mode = mode;
+    std::istringstream in(image);
+    return exe.run_stream(in, options);
+}
+
+static void assert_same_registers(const machine_state& a, const machine_state& b) {
+    for (unsigned r = 0; r < 32; ++r) {
+        assert(a.reg(r) == b.reg(r));
+    }
+    assert(a.get_pc() == b.get_pc());
+    assert(a.get_hi() == b.get_hi());
+    assert(a.get_lo() == b.get_lo());
+}
+
+static size_t pattern_index(const char* name) {
+    const auto& table = BlockEngine::patterns();
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (std::strcmp(table[i].name, name) == 0) return i;
+    }
+    assert(false && "unknown pattern");
+    return 0;
+}
+
+void test_fused_patterns() {
+    std::string image = image_of(R"(
+        .data
+        vals: .word 3, 4, 5, 6
+        .text
+        main:
+            lhi  $s0, $zero, 0x1234
+            llo  $s0, $zero, 0x5678
+            addi $t0, $zero, 0
+            addi $t1, $zero, 4
+            addi $a0, $zero, vals
+        loop:
+            lw   $t2, 0($a0)
+            addu $t3, $t3, $t2
+            addi $a0, $a0, 4
+            slti $t4, $t3, 10
+            bne  $t4, $zero, skip
+            addi $t5, $t5, 1
+        skip:
+            addi $t1, $t1, -1
+            bne  $t1, $zero, loop
+            trap 5
+    )");
+
+    machine_state stepped = run(image, ExecutionMode::STEP);
+    machine_state blocked = run(image, ExecutionMode::BLOCK);
+    assert_same_registers(stepped, blocked);
+    assert(blocked.get_register(Register::S0) == 0x12345678);
+    assert(blocked.get_register(Register::T3) == 18);
+
+    // Drive the engine directly to look at which pairs fused
+    machine_state state;
+    std::vector<uint8_t> bytes(image.begin(), image.end());
+    state.load_memory(0, bytes);
+    InstructionExecutor executor;
+    BlockEngine engine(executor);
+    engine.run(state, 100000);
+    assert_same_registers(stepped, state);
+
+    const BlockStats& stats = engine.stats();
+    assert(stats.pattern_hits[pattern_index("lhi+llo")] == 1);
+    assert(stats.pattern_hits[pattern_index("lw+addu")] == 4);
+    assert(stats.pattern_hits[pattern_index("slti+bne")] == 4);
+    assert(stats.pattern_hits[pattern_index("addi+bne")] == 4);
+    assert(!engine.unfused_pairs(4).empty());
+
+    std::cout << "Fused pattern tests passed!\n";
+}
+
+void test_branch_into_pair() {
+    // Both jumps land on the second instruction of a fusable pair
+    std::string image = image_of(R"(
+        .text
+        main:
+            addi $t2, $zero, 5
+            j    half
+            lhi  $t3, $zero, 0x1234
+        half:
+            llo  $t3, $zero, 0x5678
+            j    second
+        first:
+            addi $t0, $t0, 1
+        second:
+            bne  $t0, $t2, first
+            trap 5
+    )");
+
+    machine_state stepped = run(image, ExecutionMode::STEP);
+    machine_state blocked = run(image, ExecutionMode::BLOCK);
+    assert_same_registers(stepped, blocked);
+    assert(blocked.get_register(Register::T3) == 0x5678);
+    assert(blocked.get_register(Register::T0) == 5);
+
+    std::cout << "Branch-into-pair tests passed!\n";
+}
+
+void test_step_budget() {
+    std::string image = image_of(R"(
+        .text
+        main:
+            addi $t1, $zero, 10
+        loop:
+            addi $t0, $t0, 3
+            addi $t1, $t1, -1
+            bne  $t1, $zero, loop
+            trap 5
+    )");
+    const uint64_t exact = 1 + 10 * 3 + 1;
+
+    // Same outcome as the step loop at, and around, the exact budget
+    for (uint64_t budget = exact - 5; budget <= exact + 1; ++budget) {
+        bool step_failed = false, block_failed = false;
+        std::string step_error, block_error;
+        try { run(image, ExecutionMode::STEP, budget); } catch (const std::exception& e) { step_failed = true; step_error = e.what(); }
+        try { run(image, ExecutionMode::BLOCK, budget); } catch (const std::exception& e) { block_failed = true; block_error = e.what(); }
+        assert(step_failed == (budget < exact));
+        assert(block_failed == step_failed);
+        assert(block_error == step_error);
+    }
+
+    std::cout << "Step budget tests passed!\n";
+}
+
+// Instructions run up to a fault mid-block, as the step loop counts them
+static uint64_t steps_to_fault(const std::string& image, ExecutionMode mode, MemoryBackend memory) {
+    ResourceUsage usage;
+    ExecutorOptions options;
+    options.mode = mode;
+    options.memory = memory;
+    options.usage = &usage;
+    std::istringstream in(image);
+    try {
+        Executor().run_stream(in, options);
+        assert(false && "expected a fault");
+    } catch (const std::runtime_error&) {
+    }
+    assert(usage.stop == RunStop::FAULTED);
+    return usage.instructions;
+}
+
+void test_fault_steps() {
+    // A fused load, a single load and a store, each faulting as the fourth instruction
+    for (const char* access : {"lw $t3, 0($t2)\n addu $t4, $t3, $t1",
+                               "lb $t3, 0($t2)\n addi $t4, $t1, 1",
+                               "sw $t1, 0($t2)\n addi $t4, $t1, 1"}) {
+        std::string image = image_of(std::string(R"(
+            .text
+            main:
+                addi $t0, $zero, 1
+                addi $t1, $zero, 2
+                lhi  $t2, $zero, 0x7fff
+                )") + access + R"(
+                addi $t5, $zero, 3
+                trap 5
+        )");
+        for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+            if (!GuestMemory::backend_available(memory)) continue;
+            assert(steps_to_fault(image, ExecutionMode::STEP, memory) == 4);
+            assert(steps_to_fault(image, ExecutionMode::BLOCK, memory) == 4);
+        }
+    }
+
+    std::cout << "Fault step count tests passed!\n";
+}
+
+void test_self_modifying_code() {
+    // Overwrite the loop body after its block was compiled
+    uint32_t patched = InstructionUtils::encode(IInstruction(Opcode::ADDI, 8, 8, 100));
+    std::ostringstream src;
+    src << R"(
+        .text
+        main:
+            addi $t1, $zero, 2
+            llo  $t5, $zero, )" << (patched & 0xFFFF) << R"(
+            lhi  $t5, $zero, )" << (patched >> 16) << R"(
+            addi $t6, $zero, patch
+        loop:
+        patch:
+            addi $t0, $t0, 1
+            sw   $t5, 0($t6)
+            addi $t1, $t1, -1
+            bne  $t1, $zero, loop
+            trap 5
+    )";
+    std::string image = image_of(src.str());
+
+    machine_state stepped = run(image, ExecutionMode::STEP);
+    machine_state blocked = run(image, ExecutionMode::BLOCK);
+    assert(stepped.get_register(Register::T0) == 101);
+    assert_same_registers(stepped, blocked);
+
+    std::cout << "Self-modifying code tests passed!\n";
+}
+
+// Runs `source` in both modes, checks they agree, returns the block engine's stats
+static BlockStats compare_modes(const std::string& source, uint64_t max_steps = 1000000ULL) {
+    std::string image = image_of(source);
+    machine_state stepped = run(image, ExecutionMode::STEP, max_steps);
+
+    machine_state state;
+    std::vector<uint8_t> bytes(image.begin(), image.end());
+    state.load_memory(0, bytes);
+    InstructionExecutor executor;
+    BlockEngine engine(executor);
+    engine.run(state, max_steps);
+
+    assert_same_registers(stepped, state);
+    for (uint32_t addr = 0; addr < 0x4000; addr += 4) {
+        assert(stepped.read_memory32(addr) == state.read_memory32(addr));
+    }
+    return engine.stats();
+}
+
+void test_loop_idioms() {
+    // Byte copy with signed loads; the last byte copied is negative
+    BlockStats copy = compare_modes(R"(
+        .data
+        src: .word 0x64636261, -1, 7, 0x11223344, -16
+        .space 64
+        dst: .space 64
+        .text
+        main:
+            addi $a0, $zero, src
+            addi $a1, $zero, dst
+            addi $a2, $zero, 20
+        copy:
+            lb   $t0, 0($a0)
+            sb   $t0, 0($a1)
+            addi $a0, $a0, 1
+            addi $a2, $a2, -1
+            addi $a1, $a1, 1
+            bne  $a2, $zero, copy
+            trap 5
+    )");
+    // The first pass runs inside the entry block, which falls into the loop
+    assert(copy.idiom_loops == 1 && copy.idiom_bytes == 19);
+
+    // Fill, then strlen over a string with a length counter
+    BlockStats fill = compare_modes(R"(
+        .data
+        buf: .space 128
+        msg: .asciiz "twelve chars"
+        .text
+        main:
+            addi $a0, $zero, buf
+            addi $a1, $zero, 100
+            addi $t1, $zero, 0x41
+        fill:
+            sb   $t1, 3($a0)
+            addi $a0, $a0, 1
+            addi $a1, $a1, -1
+            bne  $a1, $zero, fill
+            addi $a0, $zero, msg
+        walk:
+            lbu  $t0, 0($a0)
+            addi $a0, $a0, 1
+            addi $v0, $v0, 1
+            bne  $t0, $zero, walk
+            trap 5
+    )");
+    assert(fill.idiom_loops == 2 && fill.idiom_bytes == 99 + 12);
+
+    // Destination inside the source: the byte loop smears, so the idiom must
+    // not fire while the ranges overlap
+    BlockStats smear = compare_modes(R"(
+        .data
+        buf: .asciiz "abcdefgh"
+        .text
+        main:
+            addi $a0, $zero, buf
+            addi $a1, $zero, buf
+            addi $a1, $a1, 1
+            addi $a2, $zero, 6
+        copy:
+            lbu  $t0, 0($a0)
+            sb   $t0, 0($a1)
+            addi $a0, $a0, 1
+            addi $a1, $a1, 1
+            addi $a2, $a2, -1
+            bne  $a2, $zero, copy
+            trap 5
+    )");
+    // The entry block copies the first byte; only the last one, which cannot
+    // smear, runs as a host call
+    assert(smear.idiom_loops == 1 && smear.idiom_bytes == 1);
+
+    std::cout << "Loop idiom tests passed!\n";
+}
+
+void test_idiom_budget() {
+    std::string image = image_of(R"(
+        .data
+        buf: .space 64
+        .text
+        main:
+            addi $a0, $zero, buf
+            addi $a1, $zero, 40
+        fill:
+            sb   $zero, 0($a0)
+            addi $a0, $a0, 1
+            addi $a1, $a1, -1
+            bne  $a1, $zero, fill
+            trap 5
+    )");
+    const uint64_t exact = 2 + 40 * 4 + 1;
+
+    for (uint64_t budget = exact - 6; budget <= exact; ++budget) {
+        std::string step_error, block_error;
+        try { run(image, ExecutionMode::STEP, budget); } catch (const std::exception& e) { step_error = e.what(); }
+        try { run(image, ExecutionMode::BLOCK, budget); } catch (const std::exception& e) { block_error = e.what(); }
+        assert(step_error == block_error);
+        assert(step_error.empty() == (budget == exact));
+    }
+
+    std::cout << "Loop idiom budget tests passed!\n";
+}
+
+int main() {
+    try {
+        test_fused_patterns();
+        test_branch_into_pair();
+        test_step_budget();
+        test_fault_steps();
+        test_self_modifying_code();
+        test_loop_idioms();
+        test_idiom_budget();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
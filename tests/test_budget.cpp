@@ -0,0 +1,199 @@
+#include "../include/executor.h"
+#include "../include/interpreter.h"
+#include "../include/block_engine.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+static const char* kSpin =
+    ".text\n"
+    "main:\n"
+    "    addi $t0, $t0, 1\n"
+    "    j    main\n";
+
+// The error the run threw, if any
+static std::string execute(const char* source, ExecutorOptions options, std::string* output = nullptr) {
+    std::istringstream bin(image_of(source)), in;
+    std::ostringstream out;
+    options.input = &in;
+    options.output = &out;
+    std::string error;
+    try {
+        Executor().run_stream(bin, options);
+    } catch (const std::runtime_error& e) {
+        error = e.what();
+    }
+    if (output) *output = out.str();
+    return error;
+}
+
+void test_slices() {
+    assert(budget_slice(0, 10) == 10);
+    assert(budget_slice(0, 100000) == kBudgetSlice);
+    assert(budget_slice(99999, 100000) == 1);
+    assert(budget_slice(100000, 100000) == 0);
+    assert(budget_slice(5, 0) == 0);
+
+    // The limit still stops runs at exactly max_steps, whatever the slice
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (ExecutionMode mode : {ExecutionMode::STEP, ExecutionMode::BLOCK}) {
+            for (uint64_t max_steps : {uint64_t{1}, uint64_t{4097}, uint64_t{10001}}) {
+                ResourceUsage usage;
+                ExecutorOptions options;
+                options.memory = memory;
+                options.mode = mode;
+                options.max_steps = max_steps;
+                options.usage = &usage;
+                assert(execute(kSpin, options) == "Executor error: reached maximum instruction count limit.");
+                assert(usage.stop == RunStop::STEP_LIMIT);
+                assert(usage.instructions == max_steps && usage.max_steps == max_steps);
+            }
+        }
+    }
+
+    // A program that exits on its last allowed step succeeds
+    const char* exits = ".text\nmain:\n    addi $t0, $zero, 1\n    trap 5\n";
+    ExecutorOptions options;
+    options.max_steps = 2;
+    assert(execute(exits, options).empty());
+    options.max_steps = 1;
+    assert(!execute(exits, options).empty());
+
+    std::istringstream in(kSpin);
+    std::string error;
+    ResourceUsage usage;
+    Interpreter interp;
+    interp.set_usage(&usage);
+    try {
+        interp.run_stream(in, 5000);
+    } catch (const std::runtime_error& e) {
+        error = e.what();
+    }
+    assert(error == "Interpreter error: reached maximum instruction count limit.");
+    assert(usage.stop == RunStop::STEP_LIMIT && usage.instructions == 5000);
+
+    std::cout << "Budget slice tests passed!\n";
+}
+
+void test_watchdog() {
+    {
+        Watchdog none(std::chrono::milliseconds(0));
+        assert(none.flag() == nullptr && !none.expired());
+    }
+    {
+        // Cancelled long before it would fire
+        Watchdog late(std::chrono::milliseconds(60000));
+        assert(late.flag() && !late.expired());
+    }
+    Watchdog soon(std::chrono::milliseconds(1));
+    while (!soon.expired()) std::this_thread::yield();
+    assert(soon.flag()->load());
+
+    // An endless loop ends at the time limit in every loop
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (ExecutionMode mode : {ExecutionMode::STEP, ExecutionMode::BLOCK}) {
+            ResourceUsage usage;
+            ExecutorOptions options;
+            options.memory = memory;
+            options.mode = mode;
+            options.max_steps = UINT64_MAX;
+            options.time_limit = std::chrono::milliseconds(20);
+            options.usage = &usage;
+            assert(execute(kSpin, options) == "Executor error: time limit exceeded.");
+            assert(usage.stop == RunStop::TIME_LIMIT && usage.time_limit.count() == 20);
+            assert(usage.wall_time >= std::chrono::milliseconds(20) && usage.instructions > 0);
+        }
+    }
+
+    // With harts the first to see it stops them all
+    const char* spawns =
+        ".text\n"
+        "main:\n"
+        "    addi $a0, $zero, spin\n"
+        "    trap 6\n"
+        "spin:\n"
+        "    addi $t0, $t0, 1\n"
+        "    j    spin\n";
+    ExecutorOptions options;
+    options.harts = 2;
+    options.max_steps = UINT64_MAX;
+    options.time_limit = std::chrono::milliseconds(20);
+    assert(execute(spawns, options) == "Executor error: time limit exceeded.");
+
+    // A run that finishes in time is unaffected
+    std::string output;
+    options = ExecutorOptions();
+    options.time_limit = std::chrono::milliseconds(60000);
+    assert(execute(".text\nmain:\n    addi $a0, $zero, 7\n    trap 0\n    trap 5\n", options, &output).empty());
+    assert(output == "7");
+
+    std::cout << "Watchdog tests passed!\n";
+}
+
+void test_memory() {
+    // Three pages: the store to the fourth faults
+    const char* touch =
+        ".text\n"
+        "main:\n"
+        "    addi $t0, $zero, 8192\n"
+        "    sw   $t0, 0($t0)\n"
+        "    addi $t0, $t0, 4096\n"
+        "    sw   $t0, 0($t0)\n"
+        "    trap 5\n";
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        ResourceUsage usage;
+        ExecutorOptions options;
+        options.memory = memory;
+        options.memory_pages = 3;
+        options.usage = &usage;
+        assert(execute(touch, options) == "Memory access violation in sw instruction");
+        assert(usage.stop == RunStop::FAULTED && usage.memory_pages == 3);
+        assert(usage.instructions == 4);
+        assert(usage.pages_touched >= 1 && usage.pages_touched <= 3);
+
+        options.memory_pages = 4;
+        assert(execute(touch, options).empty());
+        assert(usage.stop == RunStop::EXITED && usage.instructions == 5);
+        assert(usage.memory_pages == 4 && usage.pages_touched >= 2 && usage.pages_touched <= 4);
+
+        std::ostringstream report;
+        usage.report(report);
+        assert(report.str().find("run: exited\n") == 0);
+        assert(report.str().find("instructions: 5 of 100000\n") != std::string::npos);
+        assert(report.str().find(" of 4 pages touched") != std::string::npos);
+
+        // The Interpreter counts the faulting instruction too, trapped or tested
+        std::istringstream source(".text\nmain:\n    lhi $t0, $zero, 0x10\n    sw $t0, 0($t0)\n    trap 5\n");
+        Interpreter interp;
+        interp.set_usage(&usage);
+        try {
+            interp.run_stream(source, 100000, memory);
+            assert(false && "expected a fault");
+        } catch (const std::runtime_error&) {
+        }
+        assert(usage.stop == RunStop::FAULTED && usage.instructions == 2);
+    }
+
+    ExecutorOptions options;
+    options.memory_pages = 0;
+    assert(execute(kSpin, options) == "Executor error: invalid guest memory size: 0 pages");
+    options.memory_pages = (1u << 20) + 1;
+    assert(!execute(kSpin, options).empty());
+
+    std::cout << "Memory limit tests passed!\n";
+}
+
+int main() {
+    try {
+        test_slices();
+        test_watchdog();
+        test_memory();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
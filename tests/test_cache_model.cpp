@@ -0,0 +1,159 @@
+#include "../include/cache_model.h"
+#include "../include/executor.h"
+#include "../include/interpreter.h"
+#include "../include/result_cache.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+static CacheConfig geometry(uint32_t size, uint32_t ways, uint32_t line, ReplacementPolicy policy) {
+    CacheConfig c;
+    c.size = size;
+    c.ways = ways;
+    c.line = line;
+    c.policy = policy;
+    return c;
+}
+
+void test_levels() {
+    // One 2-way set of 16-byte lines: blocks A, B, C all map to it
+    const uint32_t A = 0x000, B = 0x100, C = 0x200;
+    CacheLevel lru(geometry(32, 2, 16, ReplacementPolicy::LRU));
+    CacheLevel fifo(geometry(32, 2, 16, ReplacementPolicy::FIFO));
+    for (CacheLevel* c : {&lru, &fifo}) {
+        assert(!c->access(A) && !c->access(B));
+        assert(c->access(A + 15));
+    }
+    // A was used last, so LRU evicts B; FIFO evicts A, the first filled
+    assert(!lru.access(C) && lru.access(A) && !lru.access(B));
+    assert(!fifo.access(C) && !fifo.access(A) && fifo.access(C));
+    assert(lru.hit_count() == 2 && lru.miss_count() == 4);
+
+    // Random replacement still fills empty ways first
+    CacheLevel random(geometry(64, 4, 16, ReplacementPolicy::RANDOM));
+    for (uint32_t a : {A, B, C, 0x300u}) assert(!random.access(a));
+    for (uint32_t a : {A, B, C, 0x300u}) assert(random.access(a));
+
+    bool threw = false;
+    try {
+        CacheLevel bad(geometry(96, 2, 16, ReplacementPolicy::LRU));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Cache level tests passed!\n";
+}
+
+void test_config() {
+    CacheHierarchyConfig c = CacheHierarchyConfig::parse("l1d=16K:4:32:fifo,l2=256K:8:64,region=1K");
+    assert(c.l1d.size == 16 * 1024 && c.l1d.ways == 4 && c.l1d.line == 32);
+    assert(c.l1d.policy == ReplacementPolicy::FIFO);
+    assert(c.l2.size == 256 * 1024 && c.l2.ways == 8 && c.l2.policy == ReplacementPolicy::LRU);
+    assert(c.l1i.size == CacheConfig().size && c.region == 1024);
+    assert(CacheHierarchyConfig::parse("default").l2.size == 1024 * 1024);
+
+    for (const char* bad : {"l3=1K:1:16", "l1d=1K:1", "l1d=1K:1:16:mru", "l1d=1Q:1:16", "region"}) {
+        bool threw = false;
+        try {
+            CacheHierarchyConfig::parse(bad);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // An access straddling two lines touches both
+    CacheHierarchy h(c, 4096);
+    h.data(0, 30, 4);
+    assert(h.l1d_cache().miss_count() == 2 && h.l2_cache().miss_count() == 1);
+    assert(h.pc_counts().at(0).data.accesses == 1 && h.pc_counts().at(0).data.l2_misses == 1);
+    // PCs are counted wherever they are, without an array sized for them
+    h.fetch(0x100000);
+    assert(h.pc_counts().size() == 2 && h.pc_counts().at(0x100000).fetch.accesses == 1);
+
+    std::cout << "Cache config tests passed!\n";
+}
+
+// Loads 64 consecutive words from 0x1000, 256 bytes = 4 lines of 64
+static const char* kSweep = R"(
+    .text
+    main:
+        addi $t0, $zero, 4096
+        addi $t1, $zero, 64
+    loop:
+        lw   $t2, 0($t0)
+        addi $t0, $t0, 4
+        addi $t1, $t1, -1
+        bne  $t1, $zero, loop
+        trap 5
+)";
+
+static void check_sweep(const CacheHierarchy& h) {
+    const uint64_t steps = 2 + 64 * 4 + 1;
+    assert(h.l1i_cache().hit_count() + h.l1i_cache().miss_count() == steps);
+    assert(h.l1i_cache().miss_count() == 1);
+
+    const CacheHierarchy::PcCounts& lw = h.pc_counts().at(8);
+    assert(lw.fetch.accesses == 64 && lw.data.accesses == 64);
+    assert(lw.data.l1_misses == 4 && lw.data.l2_misses == 4);
+    assert(h.pc_counts().at(12).data.accesses == 0);
+    assert(h.region_counts()[1].accesses == 64 && h.region_counts()[0].accesses == 0);
+
+    std::ostringstream report;
+    h.report(report, 3);
+    assert(report.str().find("L1D 32K 8-way 64B lru: 64 accesses, 4 misses (6.25%)") != std::string::npos);
+    assert(report.str().find("0x00001000  64 accesses") != std::string::npos);
+}
+
+void test_runs() {
+    std::string image = image_of(kSweep);
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (ExecutionMode mode : {ExecutionMode::STEP, ExecutionMode::BLOCK}) {
+            CacheHierarchy h(CacheHierarchyConfig(), 1024 * 1024);
+            ExecutorOptions options;
+            options.memory = memory;
+            options.mode = mode;       // blocks are turned off by the model
+            options.caches = &h;
+            std::istringstream in(image);
+            machine_state state = Executor().run_stream(in, options);
+            assert(state.reg(9) == 0 && state.attached_caches() == nullptr);
+            check_sweep(h);
+            assert(!ResultCache::cacheable(options));
+        }
+    }
+
+    CacheHierarchy h(CacheHierarchyConfig(), 1024 * 1024);
+    Interpreter interp;
+    interp.set_cache_model(&h);
+    std::istringstream source(kSweep);
+    interp.run_stream(source);
+    check_sweep(h);
+
+    // Only modelled accesses count; the default ones stay off the model
+    CacheHierarchy quiet(CacheHierarchyConfig(), 1024 * 1024);
+    machine_state state;
+    state.attach_caches(&quiet);
+    state.write_memory32(0x1000, 7);
+    InstructionExecutor().execute(state, IInstruction(Opcode::LW, 0, 8, 0x1000));
+    assert(state.reg(8) == 7 && state.fetch32(0) == 0);
+    assert(quiet.l1d_cache().miss_count() == 0 && quiet.l1i_cache().miss_count() == 0);
+    assert(state.load32<true>(0x1000) == 7 && quiet.l1d_cache().miss_count() == 1);
+
+    std::cout << "Cache model run tests passed!\n";
+}
+
+int main() {
+    try {
+        test_levels();
+        test_config();
+        test_runs();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
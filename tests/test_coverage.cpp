@@ -0,0 +1,157 @@
+#include "../include/coverage.h"
+#include "../include/executor.h"
+#include "../include/interpreter.h"
+#include "../include/result_cache.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+static const char* kSource =
+    ".text\n"
+    "main:\n"
+    "    addi $t0, $zero, 2\n"
+    "loop:\n"
+    "    addi $t0, $t0, -1\n"
+    "    bne  $t0, $zero, loop\n"
+    "    bne  $t0, $t0, done\n"
+    "    beq  $t0, $zero, done\n"
+    "    addi $t1, $zero, 1\n"
+    "done:\n"
+    "    trap 5\n";
+
+static CoverageMap covered(ExecutionMode mode) {
+    std::string image = image_of(kSource);
+    CoverageMap map(1024 * 1024);
+    ExecutorOptions options;
+    options.mode = mode;
+    options.coverage = &map;
+    assert(!ResultCache::cacheable(options));
+    std::istringstream in(image);
+    Executor().run_stream(in, options);
+    return map;
+}
+
+void test_recording() {
+    CoverageMap map = covered(ExecutionMode::STEP);
+    for (uint32_t pc : {0u, 4u, 8u, 12u, 16u, 24u}) assert(map.executed(pc));
+    assert(!map.executed(20) && !map.executed(28));
+    assert(map.taken(8) && map.not_taken(8));
+    assert(!map.taken(12) && map.not_taken(12));
+    assert(map.taken(16) && !map.not_taken(16));
+    assert(!map.taken(4) && !map.not_taken(4));
+
+    // Block mode steps while recording; the interpreter records the same
+    CoverageMap blocks = covered(ExecutionMode::BLOCK);
+    CoverageMap interpreted(1024 * 1024);
+    Interpreter interp;
+    interp.set_coverage(&interpreted);
+    std::istringstream in(kSource);
+    interp.run_stream(in);
+    for (uint32_t pc = 0; pc < 32; pc += 4) {
+        assert(blocks.executed(pc) == map.executed(pc) && interpreted.executed(pc) == map.executed(pc));
+        assert(interpreted.taken(pc) == map.taken(pc) && interpreted.not_taken(pc) == map.not_taken(pc));
+    }
+
+    // Taken to the next instruction is still taken, in both loops
+    const char* next = ".text\nmain:\n    beq $zero, $zero, next\nnext:\n    trap 5\n";
+    CoverageMap stepped(1024 * 1024), interpreted_next(1024 * 1024);
+    ExecutorOptions options;
+    options.coverage = &stepped;
+    std::istringstream image(image_of(next));
+    Executor().run_stream(image, options);
+    interp.set_coverage(&interpreted_next);
+    std::istringstream source(next);
+    interp.run_stream(source);
+    for (const CoverageMap* m : {&stepped, &interpreted_next}) {
+        assert(m->taken(0) && !m->not_taken(0));
+    }
+
+    std::cout << "Coverage recording tests passed!\n";
+}
+
+void test_merge() {
+    DecodedInstruction branch = InstructionUtils::predecode(0x10000001);   // beq $zero, $zero, +4
+    assert(branch.op == Operation::BEQ);
+    DecodedInstruction plain = InstructionUtils::predecode(0x20080001);    // addi $t0, $zero, 1
+
+    // Bits at both ends of the vector part and in the scalar tail
+    CoverageMap a(1100), b(1100);
+    a.record(0, plain, false);
+    a.record(1096, branch, false);
+    b.record(4, plain, false);
+    b.record(1096, branch, true);
+    b.record(2000, plain, false);   // outside the map
+    a.merge(b);
+    assert(a.executed(0) && a.executed(4) && a.executed(1096) && !a.executed(8));
+    assert(a.taken(1096) && a.not_taken(1096));
+
+    std::stringstream file;
+    a.save(file);
+    CoverageMap loaded = CoverageMap::load(file);
+    assert(loaded.memory_size() == 1100);
+    for (uint32_t pc = 0; pc < 1100; pc += 4) {
+        assert(loaded.executed(pc) == a.executed(pc) && loaded.taken(pc) == a.taken(pc));
+    }
+
+    bool threw = false;
+    try {
+        CoverageMap other(2000);
+        a.merge(other);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    threw = false;
+    try {
+        std::istringstream garbage("MIPSRUN1 not coverage");
+        CoverageMap::load(garbage);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Coverage merge tests passed!\n";
+}
+
+void test_report() {
+    Parser parser;
+    ParseResult result = parser.parse_assembly(kSource);
+    CoverageMap map = covered(ExecutionMode::STEP);
+    std::istringstream source(kSource);
+    std::ostringstream report;
+    map.report(report, result.source_lines, source);
+
+    std::string expected =
+        "Instructions: 6 of 7 (85.7%)\n"
+        "Branch directions: 4 of 6 at branches that ran (66.7%)\n"
+        "  -     1: .text\n"
+        "  -     2: main:\n"
+        "  +     3:     addi $t0, $zero, 2\n"
+        "  -     4: loop:\n"
+        "  +     5:     addi $t0, $t0, -1\n"
+        "  +     6:     bne  $t0, $zero, loop\n"
+        "  ~     7:     bne  $t0, $t0, done  [never taken]\n"
+        "  ~     8:     beq  $t0, $zero, done  [never falls through]\n"
+        "  #     9:     addi $t1, $zero, 1\n"
+        "  -    10: done:\n"
+        "  +    11:     trap 5\n";
+    assert(report.str() == expected);
+
+    std::cout << "Coverage report tests passed!\n";
+}
+
+int main() {
+    try {
+        test_recording();
+        test_merge();
+        test_report();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,130 @@
+#include "../include/debug_info.h"
+#include "../include/assembler.h"
+#include "../include/executor.h"
+#include "test_support.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <cassert>
+
+static const char* kSource =
+    ".text\n"
+    "main:\n"
+    "    jal  f\n"
+    "    trap 5\n"
+    "f:\n"
+    "    addi $t0, $zero, 1\n"
+    "inner:\n"
+    "    jr   $ra\n"
+    ".data\n"
+    "msg: .asciiz \"hi\"\n";
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// Assembles kSource into `dir`, returning the binary's path
+static std::string assemble(const std::filesystem::path& dir, bool debug) {
+    std::string source = (dir / "prog.asm").string();
+    std::ofstream(source) << kSource;
+    std::string binary = (dir / (debug ? "debug.bin" : "plain.bin")).string();
+    Assembler assembler;
+    std::vector<uint8_t> bytes = assembler.assemble_file(source);
+    std::ofstream out(binary, std::ios::binary);
+    assembler.write_binary_to_stream(bytes, out);
+    if (debug) assembler.write_debug_section(out, bytes.size());
+    return binary;
+}
+
+void test_lookups() {
+    std::filesystem::path dir = fresh_dir("mips_debug_info");
+    std::string binary = assemble(dir, true);
+    DebugInfo info(binary);
+    assert(info.available());
+
+    auto labels = info.labels();
+    assert(labels.size() == 4 && labels["main"] == 0 && labels["f"] == 8 && labels["inner"] == 12 &&
+           labels["msg"] == 16);
+    assert(info.source() == (dir / "prog.asm").string());
+    assert(info.line_of(0) == 3 && info.line_of(4) == 4 && info.line_of(8) == 6 && info.line_of(12) == 8);
+    assert(info.line_of(16) == 0 && info.line_of(2) == 0);
+
+    std::string source = info.source();
+    assert(info.symbolize(4) == "main+0x4 (" + source + ":4)");
+    assert(info.symbolize(12) == "inner (" + source + ":8)");
+    assert(info.symbolize(17) == "msg+0x1");
+
+    // A plain binary has nothing to look up
+    DebugInfo none(assemble(dir, false));
+    assert(!none.available() && none.labels().empty() && none.symbolize(0).empty());
+
+    // A section that does not add up is reported on first use
+    std::string bytes = read_file(binary);
+    bytes[20] = '\x7f';
+    std::string broken = (dir / "broken.bin").string();
+    std::ofstream(broken, std::ios::binary) << bytes;
+    DebugInfo corrupt(broken);
+    assert(corrupt.available());
+    bool threw = false;
+    try {
+        corrupt.labels();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::filesystem::remove_all(dir);
+    std::cout << "Debug info lookup tests passed!\n";
+}
+
+void test_loading() {
+    std::filesystem::path dir = fresh_dir("mips_debug_load");
+    std::string plain = assemble(dir, false);
+    std::string binary = assemble(dir, true);
+
+    // Loaders stop where the section starts, seekable stream or not
+    std::string bytes = read_file(binary);
+    assert(bytes.size() > read_file(plain).size());
+    assert(DebugInfo::image_end(reinterpret_cast<const uint8_t*>(bytes.data()) + bytes.size() -
+                                DebugInfo::kTrailerSize, bytes.size()) == read_file(plain).size());
+    std::ifstream in(binary, std::ios::binary);
+    ExecutableImage image = read_executable_image(in);
+    assert(std::string(image.bytes.begin(), image.bytes.end()) == read_file(plain));
+
+    // The profiler and the trace name code from the section
+    CallProfiler profiler;
+    DebugInfo symbols(binary);
+    ExecutorOptions options;
+    options.verbose = true;
+    options.symbols = &symbols;
+    options.profiler = &profiler;
+    std::ostringstream trace;
+    std::streambuf* old_out = std::cout.rdbuf(trace.rdbuf());
+    Executor().run_file(binary, options);
+    std::cout.rdbuf(old_out);
+    assert(trace.str().find("[f (" + symbols.source() + ":6)]") != std::string::npos);
+
+    profiler.set_symbols(symbols.labels());
+    std::ostringstream collapsed;
+    profiler.write_collapsed(collapsed);
+    assert(collapsed.str() == "main 2\nmain;f 2\n");
+
+    std::filesystem::remove_all(dir);
+    std::cout << "Debug info loading tests passed!\n";
+}
+
+int main() {
+    try {
+        test_lookups();
+        test_loading();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
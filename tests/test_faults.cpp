@@ -0,0 +1,208 @@
+#include "../include/executor.h"
+#include "../include/interpreter.h"
+#include "../include/lockstep_engine.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+// Raises each cause once, and a load straddling the end of memory; the
+// handler prints "cause:badvaddr " and skips the faulting instruction
+static const char* kHandled =
+    ".text\n"
+    "main:\n"
+    "    addi $a0, $zero, handler\n"
+    "    trap 8\n"
+    "    add  $a0, $v0, $zero\n"
+    "    trap 0\n"
+    "    addi $a0, $zero, 10\n"
+    "    trap 1\n"
+    "    lhi  $t2, $zero, 0xf\n"
+    "    llo  $t2, $zero, 0xfffe\n"
+    "    lw   $t1, 0($t2)\n"
+    "    lhi  $t0, $zero, 0x7fff\n"
+    "    lw   $t1, 4($t0)\n"
+    "    sw   $t1, 0($t0)\n"
+    "    add  $t3, $t0, $t0\n"
+    "    trap 42\n"
+    "    .word 0xfc000000\n"
+    "    addi $a0, $zero, 7\n"
+    "    trap 0\n"
+    "    trap 5\n"
+    "handler:\n"
+    "    add  $a0, $k1, $zero\n"
+    "    trap 0\n"
+    "    addi $a0, $zero, 58\n"
+    "    trap 1\n"
+    "    trap 10\n"
+    "    add  $a0, $k1, $zero\n"
+    "    trap 0\n"
+    "    addi $a0, $zero, 32\n"
+    "    trap 1\n"
+    "    addi $k0, $k0, 4\n"
+    "    trap 9\n";
+
+static const char* kHandledOutput = "-1\n4:1048574 4:2147418116 5:2147418112 12:0 8:0 10:0 7";
+
+// A jump out of memory is a fetch address error at the bad PC
+static const char* kFetch =
+    ".text\n"
+    "main:\n"
+    "    addi $a0, $zero, handler\n"
+    "    trap 8\n"
+    "    lhi  $t0, $zero, 0x7fff\n"
+    "    jalr $t0\n"
+    "    addi $a0, $zero, 7\n"
+    "    trap 0\n"
+    "    trap 5\n"
+    "handler:\n"
+    "    add  $a0, $k1, $zero\n"
+    "    trap 0\n"
+    "    trap 10\n"
+    "    sub  $a0, $k0, $k1\n"
+    "    trap 0\n"
+    "    add  $k0, $ra, $zero\n"
+    "    trap 9\n";
+
+// A fault inside the handler has nobody to go to
+static const char* kNested =
+    ".text\n"
+    "main:\n"
+    "    addi $a0, $zero, handler\n"
+    "    trap 8\n"
+    "    lhi  $t0, $zero, 0x7fff\n"
+    "    lw   $t1, 0($t0)\n"
+    "    trap 5\n"
+    "handler:\n"
+    "    sb   $t1, 0($t0)\n"
+    "    trap 9\n";
+
+// Output, and the error if the run threw
+static std::string execute(const char* source, ExecutionMode mode, MemoryBackend memory, std::string* error) {
+    std::istringstream bin(image_of(source)), in;
+    std::ostringstream out;
+    ExecutorOptions options;
+    options.mode = mode;
+    options.memory = memory;
+    options.input = &in;
+    options.output = &out;
+    try {
+        Executor().run_stream(bin, options);
+    } catch (const std::runtime_error& e) {
+        *error = e.what();
+    }
+    return out.str();
+}
+
+static std::string interpret(const char* source, MemoryBackend memory, std::string* error) {
+    std::istringstream in(source);
+    std::ostringstream out;
+    std::streambuf* old_out = std::cout.rdbuf(out.rdbuf());
+    try {
+        Interpreter().run_stream(in, 100000, memory);
+    } catch (const std::runtime_error& e) {
+        *error = e.what();
+    }
+    std::cout.rdbuf(old_out);
+    return out.str();
+}
+
+void test_state() {
+    machine_state state;
+    InstructionExecutor executor;
+    const DecodedInstruction lw = InstructionUtils::predecode(IInstruction(Opcode::LW, 8, 9, 0));
+    state.write_memory32(0x40, InstructionUtils::encode(IInstruction(Opcode::LW, 8, 9, 0)));
+
+    // Without a vector the state halts on the faulting instruction
+    state.set_pc(0x40);
+    state.set_reg(8, 0x200000);
+    executor.execute(state, lw);
+    assert(state.faulted() && state.get_pc() == 0x40);
+    assert(state.fault().cause == ExceptionCause::ADDRESS_LOAD);
+    assert(state.fault().epc == 0x40 && state.fault().bad_address == 0x200000);
+    assert(InstructionExecutor::fault_message(state) == "Memory access violation in lw instruction");
+    state.clear_fault();
+
+    // With one the handler gets it, and a second fault before eret halts
+    state.set_exception_vector(0x80);
+    executor.execute(state, lw);
+    assert(!state.faulted() && state.get_pc() == 0x80);
+    assert(state.get_register(Register::K0) == 0x40 && state.get_register(Register::K1) == 4);
+    executor.execute(state, lw);
+    assert(state.faulted() && state.get_pc() == 0x80 && state.fault().epc == 0x80);
+    state.clear_fault();
+    state.return_from_exception();
+    assert(state.get_pc() == 0x40);
+
+    // Overflow traps only with a vector
+    const DecodedInstruction add = InstructionUtils::predecode(RInstruction(8, 8, 10, 0, FunctionCode::ADD));
+    state.set_reg(8, 0x7FFFFFFF);
+    executor.execute(state, add);
+    assert(state.get_pc() == 0x80 && state.get_register(Register::K1) == 12 && state.reg(10) == 0);
+    state.return_from_exception();
+    state.set_exception_vector(machine_state::kNoVector);
+    executor.execute(state, add);
+    assert(!state.faulted() && state.reg(10) == 0xFFFFFFFE);
+
+    std::cout << "Fault state tests passed!\n";
+}
+
+void test_handlers() {
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (ExecutionMode mode : {ExecutionMode::STEP, ExecutionMode::BLOCK}) {
+            std::string error;
+            assert(execute(kHandled, mode, memory, &error) == kHandledOutput && error.empty());
+            assert(execute(kFetch, mode, memory, &error) == "407" && error.empty());
+            assert(execute(kNested, mode, memory, &error).empty());
+            assert(error == "Memory access violation in sb instruction");
+        }
+        std::string error;
+        assert(interpret(kHandled, memory, &error) == kHandledOutput && error.empty());
+        assert(interpret(kFetch, memory, &error) == "407" && error.empty());
+        interpret(kNested, memory, &error);
+        assert(error == "Memory access violation in sb instruction");
+    }
+
+    // A lane that installs a vector leaves its group and still ends like Executor
+    std::string image = image_of(kHandled);
+    LockstepEngine engine(std::vector<uint8_t>(image.begin(), image.end()), 0);
+    for (const LaneResult& lane : engine.run({"", "", ""}, 100000, 8)) {
+        assert(lane.output == kHandledOutput && lane.error.empty());
+    }
+
+    std::cout << "Guest exception handler tests passed!\n";
+}
+
+void test_unhandled() {
+    // Without a vector the errors are the ones the tools always reported
+    const char* fetch = ".text\nmain:\n    lhi $t0, $zero, 0x7fff\n    jr $t0\n";
+    const char* syscall = ".text\nmain:\n    trap 42\n";
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (ExecutionMode mode : {ExecutionMode::STEP, ExecutionMode::BLOCK}) {
+            std::string error;
+            execute(fetch, mode, memory, &error);
+            assert(error == "Executor error: PC out of bounds at 2147418112");
+            execute(syscall, mode, memory, &error);
+            assert(error == "Unknown syscall: 42");
+        }
+        std::string error;
+        interpret(fetch, memory, &error);
+        assert(error == "Interpreter error: PC points outside valid memory at address 2147418112");
+    }
+
+    std::cout << "Unhandled fault tests passed!\n";
+}
+
+int main() {
+    try {
+        test_state();
+        test_handlers();
+        test_unhandled();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,270 @@
+#include "../include/hart_group.h"
+#include "../include/executor.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+// Runs `image` with stdout captured; returns the output, or the error
+static std::string run(const std::string& image, size_t harts, MemoryBackend memory = MemoryBackend::CHECKED,
+                       uint64_t max_steps = 1000000ULL) {
+    ExecutorOptions options;
+    options.harts = harts;
+    options.memory = memory;
+    options.max_steps = max_steps;
+    std::istringstream in(image);
+    std::ostringstream out;
+    std::streambuf* old_out = std::cout.rdbuf(out.rdbuf());
+    std::string result;
+    try {
+        Executor().run_stream(in, options);
+        result = out.str();
+    } catch (const std::exception& e) {
+        result = std::string("error: ") + e.what();
+    }
+    std::cout.rdbuf(old_out);
+    return result;
+}
+
+void test_ll_sc() {
+    Parser parser;
+    ParseResult parsed = parser.parse_assembly(R"(
+        .text
+        main:
+            ll   $t1, 8($t0)
+            sc   $t2, -4($t0)
+            sync
+    )");
+    std::vector<uint8_t> bin = parser.generate_binary(parsed);
+    auto word = [&](size_t i) {
+        return bin[i] | (bin[i + 1] << 8) | (bin[i + 2] << 16) | (static_cast<uint32_t>(bin[i + 3]) << 24);
+    };
+    assert(word(0) == InstructionUtils::encode(IInstruction(Opcode::LL, 8, 9, 8)));
+    assert(word(4) == InstructionUtils::encode(IInstruction(Opcode::SC, 8, 10, 0xFFFC)));
+    assert(word(8) == InstructionUtils::encode(RInstruction(0, 0, 0, 0, FunctionCode::SYNC)));
+    assert(InstructionUtils::get_name(InstructionUtils::predecode(word(8))) == "sync");
+
+    machine_state state;
+    InstructionExecutor executor;
+    const DecodedInstruction ll = InstructionUtils::predecode(IInstruction(Opcode::LL, 8, 9, 0));
+    const DecodedInstruction sc = InstructionUtils::predecode(IInstruction(Opcode::SC, 8, 10, 0));
+    state.set_reg(8, 0x100);
+    state.write_memory32(0x100, 41);
+
+    // sc without a link fails and leaves memory alone
+    state.set_reg(10, 7);
+    executor.execute(state, sc);
+    assert(state.reg(10) == 0 && state.read_memory32(0x100) == 41);
+
+    // ll then sc stores, and the link is gone afterwards
+    executor.execute(state, ll);
+    assert(state.reg(9) == 41);
+    state.set_reg(10, 42);
+    executor.execute(state, sc);
+    assert(state.reg(10) == 1 && state.read_memory32(0x100) == 42);
+    state.set_reg(10, 43);
+    executor.execute(state, sc);
+    assert(state.reg(10) == 0 && state.read_memory32(0x100) == 42);
+
+    // A changed word breaks the link
+    executor.execute(state, ll);
+    state.write_memory32(0x100, 50);
+    state.set_reg(10, 51);
+    executor.execute(state, sc);
+    assert(state.reg(10) == 0 && state.read_memory32(0x100) == 50);
+
+    // Misaligned and out-of-range words are address errors
+    auto fault = [&](const DecodedInstruction& d) {
+        executor.execute(state, d);
+        assert(state.faulted());
+        state.clear_fault();
+        return state.fault();
+    };
+    state.set_reg(8, 0x102);
+    GuestFault unaligned = fault(ll);
+    assert(unaligned.cause == ExceptionCause::ADDRESS_LOAD && unaligned.bad_address == 0x102);
+    state.set_reg(8, static_cast<uint32_t>(state.get_memory_size()));
+    GuestFault outside = fault(sc);
+    assert(outside.cause == ExceptionCause::ADDRESS_STORE && outside.bad_address == state.get_memory_size());
+
+    // Without a HartGroup there is nobody to spawn or join
+    state.set_reg(2, 0);
+    executor.execute(state, InstructionUtils::predecode(IInstruction(Opcode::TRAP, 0, 0, 6)));
+    assert(state.reg(2) == UINT32_MAX);
+    executor.execute(state, InstructionUtils::predecode(IInstruction(Opcode::TRAP, 0, 0, 7)));
+    assert(state.reg(2) == UINT32_MAX);
+
+    std::cout << "LL/SC tests passed!\n";
+}
+
+void test_shared_counter() {
+    // Four harts bump one counter with ll/sc; main joins them and sums their results
+    std::string image = image_of(R"(
+        .data
+        counter: .word 0
+        ids:     .word 0, 0, 0, 0
+        .text
+        main:
+            addi $s0, $zero, 0
+            addi $s1, $zero, 4
+        spawn_loop:
+            addi $a0, $zero, worker
+            add  $a1, $s0, $zero
+            sll  $t0, $s0, 10
+            addi $a2, $t0, 20000
+            trap 6
+            sll  $t1, $s0, 2
+            addi $t1, $t1, ids
+            sw   $v0, 0($t1)
+            addi $s0, $s0, 1
+            bne  $s0, $s1, spawn_loop
+            addi $s0, $zero, 0
+            addi $s2, $zero, 0
+        join_loop:
+            sll  $t1, $s0, 2
+            addi $t1, $t1, ids
+            lw   $a0, 0($t1)
+            trap 7
+            add  $s2, $s2, $v0
+            addi $s0, $s0, 1
+            bne  $s0, $s1, join_loop
+            addi $t0, $zero, counter
+            lw   $a0, 0($t0)
+            trap 0
+            addi $a0, $zero, 32
+            trap 1
+            add  $a0, $s2, $zero
+            trap 0
+            trap 5
+        worker:
+            addi $t0, $zero, counter
+            addi $t2, $zero, 2000
+        inc:
+            ll   $t1, 0($t0)
+            addi $t1, $t1, 1
+            sc   $t1, 0($t0)
+            beq  $t1, $zero, inc
+            addi $t2, $t2, -1
+            bne  $t2, $zero, inc
+            sync
+            add  $s7, $a0, $zero
+            addi $a0, $zero, 119
+            trap 1
+            addi $v0, $s7, 100
+            trap 5
+    )");
+
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (int round = 0; round < 3; ++round) {
+            assert(run(image, 5, memory) == "wwww8000 406");
+        }
+    }
+
+    // With one hart every spawn fails; joining -1 fails too
+    assert(run(image, 1) == "0 -4");
+
+    std::cout << "Shared counter tests passed!\n";
+}
+
+void test_hart_slots() {
+    // Two harts: a second spawn fails until the first worker is joined
+    std::string image = image_of(R"(
+        .text
+        main:
+            addi $a0, $zero, worker
+            trap 6
+            add  $s0, $v0, $zero
+            addi $a0, $zero, worker
+            trap 6
+            add  $a0, $v0, $zero
+            trap 0
+            add  $a0, $s0, $zero
+            trap 7
+            add  $a0, $v0, $zero
+            trap 0
+            add  $a0, $s0, $zero
+            trap 7
+            add  $a0, $v0, $zero
+            trap 0
+            addi $a0, $zero, worker
+            trap 6
+            add  $a0, $v0, $zero
+            trap 0
+            trap 5
+        worker:
+            addi $v0, $zero, 9
+            trap 5
+    )");
+    // spawn -> 1 (not printed), spawn -> -1, join 1 -> 9, join 1 again -> -1, spawn reuses 1
+    assert(run(image, 2) == "-19-11");
+
+    std::cout << "Hart slot tests passed!\n";
+}
+
+void test_hart_failures() {
+    // A fault in any hart stops the run with that hart's error
+    std::string fault = image_of(R"(
+        .text
+        main:
+            addi $a0, $zero, worker
+            trap 6
+        spin:
+            addi $t9, $t9, 1
+            j    spin
+        worker:
+            lhi  $t0, $zero, 0x7fff
+            lw   $t1, 0($t0)
+            trap 5
+    )");
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        assert(run(fault, 2, memory, 100000000ULL) == "error: Memory access violation in lw instruction");
+    }
+
+    // Every hart waiting in join: 2 waits for 1, 1 for 2, main for 1
+    std::string deadlock = image_of(R"(
+        .data
+        partner: .word 0
+        .text
+        main:
+            addi $a0, $zero, first
+            trap 6
+            add  $s0, $v0, $zero
+            addi $a0, $zero, second
+            add  $a1, $s0, $zero
+            trap 6
+            addi $t0, $zero, partner
+            sw   $v0, 0($t0)
+            add  $a0, $s0, $zero
+            trap 7
+            trap 5
+        first:
+            addi $t0, $zero, partner
+        wait:
+            lw   $a0, 0($t0)
+            beq  $a0, $zero, wait
+            trap 7
+            trap 5
+        second:
+            trap 7
+            trap 5
+    )");
+    assert(run(deadlock, 3, MemoryBackend::CHECKED, 100000000ULL) ==
+           "error: Executor error: every running hart is waiting in join");
+
+    std::cout << "Hart failure tests passed!\n";
+}
+
+int main() {
+    try {
+        test_ll_sc();
+        test_shared_counter();
+        test_hart_slots();
+        test_hart_failures();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
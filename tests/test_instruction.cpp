@@ -1,5 +1,6 @@
 #include "../include/instruction.h"
 #include "../include/machine_state.h"
+#include "../include/decode_batch.h"
 #include <iostream>
 #include <cassert>
 #include <sstream>
@@ -161,6 +162,97 @@ void test_encoding_decoding() {
     std::cout << "Encoding/decoding tests passed!\n";
 }
 
+// Test the compact decoded form
+void test_predecode() {
+    std::cout << "Testing compact predecoding...\n";
+    
+    // Immediates are pre-extended / pre-shifted
+    DecodedInstruction addi = InstructionUtils::predecode(
+        InstructionUtils::encode(IInstruction(Opcode::ADDI, 5, 6, 0xFFFE)));
+    assert(addi.op == Operation::ADDI);
+    assert(addi.rs == 5 && addi.rt == 6);
+    assert(addi.imm == 0xFFFFFFFE);
+    
+    DecodedInstruction ori = InstructionUtils::predecode(
+        InstructionUtils::encode(IInstruction(Opcode::ORI, 1, 2, 0x8001)));
+    assert(ori.imm == 0x8001);
+    
+    DecodedInstruction lhi = InstructionUtils::predecode(
+        InstructionUtils::encode(IInstruction(Opcode::LHI, 0, 2, 0x1234)));
+    assert(lhi.imm == 0x12340000);
+    
+    DecodedInstruction bne = InstructionUtils::predecode(
+        InstructionUtils::encode(IInstruction(Opcode::BNE, 1, 2, 0xFFFF)));
+    assert(bne.imm == 0xFFFFFFFC);
+    
+    DecodedInstruction jal = InstructionUtils::predecode(
+        InstructionUtils::encode(JInstruction(Opcode::JAL, 0x123456)));
+    assert(jal.op == Operation::JAL);
+    assert(jal.imm == (0x123456u << 2));
+    
+    DecodedInstruction sra = InstructionUtils::predecode(
+        InstructionUtils::encode(RInstruction(0, 3, 4, 7, FunctionCode::SRA)));
+    assert(sra.op == Operation::SRA && sra.rt == 3 && sra.rd == 4 && sra.imm == 7);
+    
+    // Names and formats agree with the variant form for every word we can build
+    for (uint32_t opcode = 0; opcode < 64; ++opcode) {
+        for (uint32_t funct = 0; funct < 64; ++funct) {
+            uint32_t word = (opcode << 26) | (3u << 21) | (4u << 16) | (5u << 11) | (2u << 6) | funct;
+            Instruction full = InstructionUtils::decode(word);
+            DecodedInstruction compact = InstructionUtils::predecode(word);
+            assert(InstructionUtils::get_name(full) == InstructionUtils::get_name(compact));
+            assert(InstructionUtils::get_format(full) == InstructionUtils::get_format(compact));
+            DecodedInstruction from_variant = InstructionUtils::predecode(full);
+            assert(from_variant.op == compact.op && from_variant.imm == compact.imm);
+        }
+    }
+    
+    // Unknown encodings are reported as unsupported
+    machine_state state;
+    InstructionExecutor executor;
+    state.write_memory32(0, 0x3F << 26);
+    executor.execute(state, InstructionUtils::predecode(0x3F << 26));
+    assert(state.faulted() && state.fault().cause == ExceptionCause::RESERVED_INSTRUCTION);
+    assert(InstructionExecutor::fault_message(state) == "Unsupported instruction: unknown_i");
+    
+    std::cout << "Predecode tests passed!\n";
+}
+
+// Test batch decoding against the scalar decoder on every backend
+void test_batch_decode() {
+    std::cout << "Testing batch decoding...\n";
+    
+    std::vector<uint32_t> words;
+    uint32_t x = 0x12345678;
+    for (int i = 0; i < 1003; ++i) {  // not a multiple of the vector width
+        x = x * 1664525u + 1013904223u;
+        words.push_back(x);
+    }
+    words.push_back(InstructionUtils::encode(RInstruction(1, 2, 3, 4, FunctionCode::SRA)));
+    words.push_back(InstructionUtils::encode(IInstruction(Opcode::LW, 29, 8, 0xFFF0)));
+    
+    for (DecodeBackend backend : {DecodeBackend::SCALAR, DecodeBackend::SSE2, DecodeBackend::AVX2}) {
+        if (!BatchDecoder::backend_available(backend)) continue;
+        DecodedFields f;
+        BatchDecoder::decode(words.data(), words.size(), f, backend);
+        assert(f.size() == words.size());
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint32_t w = words[i];
+            assert(f.op[i] == static_cast<uint8_t>(InstructionUtils::predecode(w).op));
+            assert(f.opcode[i] == (w >> 26));
+            assert(f.rs[i] == ((w >> 21) & 0x1F));
+            assert(f.rt[i] == ((w >> 16) & 0x1F));
+            assert(f.rd[i] == ((w >> 11) & 0x1F));
+            assert(f.shamt[i] == ((w >> 6) & 0x1F));
+            assert(f.funct[i] == (w & 0x3F));
+            assert(f.imm[i] == InstructionUtils::sign_extend_16(w & 0xFFFF));
+        }
+        std::cout << "  backend " << BatchDecoder::backend_name(backend) << " ok\n";
+    }
+    
+    std::cout << "Batch decode tests passed!\n";
+}
+
 // Test R-type instruction execution
 void test_r_type_execution() {
     std::cout << "Testing R-type instruction execution...\n";
@@ -513,6 +605,8 @@ int main() {
         test_instruction_names();
         test_extension_utilities();
         test_encoding_decoding();
+        test_predecode();
+        test_batch_decode();
         test_r_type_execution();
         test_i_type_execution();
         test_memory_instructions();
@@ -0,0 +1,242 @@
+#include "../include/lockstep_engine.h"
+#include "../include/executor.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+// What Executor does with `input` on stdin: output, error, final state
+struct Reference {
+    std::string output;
+    std::string error;
+    machine_state state;
+};
+
+static Reference run_executor(const std::vector<uint8_t>& image, const std::string& input, uint64_t max_steps) {
+    Reference ref;
+    std::istringstream in(input);
+    std::ostringstream out;
+    std::streambuf* old_in = std::cin.rdbuf(in.rdbuf());
+    std::streambuf* old_out = std::cout.rdbuf(out.rdbuf());
+
+    // Executor leaves no state behind on errors; rerun the loop by hand to keep it
+    ref.state.load_memory(0, image);
+    InstructionExecutor executor;
+    uint64_t steps = 0;
+    try {
+        while (true) {
+            if (steps++ >= max_steps) {
+                throw std::runtime_error("Executor error: reached maximum instruction count limit.");
+            }
+            uint32_t pc = ref.state.get_pc();
+            if (!ref.state.is_valid_address(pc, 4)) {
+                ref.state.raise_exception(ExceptionCause::ADDRESS_LOAD, pc);
+            } else {
+                DecodedInstruction instr = InstructionUtils::predecode(ref.state.read_memory32(pc));
+                bool exit = instr.op == Operation::TRAP && instr.imm == 5;
+                executor.execute(ref.state, instr);
+                if (ref.state.get_pc() == pc && !ref.state.faulted()) ref.state.increment_pc();
+                if (exit) break;
+            }
+            if (ref.state.faulted()) {
+                throw std::runtime_error(InstructionExecutor::fault_message(ref.state));
+            }
+        }
+    } catch (const std::exception& e) {
+        ref.error = e.what();
+    }
+
+    std::cin.rdbuf(old_in);
+    std::cout.rdbuf(old_out);
+    ref.output = out.str();
+    return ref;
+}
+
+// Every backend and group width agrees with Executor on every input
+static void compare_all(const std::string& source, const std::vector<std::string>& inputs,
+                        uint64_t max_steps = 100000ULL) {
+    std::vector<uint8_t> image = assemble(source);
+
+    // The executor itself, through run_stream, must agree with the reference loop
+    {
+        std::string bytes(image.begin(), image.end());
+        std::istringstream bin(bytes);
+        std::istringstream in(inputs[0]);
+        std::ostringstream out;
+        std::streambuf* old_in = std::cin.rdbuf(in.rdbuf());
+        std::streambuf* old_out = std::cout.rdbuf(out.rdbuf());
+        std::string error;
+        try { Executor().run_stream(bin, max_steps); } catch (const std::exception& e) { error = e.what(); }
+        std::cin.rdbuf(old_in);
+        std::cout.rdbuf(old_out);
+        Reference ref = run_executor(image, inputs[0], max_steps);
+        assert(out.str() == ref.output && error == ref.error);
+    }
+
+    std::vector<Reference> refs;
+    for (const std::string& input : inputs) refs.push_back(run_executor(image, input, max_steps));
+
+    for (DecodeBackend backend : {DecodeBackend::SCALAR, DecodeBackend::SSE2, DecodeBackend::AVX2}) {
+        for (size_t lanes : {8, 16}) {
+            LockstepEngine engine(image, 0);
+            engine.set_backend(backend);
+            // Twice, so the second run starts from reused lane memory
+            for (int round = 0; round < 2; ++round) {
+                std::vector<LaneResult> results = engine.run(inputs, max_steps, lanes);
+                assert(results.size() == inputs.size());
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    const LaneResult& r = results[i];
+                    const Reference& ref = refs[i];
+                    assert(r.output == ref.output);
+                    assert(r.error == ref.error);
+                    GuestFault fault = ref.state.faulted() ? ref.state.fault() : GuestFault();
+                    assert(r.fault.cause == fault.cause && r.fault.epc == fault.epc &&
+                           r.fault.bad_address == fault.bad_address);
+                    for (unsigned reg = 0; reg < 32; ++reg) assert(r.registers[reg] == ref.state.reg(reg));
+                    assert(r.pc == ref.state.get_pc());
+                    assert(r.hi == ref.state.get_hi());
+                    assert(r.lo == ref.state.get_lo());
+                }
+            }
+        }
+    }
+}
+
+void test_divergent_loops() {
+    // Collatz step counts: every input takes a different path; 0 never ends
+    std::vector<std::string> inputs;
+    for (int n = 0; n < 40; ++n) inputs.push_back(std::to_string(n * 7 + 1) + "\n");
+    inputs[5] = "0\n";
+    compare_all(R"(
+        .text
+        main:
+            trap 3
+            add  $s0, $v0, $zero
+            addi $s1, $zero, 0
+            addi $t9, $zero, 1
+        loop:
+            beq  $s0, $t9, done
+            andi $t0, $s0, 1
+            beq  $t0, $zero, even
+            sll  $t1, $s0, 1
+            add  $s0, $s0, $t1
+            addi $s0, $s0, 1
+            j    next
+        even:
+            sra  $s0, $s0, 1
+        next:
+            addi $s1, $s1, 1
+            j    loop
+        done:
+            add  $a0, $s1, $zero
+            trap 0
+            addi $a0, $zero, 10
+            trap 1
+            trap 5
+    )", inputs, 20000);
+
+    std::cout << "Divergent loop tests passed!\n";
+}
+
+void test_lane_faults_and_calls() {
+    // Input picks a jump-table entry; some entries fault, one is invalid
+    std::vector<std::string> inputs;
+    for (int n = 0; n < 21; ++n) inputs.push_back(std::to_string(n % 7) + " " + std::to_string(n * 1000003) + "\n");
+    compare_all(R"(
+        .data
+        table: .word case0, case1, case2, case3, case4, case5, case6
+        msg:   .asciiz "lane "
+        .text
+        main:
+            addi $a0, $zero, msg
+            trap 2
+            trap 3
+            add  $s0, $v0, $zero
+            trap 3
+            add  $s1, $v0, $zero
+            sll  $t0, $s0, 2
+            addi $t0, $t0, table
+            lw   $t1, 0($t0)
+            jalr $t1
+            add  $a0, $v0, $zero
+            trap 0
+            trap 5
+        case0:
+            mult $s1, $s1
+            mfhi $v0
+            jr   $ra
+        case1:
+            div  $s1, $s0
+            mflo $v0
+            mfhi $t2
+            add  $v0, $v0, $t2
+            jr   $ra
+        case2:
+            lhi  $t2, $zero, 0x7fff
+            lw   $v0, 0($t2)
+            jr   $ra
+        case3:
+            sb   $s1, 0($zero)
+            lbu  $v0, 0($zero)
+            lh   $t3, 0($zero)
+            jr   $ra
+        case4:
+            .word 0xfc000000
+        case5:
+            add  $a0, $s1, $zero
+            trap 99
+        case6:
+            srav $v0, $s1, $s0
+            sltu $t4, $v0, $s1
+            nor  $v0, $v0, $t4
+            jr   $ra
+    )", inputs);
+
+    std::cout << "Lane fault and call tests passed!\n";
+}
+
+void test_lane_self_modifying_code() {
+    // Odd inputs patch the loop body, so lanes hold different code at one PC
+    std::vector<std::string> inputs;
+    for (int n = 0; n < 12; ++n) inputs.push_back(std::to_string(n) + "\n");
+    uint32_t patched = InstructionUtils::encode(IInstruction(Opcode::ADDI, 8, 8, 100));
+    std::ostringstream src;
+    src << R"(
+        .text
+        main:
+            trap 3
+            andi $t7, $v0, 1
+            addi $t1, $zero, 3
+            llo  $t5, $zero, )" << (patched & 0xFFFF) << R"(
+            lhi  $t5, $zero, )" << (patched >> 16) << R"(
+            addi $t6, $zero, patch
+        loop:
+        patch:
+            addi $t0, $t0, 1
+            beq  $t7, $zero, skip
+            sw   $t5, 0($t6)
+        skip:
+            addi $t1, $t1, -1
+            bne  $t1, $zero, loop
+            add  $a0, $t0, $zero
+            trap 0
+            trap 5
+    )";
+    compare_all(src.str(), inputs);
+
+    std::cout << "Lane self-modifying code tests passed!\n";
+}
+
+int main() {
+    try {
+        test_divergent_loops();
+        test_lane_faults_and_calls();
+        test_lane_self_modifying_code();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
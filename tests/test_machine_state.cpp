@@ -1,4 +1,5 @@
 #include "../include/machine_state.h"
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 
@@ -22,6 +23,23 @@ void test_registers() {
     std::cout << "Register tests passed!\n";
 }
 
+void test_raw_registers() {
+    machine_state ms;
+
+    // Raw indices alias the enum-based API
+    ms.set_reg(8, 7);
+    assert(ms.get_register(Register::T0) == 7);
+    ms.set_register(Register::S0, 11);
+    assert(ms.reg(16) == 11);
+
+    // Writes to slot 0 are discarded
+    ms.set_reg(0, 0xDEADBEEF);
+    assert(ms.reg(0) == 0);
+    assert(ms.get_register(Register::ZERO) == 0);
+
+    std::cout << "Raw register tests passed!\n";
+}
+
 void test_memory() {
     machine_state ms;
     
@@ -102,13 +120,107 @@ void test_pc() {
     std::cout << "PC tests passed!\n";
 }
 
+void test_guarded_memory() {
+    if (!GuestMemory::backend_available(MemoryBackend::GUARDED)) {
+        std::cout << "Guarded memory unavailable, skipped\n";
+        return;
+    }
+    machine_state ms(1000, MemoryBackend::GUARDED);
+    assert(ms.memory_backend() == MemoryBackend::GUARDED);
+    assert(!ms.bounds_checked());
+    assert(ms.get_memory_size() >= 1000);  // rounded up to whole pages
+
+    // Checked and raw accessors see the same bytes
+    ms.write_memory32(0x10, 0xCAFEBABE);
+    assert(ms.load32(0x10) == 0xCAFEBABE);
+    ms.store16(0x20, 0xBEEF);
+    assert(ms.read_memory16(0x20) == 0xBEEF);
+
+    // The checked API still throws past the committed size
+    uint32_t end = static_cast<uint32_t>(ms.get_memory_size());
+    bool caught = false;
+    try {
+        ms.read_memory32(end);
+    } catch (const std::out_of_range&) {
+        caught = true;
+    }
+    assert(caught);
+
+    // Raw accesses past the end fault and are trapped
+    uint32_t fault = 0;
+    uint32_t sink = 0;
+    bool finished = ms.guest_memory().run_trapped([&] { sink = ms.load32(end + 64); }, fault);
+    assert(!finished);
+    assert(fault == end + 64);
+    finished = ms.guest_memory().run_trapped([&] { ms.store8(0xFFFFFFFFu, 1); }, fault);
+    assert(!finished);
+    finished = ms.guest_memory().run_trapped([&] { sink = ms.load32(0x10); }, fault);
+    assert(finished && sink == 0xCAFEBABE);
+
+    // Copies are deep; shrinking and regrowing reads zeros
+    machine_state copy = ms;
+    ms.write_memory32(0x10, 0);
+    assert(copy.read_memory32(0x10) == 0xCAFEBABE);
+    copy.resize_memory(0);
+    copy.resize_memory(4096);
+    assert(copy.read_memory32(0x10) == 0);
+
+    std::cout << "Guarded memory tests passed!\n";
+}
+
+void test_shared_image() {
+    std::vector<uint8_t> bytes(10000);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 7);
+    SharedImage image(bytes);
+    assert(image.size() == bytes.size() && std::equal(bytes.begin(), bytes.end(), image.data()));
+
+    for (MemoryBackend backend : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        machine_state a(1 << 16, backend);
+        machine_state b(1 << 16, backend);
+        a.map_image(image);
+        b.map_image(image);
+        for (uint32_t addr : {0u, 4097u, 9999u}) {
+            assert(a.read_memory8(addr) == bytes[addr] && b.read_memory8(addr) == bytes[addr]);
+        }
+        assert(a.read_memory32(10000) == 0);
+
+        // Stores stay private to one instance
+        a.write_memory32(4096, 0xDEADBEEF);
+        b.store8(9999, 1);
+        assert(a.read_memory32(4096) == 0xDEADBEEF && b.read_memory32(4096) != 0xDEADBEEF);
+        assert(a.read_memory8(9999) == bytes[9999] && b.read_memory8(9999) == 1);
+        assert(std::equal(bytes.begin(), bytes.end(), image.data()));
+
+        // Copies keep the stores; shrinking drops the image like any other bytes
+        machine_state copy = a;
+        assert(copy.read_memory32(4096) == 0xDEADBEEF && copy.read_memory8(5) == bytes[5]);
+        a.resize_memory(0);
+        a.resize_memory(1 << 16);
+        assert(a.read_memory32(0) == 0 && a.read_memory32(4096) == 0);
+
+        bool caught = false;
+        machine_state small(100, backend);
+        try {
+            small.map_image(image);
+        } catch (const std::out_of_range&) {
+            caught = true;
+        }
+        assert(caught || small.get_memory_size() >= image.size());
+    }
+
+    std::cout << "Shared image tests passed!\n";
+}
+
 int main() {
     try {
         test_registers();
+        test_raw_registers();
         test_memory();
         test_endianness();
         test_bounds_and_resize__checking();
         test_pc();
+        test_guarded_memory();
+        test_shared_image();
         
         std::cout << "All tests passed!\n";
         return 0;
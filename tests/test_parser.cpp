@@ -103,6 +103,66 @@ int main() {
         assert(found_arr && "arr .word directive not parsed as expected");
         assert(found_msg && "msg .asciiz directive not parsed as expected");
 
+        // First-pass section sizes: 5 instructions, then 12 + 3 data bytes
+        assert(res.text_size == 20u && res.data_size == 15u);
+
+        // Emitting into guest memory lays out the same bytes as the vector
+        ParseResult mixed = parser.parse_assembly(std::string(R"(
+            .data
+                b: .byte 1, 2, 3
+                h: .half 0x1234
+                .align 2
+                w: .word main, 0xdeadbeef
+                s: .ascii "ab"
+                .space 5
+                f: .float 1.5
+                d: .double -2.25
+            .text
+            main:
+                addi $t0, $zero, w
+                trap 5
+        )"));
+        std::vector<uint8_t> bin = parser.generate_binary(mixed);
+        machine_state state(bin.size() + 8);
+        for (uint32_t a = 0; a < state.get_memory_size(); ++a) assert(state.read_memory8(a) == 0);
+        MemoryEmitter emitter(state);
+        parser.generate_binary(mixed, emitter);
+        assert(emitter.size() == bin.size());
+        for (uint32_t a = 0; a < bin.size(); ++a) assert(state.read_memory8(a) == bin[a]);
+        assert(state.read_memory32(bin.size()) == 0 && state.read_memory32(bin.size() + 4) == 0);
+
+        // An image that does not fit is refused
+        machine_state small(bin.size() - 1);
+        MemoryEmitter cramped(small);
+        bool threw = false;
+        try {
+            parser.generate_binary(mixed, cramped);
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        assert(threw);
+
+        // Branch offsets count words from the branch itself, as InstructionExecutor applies them
+        ParseResult branches = parser.parse_assembly(std::string(R"(
+            .text
+            main:
+                beq  $t0, $t1, ahead
+                bne  $t0, $t1, main
+                blez $t0, ahead
+                bgtz $t0, main
+            ahead:
+                beq  $t0, $t1, ahead
+        )"));
+        const int16_t expected_offsets[] = {4, -1, 2, -3, 0};
+        size_t branch = 0;
+        for (auto &pl : branches.lines) {
+            if (!std::holds_alternative<Instruction>(pl)) continue;
+            IInstruction i = std::get<IInstruction>(std::get<Instruction>(pl));
+            assert(branch < 5 && static_cast<int16_t>(i.immediate) == expected_offsets[branch]);
+            ++branch;
+        }
+        assert(branch == 5 && "every branch encoded");
+
         std::cout << "Parser tests passed.\n";
         return 0;
     } catch (const std::exception &e) {
@@ -0,0 +1,140 @@
+#include "../include/pipeline_model.h"
+#include "../include/executor.h"
+#include "../include/result_cache.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+// Runs `source` under a fresh model with `predictor`
+static std::unique_ptr<PipelineModel> timed(const std::string& source, const std::string& predictor = "static",
+                                            ExecutionMode mode = ExecutionMode::STEP) {
+    std::string image = image_of(source);
+    auto model = std::make_unique<PipelineModel>(PipelineConfig(), BranchPredictor::create(predictor));
+    ExecutorOptions options;
+    options.mode = mode;
+    options.timing = model.get();
+    assert(!ResultCache::cacheable(options));
+    std::istringstream in(image);
+    Executor().run_stream(in, options);
+    return model;
+}
+
+void test_hazards() {
+    // Only the add right after a load of its operand waits; store data is forwarded
+    auto loads = timed(R"(
+        .text
+        main:
+            lw   $t0, 0($zero)
+            add  $t1, $t0, $t0
+            lw   $t2, 4($zero)
+            addi $t3, $zero, 1
+            add  $t4, $t2, $t2
+            lw   $t5, 8($zero)
+            sw   $t5, 12($zero)
+            lw   $zero, 16($zero)
+            add  $t6, $zero, $zero
+            trap 5
+    )");
+    assert(loads->instructions() == 10);
+    assert(loads->stalls(PipelineModel::LOAD_USE) == 1 && loads->total_stalls() == 1);
+    assert(loads->cycles() == 10 + 1 + 4);
+    assert(loads->pc_timing().at(4).stalls[PipelineModel::LOAD_USE] == 1);
+
+    // mflo waits out the multiply, mfhi the divide that follows it
+    auto hilo = timed(R"(
+        .text
+        main:
+            addi $t0, $zero, 7
+            mult $t0, $t0
+            mflo $t1
+            div  $t1, $t0
+            mfhi $t2
+            trap 5
+    )");
+    PipelineConfig config;
+    assert(hilo->pc_timing().at(8).stalls[PipelineModel::HILO] == config.mult_latency - 1);
+    assert(hilo->pc_timing().at(16).stalls[PipelineModel::HILO] == config.div_latency - 1);
+    assert(hilo->stalls(PipelineModel::HILO) == config.mult_latency + config.div_latency - 2);
+
+    std::cout << "Pipeline hazard tests passed!\n";
+}
+
+static std::string counted_loop(int iterations) {
+    return R"(
+        .text
+        main:
+            addi $t0, $zero, )" + std::to_string(iterations) + R"(
+        loop:
+            addi $t0, $t0, -1
+            bne  $t0, $zero, loop
+            jal  f
+            trap 5
+        f:
+            jr   $ra
+    )";
+}
+
+void test_branches() {
+    PipelineConfig config;
+    auto fixed = timed(counted_loop(10), "static");
+    assert(fixed->branches() == 10 && fixed->mispredictions() == 1);
+    assert(fixed->stalls(PipelineModel::MISPREDICT) == config.mispredict_penalty);
+    assert(fixed->stalls(PipelineModel::JUMP) == config.jump_penalty + config.indirect_penalty);
+    assert(fixed->instructions() == 1 + 2 * 10 + 3);
+    assert(fixed->cycles() == fixed->instructions() + 4 + config.mispredict_penalty + config.jump_penalty +
+                              config.indirect_penalty);
+
+    // Weakly not taken to start: wrong on the first and the last iteration
+    auto counters = timed(counted_loop(10), "2bit");
+    assert(counters->mispredictions() == 2);
+    assert(counters->pc_timing().at(8).stalls[PipelineModel::MISPREDICT] == 2 * config.mispredict_penalty);
+
+    // Taken to the next instruction is still taken: a forward miss for static
+    auto next = timed(R"(
+        .text
+        main:
+            beq  $zero, $zero, next
+        next:
+            bne  $zero, $zero, last
+        last:
+            trap 5
+    )", "static");
+    assert(next->branches() == 2 && next->mispredictions() == 1);
+    assert(next->pc_timing().at(0).stalls[PipelineModel::MISPREDICT] == config.mispredict_penalty);
+
+    // gshare learns once the history saturates
+    auto gshare = timed(counted_loop(100), "gshare");
+    assert(gshare->branches() == 100 && gshare->mispredictions() < 20);
+
+    // Block mode is stepped while a model is attached
+    auto blocks = timed(counted_loop(10), "static", ExecutionMode::BLOCK);
+    assert(blocks->cycles() == fixed->cycles());
+
+    bool threw = false;
+    try {
+        BranchPredictor::create("oracle");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::ostringstream report;
+    fixed->report(report);
+    assert(report.str().find("Branches (static): 10, mispredicted 1 (10.00%)") != std::string::npos);
+
+    std::cout << "Pipeline branch tests passed!\n";
+}
+
+int main() {
+    try {
+        test_hazards();
+        test_branches();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
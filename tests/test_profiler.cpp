@@ -0,0 +1,181 @@
+#include "../include/call_profiler.h"
+#include "../include/executor.h"
+#include "../include/interpreter.h"
+#include "../include/result_cache.h"
+#include "../include/parser.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+// Runs `source` on the executor under `profiler`, named by the source's labels
+static void profiled(const std::string& source, CallProfiler& profiler,
+                     MemoryBackend memory = MemoryBackend::CHECKED, ExecutionMode mode = ExecutionMode::STEP) {
+    Parser parser;
+    ParseResult result = parser.parse_assembly(source);
+    std::vector<uint8_t> bin = parser.generate_binary(result);
+    std::string image(bin.begin(), bin.end());
+    profiler.set_symbols(result.labels);
+    ExecutorOptions options;
+    options.memory = memory;
+    options.mode = mode;
+    options.profiler = &profiler;
+    assert(!ResultCache::cacheable(options));
+    std::istringstream in(image);
+    Executor().run_stream(in, options);
+}
+
+static std::string collapsed(const CallProfiler& profiler) {
+    std::ostringstream out;
+    profiler.write_collapsed(out);
+    return out.str();
+}
+
+static const CallProfiler::FunctionProfile& function(const std::vector<CallProfiler::FunctionProfile>& all,
+                                                     const std::string& name) {
+    for (const auto& f : all) {
+        if (f.name == name) return f;
+    }
+    throw std::runtime_error("no profile for " + name);
+}
+
+static const char* kNested = R"(
+    .text
+    main:
+        jal  f
+        jal  f
+        trap 5
+    f:
+        add  $t1, $ra, $zero
+        jal  g
+        add  $ra, $t1, $zero
+        jr   $ra
+    g:
+        addi $t0, $zero, 1
+        jr   $ra
+)";
+
+void test_nested_calls() {
+    // A call is charged to the caller, the jr $ra to the callee
+    CallProfiler profiler;
+    profiled(kNested, profiler);
+    assert(collapsed(profiler) == "main 3\nmain;f 8\nmain;f;g 4\n");
+
+    auto all = profiler.functions();
+    assert(all.size() == 3 && all[0].name == "main");
+    assert(function(all, "main").inclusive == 15 && function(all, "main").exclusive == 3);
+    assert(function(all, "f").calls == 2 && function(all, "f").inclusive == 12 && function(all, "f").exclusive == 8);
+    assert(function(all, "g").calls == 2 && function(all, "g").inclusive == 4);
+
+    // Block mode steps while profiling, and runs add up
+    profiled(kNested, profiler, MemoryBackend::CHECKED, ExecutionMode::BLOCK);
+    assert(collapsed(profiler) == "main 6\nmain;f 16\nmain;f;g 8\n");
+    assert(function(profiler.functions(), "main").calls == 2);
+
+    std::ostringstream report;
+    profiler.report(report);
+    assert(report.str().find("Function profile (30 instructions):") != std::string::npos);
+
+    // Unnamed entry points print as addresses
+    CallProfiler anonymous;
+    assert(anonymous.name_of(0x24) == "0x00000024");
+
+    std::cout << "Nested call tests passed!\n";
+}
+
+void test_recursion() {
+    CallProfiler profiler;
+    profiled(R"(
+        .text
+        main:
+            addi $sp, $zero, 4096
+            addi $a0, $zero, 3
+            jal  r
+            trap 5
+        r:
+            addi $sp, $sp, -4
+            sw   $ra, 0($sp)
+            beq  $a0, $zero, done
+            addi $a0, $a0, -1
+            jal  r
+        done:
+            lw   $ra, 0($sp)
+            addi $sp, $sp, 4
+            jr   $ra
+    )", profiler);
+    assert(collapsed(profiler) == "main 4\nmain;r 8\nmain;r;r 8\nmain;r;r;r 8\nmain;r;r;r;r 6\n");
+
+    // Nested activations of r are counted once in its inclusive total
+    auto all = profiler.functions();
+    assert(function(all, "r").calls == 4);
+    assert(function(all, "r").inclusive == 30 && function(all, "r").exclusive == 30);
+    assert(function(all, "main").inclusive == 34);
+
+    std::cout << "Recursion tests passed!\n";
+}
+
+void test_unmatched_returns() {
+    // A jr $ra to an address no frame returns to stays in the callee
+    CallProfiler profiler;
+    profiled(R"(
+        .text
+        main:
+            jal  f
+            addi $t0, $zero, 1
+            trap 5
+        f:
+            addi $ra, $ra, 4
+            jr   $ra
+    )", profiler);
+    assert(collapsed(profiler) == "main 1\nmain;f 3\n");
+
+    // A faulting run is closed with what it retired
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        CallProfiler faulted;
+        bool threw = false;
+        try {
+            profiled(R"(
+                .text
+                main:
+                    jal  f
+                    trap 5
+                f:
+                    addi $t0, $zero, -4
+                    lw   $t1, 0($t0)
+                    jr   $ra
+            )", faulted, memory);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+        assert(collapsed(faulted) == "main 1\nmain;f 2\n");
+    }
+
+    std::cout << "Unmatched return tests passed!\n";
+}
+
+void test_interpreter() {
+    // The interpreter names functions by the labels it assembled
+    CallProfiler profiler;
+    Interpreter interp;
+    interp.set_profiler(&profiler);
+    std::istringstream in(kNested);
+    interp.run_stream(in);
+    assert(collapsed(profiler) == "main 3\nmain;f 8\nmain;f;g 4\n");
+
+    std::cout << "Interpreter profile tests passed!\n";
+}
+
+int main() {
+    try {
+        test_nested_calls();
+        test_recursion();
+        test_unmatched_returns();
+        test_interpreter();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,111 @@
+#include "../include/executor.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <cassert>
+#include <cstring>
+
+// Sums a table it first rewrites, then patches its own loop body
+static const char* kPatching = R"(
+    .data
+    table: .word 1, 2, 3, 4, 5, 6, 7, 8
+    .text
+    main:
+        addi $t0, $zero, table
+        addi $t1, $zero, 8
+    scale:
+        lw   $t2, 0($t0)
+        sll  $t2, $t2, 2
+        sw   $t2, 0($t0)
+        addi $t0, $t0, 4
+        addi $t1, $t1, -1
+        bne  $t1, $zero, scale
+        addi $t6, $zero, patch
+        lw   $t5, 0($t6)
+        addi $t0, $zero, table
+        addi $t1, $zero, 8
+    sum:
+        lw   $t2, 0($t0)
+    patch:
+        add  $s0, $s0, $t2
+        sw   $t4, 0($t6)
+        addi $t0, $t0, 4
+        addi $t1, $t1, -1
+        bne  $t1, $zero, sum
+        trap 5
+)";
+
+void test_decode() {
+    std::istringstream in(image_of(kPatching));
+    std::shared_ptr<const Program> program = Program::load(in);
+    const SharedImage& image = program->image();
+    const uint8_t* bytes = image.data();
+    assert(image.size() % 4 == 0 && image.size() > 0);
+
+    // Loaded words come from the table; anything else is decoded on the spot
+    uint32_t nop = InstructionUtils::encode(RInstruction(0, 0, 0, 0, FunctionCode::ADD));
+    uint32_t first = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    DecodedInstruction addi = program->decode(0, first);
+    assert(addi.op == Operation::ADDI && addi.rt == 8);
+    assert(program->decode(0, nop).op == Operation::ADD);
+    assert(program->decode(1, first).op == Operation::ADDI);
+    assert(program->decode(static_cast<uint32_t>(image.size()), first).op == Operation::ADDI);
+
+    std::cout << "Program decode tests passed!\n";
+}
+
+void test_concurrent_runs() {
+    std::string image = image_of(kPatching);
+    uint32_t table = label(kPatching, "table");
+    std::istringstream in(image);
+    std::shared_ptr<const Program> program = Program::load(in);
+
+    // The sum sees the scaled table once, then $t4 (zero) replaces the add
+    std::istringstream again(image);
+    machine_state expected = Executor().run_stream(again);
+    assert(expected.reg(16) == 4);
+
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        for (ExecutionMode mode : {ExecutionMode::STEP, ExecutionMode::BLOCK}) {
+            ExecutorOptions options;
+            options.memory = memory;
+            options.mode = mode;
+            std::vector<std::thread> threads;
+            std::vector<uint32_t> sums(8), tables(8);
+            for (size_t t = 0; t < 8; ++t) {
+                threads.emplace_back([&, t] {
+                    machine_state state = Executor().run(*program, options);
+                    sums[t] = state.reg(16);
+                    tables[t] = state.read_memory32(table + 4);
+                });
+            }
+            for (std::thread& thread : threads) thread.join();
+            for (size_t t = 0; t < 8; ++t) {
+                assert(sums[t] == expected.reg(16));
+                assert(tables[t] == 8);
+            }
+        }
+    }
+
+    // Runs never change the program they share
+    std::istringstream fresh(image);
+    std::shared_ptr<const Program> reloaded = Program::load(fresh);
+    assert(reloaded->image().size() == program->image().size());
+    assert(std::memcmp(reloaded->image().data(), program->image().data(), program->image().size()) == 0);
+
+    std::cout << "Concurrent run tests passed!\n";
+}
+
+int main() {
+    try {
+        test_decode();
+        test_concurrent_runs();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
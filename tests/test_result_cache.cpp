@@ -0,0 +1,162 @@
+#include "../include/result_cache.h"
+#include "../include/xxhash64.h"
+#include "test_support.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+static bool same(const RunRecord& a, const RunRecord& b) {
+    return a.output == b.output && a.error == b.error && a.registers == b.registers &&
+           a.pc == b.pc && a.hi == b.hi && a.lo == b.lo;
+}
+
+void test_xxhash64() {
+    // Reference digests
+    assert(XXHash64::hash("", 0) == 0xEF46DB3751D8E999ULL);
+    assert(XXHash64::hash("a", 1) == 0xD24EC4F1A98C6E5BULL);
+    assert(XXHash64::hash("abc", 3) == 0x44BC2CF5AD770999ULL);
+    const char* text = "Nobody inspects the spammish repetition";
+    assert(XXHash64::hash(text, std::strlen(text)) == 0xFBCEA83C8A378BF1ULL);
+
+    // Feeding in pieces gives the one-shot digest
+    std::string bytes;
+    for (int i = 0; i < 1000; ++i) bytes.push_back(static_cast<char>(i * 31 + 7));
+    for (size_t piece : {1, 3, 8, 31, 32, 33, 999}) {
+        XXHash64 h(42);
+        for (size_t at = 0; at < bytes.size(); at += piece) h.update(bytes.substr(at, piece));
+        assert(h.digest() == XXHash64::hash(bytes.data(), bytes.size(), 42));
+    }
+    assert(XXHash64::hash(bytes.data(), bytes.size(), 1) != XXHash64::hash(bytes.data(), bytes.size(), 2));
+
+    std::cout << "XXH64 tests passed!\n";
+}
+
+static const char* kEcho = R"(
+    .text
+    main:
+        trap 3
+        add  $s0, $v0, $zero
+        mult $s0, $s0
+        add  $a0, $s0, $s0
+        trap 0
+        beq  $s0, $zero, fault
+        trap 5
+    fault:
+        lhi  $t0, $zero, 0x7fff
+        lw   $t1, 0($t0)
+)";
+
+void test_keys() {
+    Program program(ExecutableImage{assemble(kEcho)});
+    ExecutorOptions options;
+    ResultCache::Key base = ResultCache::key(program, "5\n", options);
+
+    ResultCache::Key again = ResultCache::key(program, "5\n", options);
+    assert(again.name == base.name && again.check == base.check);
+    assert(ResultCache::key(program, "6\n", options).name != base.name);
+
+    // Options that change the result change the key; the engine does not
+    ExecutorOptions steps = options;
+    steps.max_steps = 3;
+    assert(ResultCache::key(program, "5\n", steps).name != base.name);
+    ExecutorOptions start = options;
+    start.start_address = 4;
+    assert(ResultCache::key(program, "5\n", start).name != base.name);
+    ExecutorOptions engine = options;
+    engine.mode = ExecutionMode::BLOCK;
+    engine.memory = MemoryBackend::GUARDED;
+    assert(ResultCache::key(program, "5\n", engine).name == base.name);
+
+    ExecutorOptions traced = options;
+    traced.verbose = true;
+    ExecutorOptions threaded = options;
+    threaded.harts = 2;
+    assert(ResultCache::cacheable(options));
+    assert(!ResultCache::cacheable(traced) && !ResultCache::cacheable(threaded));
+
+    std::cout << "Result key tests passed!\n";
+}
+
+void test_replay() {
+    std::filesystem::path dir = fresh_dir("mips_result_cache_test");
+    ResultCache cache(dir.string());
+    Program program(ExecutableImage{assemble(kEcho)});
+    ExecutorOptions options;
+
+    for (const char* input : {"21\n", "0\n"}) {
+        bool hit = true;
+        RunRecord first = cache.run(program, input, options, &hit);
+        assert(!hit);
+        RunRecord second = cache.run(program, input, options, &hit);
+        assert(hit && same(first, second));
+    }
+
+    RunRecord ok = cache.run(program, "21\n", options);
+    assert(ok.output == "42" && !ok.failed());
+    assert(ok.registers[16] == 21 && ok.lo == 441 && ok.hi == 0);
+    RunRecord fault = cache.run(program, "0\n", options);
+    assert(fault.output == "0" && fault.error == "Memory access violation in lw instruction");
+    assert(fault.registers[16] == 0);
+
+    // A damaged entry is a miss and gets rewritten
+    ResultCache::Key key = ResultCache::key(program, "21\n", options);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.run", static_cast<unsigned long long>(key.name));
+    std::filesystem::path entry = dir / name;
+    assert(std::filesystem::exists(entry));
+    std::filesystem::resize_file(entry, std::filesystem::file_size(entry) - 1);
+    RunRecord probe;
+    assert(!cache.lookup(key, probe));
+    bool hit = true;
+    assert(same(cache.run(program, "21\n", options, &hit), ok) && !hit);
+    assert(cache.lookup(key, probe) && same(probe, ok));
+
+    // Another check digest under the same name is a collision, not a hit
+    ResultCache::Key collided = key;
+    collided.check ^= 1;
+    assert(!cache.lookup(collided, probe));
+
+    // Uncacheable runs still execute, and leave nothing behind
+    ExecutorOptions threaded = options;
+    threaded.harts = 2;
+    size_t entries = std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator());
+    assert(same(cache.run(program, "21\n", threaded, &hit), ok) && !hit);
+    assert(std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()) ==
+           static_cast<std::ptrdiff_t>(entries));
+
+    std::filesystem::remove_all(dir);
+    std::cout << "Result replay tests passed!\n";
+}
+
+void test_injected_streams() {
+    // Executor reads and writes the given streams instead of cin/cout
+    Program program(ExecutableImage{assemble(kEcho)});
+    std::istringstream in("4\n");
+    std::ostringstream out;
+    ExecutorOptions options;
+    options.input = &in;
+    options.output = &out;
+    machine_state state = Executor().run(program, options);
+    assert(out.str() == "8" && state.reg(16) == 4);
+
+    std::cout << "Injected stream tests passed!\n";
+}
+
+int main() {
+    try {
+        test_xxhash64();
+        test_keys();
+        test_replay();
+        test_injected_streams();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,185 @@
+#include "../include/guest_scheduler.h"
+#include "../include/executor.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+// Executor's output with `input` on stdin, or its error
+static std::string run_executor(const std::vector<uint8_t>& image, const std::string& input, uint64_t max_steps) {
+    std::string bytes(image.begin(), image.end());
+    std::istringstream bin(bytes);
+    std::istringstream in(input);
+    std::ostringstream out;
+    std::streambuf* old_in = std::cin.rdbuf(in.rdbuf());
+    std::streambuf* old_out = std::cout.rdbuf(out.rdbuf());
+    std::string result;
+    try {
+        Executor().run_stream(bin, max_steps);
+        result = out.str();
+    } catch (const std::exception& e) {
+        result = out.str() + "error: " + e.what();
+    }
+    std::cin.rdbuf(old_in);
+    std::cout.rdbuf(old_out);
+    return result;
+}
+
+static std::string outcome(const GuestResult& r) {
+    return r.error.empty() ? r.output : r.output + "error: " + r.error;
+}
+
+// Sums integers until 0, echoing a prompt character before each read
+static const char* kSum = R"(
+    .text
+    main:
+        addi $s0, $zero, 0
+    loop:
+        addi $a0, $zero, 62
+        trap 1
+        trap 3
+        beq  $v0, $zero, done
+        add  $s0, $s0, $v0
+        j    loop
+    done:
+        trap 4
+        add  $a0, $v0, $zero
+        trap 0
+        addi $a0, $zero, 32
+        trap 1
+        add  $a0, $s0, $zero
+        trap 0
+        trap 5
+)";
+
+void test_input_in_pieces() {
+    std::vector<uint8_t> image = assemble(kSum);
+    GuestScheduler scheduler(2, 50);
+
+    // Numbers split mid-token must not be read early
+    const size_t count = 200;
+    std::vector<uint64_t> ids;
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < count; ++i) {
+        ids.push_back(scheduler.submit(image, 0));
+        inputs.push_back(std::to_string(i * 37) + " -" + std::to_string(i) + "\n12 0x");
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& input = inputs[i];
+        for (size_t at = 0; at < input.size(); at += 3) scheduler.feed(ids[i], input.substr(at, 3));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        GuestResult result = scheduler.wait(ids[i]);
+        assert(outcome(result) == run_executor(image, inputs[i], 100000ULL));
+    }
+    assert(scheduler.waiting_for_input() == 0);
+
+    std::cout << "Input in pieces tests passed!\n";
+}
+
+void test_parked_guests() {
+    std::vector<uint8_t> image = assemble(kSum);
+    GuestScheduler scheduler(1, 1000);
+
+    // Guests with no input park instead of holding the only thread
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < 50; ++i) ids.push_back(scheduler.submit(image, 0));
+    while (scheduler.waiting_for_input() < ids.size()) std::this_thread::yield();
+    for (uint64_t id : ids) {
+        while (true) {
+            std::string prompt = scheduler.take_output(id);
+            if (!prompt.empty()) {
+                assert(prompt == ">");
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < ids.size(); ++i) {
+        scheduler.feed(ids[i], std::to_string(i) + " 0\nz");
+        GuestResult result = scheduler.wait(ids[i]);
+        assert(result.error.empty());
+        assert(result.output == ">10 " + std::to_string(i));
+    }
+
+    // An incomplete number keeps the guest parked; closing the input ends it like EOF
+    uint64_t echo = scheduler.submit(assemble(R"(
+        .text
+        main:
+            trap 3
+            add  $a0, $v0, $zero
+            trap 0
+            trap 5
+    )"), 0);
+    scheduler.feed(echo, "-5");
+    while (scheduler.waiting_for_input() < 2) std::this_thread::yield();
+    assert(scheduler.take_output(echo).empty());
+    scheduler.close_input(echo);
+    assert(outcome(scheduler.wait(echo)) == "-5");
+
+    // Waited-for ids are gone
+    scheduler.feed(ids[0], "0\n");
+    assert(scheduler.wait(ids[0]).output == "10 0");
+    bool threw = false;
+    try {
+        scheduler.feed(ids[0], "1");
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Parked guest tests passed!\n";
+}
+
+void test_time_slicing() {
+    // A guest that never reads shares one thread with interactive ones
+    std::vector<uint8_t> spin = assemble(R"(
+        .text
+        main:
+            addi $t0, $t0, 1
+            j    main
+    )");
+    std::vector<uint8_t> image = assemble(kSum);
+    GuestScheduler scheduler(1, 100);
+
+    uint64_t busy = scheduler.submit(spin, 0, 20000000ULL);
+    uint64_t interactive = scheduler.submit(image, 0);
+    scheduler.feed(interactive, "40 2 0 !");
+    GuestResult result = scheduler.wait(interactive);
+    assert(result.output == ">>>32 42");
+
+    GuestResult spun = scheduler.wait(busy);
+    assert(spun.error == "Executor error: reached maximum instruction count limit.");
+    assert(spun.steps == 20000000ULL);
+
+    // Faults end the guest with Executor's error and keep what it printed
+    std::vector<uint8_t> fault = assemble(R"(
+        .text
+        main:
+            addi $a0, $zero, 7
+            trap 0
+            trap 3
+            lhi  $t0, $zero, 0x7fff
+            lw   $t1, 0($t0)
+            trap 5
+    )");
+    uint64_t id = scheduler.submit(fault, 0);
+    scheduler.feed(id, "1\n");
+    assert(outcome(scheduler.wait(id)) == run_executor(fault, "1\n", 100000ULL));
+
+    std::cout << "Time slicing tests passed!\n";
+}
+
+int main() {
+    try {
+        test_input_in_pieces();
+        test_parked_guests();
+        test_time_slicing();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
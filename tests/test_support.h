@@ -0,0 +1,42 @@
+#pragma once
+
+// Fixtures the tests share: images assembled in memory and scratch directories
+
+#include "../include/executor.h"
+#include "../include/parser.h"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// The image Parser generates for `source`, without a header
+inline std::vector<uint8_t> assemble(const std::string& source) {
+    Parser parser;
+    return parser.generate_binary(parser.parse_assembly(source));
+}
+
+// The same image as a string, for an istringstream
+inline std::string image_of(const std::string& source) {
+    std::vector<uint8_t> bin = assemble(source);
+    return std::string(bin.begin(), bin.end());
+}
+
+inline std::shared_ptr<const Program> program_of(const std::string& source) {
+    ExecutableImage image;
+    image.bytes = assemble(source);
+    return std::make_shared<const Program>(std::move(image));
+}
+
+inline uint32_t label(const std::string& source, const std::string& name) {
+    return Parser().parse_assembly(source).labels.at(name);
+}
+
+// An empty directory under the temp directory, private to this process
+inline std::filesystem::path fresh_dir(const std::string& name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                                (name + "_" + std::to_string(getpid()));
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
@@ -0,0 +1,225 @@
+#include "../include/vm.h"
+#include "test_support.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <cstring>
+
+// Sums 1..10 into $s0, storing each partial sum to `sums`, then prints it
+static const char* kSum =
+    ".data\n"
+    "sums: .space 40\n"
+    ".text\n"
+    "main:\n"
+    "    addi $t0, $zero, 1\n"
+    "    addi $t1, $zero, 11\n"
+    "    addi $t2, $zero, sums\n"
+    "loop:\n"
+    "    add  $s0, $s0, $t0\n"
+    "    sw   $s0, 0($t2)\n"
+    "    addi $t2, $t2, 4\n"
+    "    addi $t0, $t0, 1\n"
+    "    bne  $t0, $t1, loop\n"
+    "done:\n"
+    "    add  $a0, $s0, $zero\n"
+    "    trap 0\n"
+    "    trap 5\n";
+
+void test_slices() {
+    auto program = program_of(kSum);
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        std::ostringstream out;
+        VmOptions options;
+        options.memory = memory;
+        options.output = &out;
+        Vm vm(options);
+        assert(!vm.loaded());
+        vm.load(program);
+
+        // Bounded slices resume where the last one stopped
+        assert(vm.step() == RunStop::STEP_LIMIT && vm.steps() == 1 && vm.pc() == 4);
+        assert(vm.step(2) == RunStop::STEP_LIMIT && vm.steps() == 3);
+        uint64_t slices = 0;
+        RunStop stop;
+        while ((stop = vm.step(7)) == RunStop::STEP_LIMIT) ++slices;
+        assert(stop == RunStop::EXITED && vm.exited());
+        assert(vm.steps() == 3 + 5 * 10 + 3 && slices == 7);
+        assert(out.str() == "55");
+
+        // Done until the next load
+        assert(vm.step(100) == RunStop::EXITED && vm.steps() == 56);
+        vm.load(program);
+        assert(!vm.exited() && vm.steps() == 0 && vm.reg(Register::S0) == 0);
+    }
+
+    std::cout << "Vm slice tests passed!\n";
+}
+
+void test_run_until() {
+    auto program = program_of(kSum);
+    uint32_t loop = label(kSum, "loop");
+    uint32_t done = label(kSum, "done");
+    std::ostringstream out;
+    VmOptions options;
+    options.output = &out;
+    Vm vm(options);
+    vm.load(program);
+
+    // Each call stops in front of the loop head again, one iteration on
+    assert(vm.run_until(loop) == RunStop::REACHED && vm.steps() == 3);
+    for (uint32_t i = 1; i <= 3; ++i) {
+        assert(vm.run_until(loop) == RunStop::REACHED);
+        assert(vm.pc() == loop && vm.reg(Register::S0) == i * (i + 1) / 2);
+    }
+
+    // A condition on the state, then a target never reached within budget
+    assert(vm.run_until([](const machine_state& s) { return s.reg(16) > 30; }) == RunStop::REACHED);
+    assert(vm.reg(Register::S0) == 36);
+    assert(vm.run_until(0x1000, 10) == RunStop::STEP_LIMIT);
+    assert(vm.run_until(done) == RunStop::REACHED && vm.reg(Register::S0) == 55);
+    assert(vm.run_until(loop) == RunStop::EXITED && out.str() == "55");
+
+    std::cout << "Vm run_until tests passed!\n";
+}
+
+void test_views() {
+    auto program = program_of(kSum);
+    uint32_t sums = label(kSum, "sums");
+    uint32_t loop = label(kSum, "loop");
+    std::ostringstream out;
+    VmOptions options;
+    options.output = &out;
+    options.memory_pages = 4;
+    Vm vm(options);
+    vm.load(program);
+    assert(vm.memory_size() == 4 * kGuestPageSize);
+
+    // The views alias the guest: they see each change without copying
+    const std::array<uint32_t, 32>& regs = vm.registers();
+    const uint8_t* bytes = vm.memory(sums, 40);
+    vm.run_until(loop);
+    vm.run_until(loop);
+    assert(regs[16] == 1 && bytes[0] == 1);
+    vm.run_until(loop);
+    uint32_t second;
+    std::memcpy(&second, bytes + 4, 4);
+    assert(second == 3 && regs[16] == 3);
+
+    // Writes go the other way: the guest continues from what the caller set
+    vm.set_reg(Register::S0, 1000);
+    vm.memory(sums, 4)[0] = 0xAB;
+    assert(vm.step(100) == RunStop::EXITED);
+    assert(out.str() == "1052" && bytes[0] == 0xAB);
+
+    bool threw = false;
+    try {
+        vm.memory(4 * kGuestPageSize - 2, 4);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    Vm empty;
+    threw = false;
+    try {
+        empty.step();
+    } catch (const std::runtime_error& e) {
+        threw = std::string(e.what()) == "Vm error: no program loaded";
+    }
+    assert(threw);
+
+    std::cout << "Vm view tests passed!\n";
+}
+
+void test_syscall_hooks() {
+    // trap 42 is no syscall of ours: the host provides it
+    const char* source =
+        ".text\n"
+        "main:\n"
+        "    addi $a0, $zero, 20\n"
+        "    trap 42\n"
+        "    add  $a0, $v0, $zero\n"
+        "    trap 0\n"
+        "    trap 42\n"
+        "    trap 5\n";
+    auto program = program_of(source);
+    for (MemoryBackend memory : {MemoryBackend::CHECKED, MemoryBackend::GUARDED}) {
+        std::ostringstream out;
+        VmOptions options;
+        options.memory = memory;
+        options.output = &out;
+        Vm vm(options);
+
+        // Without the hook it faults as Executor would, and stays put
+        vm.load(program);
+        assert(vm.step(10) == RunStop::FAULTED && vm.faulted() && vm.pc() == 4);
+        assert(vm.fault_message() == "Unknown syscall: 42");
+        assert(vm.step(10) == RunStop::FAULTED && vm.steps() == 2);
+
+        std::vector<uint32_t> calls;
+        std::string printed;
+        vm.on_syscall(42, [&](Vm& v) {
+            calls.push_back(v.reg(Register::A0));
+            v.set_reg(Register::V0, v.reg(Register::A0) * 2 + 2);
+        });
+        vm.on_syscall(0, [&](Vm& v) { printed += std::to_string(v.reg(Register::A0)) + ";"; });
+        bool exit_seen = false;
+        vm.on_syscall(5, [&](Vm&) { exit_seen = true; });
+        vm.load(program);
+        assert(vm.step(3) == RunStop::STEP_LIMIT && calls.size() == 1);
+        assert(vm.step(100) == RunStop::EXITED && exit_seen && vm.steps() == 6);
+        assert(calls == std::vector<uint32_t>({20, 42}) && printed == "42;" && out.str().empty());
+
+        // Removed hooks fall back to the built-in syscalls
+        vm.on_syscall(0, nullptr);
+        vm.on_syscall(5, nullptr);
+        vm.load(program);
+        assert(vm.run_until(16) == RunStop::REACHED && out.str() == "42");
+    }
+
+    std::cout << "Vm syscall hook tests passed!\n";
+}
+
+void test_faults() {
+    // Without an exception vector a fault stops the Vm on the faulting instruction
+    const char* source =
+        ".text\n"
+        "main:\n"
+        "    lhi  $t0, $zero, 0x7fff\n"
+        "    lw   $t1, 0($t0)\n"
+        "    addi $a0, $zero, 7\n"
+        "    trap 0\n"
+        "    trap 5\n";
+    auto program = program_of(source);
+    std::ostringstream out;
+    VmOptions options;
+    options.output = &out;
+    Vm vm(options);
+    vm.load(program);
+    assert(vm.step(100) == RunStop::FAULTED && vm.pc() == 4);
+    assert(vm.state().fault().bad_address == 0x7fff0000);
+    assert(vm.fault_message() == "Memory access violation in lw instruction");
+
+    // The caller can repair the state and resume
+    vm.set_reg(Register::T0, 0);
+    vm.state().clear_fault();
+    assert(vm.step(100) == RunStop::EXITED && out.str() == "7");
+
+    std::cout << "Vm fault tests passed!\n";
+}
+
+int main() {
+    try {
+        test_slices();
+        test_run_until();
+        test_views();
+        test_syscall_hooks();
+        test_faults();
+
+        std::cout << "All tests passed!\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cout << "Test failed: " << e.what() << std::endl;
+        return 1;
+    }
+}